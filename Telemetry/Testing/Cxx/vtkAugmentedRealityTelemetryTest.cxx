@@ -0,0 +1,172 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// Telemetry includes
+#include "vtkAugmentedRealityTelemetry.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const double TOLERANCE = 1e-6;
+
+  //----------------------------------------------------------------------------
+  // Events of the stage lasting 1, 2, ..., count microseconds
+  void RecordEvents(vtkAugmentedRealityTelemetry* telemetry, int stage, int count)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      double startTime = telemetry->GetTime();
+      telemetry->RecordEvent(stage, startTime, startTime + i + 1);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int TestAggregates()
+  {
+    vtkNew<vtkAugmentedRealityTelemetry> telemetry;
+    telemetry->SetAggregationInterval(0.0);
+
+    // Nothing is recorded nor aggregated while disabled
+    telemetry->SetEnabled(false);
+    RecordEvents(telemetry.GetPointer(), vtkAugmentedRealityTelemetry::Ingest, 10);
+    CHECK_BOOL(telemetry->UpdateAggregates(), false);
+    telemetry->SetEnabled(true);
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    CHECK_INT(telemetry->GetStageCount(vtkAugmentedRealityTelemetry::Ingest), 0);
+
+    // Durations in milliseconds, 95th percentile by nearest rank
+    RecordEvents(telemetry.GetPointer(), vtkAugmentedRealityTelemetry::Ingest, 100);
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    CHECK_INT(telemetry->GetStageCount(vtkAugmentedRealityTelemetry::Ingest), 100);
+    CHECK_INT(telemetry->GetStageCount(vtkAugmentedRealityTelemetry::Render), 0);
+    CHECK_DOUBLE_TOLERANCE(telemetry->GetStageMeanTime(vtkAugmentedRealityTelemetry::Ingest), 0.0505, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(telemetry->GetStagePercentileTime(vtkAugmentedRealityTelemetry::Ingest), 0.095, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(telemetry->GetStageMaxTime(vtkAugmentedRealityTelemetry::Ingest), 0.1, TOLERANCE);
+
+    // Each aggregate only holds the events that ended since the previous one
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    CHECK_INT(telemetry->GetStageCount(vtkAugmentedRealityTelemetry::Ingest), 0);
+
+    // Reset drops the buffered events
+    RecordEvents(telemetry.GetPointer(), vtkAugmentedRealityTelemetry::Present, 10);
+    telemetry->Reset();
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    CHECK_INT(telemetry->GetStageCount(vtkAugmentedRealityTelemetry::Present), 0);
+
+    // Events of unknown stages are ignored
+    telemetry->RecordEvent(vtkAugmentedRealityTelemetry::Stage_Last, 0.0, 1.0);
+    telemetry->RecordEvent(-1, 0.0, 1.0);
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    for (int stage = 0; stage < vtkAugmentedRealityTelemetry::Stage_Last; ++stage)
+    {
+      CHECK_INT(telemetry->GetStageCount(stage), 0);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestWrapAround()
+  {
+    vtkNew<vtkAugmentedRealityTelemetry> telemetry;
+    telemetry->SetAggregationInterval(0.0);
+
+    // Once the ring is full the oldest events are overwritten, the newest ones are kept
+    const int bufferSize = vtkAugmentedRealityTelemetry::EventBufferSize;
+    const int count = bufferSize + 1000;
+    RecordEvents(telemetry.GetPointer(), vtkAugmentedRealityTelemetry::Render, count);
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    CHECK_INT(telemetry->GetStageCount(vtkAugmentedRealityTelemetry::Render), bufferSize);
+    CHECK_DOUBLE_TOLERANCE(telemetry->GetStageMeanTime(vtkAugmentedRealityTelemetry::Render),
+      0.5e-3 * (count - bufferSize + 1 + count), TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(telemetry->GetStageMaxTime(vtkAugmentedRealityTelemetry::Render), 1e-3 * count, TOLERANCE);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestThreadBuffers()
+  {
+    vtkNew<vtkAugmentedRealityTelemetry> telemetry;
+    telemetry->SetAggregationInterval(0.0);
+    const int numberOfThreads = 4;
+    const int bufferSize = vtkAugmentedRealityTelemetry::EventBufferSize;
+
+    // Aggregating while the threads record neither loses nor repeats an event
+    std::atomic<int> finishedThreads(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numberOfThreads; ++i)
+    {
+      threads.push_back(std::thread([&telemetry, &finishedThreads, bufferSize]()
+      {
+        RecordEvents(telemetry.GetPointer(), vtkAugmentedRealityTelemetry::PixelConversion, bufferSize / 2);
+        ++finishedThreads;
+      }));
+    }
+    int aggregatedCount = 0;
+    while (finishedThreads < numberOfThreads)
+    {
+      telemetry->UpdateAggregates();
+      aggregatedCount += telemetry->GetStageCount(vtkAugmentedRealityTelemetry::PixelConversion);
+    }
+    for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+    {
+      it->join();
+    }
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    aggregatedCount += telemetry->GetStageCount(vtkAugmentedRealityTelemetry::PixelConversion);
+    CHECK_INT(aggregatedCount, numberOfThreads * (bufferSize / 2));
+
+    // Each thread fills a ring of its own: one shared ring would only keep bufferSize events
+    threads.clear();
+    for (int i = 0; i < numberOfThreads; ++i)
+    {
+      threads.push_back(std::thread([&telemetry, bufferSize]()
+      {
+        RecordEvents(telemetry.GetPointer(), vtkAugmentedRealityTelemetry::Present, bufferSize + 100);
+      }));
+    }
+    for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+    {
+      it->join();
+    }
+    CHECK_BOOL(telemetry->UpdateAggregates(), true);
+    CHECK_INT(telemetry->GetStageCount(vtkAugmentedRealityTelemetry::Present), numberOfThreads * bufferSize);
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkAugmentedRealityTelemetryTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_STD_STRING(vtkAugmentedRealityTelemetry::GetStageAsString(vtkAugmentedRealityTelemetry::PixelConversion), "Pixel conversion");
+  CHECK_STD_STRING(vtkAugmentedRealityTelemetry::GetStageAsString(vtkAugmentedRealityTelemetry::Stage_Last), "Unknown");
+
+  CHECK_EXIT_SUCCESS(TestAggregates());
+  CHECK_EXIT_SUCCESS(TestWrapAround());
+  CHECK_EXIT_SUCCESS(TestThreadBuffers());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,478 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// Telemetry includes
+#include "vtkAugmentedRealityTelemetry.h"
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+  std::atomic<unsigned long long> NextInstanceId(1);
+
+  const char* AggregateColumnNames[] = { "Stage", "Count", "Mean (ms)", "P95 (ms)", "Max (ms)", "Load (%)" };
+  const int NumberOfAggregateColumns = 6;
+
+  //----------------------------------------------------------------------------
+  std::string EscapeJSON(const std::string& text)
+  {
+    std::ostringstream escaped;
+    for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
+    {
+      if (*it == '"' || *it == '\\')
+      {
+        escaped << '\\' << *it;
+      }
+      else if (static_cast<unsigned char>(*it) < 0x20)
+      {
+        escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(*it) << std::dec;
+      }
+      else
+      {
+        escaped << *it;
+      }
+    }
+    return escaped.str();
+  }
+}
+
+//----------------------------------------------------------------------------
+struct vtkAugmentedRealityTelemetry::ThreadBuffer
+{
+  // Fields are atomic so that reading a slot while the writer reuses it is defined, the reader
+  // then drops the copy
+  struct Slot
+  {
+    std::atomic<double> StartTime;
+    std::atomic<double> Duration;
+    std::atomic<int> Stage;
+  };
+
+  // Index of the thread in traces
+  int ThreadIndex;
+  Slot Slots[EventBufferSize];
+  // Number of events ever written, the next one goes to Count % EventBufferSize.
+  // Reserved is bumped before a slot is written, Count once it is complete.
+  std::atomic<unsigned long long> Reserved;
+  std::atomic<unsigned long long> Count;
+  // Number of events already folded into aggregates, and first event dumped in traces.
+  // Only touched under the buffers lock.
+  unsigned long long AggregatedCount;
+  unsigned long long TracedCount;
+
+  ThreadBuffer(int threadIndex)
+    : ThreadIndex(threadIndex)
+    , Reserved(0)
+    , Count(0)
+    , AggregatedCount(0)
+    , TracedCount(0)
+  {
+  }
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkAugmentedRealityTelemetry);
+
+//----------------------------------------------------------------------------
+vtkAugmentedRealityTelemetry::vtkAugmentedRealityTelemetry()
+  : InstanceId(NextInstanceId++)
+  , Origin(std::chrono::steady_clock::now())
+  , Enabled(true)
+  , AggregationInterval(1.0)
+  , LastAggregationTime(0.0)
+{
+  std::fill(this->StageCounts, this->StageCounts + Stage_Last, 0);
+  std::fill(this->StageMeanTimes, this->StageMeanTimes + Stage_Last, 0.0);
+  std::fill(this->StagePercentileTimes, this->StagePercentileTimes + Stage_Last, 0.0);
+  std::fill(this->StageMaxTimes, this->StageMaxTimes + Stage_Last, 0.0);
+  std::fill(this->StageLoads, this->StageLoads + Stage_Last, 0.0);
+}
+
+//----------------------------------------------------------------------------
+vtkAugmentedRealityTelemetry::~vtkAugmentedRealityTelemetry()
+{
+  for (std::vector<ThreadBuffer*>::iterator it = this->Buffers.begin(); it != this->Buffers.end(); ++it)
+  {
+    delete *it;
+  }
+  this->Buffers.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkAugmentedRealityTelemetry::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Name: " << this->Name << std::endl;
+  os << indent << "Enabled: " << (this->Enabled ? "true" : "false") << std::endl;
+  os << indent << "AggregationInterval: " << this->AggregationInterval << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(this->BuffersMutex);
+    os << indent << "Threads: " << this->Buffers.size() << std::endl;
+  }
+  for (int stage = 0; stage < Stage_Last; ++stage)
+  {
+    os << indent << GetStageAsString(stage) << ": " << this->StageCounts[stage] << " events, mean " << this->StageMeanTimes[stage]
+       << " ms, p95 " << this->StagePercentileTimes[stage] << " ms, max " << this->StageMaxTimes[stage]
+       << " ms, load " << this->StageLoads[stage] << "%" << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* vtkAugmentedRealityTelemetry::GetStageAsString(int stage)
+{
+  switch (stage)
+  {
+    case Ingest:
+      return "Ingest";
+    case PixelConversion:
+      return "Pixel conversion";
+    case ProjectionUpdate:
+      return "Projection update";
+    case Render:
+      return "Render";
+    case Present:
+      return "Present";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkAugmentedRealityTelemetry::SetName(const std::string& name)
+{
+  if (name == this->Name)
+  {
+    return;
+  }
+  this->Name = name;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkAugmentedRealityTelemetry::GetName() const
+{
+  return this->Name;
+}
+
+//----------------------------------------------------------------------------
+void vtkAugmentedRealityTelemetry::SetEnabled(bool enabled)
+{
+  if (enabled == this->Enabled)
+  {
+    return;
+  }
+  this->Enabled = enabled;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkAugmentedRealityTelemetry::GetEnabled() const
+{
+  return this->Enabled.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+double vtkAugmentedRealityTelemetry::GetTime() const
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - this->Origin).count();
+}
+
+//----------------------------------------------------------------------------
+vtkAugmentedRealityTelemetry::ThreadBuffer* vtkAugmentedRealityTelemetry::GetThreadBuffer()
+{
+  // Few instances live at a time, a linear search beats a map
+  thread_local std::vector<std::pair<unsigned long long, ThreadBuffer*> > threadBuffers;
+  for (std::vector<std::pair<unsigned long long, ThreadBuffer*> >::iterator it = threadBuffers.begin(); it != threadBuffers.end(); ++it)
+  {
+    if (it->first == this->InstanceId)
+    {
+      return it->second;
+    }
+  }
+
+  // First event of this thread: the only time the recording path takes the lock
+  std::lock_guard<std::mutex> lock(this->BuffersMutex);
+  ThreadBuffer* buffer = new ThreadBuffer(static_cast<int>(this->Buffers.size()));
+  this->Buffers.push_back(buffer);
+  threadBuffers.push_back(std::make_pair(this->InstanceId, buffer));
+  return buffer;
+}
+
+//----------------------------------------------------------------------------
+void vtkAugmentedRealityTelemetry::RecordEvent(int stage, double startTime, double endTime)
+{
+  if (!this->GetEnabled() || stage < 0 || stage >= Stage_Last)
+  {
+    return;
+  }
+
+  ThreadBuffer* buffer = this->GetThreadBuffer();
+  unsigned long long index = buffer->Count.load(std::memory_order_relaxed);
+  buffer->Reserved.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  ThreadBuffer::Slot& slot = buffer->Slots[index % EventBufferSize];
+  slot.StartTime.store(startTime, std::memory_order_relaxed);
+  slot.Duration.store(std::max(endTime - startTime, 0.0), std::memory_order_relaxed);
+  slot.Stage.store(stage, std::memory_order_relaxed);
+  buffer->Count.store(index + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkAugmentedRealityTelemetry::CopyEvents(ThreadBuffer* buffer, unsigned long long first, std::vector<Event>& events)
+{
+  unsigned long long count = buffer->Count.load(std::memory_order_acquire);
+  if (count > EventBufferSize)
+  {
+    first = std::max(first, count - EventBufferSize);
+  }
+  size_t copyStart = events.size();
+  for (unsigned long long index = first; index < count; ++index)
+  {
+    const ThreadBuffer::Slot& slot = buffer->Slots[index % EventBufferSize];
+    Event event;
+    event.StartTime = slot.StartTime.load(std::memory_order_relaxed);
+    event.Duration = slot.Duration.load(std::memory_order_relaxed);
+    event.Stage = slot.Stage.load(std::memory_order_relaxed);
+    events.push_back(event);
+  }
+
+  // The writer never waits: drop the copies of the slots it started reusing in the meantime
+  std::atomic_thread_fence(std::memory_order_acquire);
+  unsigned long long reservedAfterCopy = buffer->Reserved.load(std::memory_order_relaxed);
+  if (reservedAfterCopy > EventBufferSize && reservedAfterCopy - EventBufferSize > first)
+  {
+    unsigned long long overwritten = std::min(reservedAfterCopy - EventBufferSize, count) - first;
+    events.erase(events.begin() + copyStart, events.begin() + copyStart + static_cast<size_t>(overwritten));
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+bool vtkAugmentedRealityTelemetry::UpdateAggregates()
+{
+  double now = this->GetTime();
+  double interval = now - this->LastAggregationTime;
+  if (!this->GetEnabled() || interval < this->AggregationInterval * 1e6)
+  {
+    return false;
+  }
+  this->LastAggregationTime = now;
+
+  std::vector<Event> events;
+  {
+    std::lock_guard<std::mutex> lock(this->BuffersMutex);
+    for (std::vector<ThreadBuffer*>::iterator it = this->Buffers.begin(); it != this->Buffers.end(); ++it)
+    {
+      (*it)->AggregatedCount = CopyEvents(*it, (*it)->AggregatedCount, events);
+    }
+  }
+
+  std::vector<double> durations[Stage_Last];
+  for (std::vector<Event>::iterator it = events.begin(); it != events.end(); ++it)
+  {
+    durations[it->Stage].push_back(it->Duration * 1e-3);
+  }
+  for (int stage = 0; stage < Stage_Last; ++stage)
+  {
+    std::vector<double>& stageDurations = durations[stage];
+    this->StageCounts[stage] = static_cast<int>(stageDurations.size());
+    if (stageDurations.empty())
+    {
+      this->StageMeanTimes[stage] = 0.0;
+      this->StagePercentileTimes[stage] = 0.0;
+      this->StageMaxTimes[stage] = 0.0;
+      this->StageLoads[stage] = 0.0;
+      continue;
+    }
+    double total = 0.0;
+    for (std::vector<double>::iterator it = stageDurations.begin(); it != stageDurations.end(); ++it)
+    {
+      total += *it;
+    }
+    // Nearest rank
+    std::vector<double>::iterator percentile = stageDurations.begin() + (stageDurations.size() * 95 + 99) / 100 - 1;
+    std::nth_element(stageDurations.begin(), percentile, stageDurations.end());
+    this->StageMeanTimes[stage] = total / stageDurations.size();
+    this->StagePercentileTimes[stage] = *percentile;
+    this->StageMaxTimes[stage] = *std::max_element(percentile, stageDurations.end());
+    this->StageLoads[stage] = 100.0 * total / (interval * 1e-3);
+  }
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkAugmentedRealityTelemetry::GetStageCount(int stage)
+{
+  return (stage >= 0 && stage < Stage_Last ? this->StageCounts[stage] : 0);
+}
+
+//----------------------------------------------------------------------------
+double vtkAugmentedRealityTelemetry::GetStageMeanTime(int stage)
+{
+  return (stage >= 0 && stage < Stage_Last ? this->StageMeanTimes[stage] : 0.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkAugmentedRealityTelemetry::GetStagePercentileTime(int stage)
+{
+  return (stage >= 0 && stage < Stage_Last ? this->StagePercentileTimes[stage] : 0.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkAugmentedRealityTelemetry::GetStageMaxTime(int stage)
+{
+  return (stage >= 0 && stage < Stage_Last ? this->StageMaxTimes[stage] : 0.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkAugmentedRealityTelemetry::GetStageLoad(int stage)
+{
+  return (stage >= 0 && stage < Stage_Last ? this->StageLoads[stage] : 0.0);
+}
+
+//----------------------------------------------------------------------------
+void vtkAugmentedRealityTelemetry::WriteAggregates(vtkTable* table)
+{
+  if (table == nullptr)
+  {
+    return;
+  }
+
+  bool hasColumns = (table->GetNumberOfColumns() == NumberOfAggregateColumns);
+  for (int column = 0; hasColumns && column < NumberOfAggregateColumns; ++column)
+  {
+    hasColumns = (table->GetColumnByName(AggregateColumnNames[column]) != nullptr);
+  }
+  if (!hasColumns)
+  {
+    table->Initialize();
+    vtkNew<vtkStringArray> stageColumn;
+    stageColumn->SetName(AggregateColumnNames[0]);
+    table->AddColumn(stageColumn.GetPointer());
+    vtkNew<vtkIntArray> countColumn;
+    countColumn->SetName(AggregateColumnNames[1]);
+    table->AddColumn(countColumn.GetPointer());
+    for (int column = 2; column < NumberOfAggregateColumns; ++column)
+    {
+      vtkNew<vtkDoubleArray> timeColumn;
+      timeColumn->SetName(AggregateColumnNames[column]);
+      table->AddColumn(timeColumn.GetPointer());
+    }
+  }
+
+  table->SetNumberOfRows(Stage_Last);
+  vtkStringArray* stageColumn = vtkStringArray::SafeDownCast(table->GetColumnByName(AggregateColumnNames[0]));
+  vtkIntArray* countColumn = vtkIntArray::SafeDownCast(table->GetColumnByName(AggregateColumnNames[1]));
+  vtkDoubleArray* meanColumn = vtkDoubleArray::SafeDownCast(table->GetColumnByName(AggregateColumnNames[2]));
+  vtkDoubleArray* percentileColumn = vtkDoubleArray::SafeDownCast(table->GetColumnByName(AggregateColumnNames[3]));
+  vtkDoubleArray* maxColumn = vtkDoubleArray::SafeDownCast(table->GetColumnByName(AggregateColumnNames[4]));
+  vtkDoubleArray* loadColumn = vtkDoubleArray::SafeDownCast(table->GetColumnByName(AggregateColumnNames[5]));
+  if (stageColumn == nullptr || countColumn == nullptr || meanColumn == nullptr || percentileColumn == nullptr
+      || maxColumn == nullptr || loadColumn == nullptr)
+  {
+    vtkErrorMacro("WriteAggregates: table columns have unexpected types");
+    return;
+  }
+  for (int stage = 0; stage < Stage_Last; ++stage)
+  {
+    stageColumn->SetValue(stage, GetStageAsString(stage));
+    countColumn->SetValue(stage, this->StageCounts[stage]);
+    meanColumn->SetValue(stage, this->StageMeanTimes[stage]);
+    percentileColumn->SetValue(stage, this->StagePercentileTimes[stage]);
+    maxColumn->SetValue(stage, this->StageMaxTimes[stage]);
+    loadColumn->SetValue(stage, this->StageLoads[stage]);
+  }
+  table->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkAugmentedRealityTelemetry::WriteChromeTrace(const std::string& fileName)
+{
+  std::ofstream file(fileName.c_str(), std::ios::out | std::ios::trunc);
+  if (!file)
+  {
+    vtkErrorMacro("WriteChromeTrace: cannot open " << fileName);
+    return false;
+  }
+
+  std::vector<Event> events;
+  std::vector<int> eventThreads;
+  {
+    std::lock_guard<std::mutex> lock(this->BuffersMutex);
+    for (std::vector<ThreadBuffer*>::iterator it = this->Buffers.begin(); it != this->Buffers.end(); ++it)
+    {
+      CopyEvents(*it, (*it)->TracedCount, events);
+      eventThreads.resize(events.size(), (*it)->ThreadIndex);
+    }
+  }
+
+  std::string processName = EscapeJSON(this->Name.empty() ? std::string(this->GetClassName()) : this->Name);
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+  file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"" << processName << "\"}}";
+  for (size_t i = 0; i < events.size(); ++i)
+  {
+    file << "," << std::endl << "{\"name\":\"" << GetStageAsString(events[i].Stage) << "\",\"cat\":\"" << processName
+         << "\",\"ph\":\"X\",\"ts\":" << events[i].StartTime << ",\"dur\":" << events[i].Duration
+         << ",\"pid\":1,\"tid\":" << eventThreads[i] << "}";
+  }
+  file << std::endl << "]}" << std::endl;
+
+  if (!file)
+  {
+    vtkErrorMacro("WriteChromeTrace: failed to write " << fileName);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkAugmentedRealityTelemetry::Reset()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->BuffersMutex);
+    for (std::vector<ThreadBuffer*>::iterator it = this->Buffers.begin(); it != this->Buffers.end(); ++it)
+    {
+      // Only the owning thread writes the events, the readers skip past them instead
+      (*it)->AggregatedCount = (*it)->Count.load(std::memory_order_acquire);
+      (*it)->TracedCount = (*it)->AggregatedCount;
+    }
+  }
+  std::fill(this->StageCounts, this->StageCounts + Stage_Last, 0);
+  std::fill(this->StageMeanTimes, this->StageMeanTimes + Stage_Last, 0.0);
+  std::fill(this->StagePercentileTimes, this->StagePercentileTimes + Stage_Last, 0.0);
+  std::fill(this->StageMaxTimes, this->StageMaxTimes + Stage_Last, 0.0);
+  std::fill(this->StageLoads, this->StageLoads + Stage_Last, 0.0);
+  this->LastAggregationTime = this->GetTime();
+  this->Modified();
+}
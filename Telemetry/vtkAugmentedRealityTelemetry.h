@@ -0,0 +1,192 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// .NAME vtkAugmentedRealityTelemetry - per-stage timing of the AR pipelines
+// .SECTION Description
+// Records how long each stage of a video pipeline takes (ingest, pixel conversion, projection
+// update, render, present) with little enough overhead to stay on in the operating room. Each thread writes its events into its own ring buffer without locking,
+// older events are overwritten once the buffer is full.
+//
+// Once a second the owner folds the new events into per-stage aggregates (count, mean, 95th
+// percentile, maximum, share of the interval), which it can publish in a table. The events
+// still buffered can be dumped as a Chrome trace, to be opened in chrome://tracing or
+// ui.perfetto.dev.
+//
+// Stages are timed with vtkAugmentedRealityTelemetryScope, or with RecordEvent() when the
+// start and the end of a stage are seen in different callbacks.
+
+#ifndef __vtkAugmentedRealityTelemetry_h
+#define __vtkAugmentedRealityTelemetry_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerAugmentedRealityTelemetryExport.h"
+
+class vtkTable;
+
+/// \ingroup Slicer_QtModules_AugmentedReality
+class VTK_SLICER_AUGMENTEDREALITY_TELEMETRY_EXPORT vtkAugmentedRealityTelemetry : public vtkObject
+{
+public:
+  static vtkAugmentedRealityTelemetry* New();
+  vtkTypeMacro(vtkAugmentedRealityTelemetry, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum Stage
+  {
+    /// A video frame or a pose arrives in the logic
+    Ingest,
+    /// Pixel format conversion, downscaling and undistortion of a frame
+    PixelConversion,
+    /// Projection of the view camera recomputed from the camera intrinsics
+    ProjectionUpdate,
+    /// Render of the view, from the start to the end event of its render window. Includes the
+    /// upload of the video textures, and the pixel conversion when the render pulls the frame.
+    Render,
+    /// A frame or a pose is handed to the view
+    Present,
+    Stage_Last
+  };
+  static const char* GetStageAsString(int stage);
+
+  /// Name of the pipeline, used as the process name in traces
+  void SetName(const std::string& name);
+  const std::string& GetName() const;
+
+  /// Events are recorded only while enabled. On by default.
+  void SetEnabled(bool enabled);
+  bool GetEnabled() const;
+  vtkBooleanMacro(Enabled, bool);
+
+  /// Microseconds elapsed since the telemetry was created, on a steady clock
+  double GetTime() const;
+
+  /// Record a stage that ran from startTime to endTime (GetTime() clock). Can be called from any thread.
+  void RecordEvent(int stage, double startTime, double endTime);
+
+  /// Events kept per thread
+  static const int EventBufferSize = 8192;
+
+  /// Seconds between aggregates, 1 by default
+  vtkSetMacro(AggregationInterval, double);
+  vtkGetMacro(AggregationInterval, double);
+
+  /// Fold the events that ended since the last aggregates into new ones, if enabled and at least
+  /// AggregationInterval elapsed. Returns true if the aggregates were updated.
+  bool UpdateAggregates();
+
+  /// Aggregates of a stage over the last interval: number of events, mean, 95th percentile
+  /// and maximum durations in milliseconds, and share of the interval spent in the stage in percent
+  int GetStageCount(int stage);
+  double GetStageMeanTime(int stage);
+  double GetStagePercentileTime(int stage);
+  double GetStageMaxTime(int stage);
+  double GetStageLoad(int stage);
+
+  /// Write the last aggregates in the table, one row per stage. The columns are created if missing.
+  void WriteAggregates(vtkTable* table);
+
+  /// Write the buffered events as Chrome trace event JSON. Returns false if the file cannot be written.
+  bool WriteChromeTrace(const std::string& fileName);
+
+  /// Drop the buffered events and the aggregates
+  void Reset();
+
+protected:
+  vtkAugmentedRealityTelemetry();
+  virtual ~vtkAugmentedRealityTelemetry();
+
+  struct Event
+  {
+    double StartTime;
+    double Duration;
+    int Stage;
+  };
+
+  /// Ring of the events of one thread. Only that thread writes it.
+  struct ThreadBuffer;
+
+  /// Buffer of the calling thread, created on its first event
+  ThreadBuffer* GetThreadBuffer();
+
+  /// Copy the events of a buffer from index first on, skipping those overwritten while copying.
+  /// Returns the index following the last copied event.
+  static unsigned long long CopyEvents(ThreadBuffer* buffer, unsigned long long first, std::vector<Event>& events);
+
+protected:
+  // Distinguishes instances in the per-thread cache, never reused unlike addresses
+  const unsigned long long InstanceId;
+  const std::chrono::steady_clock::time_point Origin;
+  std::string Name;
+  std::atomic<bool> Enabled;
+
+  std::mutex BuffersMutex;
+  std::vector<ThreadBuffer*> Buffers;
+
+  double AggregationInterval;
+  double LastAggregationTime;
+  int StageCounts[Stage_Last];
+  double StageMeanTimes[Stage_Last];
+  double StagePercentileTimes[Stage_Last];
+  double StageMaxTimes[Stage_Last];
+  double StageLoads[Stage_Last];
+
+private:
+  vtkAugmentedRealityTelemetry(const vtkAugmentedRealityTelemetry&); // Not implemented
+  void operator=(const vtkAugmentedRealityTelemetry&); // Not implemented
+};
+
+/// \ingroup Slicer_QtModules_AugmentedReality
+/// Records one event of a stage spanning the lifetime of the scope. Does nothing if the
+/// telemetry is null or disabled when the scope is entered.
+class vtkAugmentedRealityTelemetryScope
+{
+public:
+  vtkAugmentedRealityTelemetryScope(vtkAugmentedRealityTelemetry* telemetry, int stage)
+    : Telemetry(telemetry != nullptr && telemetry->GetEnabled() ? telemetry : nullptr)
+    , Stage(stage)
+    , StartTime(this->Telemetry != nullptr ? this->Telemetry->GetTime() : 0.0)
+  {
+  }
+
+  ~vtkAugmentedRealityTelemetryScope()
+  {
+    if (this->Telemetry != nullptr)
+    {
+      this->Telemetry->RecordEvent(this->Stage, this->StartTime, this->Telemetry->GetTime());
+    }
+  }
+
+private:
+  vtkAugmentedRealityTelemetry* Telemetry;
+  int Stage;
+  double StartTime;
+
+  vtkAugmentedRealityTelemetryScope(const vtkAugmentedRealityTelemetryScope&); // Not implemented
+  void operator=(const vtkAugmentedRealityTelemetryScope&); // Not implemented
+};
+
+#endif
@@ -17,35 +17,1349 @@
 
 // TrackedScreenAR Logic includes
 #include "vtkSlicerTrackedScreenARLogic.h"
+#include "vtkTrackedScreenARFramePacer.h"
+#include "vtkTrackedScreenARHandEyeCalibration.h"
+#include "vtkTrackedScreenARLatencyMonitor.h"
+#include "vtkTrackedScreenARPixelFormatConverter.h"
+#include "vtkTrackedScreenARPoseBuffer.h"
+#include "vtkTrackedScreenARPosePredictor.h"
+#include "vtkTrackedScreenARProjection.h"
+#include "vtkTrackedScreenARQualityGovernor.h"
+#include "vtkTrackedScreenARSceneLayerPass.h"
+#include "vtkTrackedScreenARSessionPlayer.h"
+#include "vtkTrackedScreenARSessionRecorder.h"
+#include "vtkTrackedScreenARVideoSource.h"
+#include "vtkTrackedScreenARViewBinding.h"
+
+// Telemetry includes
+#include <vtkAugmentedRealityTelemetry.h>
+
+// TrackedScreenAR MRML includes
+#include <vtkMRMLTrackedScreenARParametersNode.h>
 
 // MRML includes
+#include <vtkMRMLCameraNode.h>
+#include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLTableNode.h>
+#include <vtkMRMLTransformNode.h>
+#include <vtkMRMLViewNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// Video cameras include
+#include <vtkMRMLPinholeCameraNode.h>
 
 // VTK includes
+#include <vtkCamera.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
 #include <vtkIntArray.h>
+#include <vtkMatrix3x3.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkRenderer.h>
+#include <vtkRendererCollection.h>
+#include <vtkTexture.h>
+#include <vtkTimerLog.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Intrinsics (fx, fy, cx, cy) followed by the distortion coefficients (k1, k2, p1, p2, k3)
+  void GetLensParameters(vtkMRMLPinholeCameraNode* node, double lensParameters[9])
+  {
+    vtkMatrix3x3* intrinsicMatrix = node->GetIntrinsicMatrix();
+    lensParameters[0] = intrinsicMatrix->GetElement(0, 0);
+    lensParameters[1] = intrinsicMatrix->GetElement(1, 1);
+    lensParameters[2] = intrinsicMatrix->GetElement(0, 2);
+    lensParameters[3] = intrinsicMatrix->GetElement(1, 2);
+    std::fill(lensParameters + 4, lensParameters + 9, 0.0);
+    vtkDoubleArray* coefficients = node->GetDistortionCoefficients();
+    if (coefficients != nullptr)
+    {
+      for (vtkIdType i = 0; i < std::min<vtkIdType>(5, coefficients->GetNumberOfValues()); ++i)
+      {
+        lensParameters[4 + i] = coefficients->GetValue(i);
+      }
+    }
+  }
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerTrackedScreenARLogic);
 
 //----------------------------------------------------------------------------
 vtkSlicerTrackedScreenARLogic::vtkSlicerTrackedScreenARLogic()
+  : ArrivalTimeOverride(-1.0)
+  , SessionRecorder(vtkSmartPointer<vtkTrackedScreenARSessionRecorder>::New())
+  , SessionPlayer(vtkSmartPointer<vtkTrackedScreenARSessionPlayer>::New())
+  , SessionPlaybackStartTime(0.0)
+  , SessionPlaybackPausedTime(0.0)
+  , SessionPlaybackPaused(false)
+  , HandEyeCalibration(vtkSmartPointer<vtkTrackedScreenARHandEyeCalibration>::New())
+  , CalibrationMarkerNode(nullptr)
+  , CalibrationMarkerPoses(vtkSmartPointer<vtkTrackedScreenARPoseBuffer>::New())
+  , Telemetry(vtkSmartPointer<vtkAugmentedRealityTelemetry>::New())
 {
+  this->Telemetry->SetName("TrackedScreenAR");
 }
 
 //----------------------------------------------------------------------------
 vtkSlicerTrackedScreenARLogic::~vtkSlicerTrackedScreenARLogic()
 {
+  // Drop the observations, bindings may outlive the logic through external references
+  while (!this->ViewBindings.empty())
+  {
+    this->RemoveViewBinding(this->ViewBindings.back()->GetViewNodeID());
+  }
+  vtkSetAndObserveMRMLNodeMacro(this->CalibrationMarkerNode, nullptr);
 }
 
 //----------------------------------------------------------------------------
 void vtkSlicerTrackedScreenARLogic::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "ViewBindings: " << this->ViewBindings.size() << std::endl;
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    (*it)->PrintSelf(os, indent.GetNextIndent());
+  }
+  os << indent << "VideoSources: " << this->VideoSources.size() << std::endl;
+  for (std::map<std::string, vtkSmartPointer<vtkTrackedScreenARVideoSource> >::iterator it = this->VideoSources.begin(); it != this->VideoSources.end(); ++it)
+  {
+    it->second->PrintSelf(os, indent.GetNextIndent());
+  }
+  os << indent << "ArrivalTimeOverride: " << this->ArrivalTimeOverride << std::endl;
+  os << indent << "RecordedViewNodeID: " << this->RecordedViewNodeID << std::endl;
+  os << indent << "SessionRecorder:" << std::endl;
+  this->SessionRecorder->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "PlayedViewNodeID: " << this->PlayedViewNodeID << std::endl;
+  os << indent << "SessionPlaybackPaused: " << (this->SessionPlaybackPaused ? "true" : "false") << std::endl;
+  os << indent << "SessionPlayer:" << std::endl;
+  this->SessionPlayer->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "CalibrationOutputNodeID: " << this->CalibrationOutputNodeID << std::endl;
+  os << indent << "HandEyeCalibration:" << std::endl;
+  this->HandEyeCalibration->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "TelemetryTableNodeID: " << this->TelemetryTableNodeID << std::endl;
+  os << indent << "Telemetry:" << std::endl;
+  this->Telemetry->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARViewBinding* vtkSlicerTrackedScreenARLogic::AddViewBinding(const std::string& viewNodeID)
+{
+  vtkTrackedScreenARViewBinding* binding = this->GetViewBinding(viewNodeID);
+  if (binding != nullptr)
+  {
+    return binding;
+  }
+
+  vtkNew<vtkTrackedScreenARViewBinding> newBinding;
+  newBinding->SetViewNodeID(viewNodeID);
+  this->ViewBindings.push_back(newBinding.GetPointer());
+  this->Modified();
+  return newBinding.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARViewBinding* vtkSlicerTrackedScreenARLogic::GetViewBinding(const std::string& viewNodeID)
+{
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    if ((*it)->GetViewNodeID() == viewNodeID)
+    {
+      return *it;
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::RemoveViewBinding(const std::string& viewNodeID)
+{
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    if ((*it)->GetViewNodeID() != viewNodeID)
+    {
+      continue;
+    }
+    // Keep the binding alive while it is unbound
+    vtkSmartPointer<vtkTrackedScreenARViewBinding> binding = *it;
+    this->ViewBindings.erase(it);
+
+    if (viewNodeID == this->RecordedViewNodeID)
+    {
+      this->StopSessionRecording();
+    }
+    if (viewNodeID == this->PlayedViewNodeID)
+    {
+      this->StopSessionPlayback();
+    }
+
+    this->SetVideoSourceNode(binding, nullptr);
+    this->SetCameraParametersNode(binding, nullptr);
+    this->SetCameraTransformNode(binding, nullptr);
+    this->UpdateViewCamera(binding);
+    this->SetRenderWindow(binding, nullptr);
+    binding->ParametersNodeID.clear();
+
+    vtkMRMLScene* scene = this->GetMRMLScene();
+    vtkMRMLNode* presentedNode = (scene != nullptr ? scene->GetNodeByID(binding->PresentedCameraTransformNodeID) : nullptr);
+    if (presentedNode != nullptr)
+    {
+      scene->RemoveNode(presentedNode);
+    }
+    binding->PresentedCameraTransformNodeID.clear();
+
+    this->Modified();
+    return;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerTrackedScreenARLogic::GetNumberOfViewBindings()
+{
+  return static_cast<int>(this->ViewBindings.size());
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARViewBinding* vtkSlicerTrackedScreenARLogic::GetNthViewBinding(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->ViewBindings.size()))
+  {
+    return nullptr;
+  }
+  return this->ViewBindings[index];
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetVideoSourceNode(vtkTrackedScreenARViewBinding* binding, vtkMRMLVolumeNode* node)
+{
+  if (binding == nullptr)
+  {
+    return;
+  }
+
+  vtkTrackedScreenARVideoSource* previousSource = binding->GetVideoSource();
+  std::string nodeID = (node != nullptr && node->GetID() != nullptr ? node->GetID() : "");
+  if (previousSource != nullptr && previousSource->GetVideoSourceNodeID() == nodeID)
+  {
+    return;
+  }
+
+  vtkSmartPointer<vtkTrackedScreenARVideoSource> previous = previousSource;
+  binding->SetVideoSource(nullptr);
+  if (previous != nullptr)
+  {
+    this->ReleaseVideoSource(previous);
+  }
+
+  if (!nodeID.empty())
+  {
+    vtkSmartPointer<vtkTrackedScreenARVideoSource>& source = this->VideoSources[nodeID];
+    if (source == nullptr)
+    {
+      source = vtkSmartPointer<vtkTrackedScreenARVideoSource>::New();
+      source->SetVideoSourceNodeID(nodeID);
+      source->SetTelemetry(this->Telemetry);
+      // Also sent when the node gets its image data, which a video stream may only provide with its first frame
+      vtkNew<vtkIntArray> events;
+      events->InsertNextValue(vtkMRMLVolumeNode::ImageDataModifiedEvent);
+      vtkSetAndObserveMRMLNodeEventsMacro(source->VideoSourceNode, node, events.GetPointer());
+
+      // Show the current content right away instead of waiting for the next frame
+      vtkAugmentedRealityTelemetryScope ingestScope(this->Telemetry, vtkAugmentedRealityTelemetry::Ingest);
+      if (source->PushFrame(source->GetInputImage(), this->GetArrivalTime()))
+      {
+        source->AcquireFrame();
+      }
+    }
+    binding->SetVideoSource(source);
+    this->UpdatePixelFormat(binding);
+    this->UpdateLensParameters(binding);
+    this->UpdateShrinkFactor(source);
+  }
+
+  this->UpdateBackgroundTexture(binding);
+  this->RequestProjectionUpdate(binding);
+  binding->RequestRender(vtkTrackedScreenARFramePacer::VideoSource);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTrackedScreenARParametersNode* vtkSlicerTrackedScreenARLogic::GetParametersNode(const std::string& viewNodeID)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (scene == nullptr || viewNodeID.empty())
+  {
+    return nullptr;
+  }
+
+  std::vector<vtkMRMLNode*> parametersNodes;
+  scene->GetNodesByClass("vtkMRMLTrackedScreenARParametersNode", parametersNodes);
+  for (std::vector<vtkMRMLNode*>::iterator it = parametersNodes.begin(); it != parametersNodes.end(); ++it)
+  {
+    vtkMRMLTrackedScreenARParametersNode* parametersNode = vtkMRMLTrackedScreenARParametersNode::SafeDownCast(*it);
+    if (parametersNode != nullptr && parametersNode->GetViewNodeID() != nullptr && viewNodeID == parametersNode->GetViewNodeID())
+    {
+      return parametersNode;
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTrackedScreenARParametersNode* vtkSlicerTrackedScreenARLogic::AddParametersNode(const std::string& viewNodeID)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  vtkMRMLTrackedScreenARParametersNode* parametersNode = this->GetParametersNode(viewNodeID);
+  if (scene == nullptr || viewNodeID.empty() || parametersNode != nullptr)
+  {
+    return parametersNode;
+  }
+
+  vtkNew<vtkMRMLTrackedScreenARParametersNode> newNode;
+  newNode->SetName(scene->GenerateUniqueName("TrackedScreenARParameters").c_str());
+  newNode->SetViewNodeID(viewNodeID.c_str());
+  scene->AddNode(newNode.GetPointer());
+  return newNode.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::UpdateFromParametersNode(vtkMRMLTrackedScreenARParametersNode* node)
+{
+  std::string viewNodeID = (node->GetViewNodeID() != nullptr ? node->GetViewNodeID() : "");
+
+  // The node may have been moved to another view
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    if ((*it)->GetParametersNodeID() == node->GetID() && (*it)->GetViewNodeID() != viewNodeID)
+    {
+      this->RemoveViewBinding((*it)->GetViewNodeID());
+      break;
+    }
+  }
+  if (viewNodeID.empty())
+  {
+    return;
+  }
+
+  vtkTrackedScreenARViewBinding* binding = this->AddViewBinding(viewNodeID);
+  binding->ParametersNodeID = node->GetID();
+
+  this->SetVideoSourceNode(binding, node->GetVideoSourceNode());
+  this->UpdatePixelFormat(binding);
+
+  this->SetCameraParametersNode(binding, node->GetCameraParametersNode());
+  this->SetDownscaleVideoToView(binding, node->GetDownscaleVideoToView());
+  this->SetLayeredRendering(binding, node->GetLayeredRendering());
+  this->SetTargetFrameTime(binding, node->GetTargetFrameTime());
+  this->SetAdaptiveQuality(binding, node->GetAdaptiveQuality());
+  if (node->GetSynchronizePoseToVideo() != binding->GetSynchronizePoseToVideo())
+  {
+    binding->SetSynchronizePoseToVideo(node->GetSynchronizePoseToVideo());
+    binding->RequestRender(vtkTrackedScreenARFramePacer::PoseSource);
+  }
+  if (node->GetPredictionMode() != binding->GetPosePredictor()->GetPredictionMode()
+      || node->GetPredictionHorizon() != binding->GetPredictionHorizon())
+  {
+    // The predictor keeps its measurement history, the next frame is simply posed differently
+    binding->GetPosePredictor()->SetPredictionMode(node->GetPredictionMode());
+    binding->SetPredictionHorizon(node->GetPredictionHorizon());
+    binding->RequestRender(vtkTrackedScreenARFramePacer::PoseSource);
+  }
+  binding->GetFramePacer()->SetTargetFPS(node->GetTargetFPS());
+  // Applies from the next presented pose
+  binding->SetPoseTranslationDeadband(node->GetPoseTranslationDeadband());
+  binding->SetPoseRotationDeadband(node->GetPoseRotationDeadband());
+
+  if (node->GetCameraTransformNode() != binding->CameraTransformNode)
+  {
+    this->SetCameraTransformNode(binding, node->GetCameraTransformNode());
+    this->UpdateViewCamera(binding);
+    this->ResetCameraView(binding);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARVideoSource* vtkSlicerTrackedScreenARLogic::GetVideoSource(const std::string& videoSourceNodeID)
+{
+  std::map<std::string, vtkSmartPointer<vtkTrackedScreenARVideoSource> >::iterator it = this->VideoSources.find(videoSourceNodeID);
+  return (it != this->VideoSources.end() ? it->second.GetPointer() : nullptr);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::ReleaseVideoSource(vtkTrackedScreenARVideoSource* source)
+{
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    if ((*it)->GetVideoSource() == source)
+    {
+      // Still shown in another view, which may now ask for a different downscale factor
+      // and no longer conflict with the settings of the remaining views
+      for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator remaining = this->ViewBindings.begin();
+        remaining != this->ViewBindings.end(); ++remaining)
+      {
+        if ((*remaining)->GetVideoSource() == source)
+        {
+          this->UpdatePixelFormat(*remaining);
+          this->UpdateLensParameters(*remaining);
+        }
+      }
+      this->UpdateShrinkFactor(source);
+      return;
+    }
+  }
+
+  vtkSetAndObserveMRMLNodeMacro(source->VideoSourceNode, nullptr);
+  this->VideoSources.erase(source->GetVideoSourceNodeID());
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::UpdatePixelFormat(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkTrackedScreenARVideoSource* source = binding->GetVideoSource();
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  vtkMRMLTrackedScreenARParametersNode* node = (source != nullptr && scene != nullptr ?
+    vtkMRMLTrackedScreenARParametersNode::SafeDownCast(scene->GetNodeByID(binding->ParametersNodeID)) : nullptr);
+  if (node == nullptr)
+  {
+    this->SetVideoSourceConflict(binding, vtkTrackedScreenARViewBinding::PixelFormatConflict, false);
+    return false;
+  }
+
+  int pixelFormat = node->GetPixelFormat();
+  bool conflict = false;
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    vtkMRMLTrackedScreenARParametersNode* otherNode = ((*it) != binding && (*it)->GetVideoSource() == source ?
+      vtkMRMLTrackedScreenARParametersNode::SafeDownCast(scene->GetNodeByID((*it)->ParametersNodeID)) : nullptr);
+    if (otherNode != nullptr && otherNode->GetPixelFormat() != pixelFormat)
+    {
+      conflict = true;
+    }
+  }
+  this->SetVideoSourceConflict(binding, vtkTrackedScreenARViewBinding::PixelFormatConflict, conflict);
+  if (conflict || source->GetPixelFormatConverter()->GetPixelFormat() == pixelFormat)
+  {
+    return false;
+  }
+
+  source->GetPixelFormatConverter()->SetPixelFormat(pixelFormat);
+
+  // Planar formats store the frame in a taller image, every view showing the source needs a new projection
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    if ((*it)->GetVideoSource() == source)
+    {
+      this->RequestProjectionUpdate(*it);
+      (*it)->RequestRender(vtkTrackedScreenARFramePacer::VideoSource);
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetVideoSourceConflict(vtkTrackedScreenARViewBinding* binding, int conflict, bool set)
+{
+  int conflicts = (set ? binding->VideoSourceConflicts | conflict : binding->VideoSourceConflicts & ~conflict);
+  if (conflicts == binding->VideoSourceConflicts)
+  {
+    return;
+  }
+  binding->VideoSourceConflicts = conflicts;
+  if (set)
+  {
+    // Reported once when the conflict appears, not on every update of the view
+    vtkWarningMacro("View " << binding->GetViewNodeID() << " shares video " << binding->GetVideoSource()->GetVideoSourceNodeID()
+      << " with a view using a different " << (conflict == vtkTrackedScreenARViewBinding::PixelFormatConflict ? "pixel format" : "lens model")
+      << ", the settings of the view were not applied to the video");
+  }
+  binding->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetCameraParametersNode(vtkTrackedScreenARViewBinding* binding, vtkMRMLPinholeCameraNode* node)
+{
+  if (binding == nullptr || node == binding->CameraParametersNode)
+  {
+    return;
+  }
+
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkCommand::ModifiedEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(binding->CameraParametersNode, node, events.GetPointer());
+
+  this->UpdateLensParameters(binding);
+  this->RequestProjectionUpdate(binding);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::UpdateLensParameters(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLPinholeCameraNode* node = binding->CameraParametersNode;
+  vtkTrackedScreenARVideoSource* source = binding->GetVideoSource();
+  if (node == nullptr || source == nullptr)
+  {
+    this->SetVideoSourceConflict(binding, vtkTrackedScreenARViewBinding::LensParametersConflict, false);
+    return false;
+  }
+
+  // The undistorted frame keeps the calibrated intrinsics, so the projection stays valid.
+  // The video source scales them for its undistortion stage when the video is downscaled.
+  double lensParameters[9];
+  GetLensParameters(node, lensParameters);
+
+  // The video is undistorted once for all the views showing it, they have to agree on the lens
+  bool conflict = false;
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    vtkMRMLPinholeCameraNode* otherNode = ((*it)->GetVideoSource() == source ? (*it)->CameraParametersNode : nullptr);
+    if (otherNode == nullptr || otherNode == node)
+    {
+      continue;
+    }
+    double otherLensParameters[9];
+    GetLensParameters(otherNode, otherLensParameters);
+    if (!std::equal(lensParameters, lensParameters + 9, otherLensParameters))
+    {
+      conflict = true;
+    }
+  }
+  this->SetVideoSourceConflict(binding, vtkTrackedScreenARViewBinding::LensParametersConflict, conflict);
+  if (conflict)
+  {
+    return false;
+  }
+  return source->SetLensParameters(lensParameters, lensParameters + 4);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::UpdateShrinkFactor(vtkTrackedScreenARVideoSource* source)
+{
+  // The largest view sharing the source decides, none of them is shown a video smaller than itself
+  int shrinkFactor = 0;
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    if ((*it)->GetVideoSource() == source)
+    {
+      int requested = (*it)->GetRequestedShrinkFactor();
+      shrinkFactor = (shrinkFactor == 0 ? requested : std::min(shrinkFactor, requested));
+    }
+  }
+  return source->SetShrinkFactor(std::max(1, shrinkFactor));
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetCameraTransformNode(vtkTrackedScreenARViewBinding* binding, vtkMRMLLinearTransformNode* node)
+{
+  if (binding == nullptr)
+  {
+    return;
+  }
+  if (node != binding->CameraTransformNode)
+  {
+    binding->GetPoseBuffer()->Clear();
+    binding->GetPosePredictor()->Reset();
+  }
+
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLTransformableNode::TransformModifiedEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(binding->CameraTransformNode, node, events.GetPointer());
+  this->UpdateCameraParentTransformNode(binding);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::UpdateCameraParentTransformNode(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLTransformNode* parent = (binding->CameraTransformNode != nullptr ? binding->CameraTransformNode->GetParentTransformNode() : nullptr);
+
+  // The camera transform node observes its parent too and forwards the change as its own
+  // TransformModifiedEvent. Observe with a higher priority, so the cached matrix is already
+  // invalid when that event reaches the logic.
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLTransformableNode::TransformModifiedEvent);
+  vtkNew<vtkFloatArray> priorities;
+  priorities->InsertNextValue(1.0);
+  this->GetMRMLNodesObserverManager()->SetAndObserveObjectEvents(
+    reinterpret_cast<vtkObject**>(&binding->CameraParentTransformNode), parent, events.GetPointer(), priorities.GetPointer());
+  binding->InvalidateCameraParentToWorld();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetRenderWindow(vtkTrackedScreenARViewBinding* binding, vtkRenderWindow* renderWindow)
+{
+  if (binding == nullptr || renderWindow == binding->RenderWindow)
+  {
+    return;
+  }
+
+  vtkRenderer* previousRenderer = (binding->RenderWindow != nullptr ? binding->RenderWindow->GetRenderers()->GetFirstRenderer() : nullptr);
+  if (previousRenderer != nullptr)
+  {
+    previousRenderer->SetTexturedBackground(false);
+    this->UpdateSceneLayerPass(binding, previousRenderer, false);
+  }
+  // Frame times of another window say nothing about this one
+  this->ApplyQualityLevel(binding, binding->RenderWindow, vtkTrackedScreenARQualityGovernor::FullQuality);
+  binding->GetQualityGovernor()->Reset();
+  binding->RenderStartTime = -1.0;
+
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkCommand::StartEvent);
+  events->InsertNextValue(vtkCommand::EndEvent);
+  events->InsertNextValue(vtkCommand::WindowResizeEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(binding->RenderWindow, renderWindow, events.GetPointer());
+  if (renderWindow == nullptr)
+  {
+    return;
+  }
+
+  // A render requested while no window was attached, or for the previous one, never reached an observer
+  // and would absorb every later request. Start over and request it again for this window.
+  int pendingSources = binding->FramePacer->GetDirtySources();
+  binding->FramePacer->Reset();
+
+  // The view may have been created after the binding, so may its camera node
+  this->UpdateBackgroundTexture(binding);
+  this->UpdateSceneLayerPass(binding, renderWindow->GetRenderers()->GetFirstRenderer(), binding->GetLayeredRendering());
+  this->UpdateViewCamera(binding);
+  this->RequestProjectionUpdate(binding);
+  if (pendingSources != 0)
+  {
+    binding->RequestRender(pendingSources);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::UpdateBackgroundTexture(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkTrackedScreenARVideoSource* source = binding->GetVideoSource();
+  binding->BackgroundTexture->SetInputConnection(source != nullptr ? source->GetOutputPort() : nullptr);
+
+  vtkRenderer* renderer = (binding->RenderWindow != nullptr ? binding->RenderWindow->GetRenderers()->GetFirstRenderer() : nullptr);
+  if (renderer == nullptr)
+  {
+    return;
+  }
+  renderer->SetTexturedBackground(source != nullptr);
+  renderer->SetLeftBackgroundTexture(source != nullptr ? binding->BackgroundTexture : nullptr);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::RequestProjectionUpdate(vtkTrackedScreenARViewBinding* binding)
+{
+  // Inputs change in bursts (resizing, loading a scene), the projection is computed once per frame
+  binding->ProjectionUpdatePending = true;
+  binding->SceneLayerPass->Invalidate();
+  binding->InvokeEvent(vtkTrackedScreenARViewBinding::ProjectionInputModifiedEvent);
+  binding->RequestRender(vtkTrackedScreenARFramePacer::SceneSource);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetDownscaleVideoToView(vtkTrackedScreenARViewBinding* binding, bool downscale)
+{
+  if (binding == nullptr || downscale == binding->GetDownscaleVideoToView())
+  {
+    return;
+  }
+  binding->SetDownscaleVideoToView(downscale);
+  // Frames are then already shrunk to the view at full quality
+  binding->GetQualityGovernor()->SetLevelSkipped(vtkTrackedScreenARQualityGovernor::DownscaledVideo, downscale);
+  if (binding->GetVideoSource() != nullptr && this->UpdateShrinkFactor(binding->GetVideoSource()))
+  {
+    binding->RequestRender(vtkTrackedScreenARFramePacer::VideoSource);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetLayeredRendering(vtkTrackedScreenARViewBinding* binding, bool layered)
+{
+  if (binding == nullptr || layered == binding->GetLayeredRendering())
+  {
+    return;
+  }
+  binding->SetLayeredRendering(layered);
+  if (binding->RenderWindow != nullptr)
+  {
+    this->UpdateSceneLayerPass(binding, binding->RenderWindow->GetRenderers()->GetFirstRenderer(), layered);
+    binding->RequestRender(vtkTrackedScreenARFramePacer::SceneSource);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetAdaptiveQuality(vtkTrackedScreenARViewBinding* binding, bool adaptive)
+{
+  if (binding == nullptr || adaptive == binding->GetQualityGovernor()->GetEnabled())
+  {
+    return;
+  }
+  binding->GetQualityGovernor()->SetEnabled(adaptive);
+  binding->GetQualityGovernor()->Reset();
+  this->ApplyQualityLevel(binding, binding->RenderWindow, vtkTrackedScreenARQualityGovernor::FullQuality);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetTargetFrameTime(vtkTrackedScreenARViewBinding* binding, double targetFrameTime)
+{
+  if (binding == nullptr)
+  {
+    return;
+  }
+  binding->GetQualityGovernor()->SetTargetFrameTime(targetFrameTime);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::ApplyQualityLevel(vtkTrackedScreenARViewBinding* binding, vtkRenderWindow* renderWindow, int level)
+{
+  int previousLevel = binding->AppliedQualityLevel;
+  if (level == previousLevel)
+  {
+    return;
+  }
+  binding->AppliedQualityLevel = level;
+
+  // Views sharing the source only get a smaller video if all of them degrade it
+  if (binding->GetVideoSource() != nullptr && this->UpdateShrinkFactor(binding->GetVideoSource()))
+  {
+    binding->RequestRender(vtkTrackedScreenARFramePacer::VideoSource);
+  }
+
+  bool noExpensivePasses = (level >= vtkTrackedScreenARQualityGovernor::NoExpensivePasses);
+  if (noExpensivePasses != (previousLevel >= vtkTrackedScreenARQualityGovernor::NoExpensivePasses))
+  {
+    this->SetExpensivePassesDisabled(binding, noExpensivePasses);
+  }
+  if (renderWindow == nullptr)
+  {
+    return;
+  }
+
+  // Props with levels of detail, volumes mostly, render within the time the renderer allocates them.
+  // Interactor styles reset the update rate of the window to the still rate after each interaction.
+  vtkRenderWindowInteractor* interactor = renderWindow->GetInteractor();
+  bool reducedDetail = (level >= vtkTrackedScreenARQualityGovernor::ReducedDetail);
+  if (reducedDetail != (previousLevel >= vtkTrackedScreenARQualityGovernor::ReducedDetail))
+  {
+    if (reducedDetail)
+    {
+      binding->SavedStillUpdateRate = (interactor != nullptr ? interactor->GetStillUpdateRate() : renderWindow->GetDesiredUpdateRate());
+    }
+    double updateRate = (reducedDetail ? 1.0 / binding->GetQualityGovernor()->GetTargetFrameTime() : binding->SavedStillUpdateRate);
+    if (interactor != nullptr)
+    {
+      interactor->SetStillUpdateRate(updateRate);
+    }
+    renderWindow->SetDesiredUpdateRate(updateRate);
+  }
+
+  binding->RequestRender(vtkTrackedScreenARFramePacer::SceneSource);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetExpensivePassesDisabled(vtkTrackedScreenARViewBinding* binding, bool disabled)
+{
+  // Through the view node, so the view displayable manager sets up its renderer and passes and the
+  // view controller shows the settings actually in use
+  vtkMRMLViewNode* viewNode = (this->GetMRMLScene() != nullptr ?
+    vtkMRMLViewNode::SafeDownCast(this->GetMRMLScene()->GetNodeByID(binding->GetViewNodeID())) : nullptr);
+  if (viewNode == nullptr)
+  {
+    return;
+  }
+  if (disabled)
+  {
+    binding->SavedUseDepthPeeling = (viewNode->GetUseDepthPeeling() != 0);
+    binding->SavedShadowsVisibility = viewNode->GetShadowsVisibility();
+  }
+  int wasModifying = viewNode->StartModify();
+  viewNode->SetUseDepthPeeling(!disabled && binding->SavedUseDepthPeeling);
+  viewNode->SetShadowsVisibility(!disabled && binding->SavedShadowsVisibility);
+  viewNode->EndModify(wasModifying);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::UpdateSceneLayerPass(vtkTrackedScreenARViewBinding* binding, vtkRenderer* renderer, bool install)
+{
+  vtkTrackedScreenARSceneLayerPass* pass = binding->SceneLayerPass;
+  if (renderer == nullptr || install == (renderer->GetPass() == pass))
+  {
+    return;
+  }
+
+  // The scene is only rendered when it changes, the render settings no longer weigh on the frame time
+  binding->GetQualityGovernor()->SetLevelSkipped(vtkTrackedScreenARQualityGovernor::NoExpensivePasses, install);
+
+  if (install)
+  {
+    // Keep what the view renders with, e.g. a shadow or depth peeling pass set by another module
+    pass->SetDelegatePass(renderer->GetPass());
+    pass->Invalidate();
+    renderer->SetPass(pass);
+    return;
+  }
+
+  renderer->SetPass(pass->GetDelegatePass());
+  if (renderer->GetRenderWindow() != nullptr)
+  {
+    // The layer textures and framebuffer belong to the context of the window
+    renderer->GetRenderWindow()->MakeCurrent();
+    pass->ReleaseGraphicsResources(renderer->GetRenderWindow());
+  }
+  pass->SetDelegatePass(nullptr);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::UpdateCameraProjection(vtkTrackedScreenARViewBinding* binding, vtkCamera* camera)
+{
+  int imageSize[2] = { 0, 0 };
+  if (binding == nullptr || camera == nullptr || binding->CameraParametersNode == nullptr || binding->RenderWindow == nullptr
+      || binding->GetVideoSource() == nullptr || !binding->GetVideoSource()->GetFrameSize(imageSize))
+  {
+    return false;
+  }
+
+  vtkMatrix3x3* intrinsicMatrix = binding->CameraParametersNode->GetIntrinsicMatrix();
+  int* viewportSize = binding->RenderWindow->GetSize();
+
+  vtkTrackedScreenARProjection* projection = binding->GetProjection();
+  projection->SetIntrinsics(intrinsicMatrix->GetElement(0, 0), intrinsicMatrix->GetElement(1, 1),
+                            intrinsicMatrix->GetElement(0, 2), intrinsicMatrix->GetElement(1, 2));
+  projection->SetImageSize(imageSize[0], imageSize[1]);
+  projection->SetViewportSize(viewportSize[0], viewportSize[1]);
+  bool recomputed = projection->Update();
+  projection->ApplyToCamera(camera);
+
+  bool lensChanged = this->UpdateLensParameters(binding);
+  bool pipelineChanged = this->UpdateShrinkFactor(binding->GetVideoSource());
+  return recomputed || lensChanged || pipelineChanged;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkSlicerTrackedScreenARLogic::GetPresentedCameraTransformNode(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (scene == nullptr || binding == nullptr)
+  {
+    return nullptr;
+  }
+
+  vtkMRMLLinearTransformNode* node = vtkMRMLLinearTransformNode::SafeDownCast(scene->GetNodeByID(binding->PresentedCameraTransformNodeID));
+  if (node == nullptr)
+  {
+    vtkNew<vtkMRMLLinearTransformNode> newNode;
+    newNode->SetName(scene->GenerateUniqueName("TrackedScreenARPresentedCamera").c_str());
+    newNode->SetHideFromEditors(true);
+    newNode->SetSaveWithScene(false);
+    scene->AddNode(newNode.GetPointer());
+    binding->PresentedCameraTransformNodeID = newNode->GetID();
+    node = newNode.GetPointer();
+  }
+  return node;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::PresentCameraPose(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLLinearTransformNode* presentedNode = this->GetPresentedCameraTransformNode(binding);
+  if (presentedNode == nullptr)
+  {
+    return;
+  }
+
+  vtkNew<vtkMatrix4x4> cameraToWorld;
+  double poseTimestamp = -1.0;
+  binding->ComputeCameraPose(cameraToWorld.GetPointer(), poseTimestamp);
+  if (poseTimestamp >= 0.0)
+  {
+    // Also when the pose did not move, the view then shows a newer pose of the same place
+    binding->GetLatencyMonitor()->RecordPresentedPose(poseTimestamp);
+  }
+  vtkNew<vtkMatrix4x4> presentedCameraToWorld;
+  presentedNode->GetMatrixTransformToParent(presentedCameraToWorld.GetPointer());
+  if (binding->IsPoseInDeadband(cameraToWorld.GetPointer(), presentedCameraToWorld.GetPointer()))
+  {
+    // Also the case of every video frame while the tracked screen is still, a new camera would make
+    // the scene layer render again for tracker jitter well below a pixel
+    return;
+  }
+  // The camera displayable manager requests a render for the moved camera, the view driver must not
+  // take it for a scene change
+  binding->PresentingCameraPose = true;
+  presentedNode->SetMatrixTransformToParent(cameraToWorld.GetPointer());
+  binding->PresentingCameraPose = false;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLCameraNode* vtkSlicerTrackedScreenARLogic::GetViewCameraNode(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (scene == nullptr || binding == nullptr)
+  {
+    return nullptr;
+  }
+  vtkMRMLViewNode* viewNode = vtkMRMLViewNode::SafeDownCast(scene->GetNodeByID(binding->GetViewNodeID()));
+  if (viewNode == nullptr || viewNode->GetLayoutName() == nullptr)
+  {
+    return nullptr;
+  }
+
+  std::vector<vtkMRMLNode*> cameraNodes;
+  scene->GetNodesByClass("vtkMRMLCameraNode", cameraNodes);
+  for (std::vector<vtkMRMLNode*>::iterator it = cameraNodes.begin(); it != cameraNodes.end(); ++it)
+  {
+    vtkMRMLCameraNode* cameraNode = vtkMRMLCameraNode::SafeDownCast(*it);
+    if (cameraNode != nullptr && cameraNode->GetLayoutName() != nullptr && strcmp(cameraNode->GetLayoutName(), viewNode->GetLayoutName()) == 0)
+    {
+      return cameraNode;
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::UpdateViewCamera(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLCameraNode* cameraNode = this->GetViewCameraNode(binding);
+  if (cameraNode == nullptr)
+  {
+    return;
+  }
+  if (binding->CameraTransformNode == nullptr)
+  {
+    // Leave alone a camera this view does not drive
+    if (cameraNode->GetTransformNodeID() != nullptr && binding->PresentedCameraTransformNodeID == cameraNode->GetTransformNodeID())
+    {
+      cameraNode->SetAndObserveTransformNodeID(nullptr);
+    }
+    return;
+  }
+
+  // Tracker updates only mark the pose dirty, the camera follows the presented pose once per rendered frame
+  this->PresentCameraPose(binding);
+  cameraNode->SetAndObserveTransformNodeID(this->GetPresentedCameraTransformNode(binding)->GetID());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::ResetCameraView(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLCameraNode* cameraNode = this->GetViewCameraNode(binding);
+  if (cameraNode == nullptr || binding->CameraTransformNode == nullptr)
+  {
+    return;
+  }
+
+  // The camera is parented to the presented pose, bring it up to date before taking it as reference
+  this->PresentCameraPose(binding);
+
+  // The presented node has no parent, its matrix to parent is the pose, copied once into the camera
+  this->GetPresentedCameraTransformNode(binding)->GetMatrixTransformToParent(cameraNode->GetAppliedTransform());
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerTrackedScreenARLogic::BeginFrame(vtkTrackedScreenARViewBinding* binding)
+{
+  if (binding == nullptr)
+  {
+    return 0;
+  }
+
+  this->PublishCalibrationResult();
+
+  vtkRenderer* renderer = (binding->RenderWindow != nullptr ? binding->RenderWindow->GetRenderers()->GetFirstRenderer() : nullptr);
+  if (binding->ProjectionUpdatePending && renderer != nullptr)
+  {
+    // Memoized, only recomputed if an input actually changed
+    vtkAugmentedRealityTelemetryScope projectionScope(this->Telemetry, vtkAugmentedRealityTelemetry::ProjectionUpdate);
+    binding->ProjectionUpdatePending = false;
+    this->UpdateCameraProjection(binding, renderer->GetActiveCamera());
+  }
+
+  double frameStartTime = vtkTimerLog::GetUniversalTime();
+  int dirtySources = binding->GetFramePacer()->BeginFrame(frameStartTime);
+  if ((dirtySources & vtkTrackedScreenARFramePacer::VideoSource) != 0 && binding->GetVideoSource() != nullptr)
+  {
+    // The first view sharing the source to render takes the frame, its texture runs the pipeline
+    // during the render and the other views find the frame already converted
+    binding->GetVideoSource()->AcquireFrame();
+  }
+  // A new video frame changes the synchronized pose even if no new pose arrived
+  if ((dirtySources & (vtkTrackedScreenARFramePacer::PoseSource | vtkTrackedScreenARFramePacer::VideoSource)) != 0)
+  {
+    vtkAugmentedRealityTelemetryScope presentScope(this->Telemetry, vtkAugmentedRealityTelemetry::Present);
+    this->PresentCameraPose(binding);
+  }
+  binding->FrameWorkTime = vtkTimerLog::GetUniversalTime() - frameStartTime;
+
+  this->PublishTelemetry();
+  return dirtySources;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerTrackedScreenARLogic::GetArrivalTime()
+{
+  return (this->ArrivalTimeOverride >= 0.0 ? this->ArrivalTimeOverride : vtkTimerLog::GetUniversalTime());
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSessionRecorder* vtkSlicerTrackedScreenARLogic::GetSessionRecorder()
+{
+  return this->SessionRecorder;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::StartSessionRecording(vtkTrackedScreenARViewBinding* binding, const std::string& fileName)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (binding == nullptr || scene == nullptr)
+  {
+    return false;
+  }
+  this->StopSessionRecording();
+
+  vtkTrackedScreenARVideoSource* source = binding->GetVideoSource();
+  vtkMRMLVolumeNode* videoNode = (source != nullptr ? vtkMRMLVolumeNode::SafeDownCast(scene->GetNodeByID(source->GetVideoSourceNodeID())) : nullptr);
+  this->SessionRecorder->SetVideoNode(videoNode);
+  this->SessionRecorder->SetCameraTransformNode(binding->CameraTransformNode);
+  this->SessionRecorder->SetCameraParametersNode(binding->CameraParametersNode);
+  if (!this->SessionRecorder->Start(fileName))
+  {
+    return false;
+  }
+  this->RecordedViewNodeID = binding->GetViewNodeID();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::StopSessionRecording()
+{
+  this->RecordedViewNodeID.clear();
+  bool stopped = this->SessionRecorder->Stop();
+
+  // Release the nodes, they may be removed from the scene
+  this->SessionRecorder->SetVideoNode(nullptr);
+  this->SessionRecorder->SetCameraTransformNode(nullptr);
+  this->SessionRecorder->SetCameraParametersNode(nullptr);
+  return stopped;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSessionPlayer* vtkSlicerTrackedScreenARLogic::GetSessionPlayer()
+{
+  return this->SessionPlayer;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::StartSessionPlayback(vtkTrackedScreenARViewBinding* binding, const std::string& fileName)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (binding == nullptr || scene == nullptr)
+  {
+    return false;
+  }
+  this->StopSessionPlayback();
+
+  vtkTrackedScreenARVideoSource* source = binding->GetVideoSource();
+  vtkMRMLVolumeNode* videoNode = (source != nullptr ? vtkMRMLVolumeNode::SafeDownCast(scene->GetNodeByID(source->GetVideoSourceNodeID())) : nullptr);
+  if (videoNode == nullptr || binding->CameraTransformNode == nullptr)
+  {
+    vtkErrorMacro("StartSessionPlayback: view " << binding->GetViewNodeID() << " has no video or camera transform node");
+    return false;
+  }
+  this->SessionPlayer->SetVideoNode(videoNode);
+  this->SessionPlayer->SetCameraTransformNode(binding->CameraTransformNode);
+  this->SessionPlayer->SetCameraParametersNode(binding->CameraParametersNode);
+  this->SessionPlayer->SetLogic(this);
+  if (!this->SessionPlayer->Open(fileName))
+  {
+    this->StopSessionPlayback();
+    return false;
+  }
+  this->PlayedViewNodeID = binding->GetViewNodeID();
+  this->SessionPlaybackStartTime = vtkTimerLog::GetUniversalTime();
+  this->SessionPlaybackPausedTime = 0.0;
+  this->SessionPlaybackPaused = false;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::UpdateSessionPlayback()
+{
+  if (!this->SessionPlayer->IsOpen())
+  {
+    return false;
+  }
+  if (!this->SessionPlaybackPaused)
+  {
+    this->SessionPlayer->PlayUntil(vtkTimerLog::GetUniversalTime() - this->SessionPlaybackStartTime);
+  }
+  return !this->SessionPlayer->IsAtEnd();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::StepSessionPlayback()
+{
+  if (!this->SessionPlayer->IsOpen())
+  {
+    return false;
+  }
+  this->SetSessionPlaybackPaused(true);
+  if (!this->SessionPlayer->StepFrame())
+  {
+    return false;
+  }
+  // Resume from the stepped frame
+  this->SessionPlaybackPausedTime = this->SessionPlayer->GetFrameTime(this->SessionPlayer->GetFrameIndex() - 1);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetSessionPlaybackPaused(bool paused)
+{
+  if (paused == this->SessionPlaybackPaused)
+  {
+    return;
+  }
+  double now = vtkTimerLog::GetUniversalTime();
+  if (paused)
+  {
+    this->SessionPlaybackPausedTime = now - this->SessionPlaybackStartTime;
+  }
+  else
+  {
+    this->SessionPlaybackStartTime = now - this->SessionPlaybackPausedTime;
+  }
+  this->SessionPlaybackPaused = paused;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::GetSessionPlaybackPaused()
+{
+  return this->SessionPlaybackPaused;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::StopSessionPlayback()
+{
+  // Replayed samples carry recorded timestamps, keep them out of the live latency statistics
+  vtkTrackedScreenARViewBinding* playedBinding = this->GetViewBinding(this->PlayedViewNodeID);
+  if (playedBinding != nullptr)
+  {
+    playedBinding->GetLatencyMonitor()->Reset();
+  }
+  this->PlayedViewNodeID.clear();
+  this->SessionPlaybackPaused = false;
+  this->SessionPlayer->Close();
+
+  // Release the nodes, they may be removed from the scene
+  this->SessionPlayer->SetVideoNode(nullptr);
+  this->SessionPlayer->SetCameraTransformNode(nullptr);
+  this->SessionPlayer->SetCameraParametersNode(nullptr);
+  this->SessionPlayer->SetLogic(nullptr);
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARHandEyeCalibration* vtkSlicerTrackedScreenARLogic::GetHandEyeCalibration()
+{
+  return this->HandEyeCalibration;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::SetCalibrationMarkerNode(vtkMRMLTransformNode* node)
+{
+  if (node == this->CalibrationMarkerNode)
+  {
+    return;
+  }
+  this->CalibrationMarkerPoses->Clear();
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLTransformableNode::TransformModifiedEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(this->CalibrationMarkerNode, node, events.GetPointer());
+  if (node != nullptr)
+  {
+    // A marker held still sends no event, its current pose stands until it moves
+    this->AddCalibrationMarkerPose();
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTransformNode* vtkSlicerTrackedScreenARLogic::GetCalibrationMarkerNode()
+{
+  return this->CalibrationMarkerNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::AddCalibrationMarkerPose()
+{
+  vtkNew<vtkMatrix4x4> markerToTracker;
+  this->CalibrationMarkerNode->GetMatrixTransformToWorld(markerToTracker.GetPointer());
+  this->CalibrationMarkerPoses->AddPose(this->GetArrivalTime(), markerToTracker.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::AddCalibrationSample(vtkMRMLVolumeNode* videoNode, vtkMRMLTransformNode* patternToCameraNode)
+{
+  vtkTrackedScreenARVideoSource* source = (videoNode != nullptr && videoNode->GetID() != nullptr ? this->GetVideoSource(videoNode->GetID()) : nullptr);
+  if (source == nullptr || patternToCameraNode == nullptr || this->CalibrationMarkerNode == nullptr)
+  {
+    return false;
+  }
+  // The pattern was detected in the current frame, pair it with the marker pose of that time
+  double frameTimestamp = source->GetFrameTimestamp();
+  vtkNew<vtkMatrix4x4> markerToTracker;
+  if (frameTimestamp < 0.0 || !this->CalibrationMarkerPoses->GetPose(frameTimestamp, markerToTracker.GetPointer()))
+  {
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> patternToCamera;
+  patternToCameraNode->GetMatrixTransformToParent(patternToCamera.GetPointer());
+  return this->HandEyeCalibration->AddSample(markerToTracker.GetPointer(), patternToCamera.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::StartCalibration(vtkMRMLLinearTransformNode* outputNode)
+{
+  if (outputNode == nullptr || outputNode->GetID() == nullptr || !this->HandEyeCalibration->Start())
+  {
+    return false;
+  }
+  this->CalibrationOutputNodeID = outputNode->GetID();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::PublishCalibrationResult()
+{
+  if (this->CalibrationOutputNodeID.empty())
+  {
+    return false;
+  }
+  int state = this->HandEyeCalibration->GetState();
+  if (state == vtkTrackedScreenARHandEyeCalibration::Running)
+  {
+    return false;
+  }
+
+  std::string outputNodeID = this->CalibrationOutputNodeID;
+  this->CalibrationOutputNodeID.clear();
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  vtkMRMLLinearTransformNode* outputNode = (scene != nullptr ?
+    vtkMRMLLinearTransformNode::SafeDownCast(scene->GetNodeByID(outputNodeID)) : nullptr);
+  vtkNew<vtkMatrix4x4> cameraToMarker;
+  if (outputNode == nullptr || !this->HandEyeCalibration->GetCameraToMarker(cameraToMarker.GetPointer()))
+  {
+    return false;
+  }
+  outputNode->SetMatrixTransformToParent(cameraToMarker.GetPointer());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkAugmentedRealityTelemetry* vtkSlicerTrackedScreenARLogic::GetTelemetry()
+{
+  return this->Telemetry;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTableNode* vtkSlicerTrackedScreenARLogic::GetTelemetryTableNode()
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (scene == nullptr)
+  {
+    return nullptr;
+  }
+
+  vtkMRMLTableNode* node = vtkMRMLTableNode::SafeDownCast(scene->GetNodeByID(this->TelemetryTableNodeID));
+  if (node == nullptr)
+  {
+    vtkNew<vtkMRMLTableNode> newNode;
+    newNode->SetName(scene->GenerateUniqueName("TrackedScreenARTelemetry").c_str());
+    newNode->SetSaveWithScene(false);
+    scene->AddNode(newNode.GetPointer());
+    this->TelemetryTableNodeID = newNode->GetID();
+    node = newNode.GetPointer();
+  }
+  return node;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::PublishTelemetry()
+{
+  if (!this->Telemetry->UpdateAggregates())
+  {
+    return false;
+  }
+  vtkMRMLTableNode* tableNode = this->GetTelemetryTableNode();
+  if (tableNode == nullptr)
+  {
+    return false;
+  }
+  this->Telemetry->WriteAggregates(tableNode->GetTable());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTrackedScreenARLogic::WriteTelemetryTrace(const std::string& fileName)
+{
+  return this->Telemetry->WriteChromeTrace(fileName);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::RecordViewFrame(vtkTrackedScreenARViewBinding* binding)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  vtkMRMLLinearTransformNode* presentedNode = (scene != nullptr ?
+    vtkMRMLLinearTransformNode::SafeDownCast(scene->GetNodeByID(binding->PresentedCameraTransformNodeID)) : nullptr);
+  vtkNew<vtkMatrix4x4> presentedCameraToWorld;
+  if (presentedNode != nullptr)
+  {
+    presentedNode->GetMatrixTransformToParent(presentedCameraToWorld.GetPointer());
+  }
+  double videoTimestamp = (binding->GetVideoSource() != nullptr ? binding->GetVideoSource()->GetFrameTimestamp() : -1.0);
+  this->SessionRecorder->RecordViewFrame(binding->RenderWindow, videoTimestamp, presentedCameraToWorld.GetPointer(), vtkTimerLog::GetUniversalTime());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::OnVideoImageModified(vtkTrackedScreenARVideoSource* source)
+{
+  vtkAugmentedRealityTelemetryScope ingestScope(this->Telemetry, vtkAugmentedRealityTelemetry::Ingest);
+
+  int previousFrameSize[2] = { 0, 0 };
+  bool hadFrame = source->GetFrameSize(previousFrameSize);
+  double arrivalTime = this->GetArrivalTime();
+  if (!source->PushFrame(source->GetInputImage(), arrivalTime))
+  {
+    return;
+  }
+
+  // Video source may switch resolution without the node changing
+  int frameSize[2] = { 0, 0 };
+  source->GetFrameSize(frameSize);
+  bool frameSizeChanged = !hadFrame || frameSize[0] != previousFrameSize[0] || frameSize[1] != previousFrameSize[1];
+
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    if ((*it)->GetVideoSource() != source)
+    {
+      continue;
+    }
+    if (frameSizeChanged)
+    {
+      this->RequestProjectionUpdate(*it);
+    }
+    (*it)->GetLatencyMonitor()->RecordImageArrival(arrivalTime);
+    (*it)->RequestRender(vtkTrackedScreenARFramePacer::VideoSource);
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -55,29 +1369,254 @@ void vtkSlicerTrackedScreenARLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene
   events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
   events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
   events->InsertNextValue(vtkMRMLScene::EndBatchProcessEvent);
+  events->InsertNextValue(vtkMRMLScene::StartSaveEvent);
+  events->InsertNextValue(vtkMRMLScene::EndSaveEvent);
   this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::ProcessMRMLSceneEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  if (event == vtkMRMLScene::StartSaveEvent || event == vtkMRMLScene::EndSaveEvent)
+  {
+    // Degraded render settings are transient, the view nodes are saved with the settings of the user
+    bool saving = (event == vtkMRMLScene::StartSaveEvent);
+    for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+    {
+      if ((*it)->AppliedQualityLevel >= vtkTrackedScreenARQualityGovernor::NoExpensivePasses)
+      {
+        this->SetExpensivePassesDisabled(*it, !saving);
+      }
+    }
+  }
+  this->Superclass::ProcessMRMLSceneEvents(caller, event, callData);
+}
+
 //-----------------------------------------------------------------------------
 void vtkSlicerTrackedScreenARLogic::RegisterNodes()
 {
   assert(this->GetMRMLScene() != 0);
+
+  this->GetMRMLScene()->RegisterNodeClass(vtkSmartPointer<vtkMRMLTrackedScreenARParametersNode>::New());
 }
 
 //---------------------------------------------------------------------------
 void vtkSlicerTrackedScreenARLogic::UpdateFromMRMLScene()
 {
   assert(this->GetMRMLScene() != 0);
+
+  // Node references of an imported scene are only resolved once the import finished
+  std::vector<vtkMRMLNode*> parametersNodes;
+  this->GetMRMLScene()->GetNodesByClass("vtkMRMLTrackedScreenARParametersNode", parametersNodes);
+  for (std::vector<vtkMRMLNode*>::iterator it = parametersNodes.begin(); it != parametersNodes.end(); ++it)
+  {
+    this->UpdateFromParametersNode(vtkMRMLTrackedScreenARParametersNode::SafeDownCast(*it));
+  }
 }
 
 //---------------------------------------------------------------------------
 void vtkSlicerTrackedScreenARLogic
-::OnMRMLSceneNodeAdded(vtkMRMLNode* vtkNotUsed(node))
+::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
 {
+  vtkMRMLTrackedScreenARParametersNode* parametersNode = vtkMRMLTrackedScreenARParametersNode::SafeDownCast(node);
+  if (parametersNode == nullptr)
+  {
+    return;
+  }
+
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkCommand::ModifiedEvent);
+  events->InsertNextValue(vtkMRMLNode::ReferenceAddedEvent);
+  events->InsertNextValue(vtkMRMLNode::ReferenceModifiedEvent);
+  events->InsertNextValue(vtkMRMLNode::ReferenceRemovedEvent);
+  vtkObserveMRMLNodeEventsMacro(parametersNode, events.GetPointer());
+  if (!this->GetMRMLScene()->IsBatchProcessing())
+  {
+    this->UpdateFromParametersNode(parametersNode);
+  }
 }
 
 //---------------------------------------------------------------------------
 void vtkSlicerTrackedScreenARLogic
-::OnMRMLSceneNodeRemoved(vtkMRMLNode* vtkNotUsed(node))
+::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  if (node == nullptr || node->GetID() == nullptr)
+  {
+    return;
+  }
+  std::string nodeID = node->GetID();
+
+  if (vtkMRMLTrackedScreenARParametersNode::SafeDownCast(node) != nullptr)
+  {
+    vtkUnObserveMRMLNodeMacro(node);
+    for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+    {
+      if ((*it)->GetParametersNodeID() == nodeID)
+      {
+        this->RemoveViewBinding((*it)->GetViewNodeID());
+        break;
+      }
+    }
+    return;
+  }
+
+  if (node == this->CalibrationMarkerNode)
+  {
+    this->SetCalibrationMarkerNode(nullptr);
+  }
+
+  // Copy, removing a view binding changes the list
+  std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> > bindings = this->ViewBindings;
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = bindings.begin(); it != bindings.end(); ++it)
+  {
+    vtkTrackedScreenARViewBinding* binding = *it;
+    if (binding->GetViewNodeID() == nodeID)
+    {
+      this->RemoveViewBinding(nodeID);
+      continue;
+    }
+    if (binding->GetVideoSource() != nullptr && binding->GetVideoSource()->GetVideoSourceNodeID() == nodeID)
+    {
+      this->SetVideoSourceNode(binding, nullptr);
+    }
+    if (node == binding->CameraParametersNode)
+    {
+      this->SetCameraParametersNode(binding, nullptr);
+    }
+    if (node == binding->CameraTransformNode)
+    {
+      this->SetCameraTransformNode(binding, nullptr);
+    }
+    else if (node == binding->CameraParentTransformNode)
+    {
+      this->UpdateCameraParentTransformNode(binding);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerTrackedScreenARLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
 {
+  if (caller == nullptr)
+  {
+    this->Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+    return;
+  }
+
+  vtkMRMLTrackedScreenARParametersNode* parametersNode = vtkMRMLTrackedScreenARParametersNode::SafeDownCast(caller);
+  if (parametersNode != nullptr)
+  {
+    if (this->GetMRMLScene() != nullptr && !this->GetMRMLScene()->IsBatchProcessing())
+    {
+      this->UpdateFromParametersNode(parametersNode);
+    }
+    return;
+  }
+
+  if (event == vtkMRMLVolumeNode::ImageDataModifiedEvent)
+  {
+    for (std::map<std::string, vtkSmartPointer<vtkTrackedScreenARVideoSource> >::iterator it = this->VideoSources.begin(); it != this->VideoSources.end(); ++it)
+    {
+      if (it->second->GetVideoSourceNode() == caller)
+      {
+        this->OnVideoImageModified(it->second);
+        return;
+      }
+    }
+  }
+
+  bool handled = false;
+  if (caller == this->CalibrationMarkerNode && event == vtkMRMLTransformableNode::TransformModifiedEvent)
+  {
+    // The marker may also be the parent of a camera transform, which the views handle below
+    this->AddCalibrationMarkerPose();
+    handled = true;
+  }
+
+  double now = vtkTimerLog::GetUniversalTime();
+  double arrivalTime = this->GetArrivalTime();
+  vtkNew<vtkMatrix4x4> cameraToWorld;
+  bool cameraToWorldValid = false;
+  for (std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> >::iterator it = this->ViewBindings.begin(); it != this->ViewBindings.end(); ++it)
+  {
+    vtkTrackedScreenARViewBinding* binding = *it;
+    if (caller == binding->CameraTransformNode && event == vtkMRMLTransformableNode::TransformModifiedEvent)
+    {
+      // Also sent when the camera transform is moved in the hierarchy
+      if (binding->CameraTransformNode->GetParentTransformNode() != binding->CameraParentTransformNode)
+      {
+        this->UpdateCameraParentTransformNode(binding);
+      }
+      // Views tracking the same transform share the matrix, each keeps its own history
+      vtkAugmentedRealityTelemetryScope ingestScope(this->Telemetry, vtkAugmentedRealityTelemetry::Ingest);
+      if (!cameraToWorldValid)
+      {
+        binding->GetCameraTransformToWorld(cameraToWorld.GetPointer());
+        cameraToWorldValid = true;
+      }
+      binding->GetPoseBuffer()->AddPose(arrivalTime, cameraToWorld.GetPointer());
+      binding->GetPosePredictor()->AddMeasurement(arrivalTime, cameraToWorld.GetPointer());
+      binding->GetLatencyMonitor()->RecordPoseArrival(arrivalTime);
+      binding->RequestRender(vtkTrackedScreenARFramePacer::PoseSource);
+      handled = true;
+    }
+    else if (caller == binding->CameraParentTransformNode && event == vtkMRMLTransformableNode::TransformModifiedEvent)
+    {
+      // The camera transform node sends its own TransformModifiedEvent next, which presents the new pose
+      binding->InvalidateCameraParentToWorld();
+      handled = true;
+    }
+    else if (caller == binding->CameraParametersNode && event == vtkCommand::ModifiedEvent)
+    {
+      this->UpdateLensParameters(binding);
+      this->RequestProjectionUpdate(binding);
+      handled = true;
+    }
+    else if (caller == binding->RenderWindow)
+    {
+      if (event == vtkCommand::StartEvent)
+      {
+        // Replayed frames and poses are timestamped on the recording clock, their age is meaningless here
+        if (binding->GetViewNodeID() != this->PlayedViewNodeID)
+        {
+          binding->GetLatencyMonitor()->RecordRenderStart(now);
+        }
+        binding->RenderStartTelemetryTime = this->Telemetry->GetTime();
+        binding->RenderStartTime = now;
+      }
+      else if (event == vtkCommand::EndEvent)
+      {
+        binding->GetLatencyMonitor()->RecordRenderEnd(now);
+        if (binding->RenderStartTelemetryTime >= 0.0)
+        {
+          this->Telemetry->RecordEvent(vtkAugmentedRealityTelemetry::Render, binding->RenderStartTelemetryTime, this->Telemetry->GetTime());
+          binding->RenderStartTelemetryTime = -1.0;
+        }
+        if (binding->RenderStartTime >= 0.0)
+        {
+          vtkTrackedScreenARQualityGovernor* governor = binding->GetQualityGovernor();
+          if (governor->AddFrameTime(binding->FrameWorkTime + now - binding->RenderStartTime))
+          {
+            this->ApplyQualityLevel(binding, binding->RenderWindow, governor->GetLevel());
+          }
+          binding->RenderStartTime = -1.0;
+          binding->FrameWorkTime = 0.0;
+        }
+        if (binding->GetViewNodeID() == this->RecordedViewNodeID && this->SessionRecorder->IsRecording() && this->SessionRecorder->GetRecordViewFrames())
+        {
+          this->RecordViewFrame(binding);
+        }
+      }
+      else if (event == vtkCommand::WindowResizeEvent)
+      {
+        this->RequestProjectionUpdate(binding);
+      }
+      handled = true;
+    }
+  }
+
+  if (!handled)
+  {
+    this->Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+  }
 }
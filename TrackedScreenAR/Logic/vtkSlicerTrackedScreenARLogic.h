@@ -29,11 +29,34 @@
 
 // MRML includes
 
+// VTK includes
+#include <vtkSmartPointer.h>
+
 // STD includes
 #include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "vtkSlicerTrackedScreenARModuleLogicExport.h"
 
+class vtkAugmentedRealityTelemetry;
+class vtkCamera;
+class vtkMRMLCameraNode;
+class vtkMRMLLinearTransformNode;
+class vtkMRMLPinholeCameraNode;
+class vtkMRMLTableNode;
+class vtkMRMLTrackedScreenARParametersNode;
+class vtkMRMLVolumeNode;
+class vtkMRMLTransformNode;
+class vtkRenderWindow;
+class vtkRenderer;
+class vtkTrackedScreenARHandEyeCalibration;
+class vtkTrackedScreenARPoseBuffer;
+class vtkTrackedScreenARSessionPlayer;
+class vtkTrackedScreenARSessionRecorder;
+class vtkTrackedScreenARVideoSource;
+class vtkTrackedScreenARViewBinding;
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
 class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkSlicerTrackedScreenARLogic :
@@ -45,6 +68,172 @@ public:
   vtkTypeMacro(vtkSlicerTrackedScreenARLogic, vtkSlicerModuleLogic);
   void PrintSelf(ostream& os, vtkIndent indent);
 
+  /// AR binding of the 3D view with the given view node ID, created if it does not exist yet.
+  /// Any number of views can be bound, each with its own video source, camera parameters and camera transform.
+  vtkTrackedScreenARViewBinding* AddViewBinding(const std::string& viewNodeID);
+
+  /// Binding of the given view, nullptr if the view is not bound
+  vtkTrackedScreenARViewBinding* GetViewBinding(const std::string& viewNodeID);
+
+  /// Release the binding of the given view and the video source nobody else uses
+  void RemoveViewBinding(const std::string& viewNodeID);
+
+  int GetNumberOfViewBindings();
+  vtkTrackedScreenARViewBinding* GetNthViewBinding(int index);
+
+  /// Parameters node of the given view, nullptr if the scene has none
+  vtkMRMLTrackedScreenARParametersNode* GetParametersNode(const std::string& viewNodeID);
+
+  /// Parameters node of the given view, added to the scene if it has none yet. The logic binds the view of
+  /// every parameters node of the scene and applies its references and options as they change.
+  vtkMRMLTrackedScreenARParametersNode* AddParametersNode(const std::string& viewNodeID);
+
+  /// Video volume shown in the background of the view, nullptr to disconnect. Views bound to the same
+  /// volume share one vtkTrackedScreenARVideoSource, so each frame is copied, converted and undistorted once.
+  void SetVideoSourceNode(vtkTrackedScreenARViewBinding* binding, vtkMRMLVolumeNode* node);
+
+  /// Video pipeline of the given video volume node, nullptr if no view shows it
+  vtkTrackedScreenARVideoSource* GetVideoSource(const std::string& videoSourceNodeID);
+
+  /// Pinhole camera parameters of the video source. Its intrinsics drive the projection and, with the
+  /// distortion coefficients, the lens undistortion of the video source.
+  void SetCameraParametersNode(vtkTrackedScreenARViewBinding* binding, vtkMRMLPinholeCameraNode* node);
+
+  /// Tracked camera transform. Its updates only mark the pose dirty, the camera follows the
+  /// presented camera transform node which is updated once per rendered frame.
+  void SetCameraTransformNode(vtkTrackedScreenARViewBinding* binding, vtkMRMLLinearTransformNode* node);
+
+  /// Render window displaying the view. The video is shown as background texture of its first renderer,
+  /// whose active camera gets the projection. Its start and end render events are timestamped for the latency
+  /// monitor, and resizing it updates the projection with the next frame. Setting a window resets the frame
+  /// pacer and requests a render for it, with the updates that arrived while no window was attached, so the
+  /// RenderRequestedEvent observer has to be added before.
+  void SetRenderWindow(vtkTrackedScreenARViewBinding* binding, vtkRenderWindow* renderWindow);
+
+  /// Shrink the video to the view before undistortion and texture upload, see vtkTrackedScreenARViewBinding
+  void SetDownscaleVideoToView(vtkTrackedScreenARViewBinding* binding, bool downscale);
+
+  /// Cache the virtual scene of the view between video frames, see vtkTrackedScreenARViewBinding.
+  /// The layer pass wraps the render pass the renderer had, which is restored when turned off.
+  void SetLayeredRendering(vtkTrackedScreenARViewBinding* binding, bool layered);
+
+  /// Adapt the quality of the view to a frame budget, see vtkTrackedScreenARQualityGovernor. The cost of each
+  /// frame, from BeginFrame() to the end of its render, is fed to the governor of the binding and its level
+  /// applied to the view. Depth peeling and ambient shadows are turned off through the view node. Levels
+  /// that would change nothing are skipped: the downscaled video one while DownscaleVideoToView is on,
+  /// the render effects one while LayeredRendering is on. Turning it off restores full quality.
+  void SetAdaptiveQuality(vtkTrackedScreenARViewBinding* binding, bool adaptive);
+
+  /// Frame budget of the adaptive quality of the view, in seconds
+  void SetTargetFrameTime(vtkTrackedScreenARViewBinding* binding, double targetFrameTime);
+
+  /// Update the memoized projection of the view from the camera parameters, video frame size and
+  /// render window size, then apply it to the camera. Also updates the lens parameters and downscale
+  /// factor of the video source. Returns true if the projection or the video pipeline had to change.
+  bool UpdateCameraProjection(vtkTrackedScreenARViewBinding* binding, vtkCamera* camera);
+
+  /// Hidden transform node the view camera should be parented to, created on demand
+  vtkMRMLLinearTransformNode* GetPresentedCameraTransformNode(vtkTrackedScreenARViewBinding* binding);
+
+  /// Update the presented camera transform node of the view, see vtkTrackedScreenARViewBinding::ComputeCameraPose().
+  /// The node is left unmodified if the pose did not change by more than a hundredth of a millimeter.
+  void PresentCameraPose(vtkTrackedScreenARViewBinding* binding);
+
+  /// Camera node of the bound view, found by layout name. nullptr if the scene has none.
+  vtkMRMLCameraNode* GetViewCameraNode(vtkTrackedScreenARViewBinding* binding);
+
+  /// Present the latest camera pose and take it as the reference view of the camera
+  void ResetCameraView(vtkTrackedScreenARViewBinding* binding);
+
+  /// Consume the pending updates for a render of the view starting now, taking the newest video frame,
+  /// presenting the latest camera pose and updating the projection if they changed.
+  /// Returns the mask of dirty sources, 0 if there is nothing to render.
+  int BeginFrame(vtkTrackedScreenARViewBinding* binding);
+
+  /// Arrival time given to the video frames and tracker poses received while it is set, in seconds on the
+  /// vtkTimerLog::GetUniversalTime() clock. Negative (default) to timestamp them when they arrive.
+  /// Set by vtkTrackedScreenARSessionPlayer to the recorded arrival times, so a replayed frame is
+  /// matched with the same pose in every run.
+  vtkSetMacro(ArrivalTimeOverride, double);
+  vtkGetMacro(ArrivalTimeOverride, double);
+
+  /// Arrival time of a sample received now: the override if set, the current time otherwise
+  double GetArrivalTime();
+
+  /// Recorder used by StartSessionRecording(), to configure its queue and read its statistics
+  vtkTrackedScreenARSessionRecorder* GetSessionRecorder();
+
+  /// Record the video frames and camera poses of the view to a session file, and the frame the view
+  /// displayed after each of its renders if the recorder's RecordViewFrames is on. The frames are
+  /// written by a background thread, the render only pays for the pixel readback of the view frames.
+  /// Returns false if the file cannot be created.
+  bool StartSessionRecording(vtkTrackedScreenARViewBinding* binding, const std::string& fileName);
+
+  /// Finish the session file. Returns false if no recording was running or writing failed.
+  bool StopSessionRecording();
+
+  /// Player used by StartSessionPlayback(), to read the session content and position
+  vtkTrackedScreenARSessionPlayer* GetSessionPlayer();
+
+  /// Replay a session file into the video, camera transform and camera parameters nodes of the view.
+  /// The samples are delivered by UpdateSessionPlayback() at the pace they were recorded.
+  /// Returns false if the view has no video or camera transform node or the file cannot be opened.
+  bool StartSessionPlayback(vtkTrackedScreenARViewBinding* binding, const std::string& fileName);
+
+  /// Deliver the samples recorded up to the time elapsed since the playback started, excluding pauses.
+  /// Returns false if no session is playing or its end is reached.
+  bool UpdateSessionPlayback();
+
+  /// Pause the playback and deliver its next frame. Returns false if there is no frame left.
+  bool StepSessionPlayback();
+
+  /// Suspend or resume the playback, the session time does not advance while paused
+  void SetSessionPlaybackPaused(bool paused);
+  bool GetSessionPlaybackPaused();
+
+  /// Close the played session file and release its nodes
+  void StopSessionPlayback();
+
+  /// Hand-eye calibration used by the calibration methods below, to configure it and read its statistics
+  vtkTrackedScreenARHandEyeCalibration* GetHandEyeCalibration();
+
+  /// Tracked marker attached to the video camera. Its poses (matrix to world) are buffered from now on,
+  /// so that calibration samples pair each video frame with the marker pose at the time of the frame.
+  void SetCalibrationMarkerNode(vtkMRMLTransformNode* node);
+  vtkMRMLTransformNode* GetCalibrationMarkerNode();
+
+  /// Add a calibration sample from the calibration pattern detected in the current frame of the video
+  /// volume (matrix to parent of the pattern node, pattern to camera) and the pose of the calibration
+  /// marker interpolated at the acquisition time of that frame, as the views pose their camera. The video
+  /// volume must be the video source of a view. Returns false if a node is missing, no frame or marker
+  /// pose was received, or a calibration is running.
+  bool AddCalibrationSample(vtkMRMLVolumeNode* videoNode, vtkMRMLTransformNode* patternToCameraNode);
+
+  /// Solve the calibration from the collected samples on a worker thread, rendering continues meanwhile.
+  /// Once solved, the camera to marker transform is written to the matrix to parent of the output node,
+  /// meant to be the camera transform placed under the marker transform. Returns false if it could not start.
+  bool StartCalibration(vtkMRMLLinearTransformNode* outputNode);
+
+  /// Write the result of a finished calibration into its output node, on the main thread. BeginFrame() calls it,
+  /// so the result is applied with the next rendered frame. Returns true if a result was written.
+  bool PublishCalibrationResult();
+
+  /// Timing of the pipeline stages of all views: ingest, pixel conversion, projection update,
+  /// render and present. The video pipeline runs when the render pulls the background texture,
+  /// so the render time includes the pixel conversion and the texture upload.
+  vtkAugmentedRealityTelemetry* GetTelemetry();
+
+  /// Table the per-stage aggregates are published to, created in the scene (not saved with it) on first use
+  vtkMRMLTableNode* GetTelemetryTableNode();
+
+  /// Fold the stage timings into aggregates and write them to the telemetry table, once per aggregation
+  /// interval (one second by default). BeginFrame() calls it. Returns true if the table was updated.
+  bool PublishTelemetry();
+
+  /// Write the buffered stage timings as a Chrome trace, for chrome://tracing or ui.perfetto.dev.
+  /// Returns false if the file cannot be written.
+  bool WriteTelemetryTrace(const std::string& fileName);
+
 protected:
   vtkSlicerTrackedScreenARLogic();
   virtual ~vtkSlicerTrackedScreenARLogic();
@@ -55,6 +244,91 @@ protected:
   virtual void UpdateFromMRMLScene();
   virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node);
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
+  virtual void ProcessMRMLSceneEvents(vtkObject* caller, unsigned long event, void* callData);
+  virtual void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData);
+
+  /// Copy the camera parameters of the binding into its video source, unless another view sharing the
+  /// source uses a different lens. Returns true if the pipeline changed.
+  bool UpdateLensParameters(vtkTrackedScreenARViewBinding* binding);
+
+  /// Apply the pixel format of the parameters node of the binding to its video source, unless another
+  /// view sharing the source asks for a different one. Returns true if the pipeline changed.
+  bool UpdatePixelFormat(vtkTrackedScreenARViewBinding* binding);
+
+  /// Set or clear a vtkTrackedScreenARViewBinding::VideoSourceConflictFlags flag, warns when it gets set
+  void SetVideoSourceConflict(vtkTrackedScreenARViewBinding* binding, int conflict, bool set);
+
+  /// Apply the smallest downscale factor requested by the views sharing the source.
+  /// Returns true if the pipeline changed.
+  bool UpdateShrinkFactor(vtkTrackedScreenARVideoSource* source);
+
+  /// Release the video source if no binding uses it anymore
+  void ReleaseVideoSource(vtkTrackedScreenARVideoSource* source);
+
+  /// Push the new frame of an observed video volume and request a render of the views showing it
+  void OnVideoImageModified(vtkTrackedScreenARVideoSource* source);
+
+  /// Observe the current parent of the camera transform of the binding and drop its cached world matrix
+  void UpdateCameraParentTransformNode(vtkTrackedScreenARViewBinding* binding);
+
+  /// Hand the frame just rendered in the view to the session recorder
+  void RecordViewFrame(vtkTrackedScreenARViewBinding* binding);
+
+  /// Buffer the current pose of the calibration marker
+  void AddCalibrationMarkerPose();
+
+  /// Bind the view of the parameters node and apply its references and options
+  void UpdateFromParametersNode(vtkMRMLTrackedScreenARParametersNode* node);
+
+  /// Show the video source of the binding, if any, in the background of its render window
+  void UpdateBackgroundTexture(vtkTrackedScreenARViewBinding* binding);
+
+  /// Parent the view camera to the presented camera transform if the binding has a camera transform,
+  /// release it otherwise
+  void UpdateViewCamera(vtkTrackedScreenARViewBinding* binding);
+
+  /// Install the scene layer pass of the binding on the renderer, wrapping its current pass, or restore
+  /// that pass and release the layer
+  void UpdateSceneLayerPass(vtkTrackedScreenARViewBinding* binding, vtkRenderer* renderer, bool install);
+
+  /// Apply a vtkTrackedScreenARQualityGovernor level to the video source and renderer of the view. The renderer
+  /// settings a level overrides are saved when entering it and restored when leaving it.
+  void ApplyQualityLevel(vtkTrackedScreenARViewBinding* binding, vtkRenderWindow* renderWindow, int level);
+
+  /// Turn depth peeling and shadows off on the view node of the binding, saving them, or restore them.
+  /// They are restored while the scene is saved, so a saved scene never keeps the degraded settings.
+  void SetExpensivePassesDisabled(vtkTrackedScreenARViewBinding* binding, bool disabled);
+
+  /// Have the next frame of the view update its projection
+  void RequestProjectionUpdate(vtkTrackedScreenARViewBinding* binding);
+
+protected:
+  std::vector<vtkSmartPointer<vtkTrackedScreenARViewBinding> > ViewBindings;
+  std::map<std::string, vtkSmartPointer<vtkTrackedScreenARVideoSource> > VideoSources;
+
+  double ArrivalTimeOverride;
+
+  vtkSmartPointer<vtkTrackedScreenARSessionRecorder> SessionRecorder;
+  // View whose composited frames are recorded, empty if none
+  std::string RecordedViewNodeID;
+
+  vtkSmartPointer<vtkTrackedScreenARSessionPlayer> SessionPlayer;
+  // View the session is played into, empty if none
+  std::string PlayedViewNodeID;
+  // Universal time the session time is measured from, and session time while paused
+  double SessionPlaybackStartTime;
+  double SessionPlaybackPausedTime;
+  bool SessionPlaybackPaused;
+
+  vtkSmartPointer<vtkTrackedScreenARHandEyeCalibration> HandEyeCalibration;
+  vtkMRMLTransformNode* CalibrationMarkerNode;
+  vtkSmartPointer<vtkTrackedScreenARPoseBuffer> CalibrationMarkerPoses;
+  // Node the running calibration is published to, empty if none
+  std::string CalibrationOutputNodeID;
+
+  vtkSmartPointer<vtkAugmentedRealityTelemetry> Telemetry;
+  std::string TelemetryTableNodeID;
+
 private:
 
   vtkSlicerTrackedScreenARLogic(const vtkSlicerTrackedScreenARLogic&); // Not implemented
@@ -0,0 +1,347 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARDownscaleFilter.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+// STD includes
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // 8-bit frames: block sums fit in 16 bits for factors up to 8, the average is a
+  // fixed-point multiply by the reciprocal of the block area. Common factors are
+  // compile-time constants (F > 0) so the block loops unroll and vectorize.
+  // Each thread sums into its own accumulator row, allocated once rather than per chunk.
+  template <int NC, int F>
+  struct BoxShrinkUnsignedCharFunctor
+  {
+    const unsigned char* Input;
+    unsigned char* Output;
+    int InputWidth;
+    int OutputWidth;
+    int Factor;
+    vtkSMPThreadLocal<std::vector<unsigned short> > RowSums;
+
+    void Initialize()
+    {
+      const int factor = F > 0 ? F : this->Factor;
+      this->RowSums.Local().resize(this->OutputWidth * factor * NC);
+    }
+
+    void operator()(vtkIdType beginRow, vtkIdType endRow)
+    {
+      const int factor = F > 0 ? F : this->Factor;
+      const vtkIdType inputRowLength = static_cast<vtkIdType>(this->InputWidth) * NC;
+      const int usedRowLength = this->OutputWidth * factor * NC;
+      const unsigned int reciprocal = (65536u + factor * factor / 2) / (factor * factor);
+      std::vector<unsigned short>& rowSums = this->RowSums.Local();
+
+      for (vtkIdType outRow = beginRow; outRow < endRow; ++outRow)
+      {
+        // Sum the block rows, contiguous and branch-free
+        const unsigned char* in = this->Input + outRow * factor * inputRowLength;
+        for (int i = 0; i < usedRowLength; ++i)
+        {
+          rowSums[i] = in[i];
+        }
+        for (int blockRow = 1; blockRow < factor; ++blockRow)
+        {
+          in += inputRowLength;
+          for (int i = 0; i < usedRowLength; ++i)
+          {
+            rowSums[i] += in[i];
+          }
+        }
+
+        // Sum the block columns and scale
+        unsigned char* out = this->Output + outRow * this->OutputWidth * NC;
+        const unsigned short* sums = rowSums.data();
+        for (int outColumn = 0; outColumn < this->OutputWidth; ++outColumn, sums += factor * NC, out += NC)
+        {
+          for (int component = 0; component < NC; ++component)
+          {
+            unsigned int sum = 0;
+            for (int blockColumn = 0; blockColumn < factor; ++blockColumn)
+            {
+              sum += sums[blockColumn * NC + component];
+            }
+            out[component] = static_cast<unsigned char>((sum * reciprocal + 32768u) >> 16);
+          }
+        }
+      }
+    }
+
+    void Reduce()
+    {
+      // Output rows are written by exactly one thread, nothing to merge
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  // Other scalar types, averaged in double precision
+  template <class T>
+  struct BoxShrinkFunctor
+  {
+    const T* Input;
+    T* Output;
+    int InputWidth;
+    int OutputWidth;
+    int NumberOfComponents;
+    int Factor;
+    vtkSMPThreadLocal<std::vector<double> > RowSums;
+
+    void Initialize()
+    {
+      this->RowSums.Local().resize(this->OutputWidth * this->Factor * this->NumberOfComponents);
+    }
+
+    void operator()(vtkIdType beginRow, vtkIdType endRow)
+    {
+      const int factor = this->Factor;
+      const int nc = this->NumberOfComponents;
+      const vtkIdType inputRowLength = static_cast<vtkIdType>(this->InputWidth) * nc;
+      const int usedRowLength = this->OutputWidth * factor * nc;
+      const double scale = 1.0 / (factor * factor);
+      std::vector<double>& rowSums = this->RowSums.Local();
+
+      for (vtkIdType outRow = beginRow; outRow < endRow; ++outRow)
+      {
+        const T* in = this->Input + outRow * factor * inputRowLength;
+        std::fill(rowSums.begin(), rowSums.end(), 0.0);
+        for (int blockRow = 0; blockRow < factor; ++blockRow, in += inputRowLength)
+        {
+          for (int i = 0; i < usedRowLength; ++i)
+          {
+            rowSums[i] += in[i];
+          }
+        }
+
+        T* out = this->Output + outRow * this->OutputWidth * nc;
+        const double* sums = rowSums.data();
+        for (int outColumn = 0; outColumn < this->OutputWidth; ++outColumn, sums += factor * nc, out += nc)
+        {
+          for (int component = 0; component < nc; ++component)
+          {
+            double sum = 0.0;
+            for (int blockColumn = 0; blockColumn < factor; ++blockColumn)
+            {
+              sum += sums[blockColumn * nc + component];
+            }
+            out[component] = static_cast<T>(sum * scale);
+          }
+        }
+      }
+    }
+
+    void Reduce()
+    {
+      // Output rows are written by exactly one thread, nothing to merge
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  template <int NC, int F>
+  void BoxShrinkUnsignedChar(const unsigned char* input, unsigned char* output, int inputWidth, const int outputSize[2], int factor)
+  {
+    BoxShrinkUnsignedCharFunctor<NC, F> functor;
+    functor.Input = input;
+    functor.Output = output;
+    functor.InputWidth = inputWidth;
+    functor.OutputWidth = outputSize[0];
+    functor.Factor = factor;
+    vtkSMPTools::For(0, outputSize[1], functor);
+  }
+
+  //----------------------------------------------------------------------------
+  template <int NC>
+  void BoxShrinkUnsignedChar(const unsigned char* input, unsigned char* output, int inputWidth, const int outputSize[2], int factor)
+  {
+    switch (factor)
+    {
+      case 2:
+        BoxShrinkUnsignedChar<NC, 2>(input, output, inputWidth, outputSize, factor);
+        break;
+      case 3:
+        BoxShrinkUnsignedChar<NC, 3>(input, output, inputWidth, outputSize, factor);
+        break;
+      case 4:
+        BoxShrinkUnsignedChar<NC, 4>(input, output, inputWidth, outputSize, factor);
+        break;
+      default:
+        BoxShrinkUnsignedChar<NC, 0>(input, output, inputWidth, outputSize, factor);
+        break;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARDownscaleFilter);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARDownscaleFilter::vtkTrackedScreenARDownscaleFilter()
+  : ShrinkFactor(1)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARDownscaleFilter::~vtkTrackedScreenARDownscaleFilter()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARDownscaleFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "ShrinkFactor: " << this->ShrinkFactor << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARDownscaleFilter::ShrinkIntrinsics(const double intrinsics[4], int shrinkFactor, double shrunkIntrinsics[4])
+{
+  // Output pixel centers sit in the middle of their input block
+  const double factor = shrinkFactor;
+  const double offset = (factor - 1.0) / 2.0;
+  shrunkIntrinsics[0] = intrinsics[0] / factor;
+  shrunkIntrinsics[1] = intrinsics[1] / factor;
+  shrunkIntrinsics[2] = (intrinsics[2] - offset) / factor;
+  shrunkIntrinsics[3] = (intrinsics[3] - offset) / factor;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARDownscaleFilter::RequestInformation(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector,
+    vtkInformationVector* outputVector)
+{
+  if (this->ShrinkFactor == 1)
+  {
+    return 1;
+  }
+
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+
+  int extent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent);
+  for (int axis = 0; axis < 2; ++axis)
+  {
+    int size = (extent[2 * axis + 1] - extent[2 * axis] + 1) / this->ShrinkFactor;
+    extent[2 * axis + 1] = extent[2 * axis] + std::max(1, size) - 1;
+  }
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARDownscaleFilter::RequestUpdateExtent(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector,
+    vtkInformationVector* vtkNotUsed(outputVector))
+{
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARDownscaleFilter::RequestData(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector,
+    vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkImageData* output = vtkImageData::GetData(outputVector);
+  if (input == nullptr || output == nullptr)
+  {
+    return 0;
+  }
+
+  const int factor = this->ShrinkFactor;
+  int* dimensions = input->GetDimensions();
+  if (factor == 1 || input->GetPointData()->GetScalars() == nullptr
+      || dimensions[0] < factor || dimensions[1] < factor || dimensions[2] != 1)
+  {
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  // Trailing pixels that do not fill a whole block are dropped
+  const int outputSize[2] = { dimensions[0] / factor, dimensions[1] / factor };
+  const int numberOfComponents = input->GetNumberOfScalarComponents();
+  int* inputExtent = input->GetExtent();
+  double spacing[3];
+  input->GetSpacing(spacing);
+  spacing[0] *= factor;
+  spacing[1] *= factor;
+  output->SetOrigin(input->GetOrigin());
+  output->SetSpacing(spacing);
+  output->SetExtent(inputExtent[0], inputExtent[0] + outputSize[0] - 1, inputExtent[2], inputExtent[2] + outputSize[1] - 1,
+                    inputExtent[4], inputExtent[5]);
+  // AllocateScalars reuses the output array while type and size are unchanged, so steady state does not allocate
+  output->AllocateScalars(input->GetScalarType(), numberOfComponents);
+
+  void* inPtr = input->GetScalarPointer();
+  void* outPtr = output->GetScalarPointer();
+
+  if (input->GetScalarType() == VTK_UNSIGNED_CHAR && numberOfComponents >= 1 && numberOfComponents <= 4)
+  {
+    const unsigned char* in = static_cast<const unsigned char*>(inPtr);
+    unsigned char* out = static_cast<unsigned char*>(outPtr);
+    switch (numberOfComponents)
+    {
+      case 1:
+        BoxShrinkUnsignedChar<1>(in, out, dimensions[0], outputSize, factor);
+        break;
+      case 2:
+        BoxShrinkUnsignedChar<2>(in, out, dimensions[0], outputSize, factor);
+        break;
+      case 3:
+        BoxShrinkUnsignedChar<3>(in, out, dimensions[0], outputSize, factor);
+        break;
+      default:
+        BoxShrinkUnsignedChar<4>(in, out, dimensions[0], outputSize, factor);
+        break;
+    }
+    return 1;
+  }
+
+  switch (input->GetScalarType())
+  {
+    vtkTemplateMacro(
+      BoxShrinkFunctor<VTK_TT> functor;
+      functor.Input = static_cast<const VTK_TT*>(inPtr);
+      functor.Output = static_cast<VTK_TT*>(outPtr);
+      functor.InputWidth = dimensions[0];
+      functor.OutputWidth = outputSize[0];
+      functor.NumberOfComponents = numberOfComponents;
+      functor.Factor = factor;
+      vtkSMPTools::For(0, outputSize[1], functor));
+    default:
+      vtkErrorMacro("RequestData: unsupported scalar type " << input->GetScalarTypeAsString());
+      return 0;
+  }
+
+  return 1;
+}
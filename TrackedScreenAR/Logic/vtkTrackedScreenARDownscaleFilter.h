@@ -0,0 +1,69 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARDownscaleFilter - box-filter shrink of video frames
+// .SECTION Description
+// Averages ShrinkFactor x ShrinkFactor blocks of pixels, so a frame much larger than
+// the view is reduced before undistortion and texture upload. Rows are summed into an
+// accumulator row first, which keeps the inner loops contiguous for the compiler to
+// vectorize, and output rows are split across cores with vtkSMPTools. The output
+// scalars are reused from frame to frame. A factor of 1 passes the input through
+// without copying.
+//
+// Output pixel i covers input pixels [i * f, i * f + f - 1], see ShrinkIntrinsics()
+// for the matching camera intrinsics.
+
+#ifndef __vtkTrackedScreenARDownscaleFilter_h
+#define __vtkTrackedScreenARDownscaleFilter_h
+
+// VTK includes
+#include <vtkImageAlgorithm.h>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARDownscaleFilter : public vtkImageAlgorithm
+{
+public:
+  static vtkTrackedScreenARDownscaleFilter* New();
+  vtkTypeMacro(vtkTrackedScreenARDownscaleFilter, vtkImageAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Integer shrink factor along both axes, 1 (pass-through) by default
+  vtkSetClampMacro(ShrinkFactor, int, 1, 8);
+  vtkGetMacro(ShrinkFactor, int);
+
+  /// Intrinsics (fx, fy, cx, cy) of the shrunk image given those of the full image
+  static void ShrinkIntrinsics(const double intrinsics[4], int shrinkFactor, double shrunkIntrinsics[4]);
+
+protected:
+  vtkTrackedScreenARDownscaleFilter();
+  virtual ~vtkTrackedScreenARDownscaleFilter();
+
+  virtual int RequestInformation(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+  virtual int RequestUpdateExtent(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+  virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+
+protected:
+  int ShrinkFactor;
+
+private:
+  vtkTrackedScreenARDownscaleFilter(const vtkTrackedScreenARDownscaleFilter&); // Not implemented
+  void operator=(const vtkTrackedScreenARDownscaleFilter&); // Not implemented
+};
+
+#endif
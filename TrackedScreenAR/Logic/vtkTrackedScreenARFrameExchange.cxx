@@ -0,0 +1,183 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARFrameExchange.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARFrameExchange);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARFrameExchange::vtkTrackedScreenARFrameExchange()
+  : WriteIndex(0)
+  , ReadIndex(1)
+  , SharedState(2)
+  , NumberOfPublishedFrames(0)
+  , NumberOfAcquiredFrames(0)
+  , NumberOfDroppedFrames(0)
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    this->Slots[i] = vtkImageData::New();
+    this->Timestamps[i] = -1.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARFrameExchange::~vtkTrackedScreenARFrameExchange()
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    this->Slots[i]->Delete();
+    this->Slots[i] = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARFrameExchange::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfPublishedFrames: " << this->GetNumberOfPublishedFrames() << std::endl;
+  os << indent << "NumberOfAcquiredFrames: " << this->GetNumberOfAcquiredFrames() << std::endl;
+  os << indent << "NumberOfDroppedFrames: " << this->GetNumberOfDroppedFrames() << std::endl;
+  os << indent << "ReadFrameTimestamp: " << this->GetReadFrameTimestamp() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkTrackedScreenARFrameExchange::GetWriteFrame()
+{
+  return this->Slots[this->WriteIndex];
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARFrameExchange::PublishFrame(double timestamp)
+{
+  this->Timestamps[this->WriteIndex] = timestamp;
+
+  // Release makes the frame contents visible to the consumer that picks the slot up,
+  // acquire makes sure the consumer is done with the slot we get back
+  int previous = this->SharedState.exchange(this->WriteIndex | NewFrameFlag, std::memory_order_acq_rel);
+  this->WriteIndex = previous & SlotIndexMask;
+
+  ++this->NumberOfPublishedFrames;
+  if ((previous & NewFrameFlag) != 0)
+  {
+    // The consumer never saw the frame we just took back
+    ++this->NumberOfDroppedFrames;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARFrameExchange::WriteFrame(vtkImageData* image, double timestamp)
+{
+  vtkDataArray* scalars = (image != nullptr ? image->GetPointData()->GetScalars() : nullptr);
+  if (scalars == nullptr)
+  {
+    return false;
+  }
+
+  vtkImageData* frame = this->GetWriteFrame();
+  frame->CopyStructure(image);
+  // AllocateScalars reuses the slot array unless it is shared with a shallow copy downstream, so this never writes into a frame being read
+  frame->AllocateScalars(image->GetScalarType(), image->GetNumberOfScalarComponents());
+  memcpy(frame->GetScalarPointer(), image->GetScalarPointer(), scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents() * scalars->GetDataTypeSize());
+  frame->Modified();
+
+  this->PublishFrame(timestamp);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARFrameExchange::ShareFrame(vtkImageData* image, double timestamp)
+{
+  vtkDataArray* scalars = (image != nullptr ? image->GetPointData()->GetScalars() : nullptr);
+  if (scalars == nullptr)
+  {
+    return false;
+  }
+
+  // The slot references the image array, a later WriteFrame() into this slot allocates its own
+  vtkImageData* frame = this->GetWriteFrame();
+  frame->CopyStructure(image);
+  frame->GetPointData()->SetScalars(scalars);
+  frame->Modified();
+
+  this->PublishFrame(timestamp);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARFrameExchange::AcquireLatestFrame()
+{
+  if ((this->SharedState.load(std::memory_order_relaxed) & NewFrameFlag) == 0)
+  {
+    return false;
+  }
+
+  int previous = this->SharedState.exchange(this->ReadIndex, std::memory_order_acq_rel);
+  this->ReadIndex = previous & SlotIndexMask;
+  ++this->NumberOfAcquiredFrames;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkTrackedScreenARFrameExchange::GetReadFrame()
+{
+  return this->Slots[this->ReadIndex];
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARFrameExchange::GetReadFrameTimestamp() const
+{
+  return this->Timestamps[this->ReadIndex];
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkTrackedScreenARFrameExchange::GetNumberOfPublishedFrames() const
+{
+  return this->NumberOfPublishedFrames.load();
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkTrackedScreenARFrameExchange::GetNumberOfAcquiredFrames() const
+{
+  return this->NumberOfAcquiredFrames.load();
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkTrackedScreenARFrameExchange::GetNumberOfDroppedFrames() const
+{
+  return this->NumberOfDroppedFrames.load();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARFrameExchange::ResetFrameCounts()
+{
+  this->NumberOfPublishedFrames = 0;
+  this->NumberOfAcquiredFrames = 0;
+  this->NumberOfDroppedFrames = 0;
+}
@@ -0,0 +1,117 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARFrameExchange - latest-frame-wins triple buffer of video frames
+// .SECTION Description
+// Hands video frames from one producer to one consumer (the renderer) through three
+// image slots: one owned by the producer, one owned by the consumer and one shared.
+// Publishing a frame swaps the producer slot with the shared one, acquiring swaps the
+// shared slot with the consumer one, both with a single atomic exchange, so neither
+// side ever waits for the other and a frame is never written while it is read.
+//
+// The consumer always gets the newest published frame. A frame that is replaced by a
+// newer one before the consumer acquired it is dropped and counted, latency stays
+// bounded to one frame however slow the consumer is.
+//
+// A producer on another thread copies its image with WriteFrame(), since it may
+// overwrite the image while the consumer reads the frame. A producer on the consumer
+// thread, such as an observer of a video volume node, cannot write during a render
+// and publishes its image without a copy with ShareFrame().
+
+#ifndef __vtkTrackedScreenARFrameExchange_h
+#define __vtkTrackedScreenARFrameExchange_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <atomic>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARFrameExchange : public vtkObject
+{
+public:
+  static vtkTrackedScreenARFrameExchange* New();
+  vtkTypeMacro(vtkTrackedScreenARFrameExchange, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Producer: slot to fill before PublishFrame(). It stays owned by the producer until then.
+  vtkImageData* GetWriteFrame();
+
+  /// Producer: make the write frame the newest frame and take a free slot for the next one
+  void PublishFrame(double timestamp);
+
+  /// Producer: copy the image into the write frame and publish it. The slot scalars are reused
+  /// unless the frame type changed or a consumer still holds a reference to them.
+  /// Returns false if the image has no scalars.
+  bool WriteFrame(vtkImageData* image, double timestamp);
+
+  /// Producer on the consumer thread: publish the image scalars themselves instead of a copy.
+  /// The image must not be written while the consumer may read the frame, which holds when
+  /// both run on the same thread. Returns false if the image has no scalars.
+  bool ShareFrame(vtkImageData* image, double timestamp);
+
+  /// Consumer: take the newest published frame if there is one the consumer has not seen.
+  /// Returns false (and keeps the current read frame) otherwise.
+  bool AcquireLatestFrame();
+
+  /// Consumer: frame taken by the last successful AcquireLatestFrame(), empty before that
+  vtkImageData* GetReadFrame();
+  double GetReadFrameTimestamp() const;
+
+  /// Frames published, acquired, and replaced before they could be acquired
+  unsigned long long GetNumberOfPublishedFrames() const;
+  unsigned long long GetNumberOfAcquiredFrames() const;
+  unsigned long long GetNumberOfDroppedFrames() const;
+  void ResetFrameCounts();
+
+protected:
+  vtkTrackedScreenARFrameExchange();
+  virtual ~vtkTrackedScreenARFrameExchange();
+
+  // The shared state packs the index of the shared slot with a flag telling whether it holds
+  // a frame the consumer has not taken yet
+  enum
+  {
+    SlotIndexMask = 0x3,
+    NewFrameFlag = 0x4
+  };
+
+protected:
+  vtkImageData* Slots[3];
+  double Timestamps[3];
+
+  // Only touched by the producer
+  int WriteIndex;
+  // Only touched by the consumer
+  int ReadIndex;
+  std::atomic<int> SharedState;
+
+  std::atomic<unsigned long long> NumberOfPublishedFrames;
+  std::atomic<unsigned long long> NumberOfAcquiredFrames;
+  std::atomic<unsigned long long> NumberOfDroppedFrames;
+
+private:
+  vtkTrackedScreenARFrameExchange(const vtkTrackedScreenARFrameExchange&); // Not implemented
+  void operator=(const vtkTrackedScreenARFrameExchange&); // Not implemented
+};
+
+#endif
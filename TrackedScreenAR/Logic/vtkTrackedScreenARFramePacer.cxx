@@ -0,0 +1,121 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARFramePacer.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARFramePacer);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARFramePacer::vtkTrackedScreenARFramePacer()
+  : TargetFPS(60.0)
+  , DirtySources(0)
+  , LastFrameTimestamp(-1.0)
+  , RenderCount(0)
+  , DroppedUpdateCount(0)
+  , MergedUpdateCount(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARFramePacer::~vtkTrackedScreenARFramePacer()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARFramePacer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "TargetFPS: " << this->TargetFPS << std::endl;
+  os << indent << "DirtySources: " << this->DirtySources << std::endl;
+  os << indent << "RenderCount: " << this->RenderCount << std::endl;
+  os << indent << "DroppedUpdateCount: " << this->DroppedUpdateCount << std::endl;
+  os << indent << "MergedUpdateCount: " << this->MergedUpdateCount << std::endl;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARFramePacer::MarkDirty(int source)
+{
+  bool wasPending = this->DirtySources != 0;
+
+  if ((this->DirtySources & source) != 0)
+  {
+    this->DroppedUpdateCount++;
+  }
+  else if (wasPending)
+  {
+    this->MergedUpdateCount++;
+  }
+
+  this->DirtySources |= source;
+  return !wasPending;
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARFramePacer::GetDelayToNextFrame(double timestamp) const
+{
+  if (this->LastFrameTimestamp < 0.0)
+  {
+    return 0.0;
+  }
+  double nextFrameTimestamp = this->LastFrameTimestamp + 1.0 / this->TargetFPS;
+  return std::max(0.0, nextFrameTimestamp - timestamp);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARFramePacer::IsRenderPending() const
+{
+  return this->DirtySources != 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARFramePacer::BeginFrame(double timestamp)
+{
+  int dirtySources = this->DirtySources;
+  if (dirtySources == 0)
+  {
+    return 0;
+  }
+
+  this->DirtySources = 0;
+  this->LastFrameTimestamp = timestamp;
+  this->RenderCount++;
+  return dirtySources;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARFramePacer::Reset()
+{
+  this->DirtySources = 0;
+  this->LastFrameTimestamp = -1.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARFramePacer::ResetStatistics()
+{
+  this->RenderCount = 0;
+  this->DroppedUpdateCount = 0;
+  this->MergedUpdateCount = 0;
+}
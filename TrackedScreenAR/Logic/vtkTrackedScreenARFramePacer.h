@@ -0,0 +1,104 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARFramePacer - coalesces dirty sources into one render per display tick
+// .SECTION Description
+// Video frames, tracker poses and scene changes mark the pacer dirty. The pacer
+// answers when the next render is due so that at most one render is issued per
+// target interval, no matter how many sources changed in between. Updates that
+// are superseded before they are rendered are counted as dropped, updates that
+// join an already pending render are counted as merged.
+
+#ifndef __vtkTrackedScreenARFramePacer_h
+#define __vtkTrackedScreenARFramePacer_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARFramePacer : public vtkObject
+{
+public:
+  enum DirtySource
+  {
+    VideoSource = 0x1,
+    PoseSource = 0x2,
+    /// Scene or display changes, e.g. a render requested by a displayable manager of the view
+    SceneSource = 0x4
+  };
+
+  static vtkTrackedScreenARFramePacer* New();
+  vtkTypeMacro(vtkTrackedScreenARFramePacer, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Target render rate, in frames per second
+  vtkSetClampMacro(TargetFPS, double, 1.0, 1000.0);
+  vtkGetMacro(TargetFPS, double);
+
+  /// Mark a source dirty.
+  /// Returns true if no render was pending yet, i.e. the caller has to schedule one.
+  bool MarkDirty(int source);
+
+  /// Time in seconds until the pending render is due (0 if it is due now)
+  double GetDelayToNextFrame(double timestamp) const;
+
+  /// True if at least one source is dirty
+  bool IsRenderPending() const;
+
+  /// Consume the dirty sources for a render starting at the given time.
+  /// Returns the mask of dirty sources, 0 if there is nothing to render.
+  int BeginFrame(double timestamp);
+
+  /// Dirty sources not yet consumed by BeginFrame
+  vtkGetMacro(DirtySources, int);
+
+  /// Number of renders issued through BeginFrame
+  vtkGetMacro(RenderCount, unsigned long);
+
+  /// Number of updates from a source that were superseded by a newer update before being rendered
+  vtkGetMacro(DroppedUpdateCount, unsigned long);
+
+  /// Number of updates that joined a render already pending for another source
+  vtkGetMacro(MergedUpdateCount, unsigned long);
+
+  void ResetStatistics();
+
+  /// Forget the dirty sources and the time of the last render, e.g. when a render was requested that no
+  /// one will issue. The next MarkDirty() then asks for a render due right away. Statistics are kept.
+  void Reset();
+
+protected:
+  vtkTrackedScreenARFramePacer();
+  virtual ~vtkTrackedScreenARFramePacer();
+
+protected:
+  double TargetFPS;
+  int DirtySources;
+  double LastFrameTimestamp;
+
+  unsigned long RenderCount;
+  unsigned long DroppedUpdateCount;
+  unsigned long MergedUpdateCount;
+
+private:
+  vtkTrackedScreenARFramePacer(const vtkTrackedScreenARFramePacer&); // Not implemented
+  void operator=(const vtkTrackedScreenARFramePacer&); // Not implemented
+};
+
+#endif
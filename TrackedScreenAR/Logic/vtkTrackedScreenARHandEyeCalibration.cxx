@@ -0,0 +1,675 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARHandEyeCalibration.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace
+{
+  // Three samples give three motions, two with different rotation axes fix the calibration
+  const int MINIMAL_SAMPLE_SIZE = 3;
+
+  // The inlier set usually settles after two or three refinements
+  const int MAXIMUM_REFINEMENT_ITERATIONS = 10;
+
+  // Rejects sample sets whose motions rotate about a single axis, relative to the largest eigenvalue
+  const double DEGENERACY_TOLERANCE = 1e-9;
+
+  //----------------------------------------------------------------------------
+  // Well-spread generator seed from the user seed and the hypothesis index (SplitMix64 finalizer),
+  // consecutive seeds would give correlated first draws
+  unsigned int HypothesisSeed(unsigned int randomSeed, vtkIdType index)
+  {
+    unsigned long long z = (static_cast<unsigned long long>(randomSeed) << 32) + static_cast<unsigned long long>(index) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<unsigned int>(z ^ (z >> 31));
+  }
+
+  //----------------------------------------------------------------------------
+  // Quaternion of the rotation with a non-negative scalar part. A X = X B preserves the rotation
+  // angle, so A and B quaternions taken this way satisfy q_A q_X = q_X q_B with the same sign.
+  void GetCanonicalQuaternion(const vtkTrackedScreenARRigidTransform& transform, double q[4])
+  {
+    transform.GetQuaternion(q);
+    if (q[0] < 0.0)
+    {
+      for (int i = 0; i < 4; ++i)
+      {
+        q[i] = -q[i];
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Chordal mean: normalized sum of sign-aligned quaternions, mean translation
+  vtkTrackedScreenARRigidTransform MeanPose(const std::vector<vtkTrackedScreenARRigidTransform>& poses, const std::vector<int>& indices)
+  {
+    double qSum[4] = { 0.0, 0.0, 0.0, 0.0 };
+    double pSum[3] = { 0.0, 0.0, 0.0 };
+    double qFirst[4] = { 1.0, 0.0, 0.0, 0.0 };
+    for (size_t n = 0; n < indices.size(); ++n)
+    {
+      const vtkTrackedScreenARRigidTransform& pose = poses[indices[n]];
+      double q[4];
+      pose.GetQuaternion(q);
+      if (n == 0)
+      {
+        std::copy(q, q + 4, qFirst);
+      }
+      double sign = (vtkTrackedScreenARRigidTransform::QuaternionDot(q, qFirst) < 0.0) ? -1.0 : 1.0;
+      for (int i = 0; i < 4; ++i)
+      {
+        qSum[i] += sign * q[i];
+      }
+      for (int i = 0; i < 3; ++i)
+      {
+        pSum[i] += pose.Element[4 * i + 3];
+      }
+    }
+    vtkTrackedScreenARRigidTransform::QuaternionNormalize(qSum);
+    for (int i = 0; i < 3; ++i)
+    {
+      pSum[i] /= indices.size();
+    }
+    return vtkTrackedScreenARRigidTransform::FromQuaternion(qSum, pSum);
+  }
+
+  //----------------------------------------------------------------------------
+  // Distance between the translations and rotation angle (radians) between two rigid transforms
+  void ComputeDeviation(const vtkTrackedScreenARRigidTransform& a, const vtkTrackedScreenARRigidTransform& b,
+                        double& distance, double& angle)
+  {
+    const double* ea = a.Element;
+    const double* eb = b.Element;
+    distance = sqrt((ea[3] - eb[3]) * (ea[3] - eb[3]) + (ea[7] - eb[7]) * (ea[7] - eb[7]) + (ea[11] - eb[11]) * (ea[11] - eb[11]));
+    // trace(Ra^T Rb) = 1 + 2 cos(angle)
+    double trace = 0.0;
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        trace += ea[4 * row + column] * eb[4 * row + column];
+      }
+    }
+    angle = acos(std::max(-1.0, std::min(1.0, (trace - 1.0) / 2.0)));
+  }
+
+  //----------------------------------------------------------------------------
+  struct InlierCriteria
+  {
+    double TranslationThreshold;
+    double RotationThreshold;
+
+    // MSAC cost of a sample: its normalized squared deviation if it is an inlier, 1 otherwise
+    double Cost(const vtkTrackedScreenARRigidTransform& patternToTracker, const vtkTrackedScreenARRigidTransform& consensus, bool& inlier) const
+    {
+      double distance = 0.0;
+      double angle = 0.0;
+      ComputeDeviation(patternToTracker, consensus, distance, angle);
+      inlier = (distance <= this->TranslationThreshold && angle <= this->RotationThreshold);
+      if (!inlier)
+      {
+        return 1.0;
+      }
+      double normalizedDistance = distance / this->TranslationThreshold;
+      double normalizedAngle = angle / this->RotationThreshold;
+      return 0.5 * (normalizedDistance * normalizedDistance + normalizedAngle * normalizedAngle);
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  struct Hypothesis
+  {
+    double Cost;
+    vtkIdType Index;
+    vtkTrackedScreenARRigidTransform CameraToMarker;
+    // Pattern pose the minimal set of the hypothesis agrees on
+    vtkTrackedScreenARRigidTransform PatternToTracker;
+
+    bool IsBetterThan(const Hypothesis& other) const
+    {
+      return this->Cost < other.Cost || (this->Cost == other.Cost && this->Index < other.Index);
+    }
+  };
+}
+
+//----------------------------------------------------------------------------
+// RANSAC hypotheses, evaluated in parallel. Each hypothesis draws its samples from its own
+// generator seeded with its index, so the result does not depend on the number of threads.
+struct vtkTrackedScreenARHandEyeCalibration::RansacFunctor
+{
+  const std::vector<Sample>* Samples;
+  InlierCriteria Criteria;
+  unsigned int RandomSeed;
+  const std::atomic<bool>* CancelRequested;
+  vtkSMPThreadLocal<Hypothesis> LocalBest;
+  Hypothesis Best;
+
+  void Initialize()
+  {
+    Hypothesis& best = this->LocalBest.Local();
+    best.Cost = std::numeric_limits<double>::max();
+    best.Index = -1;
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    const std::vector<Sample>& samples = *this->Samples;
+    const int numberOfSamples = static_cast<int>(samples.size());
+    Hypothesis& best = this->LocalBest.Local();
+    std::vector<int> minimalSet(MINIMAL_SAMPLE_SIZE);
+    std::vector<vtkTrackedScreenARRigidTransform> patternToTracker(MINIMAL_SAMPLE_SIZE);
+    std::vector<int> minimalIndices;
+    for (int i = 0; i < MINIMAL_SAMPLE_SIZE; ++i)
+    {
+      minimalIndices.push_back(i);
+    }
+
+    for (vtkIdType index = begin; index < end; ++index)
+    {
+      if (this->CancelRequested->load(std::memory_order_relaxed))
+      {
+        return;
+      }
+
+      std::mt19937 generator(HypothesisSeed(this->RandomSeed, index));
+      std::uniform_int_distribution<int> distribution(0, numberOfSamples - 1);
+      for (int i = 0; i < MINIMAL_SAMPLE_SIZE; ++i)
+      {
+        int sample = 0;
+        do
+        {
+          sample = distribution(generator);
+        }
+        while (std::find(minimalSet.begin(), minimalSet.begin() + i, sample) != minimalSet.begin() + i);
+        minimalSet[i] = sample;
+      }
+
+      Hypothesis hypothesis;
+      hypothesis.Index = index;
+      if (!SolveLinear(samples, minimalSet, hypothesis.CameraToMarker))
+      {
+        continue;
+      }
+
+      for (int i = 0; i < MINIMAL_SAMPLE_SIZE; ++i)
+      {
+        patternToTracker[i] = ComputePatternToTracker(samples[minimalSet[i]], hypothesis.CameraToMarker);
+      }
+      hypothesis.PatternToTracker = MeanPose(patternToTracker, minimalIndices);
+
+      hypothesis.Cost = 0.0;
+      for (int i = 0; i < numberOfSamples && hypothesis.Cost <= best.Cost; ++i)
+      {
+        bool inlier = false;
+        hypothesis.Cost += this->Criteria.Cost(ComputePatternToTracker(samples[i], hypothesis.CameraToMarker), hypothesis.PatternToTracker, inlier);
+      }
+      if (hypothesis.IsBetterThan(best))
+      {
+        best = hypothesis;
+      }
+    }
+  }
+
+  void Reduce()
+  {
+    this->Best.Cost = std::numeric_limits<double>::max();
+    this->Best.Index = -1;
+    for (vtkSMPThreadLocal<Hypothesis>::iterator it = this->LocalBest.begin(); it != this->LocalBest.end(); ++it)
+    {
+      if ((*it).Index >= 0 && (*it).IsBetterThan(this->Best))
+      {
+        this->Best = *it;
+      }
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARHandEyeCalibration);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARHandEyeCalibration::vtkTrackedScreenARHandEyeCalibration()
+  : NumberOfIterations(1000)
+  , InlierTranslationThreshold(2.0)
+  , InlierRotationThreshold(1.0)
+  , RandomSeed(0)
+  , State(Idle)
+  , CancelRequested(false)
+  , NumberOfInliers(0)
+  , TranslationResidual(0.0)
+  , RotationResidual(0.0)
+  , SolveTime(0.0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARHandEyeCalibration::~vtkTrackedScreenARHandEyeCalibration()
+{
+  this->Cancel();
+  this->Wait();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARHandEyeCalibration::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfSamples: " << this->Samples.size() << std::endl;
+  os << indent << "NumberOfIterations: " << this->NumberOfIterations << std::endl;
+  os << indent << "InlierTranslationThreshold: " << this->InlierTranslationThreshold << std::endl;
+  os << indent << "InlierRotationThreshold: " << this->InlierRotationThreshold << std::endl;
+  os << indent << "RandomSeed: " << this->RandomSeed << std::endl;
+  int state = this->GetState();
+  os << indent << "State: " << GetStateAsString(state) << std::endl;
+  if (state == Succeeded)
+  {
+    os << indent << "NumberOfInliers: " << this->NumberOfInliers << std::endl;
+    os << indent << "TranslationResidual: " << this->TranslationResidual << std::endl;
+    os << indent << "RotationResidual: " << this->RotationResidual << std::endl;
+    os << indent << "SolveTime: " << this->SolveTime << std::endl;
+  }
+  else if (state == Failed)
+  {
+    os << indent << "FailureReason: " << this->FailureReason << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::AddSample(vtkMatrix4x4* markerToTracker, vtkMatrix4x4* patternToCamera)
+{
+  if (markerToTracker == nullptr || patternToCamera == nullptr || this->GetState() == Running)
+  {
+    return false;
+  }
+  Sample sample;
+  sample.MarkerToTracker = vtkTrackedScreenARRigidTransform::FromMatrix(markerToTracker);
+  sample.PatternToCamera = vtkTrackedScreenARRigidTransform::FromMatrix(patternToCamera);
+  this->Samples.push_back(sample);
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARHandEyeCalibration::GetNumberOfSamples()
+{
+  return static_cast<int>(this->Samples.size());
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::RemoveAllSamples()
+{
+  if (this->GetState() == Running)
+  {
+    return false;
+  }
+  this->Samples.clear();
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::Start()
+{
+  if (this->GetState() == Running)
+  {
+    return false;
+  }
+  if (static_cast<int>(this->Samples.size()) < MINIMAL_SAMPLE_SIZE)
+  {
+    vtkErrorMacro("Start: at least " << MINIMAL_SAMPLE_SIZE << " samples are needed, " << this->Samples.size() << " collected");
+    return false;
+  }
+  this->Wait();
+
+  this->CancelRequested = false;
+  this->State = Running;
+  this->SolverThread = std::thread(&vtkTrackedScreenARHandEyeCalibration::RunSolver, this, this->NumberOfIterations,
+    this->InlierTranslationThreshold, vtkMath::RadiansFromDegrees(this->InlierRotationThreshold), this->RandomSeed);
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::Solve()
+{
+  if (this->GetState() == Running)
+  {
+    return false;
+  }
+  this->Wait();
+
+  this->CancelRequested = false;
+  this->State = Running;
+  bool success = this->RunSolver(this->NumberOfIterations, this->InlierTranslationThreshold,
+    vtkMath::RadiansFromDegrees(this->InlierRotationThreshold), this->RandomSeed);
+  this->Modified();
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARHandEyeCalibration::Cancel()
+{
+  this->CancelRequested = true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARHandEyeCalibration::Wait()
+{
+  if (this->SolverThread.joinable())
+  {
+    this->SolverThread.join();
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARHandEyeCalibration::GetState()
+{
+  return this->State.load(std::memory_order_acquire);
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTrackedScreenARHandEyeCalibration::GetStateAsString(int state)
+{
+  switch (state)
+  {
+    case Idle:
+      return "Idle";
+    case Running:
+      return "Running";
+    case Succeeded:
+      return "Succeeded";
+    case Failed:
+      return "Failed";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkTrackedScreenARHandEyeCalibration::GetFailureReason()
+{
+  return (this->GetState() == Failed ? this->FailureReason : std::string());
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::GetCameraToMarker(vtkMatrix4x4* cameraToMarker)
+{
+  if (cameraToMarker == nullptr || this->GetState() != Succeeded)
+  {
+    return false;
+  }
+  this->CameraToMarker.ToMatrix(cameraToMarker);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::GetPatternToTracker(vtkMatrix4x4* patternToTracker)
+{
+  if (patternToTracker == nullptr || this->GetState() != Succeeded)
+  {
+    return false;
+  }
+  this->PatternToTracker.ToMatrix(patternToTracker);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARHandEyeCalibration::GetNumberOfInliers()
+{
+  return (this->GetState() == Succeeded ? this->NumberOfInliers : 0);
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARHandEyeCalibration::GetTranslationResidual()
+{
+  return (this->GetState() == Succeeded ? this->TranslationResidual : 0.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARHandEyeCalibration::GetRotationResidual()
+{
+  return (this->GetState() == Succeeded ? this->RotationResidual : 0.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARHandEyeCalibration::GetSolveTime()
+{
+  return (this->GetState() == Succeeded ? this->SolveTime : 0.0);
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARRigidTransform vtkTrackedScreenARHandEyeCalibration::ComputePatternToTracker(const Sample& sample,
+    const vtkTrackedScreenARRigidTransform& cameraToMarker)
+{
+  return vtkTrackedScreenARRigidTransform::Compose(sample.MarkerToTracker,
+    vtkTrackedScreenARRigidTransform::Compose(cameraToMarker, sample.PatternToCamera));
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::SolveLinear(const std::vector<Sample>& samples, const std::vector<int>& indices,
+    vtkTrackedScreenARRigidTransform& cameraToMarker)
+{
+  // Motion between every two samples: A = inv(M_j) M_i, B = P_j inv(P_i)
+  std::vector<vtkTrackedScreenARRigidTransform> markerMotions;
+  std::vector<vtkTrackedScreenARRigidTransform> cameraMotions;
+  for (size_t i = 0; i < indices.size(); ++i)
+  {
+    const Sample& first = samples[indices[i]];
+    for (size_t j = i + 1; j < indices.size(); ++j)
+    {
+      const Sample& second = samples[indices[j]];
+      markerMotions.push_back(vtkTrackedScreenARRigidTransform::Compose(second.MarkerToTracker.Inverse(), first.MarkerToTracker));
+      cameraMotions.push_back(vtkTrackedScreenARRigidTransform::Compose(second.PatternToCamera, first.PatternToCamera.Inverse()));
+    }
+  }
+
+  // Rotation: q_A q_X - q_X q_B = (L(q_A) - R(q_B)) q_X = 0, q_X is the eigenvector of the
+  // smallest eigenvalue of the sum of (L - R)^T (L - R)
+  double normal[4][4] = { { 0.0 } };
+  for (size_t m = 0; m < markerMotions.size(); ++m)
+  {
+    double a[4];
+    double b[4];
+    GetCanonicalQuaternion(markerMotions[m], a);
+    GetCanonicalQuaternion(cameraMotions[m], b);
+    const double k[4][4] =
+    {
+      { a[0] - b[0], -a[1] + b[1], -a[2] + b[2], -a[3] + b[3] },
+      { a[1] - b[1], a[0] - b[0], -a[3] - b[3], a[2] + b[2] },
+      { a[2] - b[2], a[3] + b[3], a[0] - b[0], -a[1] - b[1] },
+      { a[3] - b[3], -a[2] - b[2], a[1] + b[1], a[0] - b[0] }
+    };
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        normal[row][column] += k[0][row] * k[0][column] + k[1][row] * k[1][column] + k[2][row] * k[2][column] + k[3][row] * k[3][column];
+      }
+    }
+  }
+  double* normalRows[4] = { normal[0], normal[1], normal[2], normal[3] };
+  double eigenvalues[4];
+  double eigenvectors[4][4];
+  double* eigenvectorRows[4] = { eigenvectors[0], eigenvectors[1], eigenvectors[2], eigenvectors[3] };
+  // Eigenvalues in decreasing order, eigenvectors in columns
+  if (!vtkMath::JacobiN(normalRows, 4, eigenvalues, eigenvectorRows) || eigenvalues[2] <= DEGENERACY_TOLERANCE * eigenvalues[0])
+  {
+    return false;
+  }
+  double rotation[4] = { eigenvectors[0][3], eigenvectors[1][3], eigenvectors[2][3], eigenvectors[3][3] };
+  vtkTrackedScreenARRigidTransform::QuaternionNormalize(rotation);
+  const double zero[3] = { 0.0, 0.0, 0.0 };
+  vtkTrackedScreenARRigidTransform rotationOnly = vtkTrackedScreenARRigidTransform::FromQuaternion(rotation, zero);
+
+  // Translation: least squares of (R_A - I) t = R_X t_B - t_A
+  double translationNormal[3][3] = { { 0.0 } };
+  double translationRhs[3] = { 0.0, 0.0, 0.0 };
+  for (size_t m = 0; m < markerMotions.size(); ++m)
+  {
+    const double* a = markerMotions[m].Element;
+    double cameraTranslation[3];
+    cameraMotions[m].GetTranslation(cameraTranslation);
+    double rotatedCameraTranslation[3];
+    rotationOnly.TransformPoint(cameraTranslation, rotatedCameraTranslation);
+    double c[3][3];
+    double rhs[3];
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        c[row][column] = a[4 * row + column] - (row == column ? 1.0 : 0.0);
+      }
+      rhs[row] = rotatedCameraTranslation[row] - a[4 * row + 3];
+    }
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        translationNormal[row][column] += c[0][row] * c[0][column] + c[1][row] * c[1][column] + c[2][row] * c[2][column];
+      }
+      translationRhs[row] += c[0][row] * rhs[0] + c[1][row] * rhs[1] + c[2][row] * rhs[2];
+    }
+  }
+  double scale = (translationNormal[0][0] + translationNormal[1][1] + translationNormal[2][2]) / 3.0;
+  if (scale <= 0.0 || vtkMath::Determinant3x3(translationNormal) <= DEGENERACY_TOLERANCE * scale * scale * scale)
+  {
+    return false;
+  }
+  int pivots[3];
+  vtkMath::LUFactor3x3(translationNormal, pivots);
+  vtkMath::LUSolve3x3(translationNormal, pivots, translationRhs);
+
+  cameraToMarker = vtkTrackedScreenARRigidTransform::FromQuaternion(rotation, translationRhs);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARHandEyeCalibration::RunSolver(int numberOfIterations, double translationThreshold, double rotationThreshold, int randomSeed)
+{
+  double startTime = vtkTimerLog::GetUniversalTime();
+  const std::vector<Sample>& samples = this->Samples;
+  const int numberOfSamples = static_cast<int>(samples.size());
+  const InlierCriteria criteria = { translationThreshold, rotationThreshold };
+  std::string failureReason;
+
+  RansacFunctor ransac;
+  ransac.Samples = &samples;
+  ransac.Criteria = criteria;
+  ransac.RandomSeed = static_cast<unsigned int>(randomSeed);
+  ransac.CancelRequested = &this->CancelRequested;
+  vtkSMPTools::For(0, numberOfIterations, ransac);
+
+  vtkTrackedScreenARRigidTransform cameraToMarker = ransac.Best.CameraToMarker;
+  vtkTrackedScreenARRigidTransform consensus = ransac.Best.PatternToTracker;
+  std::vector<vtkTrackedScreenARRigidTransform> patternToTracker(numberOfSamples);
+  std::vector<int> inliers;
+  if (this->CancelRequested)
+  {
+    failureReason = "cancelled";
+  }
+  else if (ransac.Best.Index < 0)
+  {
+    failureReason = "the samples do not constrain the calibration, rotate the camera about at least two different axes";
+  }
+  else
+  {
+    // Pattern pose implied by every sample, and the samples agreeing with the consensus
+    auto findInliers = [&]()
+    {
+      inliers.clear();
+      for (int i = 0; i < numberOfSamples; ++i)
+      {
+        patternToTracker[i] = ComputePatternToTracker(samples[i], cameraToMarker);
+        bool inlier = false;
+        criteria.Cost(patternToTracker[i], consensus, inlier);
+        if (inlier)
+        {
+          inliers.push_back(i);
+        }
+      }
+    };
+
+    // Refine on the inliers of the best hypothesis until they do not change anymore
+    findInliers();
+    for (int iteration = 0; iteration < MAXIMUM_REFINEMENT_ITERATIONS && static_cast<int>(inliers.size()) >= MINIMAL_SAMPLE_SIZE; ++iteration)
+    {
+      if (!SolveLinear(samples, inliers, cameraToMarker))
+      {
+        inliers.clear();
+        break;
+      }
+      for (size_t n = 0; n < inliers.size(); ++n)
+      {
+        patternToTracker[inliers[n]] = ComputePatternToTracker(samples[inliers[n]], cameraToMarker);
+      }
+      consensus = MeanPose(patternToTracker, inliers);
+      std::vector<int> previousInliers = inliers;
+      findInliers();
+      if (inliers == previousInliers)
+      {
+        break;
+      }
+    }
+    if (static_cast<int>(inliers.size()) < MINIMAL_SAMPLE_SIZE)
+    {
+      failureReason = "fewer than 3 samples agree on the pattern pose, check the pattern detection and the inlier thresholds";
+    }
+  }
+
+  if (!failureReason.empty())
+  {
+    this->FailureReason = failureReason;
+    this->State.store(Failed, std::memory_order_release);
+    return false;
+  }
+
+  double sumSquaredDistance = 0.0;
+  double sumSquaredAngle = 0.0;
+  for (size_t n = 0; n < inliers.size(); ++n)
+  {
+    double distance = 0.0;
+    double angle = 0.0;
+    ComputeDeviation(patternToTracker[inliers[n]], consensus, distance, angle);
+    sumSquaredDistance += distance * distance;
+    sumSquaredAngle += angle * angle;
+  }
+  this->CameraToMarker = cameraToMarker;
+  this->PatternToTracker = consensus;
+  this->NumberOfInliers = static_cast<int>(inliers.size());
+  this->TranslationResidual = sqrt(sumSquaredDistance / inliers.size());
+  this->RotationResidual = vtkMath::DegreesFromRadians(sqrt(sumSquaredAngle / inliers.size()));
+  this->SolveTime = vtkTimerLog::GetUniversalTime() - startTime;
+  this->FailureReason.clear();
+  this->State.store(Succeeded, std::memory_order_release);
+  return true;
+}
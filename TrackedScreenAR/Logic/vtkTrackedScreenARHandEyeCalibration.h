@@ -0,0 +1,179 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARHandEyeCalibration - hand-eye calibration of the tracked video camera
+// .SECTION Description
+// Estimates the camera-to-marker transform X of a video camera rigidly attached to a tracked
+// marker, from samples pairing the tracker pose of the marker (marker to tracker, M) with the
+// pose of a static calibration pattern detected in the video frame taken at the same time
+// (pattern to camera, P). The pattern pose in tracker coordinates M X P is the same for every
+// sample, so each pair of samples i, j gives a motion constraint A X = X B with
+// A = inv(M_j) M_i and B = P_j inv(P_i).
+//
+// The rotation is the least-squares solution of the quaternion form of the constraints, the
+// translation the least-squares solution of (R_A - I) t = R_X t_B - t_A. A RANSAC over minimal
+// sets of three samples, spread over the cores with vtkSMPTools, finds the samples agreeing on
+// the pattern pose within the inlier thresholds, which rejects wrong pattern detections and
+// tracking glitches. The solution is then refined on the inliers until they settle.
+//
+// Start() solves on a worker thread, so rendering continues meanwhile. The state and the result
+// are polled from the main thread. Samples cannot be changed while solving.
+
+#ifndef __vtkTrackedScreenARHandEyeCalibration_h
+#define __vtkTrackedScreenARHandEyeCalibration_h
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARRigidTransform.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkMatrix4x4;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARHandEyeCalibration : public vtkObject
+{
+public:
+  static vtkTrackedScreenARHandEyeCalibration* New();
+  vtkTypeMacro(vtkTrackedScreenARHandEyeCalibration, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum StateType
+  {
+    Idle = 0,
+    Running,
+    Succeeded,
+    Failed,
+    State_Last
+  };
+
+  /// Add a sample: tracker pose of the marker and pose of the pattern detected in the simultaneous
+  /// video frame. Returns false while solving.
+  bool AddSample(vtkMatrix4x4* markerToTracker, vtkMatrix4x4* patternToCamera);
+
+  int GetNumberOfSamples();
+
+  /// Discard the samples. Returns false while solving.
+  bool RemoveAllSamples();
+
+  /// Number of RANSAC hypotheses, 1000 by default
+  vtkSetClampMacro(NumberOfIterations, int, 1, 1000000);
+  vtkGetMacro(NumberOfIterations, int);
+
+  /// Largest distance, in mm, of the pattern position implied by an inlier sample from the consensus. 2 mm by default.
+  vtkSetMacro(InlierTranslationThreshold, double);
+  vtkGetMacro(InlierTranslationThreshold, double);
+
+  /// Largest angle, in degrees, of the pattern orientation implied by an inlier sample from the consensus. 1 degree by default.
+  vtkSetMacro(InlierRotationThreshold, double);
+  vtkGetMacro(InlierRotationThreshold, double);
+
+  /// Seed of the sample selection, the result only depends on it and on the samples, not on the number of threads
+  vtkSetMacro(RandomSeed, int);
+  vtkGetMacro(RandomSeed, int);
+
+  /// Solve on a worker thread. Returns false if a solve is already running or there are fewer than 3 samples.
+  bool Start();
+
+  /// Solve on the calling thread. Returns true if a calibration was found.
+  bool Solve();
+
+  /// Ask a running solve to stop, it ends in the Failed state
+  void Cancel();
+
+  /// Block until the worker thread finished
+  void Wait();
+
+  /// One of StateType, safe to poll from any thread
+  int GetState();
+  static const char* GetStateAsString(int state);
+
+  /// Why the last solve failed, empty if it did not
+  std::string GetFailureReason();
+
+  /// Result of the last successful solve. Return false unless the state is Succeeded.
+  bool GetCameraToMarker(vtkMatrix4x4* cameraToMarker);
+  bool GetPatternToTracker(vtkMatrix4x4* patternToTracker);
+
+  /// Statistics of the last successful solve: inliers, RMS deviation of the pattern pose they imply
+  /// from the consensus (mm and degrees), and time spent solving in seconds
+  int GetNumberOfInliers();
+  double GetTranslationResidual();
+  double GetRotationResidual();
+  double GetSolveTime();
+
+protected:
+  vtkTrackedScreenARHandEyeCalibration();
+  virtual ~vtkTrackedScreenARHandEyeCalibration();
+
+  struct Sample
+  {
+    vtkTrackedScreenARRigidTransform MarkerToTracker;
+    vtkTrackedScreenARRigidTransform PatternToCamera;
+  };
+
+  /// Evaluates RANSAC hypotheses with vtkSMPTools
+  struct RansacFunctor;
+
+  /// Pattern pose in tracker coordinates implied by a sample and a calibration: M X P
+  static vtkTrackedScreenARRigidTransform ComputePatternToTracker(const Sample& sample, const vtkTrackedScreenARRigidTransform& cameraToMarker);
+
+  /// Camera to marker transform fitting the motions between every two of the given samples.
+  /// Returns false if the motions do not constrain it (rotations about a single axis).
+  static bool SolveLinear(const std::vector<Sample>& samples, const std::vector<int>& indices,
+                          vtkTrackedScreenARRigidTransform& cameraToMarker);
+
+  /// Run the solver with the given parameters, store the result and switch to the final state.
+  /// Parameters are passed by value so the setters can be called while the worker thread runs.
+  bool RunSolver(int numberOfIterations, double translationThreshold, double rotationThreshold, int randomSeed);
+
+protected:
+  // Only changed while no solve is running
+  std::vector<Sample> Samples;
+
+  int NumberOfIterations;
+  double InlierTranslationThreshold;
+  double InlierRotationThreshold;
+  int RandomSeed;
+
+  std::thread SolverThread;
+  std::atomic<int> State;
+  std::atomic<bool> CancelRequested;
+
+  // Written by the solver before the state becomes Succeeded or Failed
+  vtkTrackedScreenARRigidTransform CameraToMarker;
+  vtkTrackedScreenARRigidTransform PatternToTracker;
+  int NumberOfInliers;
+  double TranslationResidual;
+  double RotationResidual;
+  double SolveTime;
+  std::string FailureReason;
+
+private:
+  vtkTrackedScreenARHandEyeCalibration(const vtkTrackedScreenARHandEyeCalibration&); // Not implemented
+  void operator=(const vtkTrackedScreenARHandEyeCalibration&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,317 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARLatencyMonitor.h"
+
+// VTK includes
+#include <vtkIntArray.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARLatencyMonitor);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARLatencyMonitor::vtkTrackedScreenARLatencyMonitor()
+  : WindowSize(1000)
+  , BinWidth(1.0)
+  , NumberOfBins(100)
+  , LastImageArrival(-1.0)
+  , LastPoseArrival(-1.0)
+  , LastPresentedPose(-1.0)
+  , RenderInProgress(false)
+  , NextFrameIndex(0)
+  , TotalNumberOfFrames(0)
+{
+  this->CurrentFrame.ImageArrival = -1.0;
+  this->CurrentFrame.PoseTimestamp = -1.0;
+  this->CurrentFrame.RenderStart = -1.0;
+  this->CurrentFrame.RenderEnd = -1.0;
+  this->Frames.reserve(this->WindowSize);
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARLatencyMonitor::~vtkTrackedScreenARLatencyMonitor()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "WindowSize: " << this->WindowSize << std::endl;
+  os << indent << "BinWidth: " << this->BinWidth << std::endl;
+  os << indent << "NumberOfBins: " << this->NumberOfBins << std::endl;
+  os << indent << "NumberOfFrames: " << this->GetNumberOfFrames() << std::endl;
+  os << indent << "TotalNumberOfFrames: " << this->TotalNumberOfFrames << std::endl;
+  for (int metric = 0; metric < Metric_Last; ++metric)
+  {
+    os << indent << GetMetricAsString(metric) << " mean/p95/max (ms): " << this->GetMean(metric) << " / "
+       << this->GetPercentile(metric, 95.0) << " / " << this->GetMaximum(metric) << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::SetWindowSize(int size)
+{
+  size = std::max(1, size);
+  if (size == this->WindowSize)
+  {
+    return;
+  }
+  this->WindowSize = size;
+  this->Frames.clear();
+  this->Frames.reserve(size);
+  this->NextFrameIndex = 0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::RecordImageArrival(double timestamp)
+{
+  this->LastImageArrival = timestamp;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::RecordPoseArrival(double timestamp)
+{
+  this->LastPoseArrival = timestamp;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::RecordPresentedPose(double timestamp)
+{
+  this->LastPresentedPose = timestamp;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::RecordRenderStart(double timestamp)
+{
+  // The render displays whatever arrived last
+  this->CurrentFrame.ImageArrival = this->LastImageArrival;
+  this->CurrentFrame.PoseTimestamp = (this->LastPresentedPose >= 0.0 ? this->LastPresentedPose : this->LastPoseArrival);
+  this->CurrentFrame.RenderStart = timestamp;
+  this->RenderInProgress = true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::RecordRenderEnd(double timestamp)
+{
+  if (!this->RenderInProgress)
+  {
+    return;
+  }
+  this->RenderInProgress = false;
+  this->CurrentFrame.RenderEnd = timestamp;
+
+  if (static_cast<int>(this->Frames.size()) < this->WindowSize)
+  {
+    this->Frames.push_back(this->CurrentFrame);
+  }
+  else
+  {
+    this->Frames[this->NextFrameIndex] = this->CurrentFrame;
+  }
+  this->NextFrameIndex = (this->NextFrameIndex + 1) % this->WindowSize;
+  this->TotalNumberOfFrames++;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARLatencyMonitor::GetNumberOfFrames() const
+{
+  return static_cast<int>(this->Frames.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARLatencyMonitor::GetFrameMetric(const FrameRecord& frame, int metric)
+{
+  double since = -1.0;
+  switch (metric)
+  {
+    case VideoLatency:
+      since = frame.ImageArrival;
+      break;
+    case PoseLatency:
+      since = frame.PoseTimestamp;
+      break;
+    case RenderDuration:
+      since = frame.RenderStart;
+      break;
+    default:
+      return -1.0;
+  }
+  if (since < 0.0 || frame.RenderEnd < since)
+  {
+    return -1.0;
+  }
+  return (frame.RenderEnd - since) * 1000.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::GetValidSamples(int metric, std::vector<double>& samples) const
+{
+  samples.clear();
+  samples.reserve(this->Frames.size());
+  for (std::vector<FrameRecord>::const_iterator it = this->Frames.begin(); it != this->Frames.end(); ++it)
+  {
+    double value = GetFrameMetric(*it, metric);
+    if (value >= 0.0)
+    {
+      samples.push_back(value);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARLatencyMonitor::GetMean(int metric) const
+{
+  std::vector<double> samples;
+  this->GetValidSamples(metric, samples);
+  if (samples.empty())
+  {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for (std::vector<double>::const_iterator it = samples.begin(); it != samples.end(); ++it)
+  {
+    sum += *it;
+  }
+  return sum / samples.size();
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARLatencyMonitor::GetMaximum(int metric) const
+{
+  std::vector<double> samples;
+  this->GetValidSamples(metric, samples);
+  if (samples.empty())
+  {
+    return 0.0;
+  }
+  return *std::max_element(samples.begin(), samples.end());
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARLatencyMonitor::GetPercentile(int metric, double percentile) const
+{
+  std::vector<double> samples;
+  this->GetValidSamples(metric, samples);
+  if (samples.empty())
+  {
+    return 0.0;
+  }
+  percentile = std::min(100.0, std::max(0.0, percentile));
+  size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * samples.size()));
+  rank = std::max<size_t>(rank, 1) - 1;
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank];
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::GetHistogram(int metric, vtkIntArray* counts) const
+{
+  if (counts == nullptr)
+  {
+    return;
+  }
+  counts->SetNumberOfComponents(1);
+  counts->SetNumberOfTuples(this->NumberOfBins);
+  counts->FillComponent(0, 0);
+
+  std::vector<double> samples;
+  this->GetValidSamples(metric, samples);
+  for (std::vector<double>::const_iterator it = samples.begin(); it != samples.end(); ++it)
+  {
+    int bin = std::min(this->NumberOfBins - 1, static_cast<int>(*it / this->BinWidth));
+    counts->SetValue(bin, counts->GetValue(bin) + 1);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARLatencyMonitor::ExportToCSV(const char* fileName) const
+{
+  if (fileName == nullptr)
+  {
+    vtkErrorMacro("ExportToCSV: invalid file name");
+    return false;
+  }
+
+  std::ofstream file(fileName);
+  if (!file)
+  {
+    vtkErrorMacro("ExportToCSV: unable to open " << fileName << " for writing");
+    return false;
+  }
+
+  file << "ImageArrival,PoseTimestamp,RenderStart,RenderEnd";
+  for (int metric = 0; metric < Metric_Last; ++metric)
+  {
+    file << "," << GetMetricAsString(metric) << "Ms";
+  }
+  file << "\n";
+
+  file.precision(17);
+  // Oldest frame first
+  size_t numberOfFrames = this->Frames.size();
+  size_t first = (numberOfFrames < static_cast<size_t>(this->WindowSize)) ? 0 : this->NextFrameIndex;
+  for (size_t i = 0; i < numberOfFrames; ++i)
+  {
+    const FrameRecord& frame = this->Frames[(first + i) % numberOfFrames];
+    file << frame.ImageArrival << "," << frame.PoseTimestamp << "," << frame.RenderStart << "," << frame.RenderEnd;
+    for (int metric = 0; metric < Metric_Last; ++metric)
+    {
+      file << "," << GetFrameMetric(frame, metric);
+    }
+    file << "\n";
+  }
+
+  return file.good();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARLatencyMonitor::Reset()
+{
+  this->Frames.clear();
+  this->NextFrameIndex = 0;
+  this->TotalNumberOfFrames = 0;
+  this->RenderInProgress = false;
+  this->LastImageArrival = -1.0;
+  this->LastPoseArrival = -1.0;
+  this->LastPresentedPose = -1.0;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTrackedScreenARLatencyMonitor::GetMetricAsString(int metric)
+{
+  switch (metric)
+  {
+    case VideoLatency:
+      return "VideoLatency";
+    case PoseLatency:
+      return "PoseLatency";
+    case RenderDuration:
+      return "RenderDuration";
+    default:
+      return "Unknown";
+  }
+}
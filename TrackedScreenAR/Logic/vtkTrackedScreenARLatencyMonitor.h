@@ -0,0 +1,138 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARLatencyMonitor - glass-to-glass latency statistics
+// .SECTION Description
+// Records the arrival time of video frames and tracker poses, the timestamp of the
+// pose presented to the view, and the start and end of each render. When a render
+// ends, the age of the video frame and pose it displayed is stored in a rolling
+// window of the most recent frames, from which histograms and percentiles can be
+// queried or a CSV file exported.
+// All times are in seconds, latencies are reported in milliseconds.
+
+#ifndef __vtkTrackedScreenARLatencyMonitor_h
+#define __vtkTrackedScreenARLatencyMonitor_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkIntArray;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARLatencyMonitor : public vtkObject
+{
+public:
+  enum Metric
+  {
+    /// Render end minus arrival of the displayed video frame
+    VideoLatency = 0,
+    /// Render end minus timestamp of the displayed pose
+    PoseLatency,
+    /// Render end minus render start
+    RenderDuration,
+    Metric_Last
+  };
+
+  static vtkTrackedScreenARLatencyMonitor* New();
+  vtkTypeMacro(vtkTrackedScreenARLatencyMonitor, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of most recent frames kept for statistics
+  void SetWindowSize(int size);
+  vtkGetMacro(WindowSize, int);
+
+  /// Histogram bin width in milliseconds, and number of bins (the last bin collects everything above)
+  vtkSetClampMacro(BinWidth, double, 0.01, 1000.0);
+  vtkGetMacro(BinWidth, double);
+  vtkSetClampMacro(NumberOfBins, int, 1, 10000);
+  vtkGetMacro(NumberOfBins, int);
+
+  void RecordImageArrival(double timestamp);
+  void RecordPoseArrival(double timestamp);
+
+  /// Tracker timestamp of the pose shown by the next renders. A pose synchronized to an older video frame
+  /// is older than the latest arrival, so once a pose was presented its timestamp is used instead.
+  void RecordPresentedPose(double timestamp);
+  void RecordRenderStart(double timestamp);
+  void RecordRenderEnd(double timestamp);
+
+  /// Number of frames currently in the rolling window
+  int GetNumberOfFrames() const;
+
+  /// Total number of frames recorded since the last reset
+  vtkGetMacro(TotalNumberOfFrames, unsigned long);
+
+  /// Statistics of a metric over the rolling window, in milliseconds.
+  /// Frames for which the metric is unknown (e.g. no pose arrived yet) are ignored.
+  double GetMean(int metric) const;
+  double GetMaximum(int metric) const;
+  /// percentile is in [0, 100]
+  double GetPercentile(int metric, double percentile) const;
+
+  /// Fill counts with the histogram of a metric over the rolling window
+  void GetHistogram(int metric, vtkIntArray* counts) const;
+
+  /// Write one line per frame in the rolling window. Returns false if the file could not be written.
+  bool ExportToCSV(const char* fileName) const;
+
+  void Reset();
+
+  static const char* GetMetricAsString(int metric);
+
+protected:
+  vtkTrackedScreenARLatencyMonitor();
+  virtual ~vtkTrackedScreenARLatencyMonitor();
+
+  struct FrameRecord
+  {
+    double ImageArrival;
+    double PoseTimestamp;
+    double RenderStart;
+    double RenderEnd;
+  };
+
+  /// Latency of the metric in milliseconds, negative if unknown
+  static double GetFrameMetric(const FrameRecord& frame, int metric);
+  void GetValidSamples(int metric, std::vector<double>& samples) const;
+
+protected:
+  int WindowSize;
+  double BinWidth;
+  int NumberOfBins;
+
+  double LastImageArrival;
+  double LastPoseArrival;
+  double LastPresentedPose;
+  FrameRecord CurrentFrame;
+  bool RenderInProgress;
+
+  // Ring buffer of the most recent frames
+  std::vector<FrameRecord> Frames;
+  int NextFrameIndex;
+  unsigned long TotalNumberOfFrames;
+
+private:
+  vtkTrackedScreenARLatencyMonitor(const vtkTrackedScreenARLatencyMonitor&); // Not implemented
+  void operator=(const vtkTrackedScreenARLatencyMonitor&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,924 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARPixelFormatConverter.h"
+
+// VTK includes
+#include <vtkDataObject.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkSMPTools.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+// STD includes
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+# define TRACKEDSCREENAR_X86_KERNELS
+# include <immintrin.h>
+# if defined(_MSC_VER) && !defined(__clang__)
+#  include <intrin.h>
+#  define TRACKEDSCREENAR_TARGET_SSE2
+#  define TRACKEDSCREENAR_TARGET_AVX2
+# else
+#  define TRACKEDSCREENAR_TARGET_SSE2 __attribute__((target("sse2")))
+#  define TRACKEDSCREENAR_TARGET_AVX2 __attribute__((target("avx2")))
+# endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+# define TRACKEDSCREENAR_NEON_KERNELS
+# include <arm_neon.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Scalar reference kernels. BT.601 limited range in 8-bit fixed point, the
+  // vectorized kernels below produce bit-identical results.
+
+  //----------------------------------------------------------------------------
+  inline unsigned char ClampToByte(int value)
+  {
+    return static_cast<unsigned char>(value < 0 ? 0 : (value > 255 ? 255 : value));
+  }
+
+  //----------------------------------------------------------------------------
+  inline void YUVToRGBA(int y, int u, int v, unsigned char* out)
+  {
+    const int c = (y - 16) * 298;
+    const int d = u - 128;
+    const int e = v - 128;
+    out[0] = ClampToByte((c + 409 * e + 128) >> 8);
+    out[1] = ClampToByte((c - 100 * d - 208 * e + 128) >> 8);
+    out[2] = ClampToByte((c + 516 * d + 128) >> 8);
+    out[3] = 255;
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertNV12RowScalar(const unsigned char* y, const unsigned char* uv, unsigned char* out, int begin, int width)
+  {
+    for (int x = begin; x < width; ++x)
+    {
+      const int chroma = x & ~1;
+      YUVToRGBA(y[x], uv[chroma], uv[chroma + 1], out + 4 * x);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertI420RowScalar(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* out, int begin, int width)
+  {
+    for (int x = begin; x < width; ++x)
+    {
+      YUVToRGBA(y[x], u[x / 2], v[x / 2], out + 4 * x);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // YUYV stores Y0 U Y1 V, UYVY stores U Y0 V Y1
+  template <bool ChromaFirst>
+  void ConvertPackedYUVRowScalar(const unsigned char* packed, unsigned char* out, int begin, int width)
+  {
+    const int lumaOffset = ChromaFirst ? 1 : 0;
+    const int chromaOffset = ChromaFirst ? 0 : 1;
+    for (int x = begin; x < width; ++x)
+    {
+      const unsigned char* pair = packed + 2 * (x & ~1);
+      YUVToRGBA(packed[2 * x + lumaOffset], pair[chromaOffset], pair[chromaOffset + 2], out + 4 * x);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertBGRRowScalar(const unsigned char* in, unsigned char* out, int begin, int width)
+  {
+    for (int x = begin; x < width; ++x)
+    {
+      out[3 * x] = in[3 * x + 2];
+      out[3 * x + 1] = in[3 * x + 1];
+      out[3 * x + 2] = in[3 * x];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertBGRARowScalar(const unsigned char* in, unsigned char* out, int begin, int width)
+  {
+    for (int x = begin; x < width; ++x)
+    {
+      out[4 * x] = in[4 * x + 2];
+      out[4 * x + 1] = in[4 * x + 1];
+      out[4 * x + 2] = in[4 * x];
+      out[4 * x + 3] = in[4 * x + 3];
+    }
+  }
+
+#ifdef TRACKEDSCREENAR_X86_KERNELS
+  //----------------------------------------------------------------------------
+  // SSE2: 8 pixels per step. y16 holds 8 luma samples, c16 the 4 chroma pairs
+  // U0 V0 U1 V1 U2 V2 U3 V3 covering them, both as 16-bit lanes.
+  TRACKEDSCREENAR_TARGET_SSE2 inline __m128i CoefficientPairSSE2(short a, short b)
+  {
+    return _mm_setr_epi16(a, b, a, b, a, b, a, b);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_SSE2 inline __m128i RoundAndPackSSE2(__m128i low, __m128i high)
+  {
+    const __m128i rounding = _mm_set1_epi32(128);
+    low = _mm_srai_epi32(_mm_add_epi32(low, rounding), 8);
+    high = _mm_srai_epi32(_mm_add_epi32(high, rounding), 8);
+    return _mm_packs_epi32(low, high);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_SSE2 inline void YUV8ToRGBASSE2(__m128i y16, __m128i c16, unsigned char* out)
+  {
+    // Each chroma sample covers two pixels
+    __m128i u = _mm_and_si128(c16, _mm_set1_epi32(0x0000ffff));
+    u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+    __m128i v = _mm_srli_epi32(c16, 16);
+    v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+
+    y16 = _mm_sub_epi16(y16, _mm_set1_epi16(16));
+    u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+    v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+
+    // Interleave luma with chroma so one multiply-add gives 298 * y + k * chroma in 32 bits
+    const __m128i yvLow = _mm_unpacklo_epi16(y16, v);
+    const __m128i yvHigh = _mm_unpackhi_epi16(y16, v);
+    const __m128i yuLow = _mm_unpacklo_epi16(y16, u);
+    const __m128i yuHigh = _mm_unpackhi_epi16(y16, u);
+
+    const __m128i redCoefficients = CoefficientPairSSE2(298, 409);
+    const __m128i greenLumaCoefficients = CoefficientPairSSE2(298, -100);
+    const __m128i greenChromaCoefficients = CoefficientPairSSE2(0, -208);
+    const __m128i blueCoefficients = CoefficientPairSSE2(298, 516);
+
+    __m128i r = RoundAndPackSSE2(_mm_madd_epi16(yvLow, redCoefficients), _mm_madd_epi16(yvHigh, redCoefficients));
+    __m128i g = RoundAndPackSSE2(
+      _mm_add_epi32(_mm_madd_epi16(yuLow, greenLumaCoefficients), _mm_madd_epi16(yvLow, greenChromaCoefficients)),
+      _mm_add_epi32(_mm_madd_epi16(yuHigh, greenLumaCoefficients), _mm_madd_epi16(yvHigh, greenChromaCoefficients)));
+    __m128i b = RoundAndPackSSE2(_mm_madd_epi16(yuLow, blueCoefficients), _mm_madd_epi16(yuHigh, blueCoefficients));
+
+    // Saturate to bytes and interleave into RGBA
+    const __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_packus_epi16(g, g));
+    const __m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_set1_epi8(static_cast<char>(0xff)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi16(rg, ba));
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_SSE2 void ConvertNV12RowSSE2(const unsigned char* y, const unsigned char* uv, unsigned char* out, int width)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero);
+      __m128i c16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(uv + x)), zero);
+      YUV8ToRGBASSE2(y16, c16, out + 4 * x);
+    }
+    ConvertNV12RowScalar(y, uv, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_SSE2 void ConvertI420RowSSE2(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* out, int width)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      int uBytes = 0;
+      int vBytes = 0;
+      memcpy(&uBytes, u + x / 2, 4);
+      memcpy(&vBytes, v + x / 2, 4);
+      __m128i c8 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(uBytes), _mm_cvtsi32_si128(vBytes));
+      __m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero);
+      YUV8ToRGBASSE2(y16, _mm_unpacklo_epi8(c8, zero), out + 4 * x);
+    }
+    ConvertI420RowScalar(y, u, v, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  template <bool ChromaFirst>
+  TRACKEDSCREENAR_TARGET_SSE2 void ConvertPackedYUVRowSSE2(const unsigned char* packed, unsigned char* out, int width)
+  {
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed + 2 * x));
+      __m128i low = _mm_and_si128(raw, lowBytes);
+      __m128i high = _mm_srli_epi16(raw, 8);
+      YUV8ToRGBASSE2(ChromaFirst ? high : low, ChromaFirst ? low : high, out + 4 * x);
+    }
+    ConvertPackedYUVRowScalar<ChromaFirst>(packed, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_SSE2 void ConvertBGRARowSSE2(const unsigned char* in, unsigned char* out, int width)
+  {
+    const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xff00ff00));
+    const __m128i redBlue = _mm_set1_epi32(0x00ff00ff);
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+      __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * x));
+      __m128i swapped = _mm_and_si128(pixels, redBlue);
+      swapped = _mm_or_si128(_mm_slli_epi32(swapped, 16), _mm_srli_epi32(swapped, 16));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x), _mm_or_si128(_mm_and_si128(pixels, greenAlpha), swapped));
+    }
+    ConvertBGRARowScalar(in, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  // AVX2: 16 pixels per step. Unpack, multiply-add and pack all work within 128-bit
+  // lanes, so lane 0 carries pixels 0-7 and lane 1 pixels 8-15 throughout.
+  TRACKEDSCREENAR_TARGET_AVX2 inline __m256i CoefficientPairAVX2(short a, short b)
+  {
+    return _mm256_set1_epi32(static_cast<int>((static_cast<unsigned int>(static_cast<unsigned short>(b)) << 16) | static_cast<unsigned short>(a)));
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_AVX2 inline __m256i RoundAndPackAVX2(__m256i low, __m256i high)
+  {
+    const __m256i rounding = _mm256_set1_epi32(128);
+    low = _mm256_srai_epi32(_mm256_add_epi32(low, rounding), 8);
+    high = _mm256_srai_epi32(_mm256_add_epi32(high, rounding), 8);
+    return _mm256_packs_epi32(low, high);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_AVX2 inline void YUV16ToRGBAAVX2(__m256i y16, __m256i c16, unsigned char* out)
+  {
+    __m256i u = _mm256_and_si256(c16, _mm256_set1_epi32(0x0000ffff));
+    u = _mm256_or_si256(u, _mm256_slli_epi32(u, 16));
+    __m256i v = _mm256_srli_epi32(c16, 16);
+    v = _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+
+    y16 = _mm256_sub_epi16(y16, _mm256_set1_epi16(16));
+    u = _mm256_sub_epi16(u, _mm256_set1_epi16(128));
+    v = _mm256_sub_epi16(v, _mm256_set1_epi16(128));
+
+    const __m256i yvLow = _mm256_unpacklo_epi16(y16, v);
+    const __m256i yvHigh = _mm256_unpackhi_epi16(y16, v);
+    const __m256i yuLow = _mm256_unpacklo_epi16(y16, u);
+    const __m256i yuHigh = _mm256_unpackhi_epi16(y16, u);
+
+    const __m256i redCoefficients = CoefficientPairAVX2(298, 409);
+    const __m256i greenLumaCoefficients = CoefficientPairAVX2(298, -100);
+    const __m256i greenChromaCoefficients = CoefficientPairAVX2(0, -208);
+    const __m256i blueCoefficients = CoefficientPairAVX2(298, 516);
+
+    __m256i r = RoundAndPackAVX2(_mm256_madd_epi16(yvLow, redCoefficients), _mm256_madd_epi16(yvHigh, redCoefficients));
+    __m256i g = RoundAndPackAVX2(
+      _mm256_add_epi32(_mm256_madd_epi16(yuLow, greenLumaCoefficients), _mm256_madd_epi16(yvLow, greenChromaCoefficients)),
+      _mm256_add_epi32(_mm256_madd_epi16(yuHigh, greenLumaCoefficients), _mm256_madd_epi16(yvHigh, greenChromaCoefficients)));
+    __m256i b = RoundAndPackAVX2(_mm256_madd_epi16(yuLow, blueCoefficients), _mm256_madd_epi16(yuHigh, blueCoefficients));
+
+    const __m256i rg = _mm256_unpacklo_epi8(_mm256_packus_epi16(r, r), _mm256_packus_epi16(g, g));
+    const __m256i ba = _mm256_unpacklo_epi8(_mm256_packus_epi16(b, b), _mm256_set1_epi8(static_cast<char>(0xff)));
+    // low holds pixels 0-3 and 8-11, high holds 4-7 and 12-15
+    const __m256i low = _mm256_unpacklo_epi16(rg, ba);
+    const __m256i high = _mm256_unpackhi_epi16(rg, ba);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(low, high, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32), _mm256_permute2x128_si256(low, high, 0x31));
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_AVX2 void ConvertNV12RowAVX2(const unsigned char* y, const unsigned char* uv, unsigned char* out, int width)
+  {
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x)));
+      __m256i c16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x)));
+      YUV16ToRGBAAVX2(y16, c16, out + 4 * x);
+    }
+    ConvertNV12RowScalar(y, uv, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_AVX2 void ConvertI420RowAVX2(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* out, int width)
+  {
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i c8 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x / 2)),
+                                     _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x / 2)));
+      __m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x)));
+      YUV16ToRGBAAVX2(y16, _mm256_cvtepu8_epi16(c8), out + 4 * x);
+    }
+    ConvertI420RowScalar(y, u, v, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  template <bool ChromaFirst>
+  TRACKEDSCREENAR_TARGET_AVX2 void ConvertPackedYUVRowAVX2(const unsigned char* packed, unsigned char* out, int width)
+  {
+    const __m256i lowBytes = _mm256_set1_epi16(0x00ff);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packed + 2 * x));
+      __m256i low = _mm256_and_si256(raw, lowBytes);
+      __m256i high = _mm256_srli_epi16(raw, 8);
+      YUV16ToRGBAAVX2(ChromaFirst ? high : low, ChromaFirst ? low : high, out + 4 * x);
+    }
+    ConvertPackedYUVRowScalar<ChromaFirst>(packed, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_AVX2 void ConvertBGRRowAVX2(const unsigned char* in, unsigned char* out, int width)
+  {
+    // Each 128-bit lane swizzles 4 pixels (12 bytes), the last 4 bytes are rewritten by the next store
+    const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15,
+      2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+    int x = 0;
+    // 8 pixels per step, reading and writing 28 bytes
+    for (; x + 10 <= width; x += 8)
+    {
+      const unsigned char* source = in + 3 * x;
+      __m256i pixels = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 12)), 1);
+      pixels = _mm256_shuffle_epi8(pixels, shuffle);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 3 * x), _mm256_castsi256_si128(pixels));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 3 * x + 12), _mm256_extracti128_si256(pixels, 1));
+    }
+    ConvertBGRRowScalar(in, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  TRACKEDSCREENAR_TARGET_AVX2 void ConvertBGRARowAVX2(const unsigned char* in, unsigned char* out, int width)
+  {
+    const __m256i greenAlpha = _mm256_set1_epi32(static_cast<int>(0xff00ff00));
+    const __m256i redBlue = _mm256_set1_epi32(0x00ff00ff);
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * x));
+      __m256i swapped = _mm256_and_si256(pixels, redBlue);
+      swapped = _mm256_or_si256(_mm256_slli_epi32(swapped, 16), _mm256_srli_epi32(swapped, 16));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x), _mm256_or_si256(_mm256_and_si256(pixels, greenAlpha), swapped));
+    }
+    ConvertBGRARowScalar(in, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  bool CPUSupportsAVX2()
+  {
+# if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+      return false;
+    }
+    __cpuid(info, 1);
+    const bool osSavesYMM = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    if (!osSavesYMM || (info[2] & (1 << 28)) == 0)
+    {
+      return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+# else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+# endif
+  }
+#endif
+
+#ifdef TRACKEDSCREENAR_NEON_KERNELS
+  //----------------------------------------------------------------------------
+  // NEON: 8 pixels per step, c holds the interleaved chroma pairs U0 V0 U1 V1 U2 V2 U3 V3
+  inline uint8x8_t RoundAndNarrowNEON(int32x4_t low, int32x4_t high)
+  {
+    return vqmovun_s16(vcombine_s16(vqrshrn_n_s32(low, 8), vqrshrn_n_s32(high, 8)));
+  }
+
+  //----------------------------------------------------------------------------
+  inline void YUV8ToRGBANEON(uint8x8_t y, uint8x8_t c, unsigned char* out)
+  {
+    const uint8x8x2_t separated = vuzp_u8(c, c);
+    const uint8x8_t u8 = vzip_u8(separated.val[0], separated.val[0]).val[0];
+    const uint8x8_t v8 = vzip_u8(separated.val[1], separated.val[1]).val[0];
+
+    const int16x8_t y16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y)), vdupq_n_s16(16));
+    const int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), vdupq_n_s16(128));
+    const int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), vdupq_n_s16(128));
+
+    const int32x4_t lumaLow = vmull_n_s16(vget_low_s16(y16), 298);
+    const int32x4_t lumaHigh = vmull_n_s16(vget_high_s16(y16), 298);
+
+    uint8x8x4_t rgba;
+    rgba.val[0] = RoundAndNarrowNEON(vmlal_n_s16(lumaLow, vget_low_s16(v16), 409), vmlal_n_s16(lumaHigh, vget_high_s16(v16), 409));
+    rgba.val[1] = RoundAndNarrowNEON(
+      vmlal_n_s16(vmlal_n_s16(lumaLow, vget_low_s16(u16), -100), vget_low_s16(v16), -208),
+      vmlal_n_s16(vmlal_n_s16(lumaHigh, vget_high_s16(u16), -100), vget_high_s16(v16), -208));
+    rgba.val[2] = RoundAndNarrowNEON(vmlal_n_s16(lumaLow, vget_low_s16(u16), 516), vmlal_n_s16(lumaHigh, vget_high_s16(u16), 516));
+    rgba.val[3] = vdup_n_u8(255);
+    vst4_u8(out, rgba);
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertNV12RowNEON(const unsigned char* y, const unsigned char* uv, unsigned char* out, int width)
+  {
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      YUV8ToRGBANEON(vld1_u8(y + x), vld1_u8(uv + x), out + 4 * x);
+    }
+    ConvertNV12RowScalar(y, uv, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertI420RowNEON(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* out, int width)
+  {
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      uint32_t uBytes = 0;
+      uint32_t vBytes = 0;
+      memcpy(&uBytes, u + x / 2, 4);
+      memcpy(&vBytes, v + x / 2, 4);
+      const uint8x8_t c = vzip_u8(vcreate_u8(uBytes), vcreate_u8(vBytes)).val[0];
+      YUV8ToRGBANEON(vld1_u8(y + x), c, out + 4 * x);
+    }
+    ConvertI420RowScalar(y, u, v, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  template <bool ChromaFirst>
+  void ConvertPackedYUVRowNEON(const unsigned char* packed, unsigned char* out, int width)
+  {
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      const uint8x8x2_t raw = vld2_u8(packed + 2 * x);
+      YUV8ToRGBANEON(raw.val[ChromaFirst ? 1 : 0], raw.val[ChromaFirst ? 0 : 1], out + 4 * x);
+    }
+    ConvertPackedYUVRowScalar<ChromaFirst>(packed, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertBGRRowNEON(const unsigned char* in, unsigned char* out, int width)
+  {
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      uint8x8x3_t pixels = vld3_u8(in + 3 * x);
+      const uint8x8_t blue = pixels.val[0];
+      pixels.val[0] = pixels.val[2];
+      pixels.val[2] = blue;
+      vst3_u8(out + 3 * x, pixels);
+    }
+    ConvertBGRRowScalar(in, out, x, width);
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertBGRARowNEON(const unsigned char* in, unsigned char* out, int width)
+  {
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      uint8x8x4_t pixels = vld4_u8(in + 4 * x);
+      const uint8x8_t blue = pixels.val[0];
+      pixels.val[0] = pixels.val[2];
+      pixels.val[2] = blue;
+      vst4_u8(out + 4 * x, pixels);
+    }
+    ConvertBGRARowScalar(in, out, x, width);
+  }
+#endif
+
+  //----------------------------------------------------------------------------
+  int DetectInstructionSet()
+  {
+#if defined(TRACKEDSCREENAR_X86_KERNELS)
+    // SSE2 is part of every x86-64 CPU, and of all 32-bit x86 CPUs Slicer runs on
+    return CPUSupportsAVX2() ? vtkTrackedScreenARPixelFormatConverter::InstructionSetAVX2 : vtkTrackedScreenARPixelFormatConverter::InstructionSetSSE2;
+#elif defined(TRACKEDSCREENAR_NEON_KERNELS)
+    return vtkTrackedScreenARPixelFormatConverter::InstructionSetNEON;
+#else
+    return vtkTrackedScreenARPixelFormatConverter::InstructionSetScalar;
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  // Converts a range of frame rows, planes are addressed from the frame size
+  struct ConvertRowsFunctor
+  {
+    int PixelFormat;
+    int InstructionSet;
+    int Width;
+    int Height;
+    const unsigned char* Input;
+    unsigned char* Output;
+
+    void operator()(vtkIdType beginRow, vtkIdType endRow) const
+    {
+      const vtkIdType width = this->Width;
+      const vtkIdType planeSize = width * this->Height;
+      for (vtkIdType row = beginRow; row < endRow; ++row)
+      {
+        switch (this->PixelFormat)
+        {
+          case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR:
+            this->ConvertBGR(this->Input + 3 * width * row, this->Output + 3 * width * row);
+            break;
+          case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGRA:
+            this->ConvertBGRA(this->Input + 4 * width * row, this->Output + 4 * width * row);
+            break;
+          case vtkTrackedScreenARPixelFormatConverter::PixelFormatNV12:
+            this->ConvertNV12(this->Input + width * row, this->Input + planeSize + width * (row / 2), this->Output + 4 * width * row);
+            break;
+          case vtkTrackedScreenARPixelFormatConverter::PixelFormatI420:
+          {
+            const unsigned char* u = this->Input + planeSize + (width / 2) * (row / 2);
+            this->ConvertI420(this->Input + width * row, u, u + planeSize / 4, this->Output + 4 * width * row);
+            break;
+          }
+          case vtkTrackedScreenARPixelFormatConverter::PixelFormatYUYV:
+            this->ConvertPackedYUV<false>(this->Input + 2 * width * row, this->Output + 4 * width * row);
+            break;
+          case vtkTrackedScreenARPixelFormatConverter::PixelFormatUYVY:
+            this->ConvertPackedYUV<true>(this->Input + 2 * width * row, this->Output + 4 * width * row);
+            break;
+          default:
+            break;
+        }
+      }
+    }
+
+    void ConvertBGR(const unsigned char* in, unsigned char* out) const
+    {
+      switch (this->InstructionSet)
+      {
+#if defined(TRACKEDSCREENAR_X86_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetAVX2:
+          ConvertBGRRowAVX2(in, out, this->Width);
+          return;
+#elif defined(TRACKEDSCREENAR_NEON_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetNEON:
+          ConvertBGRRowNEON(in, out, this->Width);
+          return;
+#endif
+        default:
+          // 3-byte swizzles need a byte shuffle, which SSE2 lacks
+          ConvertBGRRowScalar(in, out, 0, this->Width);
+          return;
+      }
+    }
+
+    void ConvertBGRA(const unsigned char* in, unsigned char* out) const
+    {
+      switch (this->InstructionSet)
+      {
+#if defined(TRACKEDSCREENAR_X86_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetAVX2:
+          ConvertBGRARowAVX2(in, out, this->Width);
+          return;
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetSSE2:
+          ConvertBGRARowSSE2(in, out, this->Width);
+          return;
+#elif defined(TRACKEDSCREENAR_NEON_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetNEON:
+          ConvertBGRARowNEON(in, out, this->Width);
+          return;
+#endif
+        default:
+          ConvertBGRARowScalar(in, out, 0, this->Width);
+          return;
+      }
+    }
+
+    void ConvertNV12(const unsigned char* y, const unsigned char* uv, unsigned char* out) const
+    {
+      switch (this->InstructionSet)
+      {
+#if defined(TRACKEDSCREENAR_X86_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetAVX2:
+          ConvertNV12RowAVX2(y, uv, out, this->Width);
+          return;
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetSSE2:
+          ConvertNV12RowSSE2(y, uv, out, this->Width);
+          return;
+#elif defined(TRACKEDSCREENAR_NEON_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetNEON:
+          ConvertNV12RowNEON(y, uv, out, this->Width);
+          return;
+#endif
+        default:
+          ConvertNV12RowScalar(y, uv, out, 0, this->Width);
+          return;
+      }
+    }
+
+    void ConvertI420(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* out) const
+    {
+      switch (this->InstructionSet)
+      {
+#if defined(TRACKEDSCREENAR_X86_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetAVX2:
+          ConvertI420RowAVX2(y, u, v, out, this->Width);
+          return;
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetSSE2:
+          ConvertI420RowSSE2(y, u, v, out, this->Width);
+          return;
+#elif defined(TRACKEDSCREENAR_NEON_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetNEON:
+          ConvertI420RowNEON(y, u, v, out, this->Width);
+          return;
+#endif
+        default:
+          ConvertI420RowScalar(y, u, v, out, 0, this->Width);
+          return;
+      }
+    }
+
+    template <bool ChromaFirst>
+    void ConvertPackedYUV(const unsigned char* packed, unsigned char* out) const
+    {
+      switch (this->InstructionSet)
+      {
+#if defined(TRACKEDSCREENAR_X86_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetAVX2:
+          ConvertPackedYUVRowAVX2<ChromaFirst>(packed, out, this->Width);
+          return;
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetSSE2:
+          ConvertPackedYUVRowSSE2<ChromaFirst>(packed, out, this->Width);
+          return;
+#elif defined(TRACKEDSCREENAR_NEON_KERNELS)
+        case vtkTrackedScreenARPixelFormatConverter::InstructionSetNEON:
+          ConvertPackedYUVRowNEON<ChromaFirst>(packed, out, this->Width);
+          return;
+#endif
+        default:
+          ConvertPackedYUVRowScalar<ChromaFirst>(packed, out, 0, this->Width);
+          return;
+      }
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  int GetInputNumberOfComponents(int format)
+  {
+    switch (format)
+    {
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR:
+        return 3;
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGRA:
+        return 4;
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatYUYV:
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatUYVY:
+        return 2;
+      default:
+        return 1;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int GetOutputNumberOfComponents(int format)
+  {
+    return format == vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR ? 3 : 4;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsPlanar(int format)
+  {
+    return format == vtkTrackedScreenARPixelFormatConverter::PixelFormatNV12 || format == vtkTrackedScreenARPixelFormatConverter::PixelFormatI420;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARPixelFormatConverter);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPixelFormatConverter::vtkTrackedScreenARPixelFormatConverter()
+  : PixelFormat(PixelFormatRGB)
+  , InstructionSet(InstructionSetAuto)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPixelFormatConverter::~vtkTrackedScreenARPixelFormatConverter()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPixelFormatConverter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "PixelFormat: " << GetPixelFormatAsString(this->PixelFormat) << std::endl;
+  os << indent << "InstructionSet: " << GetInstructionSetAsString(this->InstructionSet) << std::endl;
+  os << indent << "WidestInstructionSet: " << GetInstructionSetAsString(GetWidestInstructionSet()) << std::endl;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTrackedScreenARPixelFormatConverter::GetPixelFormatAsString(int format)
+{
+  switch (format)
+  {
+    case PixelFormatRGB:
+      return "RGB";
+    case PixelFormatBGR:
+      return "BGR";
+    case PixelFormatBGRA:
+      return "BGRA";
+    case PixelFormatNV12:
+      return "NV12";
+    case PixelFormatI420:
+      return "I420";
+    case PixelFormatYUYV:
+      return "YUYV";
+    case PixelFormatUYVY:
+      return "UYVY";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPixelFormatConverter::GetPixelFormatFromString(const char* name)
+{
+  if (name == nullptr)
+  {
+    return -1;
+  }
+  for (int format = 0; format < PixelFormat_Last; ++format)
+  {
+    if (strcmp(name, GetPixelFormatAsString(format)) == 0)
+    {
+      return format;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPixelFormatConverter::ComputeFrameSize(int format, const int inputDimensions[2], int frameSize[2])
+{
+  frameSize[0] = inputDimensions[0];
+  frameSize[1] = IsPlanar(format) ? inputDimensions[1] * 2 / 3 : inputDimensions[1];
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPixelFormatConverter::GetWidestInstructionSet()
+{
+  // Thread-safe one-time detection
+  static const int instructionSet = DetectInstructionSet();
+  return instructionSet;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPixelFormatConverter::IsInstructionSetSupported(int instructionSet)
+{
+  switch (instructionSet)
+  {
+    case InstructionSetAuto:
+    case InstructionSetScalar:
+      return true;
+#if defined(TRACKEDSCREENAR_X86_KERNELS)
+    case InstructionSetSSE2:
+      return true;
+    case InstructionSetAVX2:
+      return GetWidestInstructionSet() == InstructionSetAVX2;
+#elif defined(TRACKEDSCREENAR_NEON_KERNELS)
+    case InstructionSetNEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTrackedScreenARPixelFormatConverter::GetInstructionSetAsString(int instructionSet)
+{
+  switch (instructionSet)
+  {
+    case InstructionSetAuto:
+      return "Auto";
+    case InstructionSetScalar:
+      return "Scalar";
+    case InstructionSetSSE2:
+      return "SSE2";
+    case InstructionSetAVX2:
+      return "AVX2";
+    case InstructionSetNEON:
+      return "NEON";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPixelFormatConverter::RequestInformation(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector,
+    vtkInformationVector* outputVector)
+{
+  if (this->PixelFormat == PixelFormatRGB)
+  {
+    return 1;
+  }
+
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+
+  int extent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent);
+  int inputDimensions[2] = { extent[1] - extent[0] + 1, extent[3] - extent[2] + 1 };
+  int frameSize[2];
+  ComputeFrameSize(this->PixelFormat, inputDimensions, frameSize);
+  extent[3] = extent[2] + frameSize[1] - 1;
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, GetOutputNumberOfComponents(this->PixelFormat));
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPixelFormatConverter::RequestUpdateExtent(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector,
+    vtkInformationVector* vtkNotUsed(outputVector))
+{
+  // Chroma planes follow the luma plane, always convert whole frames
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPixelFormatConverter::RequestData(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector,
+    vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkImageData* output = vtkImageData::GetData(outputVector);
+  if (input == nullptr || output == nullptr)
+  {
+    return 0;
+  }
+
+  if (this->PixelFormat == PixelFormatRGB)
+  {
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  int* dimensions = input->GetDimensions();
+  if (input->GetScalarType() != VTK_UNSIGNED_CHAR || input->GetNumberOfScalarComponents() != GetInputNumberOfComponents(this->PixelFormat)
+      || dimensions[2] != 1)
+  {
+    vtkErrorMacro("RequestData: " << GetPixelFormatAsString(this->PixelFormat) << " frames must be single-slice unsigned char with "
+                  << GetInputNumberOfComponents(this->PixelFormat) << " component(s)");
+    return 0;
+  }
+
+  int frameSize[2];
+  ComputeFrameSize(this->PixelFormat, dimensions, frameSize);
+  if (IsPlanar(this->PixelFormat) && (dimensions[1] % 3 != 0 || frameSize[0] % 2 != 0 || frameSize[1] % 2 != 0))
+  {
+    vtkErrorMacro("RequestData: " << GetPixelFormatAsString(this->PixelFormat) << " frames must have even width and height");
+    return 0;
+  }
+  // A pixel pair shares its chroma, the last pixel of an odd row would read past the row
+  if ((this->PixelFormat == PixelFormatYUYV || this->PixelFormat == PixelFormatUYVY) && frameSize[0] % 2 != 0)
+  {
+    vtkErrorMacro("RequestData: " << GetPixelFormatAsString(this->PixelFormat) << " frames must have even width");
+    return 0;
+  }
+
+  // AllocateScalars reuses the output array while type and size are unchanged, so steady state does not allocate
+  int* inputExtent = input->GetExtent();
+  output->SetOrigin(input->GetOrigin());
+  output->SetSpacing(input->GetSpacing());
+  output->SetExtent(inputExtent[0], inputExtent[1], inputExtent[2], inputExtent[2] + frameSize[1] - 1, inputExtent[4], inputExtent[5]);
+  output->AllocateScalars(VTK_UNSIGNED_CHAR, GetOutputNumberOfComponents(this->PixelFormat));
+
+  ConvertRowsFunctor functor;
+  functor.PixelFormat = this->PixelFormat;
+  functor.InstructionSet = (this->InstructionSet != InstructionSetAuto && IsInstructionSetSupported(this->InstructionSet)) ?
+    this->InstructionSet : GetWidestInstructionSet();
+  functor.Width = frameSize[0];
+  functor.Height = frameSize[1];
+  functor.Input = static_cast<const unsigned char*>(input->GetScalarPointer());
+  functor.Output = static_cast<unsigned char*>(output->GetScalarPointer());
+  vtkSMPTools::For(0, frameSize[1], functor);
+
+  return 1;
+}
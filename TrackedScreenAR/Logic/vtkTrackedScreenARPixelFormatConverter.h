@@ -0,0 +1,112 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARPixelFormatConverter - converts raw capture frames to RGB(A) textures
+// .SECTION Description
+// Converts video frames stored in the layout of the capture device into the RGB(A)
+// pixels vtkTexture expects, so the frame is touched once on its way to the texture.
+// The input must be unsigned char and is interpreted according to PixelFormat:
+//  - RGB: passed through without copying (default)
+//  - BGR, BGRA: 3 or 4 components, channels are swizzled to RGB and RGBA
+//  - NV12, I420: 1 component, the Y plane followed by the chroma plane(s), so the
+//    input is 1.5 times as high as the frame
+//  - YUYV, UYVY: 2 components, luma and alternating chroma per pixel, even width
+// YUV frames are decoded as BT.601 limited range into RGBA, 4-byte pixels are what
+// the texture upload consumes without repacking.
+//
+// Rows are converted in parallel with vtkSMPTools and each row uses the widest
+// kernel the CPU supports (AVX2 or SSE2 on x86, NEON on ARM), unless InstructionSet
+// selects another one. The output scalars are reused from frame to frame.
+
+#ifndef __vtkTrackedScreenARPixelFormatConverter_h
+#define __vtkTrackedScreenARPixelFormatConverter_h
+
+// VTK includes
+#include <vtkImageAlgorithm.h>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARPixelFormatConverter : public vtkImageAlgorithm
+{
+public:
+  enum PixelFormatType
+  {
+    PixelFormatRGB = 0,
+    PixelFormatBGR,
+    PixelFormatBGRA,
+    PixelFormatNV12,
+    PixelFormatI420,
+    PixelFormatYUYV,
+    PixelFormatUYVY,
+    PixelFormat_Last
+  };
+
+  enum InstructionSetType
+  {
+    /// Widest instruction set the CPU supports
+    InstructionSetAuto = -1,
+    InstructionSetScalar = 0,
+    InstructionSetSSE2,
+    InstructionSetAVX2,
+    InstructionSetNEON,
+    InstructionSet_Last
+  };
+
+  static vtkTrackedScreenARPixelFormatConverter* New();
+  vtkTypeMacro(vtkTrackedScreenARPixelFormatConverter, vtkImageAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Layout of the input frames, PixelFormatRGB by default
+  vtkSetClampMacro(PixelFormat, int, PixelFormatRGB, PixelFormat_Last - 1);
+  vtkGetMacro(PixelFormat, int);
+  static const char* GetPixelFormatAsString(int format);
+  /// Returns -1 if the name is not recognized
+  static int GetPixelFormatFromString(const char* name);
+
+  /// Size of the frame stored in an input image of the given dimensions
+  static void ComputeFrameSize(int format, const int inputDimensions[2], int frameSize[2]);
+
+  /// Kernels to run, InstructionSetAuto by default. InstructionSetScalar runs the scalar reference
+  /// kernels. An instruction set the CPU does not support runs the widest one it supports.
+  vtkSetClampMacro(InstructionSet, int, InstructionSetAuto, InstructionSet_Last - 1);
+  vtkGetMacro(InstructionSet, int);
+
+  /// Widest instruction set the kernels dispatch to on this CPU
+  static int GetWidestInstructionSet();
+  static bool IsInstructionSetSupported(int instructionSet);
+  /// "Auto", "Scalar", "SSE2", "AVX2" or "NEON"
+  static const char* GetInstructionSetAsString(int instructionSet);
+
+protected:
+  vtkTrackedScreenARPixelFormatConverter();
+  virtual ~vtkTrackedScreenARPixelFormatConverter();
+
+  virtual int RequestInformation(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+  virtual int RequestUpdateExtent(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+  virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+
+protected:
+  int PixelFormat;
+  int InstructionSet;
+
+private:
+  vtkTrackedScreenARPixelFormatConverter(const vtkTrackedScreenARPixelFormatConverter&); // Not implemented
+  void operator=(const vtkTrackedScreenARPixelFormatConverter&); // Not implemented
+};
+
+#endif
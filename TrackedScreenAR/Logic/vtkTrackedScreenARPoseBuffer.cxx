@@ -0,0 +1,312 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARPoseBuffer.h"
+#include "vtkTrackedScreenARRigidTransform.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  const int DEFAULT_CAPACITY = 256;
+
+  // A reader racing the writer on the newest slot simply tries again
+  const int MAX_READ_ATTEMPTS = 4;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARPoseBuffer);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPoseBuffer::vtkTrackedScreenARPoseBuffer()
+  : Capacity(0)
+  , MaximumSynchronizationAge(0.25)
+  , WriteCount(0)
+{
+  this->SetCapacity(DEFAULT_CAPACITY);
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPoseBuffer::~vtkTrackedScreenARPoseBuffer()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPoseBuffer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Capacity: " << this->Capacity << std::endl;
+  os << indent << "MaximumSynchronizationAge: " << this->MaximumSynchronizationAge << std::endl;
+  os << indent << "NumberOfPoses: " << this->GetNumberOfPoses() << std::endl;
+  double oldest = 0.0;
+  double newest = 0.0;
+  if (this->GetTimeRange(oldest, newest))
+  {
+    os << indent << "TimeRange: " << oldest << " " << newest << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPoseBuffer::SetCapacity(int capacity)
+{
+  capacity = std::max(2, capacity);
+  if (capacity == this->Capacity)
+  {
+    return;
+  }
+  this->Slots.reset(new Slot[capacity]);
+  this->Capacity = capacity;
+  for (int i = 0; i < capacity; ++i)
+  {
+    this->Slots[i].Sequence.store(0, std::memory_order_relaxed);
+  }
+  this->WriteCount.store(0, std::memory_order_release);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPoseBuffer::GetCapacity() const
+{
+  return this->Capacity;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPoseBuffer::AddPose(double timestamp, vtkMatrix4x4* matrix)
+{
+  if (matrix == nullptr)
+  {
+    return;
+  }
+
+  PoseSample sample;
+  sample.Timestamp = timestamp;
+  vtkTrackedScreenARRigidTransform pose = vtkTrackedScreenARRigidTransform::FromMatrix(matrix);
+  pose.GetQuaternion(sample.Orientation);
+  pose.GetTranslation(sample.Position);
+
+  // Single writer: nobody else advances WriteCount
+  unsigned long long writeIndex = this->WriteCount.load(std::memory_order_relaxed);
+  sample.WriteIndex = writeIndex;
+  Slot& slot = this->Slots[writeIndex % this->Capacity];
+
+  unsigned long long sequence = slot.Sequence.load(std::memory_order_relaxed);
+  slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.Sample = sample;
+  slot.Sequence.store(sequence + 2, std::memory_order_release);
+
+  this->WriteCount.store(writeIndex + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPoseBuffer::ReadSample(unsigned long long writeIndex, PoseSample& sample) const
+{
+  const Slot& slot = this->Slots[writeIndex % this->Capacity];
+
+  unsigned long long before = slot.Sequence.load(std::memory_order_acquire);
+  if ((before & 1) != 0)
+  {
+    // Write in progress
+    return false;
+  }
+  sample = slot.Sample;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  unsigned long long after = slot.Sequence.load(std::memory_order_relaxed);
+
+  return before == after && sample.WriteIndex == writeIndex;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPoseBuffer::GetPose(double timestamp, vtkMatrix4x4* matrix) const
+{
+  if (matrix == nullptr)
+  {
+    return false;
+  }
+
+  for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+  {
+    unsigned long long writeCount = this->WriteCount.load(std::memory_order_acquire);
+    if (writeCount == 0)
+    {
+      return false;
+    }
+    unsigned long long oldestIndex = (writeCount > static_cast<unsigned long long>(this->Capacity)) ? writeCount - this->Capacity : 0;
+
+    // Walk back from the newest sample until one is not newer than the requested time.
+    // Poses arrive much faster than video frames, so only a few samples are visited.
+    PoseSample newer;
+    PoseSample older;
+    bool haveNewer = false;
+    bool haveOlder = false;
+    for (unsigned long long index = writeCount; index-- > oldestIndex;)
+    {
+      PoseSample sample;
+      if (!this->ReadSample(index, sample))
+      {
+        // Overwritten by the writer, older samples are gone too
+        break;
+      }
+      if (sample.Timestamp <= timestamp)
+      {
+        older = sample;
+        haveOlder = true;
+        break;
+      }
+      newer = sample;
+      haveNewer = true;
+    }
+
+    if (haveOlder && haveNewer)
+    {
+      double interval = newer.Timestamp - older.Timestamp;
+      double t = (interval > 0.0) ? (timestamp - older.Timestamp) / interval : 0.0;
+      PoseSample interpolated;
+      InterpolatePose(older.Orientation, older.Position, newer.Orientation, newer.Position, t,
+                      interpolated.Orientation, interpolated.Position);
+      SampleToMatrix(interpolated, matrix);
+      return true;
+    }
+    if (haveOlder)
+    {
+      // Requested time is after the newest pose
+      SampleToMatrix(older, matrix);
+      return true;
+    }
+    if (haveNewer)
+    {
+      // Requested time is before the oldest pose
+      SampleToMatrix(newer, matrix);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPoseBuffer::GetSynchronizedPose(double timestamp, vtkMatrix4x4* matrix) const
+{
+  double poseTimestamp = 0.0;
+  return this->GetSynchronizedPose(timestamp, matrix, poseTimestamp);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPoseBuffer::GetSynchronizedPose(double timestamp, vtkMatrix4x4* matrix, double& poseTimestamp) const
+{
+  double oldest = 0.0;
+  double newest = 0.0;
+  if (matrix == nullptr || !this->GetTimeRange(oldest, newest))
+  {
+    return false;
+  }
+  if (timestamp < oldest || newest - timestamp > this->MaximumSynchronizationAge)
+  {
+    // No pose was recorded when the frame was acquired, or not recently enough to be worth waiting for
+    return this->GetLatestPose(matrix, poseTimestamp);
+  }
+  poseTimestamp = timestamp;
+  return this->GetPose(timestamp, matrix);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPoseBuffer::GetLatestPose(vtkMatrix4x4* matrix, double& timestamp) const
+{
+  for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+  {
+    unsigned long long writeCount = this->WriteCount.load(std::memory_order_acquire);
+    if (writeCount == 0)
+    {
+      return false;
+    }
+    PoseSample sample;
+    if (this->ReadSample(writeCount - 1, sample))
+    {
+      timestamp = sample.Timestamp;
+      if (matrix != nullptr)
+      {
+        SampleToMatrix(sample, matrix);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPoseBuffer::GetTimeRange(double& oldest, double& newest) const
+{
+  for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+  {
+    unsigned long long writeCount = this->WriteCount.load(std::memory_order_acquire);
+    if (writeCount == 0)
+    {
+      return false;
+    }
+    unsigned long long oldestIndex = (writeCount > static_cast<unsigned long long>(this->Capacity)) ? writeCount - this->Capacity : 0;
+    PoseSample oldestSample;
+    PoseSample newestSample;
+    // The oldest slot is the next one to be overwritten, skip ahead one if it is being written
+    if ((this->ReadSample(oldestIndex, oldestSample) || this->ReadSample(oldestIndex + 1, oldestSample))
+        && this->ReadSample(writeCount - 1, newestSample))
+    {
+      oldest = oldestSample.Timestamp;
+      newest = newestSample.Timestamp;
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPoseBuffer::GetNumberOfPoses() const
+{
+  unsigned long long writeCount = this->WriteCount.load(std::memory_order_acquire);
+  return static_cast<int>(std::min<unsigned long long>(writeCount, this->Capacity));
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPoseBuffer::Clear()
+{
+  this->WriteCount.store(0, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPoseBuffer::InterpolatePose(const double q0[4], const double p0[3], const double q1[4], const double p1[3], double t,
+    double q[4], double p[3])
+{
+  t = std::min(1.0, std::max(0.0, t));
+  for (int i = 0; i < 3; ++i)
+  {
+    p[i] = (1.0 - t) * p0[i] + t * p1[i];
+  }
+  vtkTrackedScreenARRigidTransform::QuaternionSlerp(q0, q1, t, q);
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPoseBuffer::SampleToMatrix(const PoseSample& sample, vtkMatrix4x4* matrix)
+{
+  vtkTrackedScreenARRigidTransform::FromQuaternion(sample.Orientation, sample.Position).ToMatrix(matrix);
+}
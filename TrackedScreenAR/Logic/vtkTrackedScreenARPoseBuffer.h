@@ -0,0 +1,129 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARPoseBuffer - timestamped ring buffer of rigid tracker poses
+// .SECTION Description
+// Fixed-capacity ring buffer of rigid poses (rotation quaternion + translation)
+// with a single writer and any number of readers. Writers never block: each slot
+// is guarded by a sequence counter, readers retry a slot that was overwritten while
+// being copied. GetPose() returns the pose at an arbitrary timestamp, interpolating
+// between the two bracketing samples (SLERP for the rotation, linear for the
+// translation) and clamping to the oldest/newest sample outside the stored range.
+// Poses are expected to be added in increasing timestamp order.
+
+#ifndef __vtkTrackedScreenARPoseBuffer_h
+#define __vtkTrackedScreenARPoseBuffer_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <atomic>
+#include <memory>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkMatrix4x4;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARPoseBuffer : public vtkObject
+{
+public:
+  static vtkTrackedScreenARPoseBuffer* New();
+  vtkTypeMacro(vtkTrackedScreenARPoseBuffer, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Maximum number of poses kept. Changing it discards the stored poses,
+  /// it must not be called while another thread accesses the buffer.
+  void SetCapacity(int capacity);
+  int GetCapacity() const;
+
+  /// Append a pose. Only the rotation and translation of the matrix are stored.
+  void AddPose(double timestamp, vtkMatrix4x4* matrix);
+
+  /// Pose at the given timestamp, interpolated between the bracketing samples.
+  /// Returns false if the buffer is empty.
+  bool GetPose(double timestamp, vtkMatrix4x4* matrix) const;
+
+  /// Pose at the acquisition time of a video frame: interpolated as by GetPose() if the time is within the
+  /// stored range and at most MaximumSynchronizationAge before the newest pose, otherwise the latest pose.
+  /// A stalled or still video then does not freeze the pose at the oldest sample while the tracker moves on.
+  /// Returns false if the buffer is empty.
+  bool GetSynchronizedPose(double timestamp, vtkMatrix4x4* matrix) const;
+
+  /// Same as above, poseTimestamp is set to the tracker time of the returned pose: the frame time if it was
+  /// interpolated, the timestamp of the latest pose otherwise
+  bool GetSynchronizedPose(double timestamp, vtkMatrix4x4* matrix, double& poseTimestamp) const;
+
+  /// Largest lag of a frame timestamp behind the newest pose for which GetSynchronizedPose() still
+  /// interpolates, in seconds. Well above the video latency, 0.25 s by default.
+  vtkSetClampMacro(MaximumSynchronizationAge, double, 0.0, VTK_DOUBLE_MAX);
+  vtkGetMacro(MaximumSynchronizationAge, double);
+
+  /// Most recent pose. Returns false if the buffer is empty.
+  bool GetLatestPose(vtkMatrix4x4* matrix, double& timestamp) const;
+
+  /// Timestamps of the oldest and newest stored poses. Returns false if the buffer is empty.
+  bool GetTimeRange(double& oldest, double& newest) const;
+
+  /// Number of poses currently stored
+  int GetNumberOfPoses() const;
+
+  /// Discard all stored poses
+  void Clear();
+
+  /// Interpolate between two rigid poses (quaternion w,x,y,z + translation), t in [0, 1]
+  static void InterpolatePose(const double q0[4], const double p0[3], const double q1[4], const double p1[3], double t,
+                              double q[4], double p[3]);
+
+protected:
+  vtkTrackedScreenARPoseBuffer();
+  virtual ~vtkTrackedScreenARPoseBuffer();
+
+  struct PoseSample
+  {
+    unsigned long long WriteIndex;
+    double Timestamp;
+    double Orientation[4];
+    double Position[3];
+  };
+
+  struct Slot
+  {
+    std::atomic<unsigned long long> Sequence;
+    PoseSample Sample;
+  };
+
+  /// Copy the sample stored at the given write count, returns false if it was overwritten meanwhile
+  bool ReadSample(unsigned long long writeIndex, PoseSample& sample) const;
+
+  static void SampleToMatrix(const PoseSample& sample, vtkMatrix4x4* matrix);
+
+protected:
+  std::unique_ptr<Slot[]> Slots;
+  int Capacity;
+  double MaximumSynchronizationAge;
+
+  // Number of poses ever written, the newest pose is at (WriteCount - 1) % capacity
+  std::atomic<unsigned long long> WriteCount;
+
+private:
+  vtkTrackedScreenARPoseBuffer(const vtkTrackedScreenARPoseBuffer&); // Not implemented
+  void operator=(const vtkTrackedScreenARPoseBuffer&); // Not implemented
+};
+
+#endif
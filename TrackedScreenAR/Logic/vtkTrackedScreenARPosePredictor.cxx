@@ -0,0 +1,394 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARPoseBuffer.h"
+#include "vtkTrackedScreenARPosePredictor.h"
+#include "vtkTrackedScreenARRigidTransform.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Pending predictions are scored within a few tracker samples, this only bounds memory
+  const size_t MAX_PENDING_PREDICTIONS = 64;
+
+  //----------------------------------------------------------------------------
+  // Rotate q by the rotation vector v expressed in the world frame
+  void ApplyRotationVector(const double v[3], const double q[4], double result[4])
+  {
+    double increment[4];
+    vtkTrackedScreenARRigidTransform::RotationVectorToQuaternion(v, increment);
+    vtkTrackedScreenARRigidTransform::QuaternionMultiply(increment, q, result);
+    vtkTrackedScreenARRigidTransform::QuaternionNormalize(result);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARPosePredictor);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPosePredictor::vtkTrackedScreenARPosePredictor()
+  : PredictionMode(PredictionOff)
+  , MaximumPredictionHorizon(0.1)
+  , TranslationProcessNoise(2000.0)
+  , TranslationMeasurementNoise(0.25)
+  , RotationProcessNoise(20.0)
+  , RotationMeasurementNoise(0.002)
+  , LastTranslationResidual(0.0)
+  , LastRotationResidual(0.0)
+  , SumSquaredTranslationResidual(0.0)
+  , SumSquaredRotationResidual(0.0)
+  , SumSquaredBaselineTranslationResidual(0.0)
+  , SumSquaredBaselineRotationResidual(0.0)
+  , NumberOfResiduals(0)
+{
+  this->Reset();
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPosePredictor::~vtkTrackedScreenARPosePredictor()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "PredictionMode: " << GetPredictionModeAsString(this->PredictionMode) << std::endl;
+  os << indent << "MaximumPredictionHorizon: " << this->MaximumPredictionHorizon << std::endl;
+  os << indent << "TranslationProcessNoise: " << this->TranslationProcessNoise << std::endl;
+  os << indent << "TranslationMeasurementNoise: " << this->TranslationMeasurementNoise << std::endl;
+  os << indent << "RotationProcessNoise: " << this->RotationProcessNoise << std::endl;
+  os << indent << "RotationMeasurementNoise: " << this->RotationMeasurementNoise << std::endl;
+  os << indent << "LatestTimestamp: " << this->LatestTimestamp << std::endl;
+  os << indent << "NumberOfResiduals: " << this->NumberOfResiduals << std::endl;
+  os << indent << "RMSTranslationResidual: " << this->GetRMSTranslationResidual() << std::endl;
+  os << indent << "RMSRotationResidual: " << this->GetRMSRotationResidual() << std::endl;
+  os << indent << "RMSBaselineTranslationResidual: " << this->GetRMSBaselineTranslationResidual() << std::endl;
+  os << indent << "RMSBaselineRotationResidual: " << this->GetRMSBaselineRotationResidual() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTrackedScreenARPosePredictor::GetPredictionModeAsString(int mode)
+{
+  switch (mode)
+  {
+    case PredictionOff:
+      return "Off";
+    case ConstantVelocity:
+      return "ConstantVelocity";
+    case Kalman:
+      return "Kalman";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::Reset()
+{
+  this->NumberOfMeasurements = 0;
+  this->LatestTimestamp = -1.0;
+  this->PendingPredictions.clear();
+  for (int i = 0; i < 3; ++i)
+  {
+    this->LinearVelocity[i] = 0.0;
+    this->AngularVelocity[i] = 0.0;
+    this->FilteredPosition[i] = 0.0;
+    this->FilteredLinearVelocity[i] = 0.0;
+    this->FilteredAngularVelocity[i] = 0.0;
+    this->AngularVelocityVariance[i] = 0.0;
+    for (int j = 0; j < 4; ++j)
+    {
+      this->TranslationCovariance[i][j] = 0.0;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::ResetResiduals()
+{
+  this->LastTranslationResidual = 0.0;
+  this->LastRotationResidual = 0.0;
+  this->SumSquaredTranslationResidual = 0.0;
+  this->SumSquaredRotationResidual = 0.0;
+  this->SumSquaredBaselineTranslationResidual = 0.0;
+  this->SumSquaredBaselineRotationResidual = 0.0;
+  this->NumberOfResiduals = 0;
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARPosePredictor::GetRMSTranslationResidual() const
+{
+  return this->NumberOfResiduals > 0 ? sqrt(this->SumSquaredTranslationResidual / this->NumberOfResiduals) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARPosePredictor::GetRMSRotationResidual() const
+{
+  return this->NumberOfResiduals > 0 ? sqrt(this->SumSquaredRotationResidual / this->NumberOfResiduals) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARPosePredictor::GetRMSBaselineTranslationResidual() const
+{
+  return this->NumberOfResiduals > 0 ? sqrt(this->SumSquaredBaselineTranslationResidual / this->NumberOfResiduals) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARPosePredictor::GetRMSBaselineRotationResidual() const
+{
+  return this->NumberOfResiduals > 0 ? sqrt(this->SumSquaredBaselineRotationResidual / this->NumberOfResiduals) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::AddMeasurement(double timestamp, vtkMatrix4x4* matrix)
+{
+  if (matrix == nullptr)
+  {
+    return;
+  }
+
+  Pose current;
+  MatrixToPose(matrix, timestamp, current);
+
+  if (this->NumberOfMeasurements == 0)
+  {
+    this->Latest = current;
+    this->LatestTimestamp = timestamp;
+    this->NumberOfMeasurements = 1;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      this->FilteredPosition[axis] = current.Position[axis];
+      this->FilteredLinearVelocity[axis] = 0.0;
+      double measurementVariance = this->TranslationMeasurementNoise * this->TranslationMeasurementNoise;
+      // Position known up to measurement noise, velocity unknown
+      this->TranslationCovariance[axis][0] = measurementVariance;
+      this->TranslationCovariance[axis][1] = 0.0;
+      this->TranslationCovariance[axis][2] = 0.0;
+      this->TranslationCovariance[axis][3] = 1e6;
+      this->FilteredAngularVelocity[axis] = 0.0;
+      this->AngularVelocityVariance[axis] = 1e3;
+    }
+    return;
+  }
+
+  double dt = timestamp - this->Latest.Timestamp;
+  if (dt <= 0.0)
+  {
+    // Out of order or duplicate sample, keep the state as is
+    return;
+  }
+
+  this->ScorePredictions(this->Latest, current);
+
+  // Instantaneous velocities between the last two measurements
+  double measuredLinearVelocity[3];
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    measuredLinearVelocity[axis] = (current.Position[axis] - this->Latest.Position[axis]) / dt;
+  }
+  double inverseLatest[4];
+  double increment[4];
+  vtkTrackedScreenARRigidTransform::QuaternionConjugate(this->Latest.Orientation, inverseLatest);
+  vtkTrackedScreenARRigidTransform::QuaternionMultiply(current.Orientation, inverseLatest, increment);
+  double measuredAngularVelocity[3];
+  vtkTrackedScreenARRigidTransform::QuaternionToRotationVector(increment, measuredAngularVelocity);
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    measuredAngularVelocity[axis] /= dt;
+    this->LinearVelocity[axis] = measuredLinearVelocity[axis];
+    this->AngularVelocity[axis] = measuredAngularVelocity[axis];
+  }
+
+  // Kalman filter, constant velocity model per translation axis
+  double accelerationVariance = this->TranslationProcessNoise * this->TranslationProcessNoise;
+  double positionVariance = this->TranslationMeasurementNoise * this->TranslationMeasurementNoise;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    double* P = this->TranslationCovariance[axis];
+
+    // Predict
+    double x0 = this->FilteredPosition[axis] + dt * this->FilteredLinearVelocity[axis];
+    double x1 = this->FilteredLinearVelocity[axis];
+    double p00 = P[0] + dt * (P[1] + P[2]) + dt * dt * P[3] + accelerationVariance * dt * dt * dt * dt / 4.0;
+    double p01 = P[1] + dt * P[3] + accelerationVariance * dt * dt * dt / 2.0;
+    double p10 = P[2] + dt * P[3] + accelerationVariance * dt * dt * dt / 2.0;
+    double p11 = P[3] + accelerationVariance * dt * dt;
+
+    // Update with the measured position
+    double innovation = current.Position[axis] - x0;
+    double innovationVariance = p00 + positionVariance;
+    double k0 = p00 / innovationVariance;
+    double k1 = p10 / innovationVariance;
+    this->FilteredPosition[axis] = x0 + k0 * innovation;
+    this->FilteredLinearVelocity[axis] = x1 + k1 * innovation;
+    P[0] = (1.0 - k0) * p00;
+    P[1] = (1.0 - k0) * p01;
+    P[2] = p10 - k1 * p00;
+    P[3] = p11 - k1 * p01;
+  }
+
+  // Random walk filter on the angular velocity, the measured rate is a difference of two noisy angles
+  double angularVelocityProcessVariance = this->RotationProcessNoise * this->RotationProcessNoise * dt * dt;
+  double angularVelocityMeasurementVariance = 2.0 * this->RotationMeasurementNoise * this->RotationMeasurementNoise / (dt * dt);
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    double variance = this->AngularVelocityVariance[axis] + angularVelocityProcessVariance;
+    double gain = variance / (variance + angularVelocityMeasurementVariance);
+    this->FilteredAngularVelocity[axis] += gain * (measuredAngularVelocity[axis] - this->FilteredAngularVelocity[axis]);
+    this->AngularVelocityVariance[axis] = (1.0 - gain) * variance;
+  }
+
+  this->Latest = current;
+  this->LatestTimestamp = timestamp;
+  this->NumberOfMeasurements++;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARPosePredictor::PredictPose(double timestamp, vtkMatrix4x4* matrix)
+{
+  if (matrix == nullptr || this->NumberOfMeasurements == 0)
+  {
+    return false;
+  }
+
+  PendingPrediction pending;
+  this->Extrapolate(timestamp, pending.Predicted);
+  PoseToMatrix(pending.Predicted, matrix);
+
+  if (timestamp > this->Latest.Timestamp)
+  {
+    // Remember it to be scored against the measurement at the time it was extrapolated to,
+    // which is clamped to the maximum horizon. The latest pose is scored at the same time,
+    // that is the error prediction should beat.
+    pending.Predicted.Timestamp = this->Latest.Timestamp
+      + std::min(this->MaximumPredictionHorizon, timestamp - this->Latest.Timestamp);
+    pending.Baseline = this->Latest;
+    pending.Baseline.Timestamp = pending.Predicted.Timestamp;
+    this->PendingPredictions.push_back(pending);
+    if (this->PendingPredictions.size() > MAX_PENDING_PREDICTIONS)
+    {
+      this->PendingPredictions.pop_front();
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::Extrapolate(double timestamp, Pose& pose) const
+{
+  pose = this->Latest;
+  if (this->PredictionMode == PredictionOff || this->NumberOfMeasurements < 2)
+  {
+    return;
+  }
+
+  double horizon = std::min(this->MaximumPredictionHorizon, std::max(0.0, timestamp - this->Latest.Timestamp));
+  const double* linearVelocity = this->LinearVelocity;
+  const double* angularVelocity = this->AngularVelocity;
+  const double* position = this->Latest.Position;
+  if (this->PredictionMode == Kalman)
+  {
+    linearVelocity = this->FilteredLinearVelocity;
+    angularVelocity = this->FilteredAngularVelocity;
+    position = this->FilteredPosition;
+  }
+
+  double rotation[3];
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    pose.Position[axis] = position[axis] + horizon * linearVelocity[axis];
+    rotation[axis] = horizon * angularVelocity[axis];
+  }
+  ApplyRotationVector(rotation, this->Latest.Orientation, pose.Orientation);
+  pose.Timestamp = this->Latest.Timestamp + horizon;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::ScorePredictions(const Pose& previous, const Pose& current)
+{
+  double interval = current.Timestamp - previous.Timestamp;
+  while (!this->PendingPredictions.empty() && this->PendingPredictions.front().Predicted.Timestamp <= current.Timestamp)
+  {
+    PendingPrediction pending = this->PendingPredictions.front();
+    this->PendingPredictions.pop_front();
+    double targetTimestamp = pending.Predicted.Timestamp;
+    if (targetTimestamp < previous.Timestamp)
+    {
+      // Target time fell before a gap in the measurements, nothing to compare to
+      continue;
+    }
+
+    Pose measured;
+    vtkTrackedScreenARPoseBuffer::InterpolatePose(previous.Orientation, previous.Position, current.Orientation, current.Position,
+        (targetTimestamp - previous.Timestamp) / interval, measured.Orientation, measured.Position);
+
+    double translationError = 0.0;
+    double rotationError = 0.0;
+    ComputePoseError(pending.Predicted, measured, translationError, rotationError);
+    double baselineTranslationError = 0.0;
+    double baselineRotationError = 0.0;
+    ComputePoseError(pending.Baseline, measured, baselineTranslationError, baselineRotationError);
+
+    this->LastTranslationResidual = translationError;
+    this->LastRotationResidual = rotationError;
+    this->SumSquaredTranslationResidual += translationError * translationError;
+    this->SumSquaredRotationResidual += rotationError * rotationError;
+    this->SumSquaredBaselineTranslationResidual += baselineTranslationError * baselineTranslationError;
+    this->SumSquaredBaselineRotationResidual += baselineRotationError * baselineRotationError;
+    this->NumberOfResiduals++;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::ComputePoseError(const Pose& pose, const Pose& reference,
+    double& translationError, double& rotationError)
+{
+  translationError = sqrt(vtkMath::Distance2BetweenPoints(pose.Position, reference.Position));
+  double inverseReference[4];
+  double difference[4];
+  vtkTrackedScreenARRigidTransform::QuaternionConjugate(reference.Orientation, inverseReference);
+  vtkTrackedScreenARRigidTransform::QuaternionMultiply(pose.Orientation, inverseReference, difference);
+  double rotationVector[3];
+  vtkTrackedScreenARRigidTransform::QuaternionToRotationVector(difference, rotationVector);
+  rotationError = vtkMath::DegreesFromRadians(vtkMath::Norm(rotationVector));
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::MatrixToPose(vtkMatrix4x4* matrix, double timestamp, Pose& pose)
+{
+  pose.Timestamp = timestamp;
+  vtkTrackedScreenARRigidTransform transform = vtkTrackedScreenARRigidTransform::FromMatrix(matrix);
+  transform.GetQuaternion(pose.Orientation);
+  transform.GetTranslation(pose.Position);
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARPosePredictor::PoseToMatrix(const Pose& pose, vtkMatrix4x4* matrix)
+{
+  vtkTrackedScreenARRigidTransform::FromQuaternion(pose.Orientation, pose.Position).ToMatrix(matrix);
+}
@@ -0,0 +1,171 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARPosePredictor - extrapolates a tracked rigid pose forward in time
+// .SECTION Description
+// Estimates linear and angular velocity of a tracked pose and extrapolates it to a
+// future timestamp, to compensate the latency between pose arrival and display.
+// ConstantVelocity uses the difference of the last two measurements. Kalman runs a
+// constant-velocity Kalman filter per translation axis and a random-walk filter on
+// the angular velocity, which is less sensitive to tracker jitter.
+//
+// Each prediction is remembered and compared with the measured pose once the
+// tracker reports a pose at or after the predicted time, the difference is
+// reported as the residual error. The latest measured pose, which is what is
+// displayed with prediction off, is scored at the same time as the baseline
+// error that prediction has to improve on.
+
+#ifndef __vtkTrackedScreenARPosePredictor_h
+#define __vtkTrackedScreenARPosePredictor_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <deque>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkMatrix4x4;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARPosePredictor : public vtkObject
+{
+public:
+  enum PredictionModeType
+  {
+    PredictionOff = 0,
+    ConstantVelocity,
+    Kalman,
+    PredictionMode_Last
+  };
+
+  static vtkTrackedScreenARPosePredictor* New();
+  vtkTypeMacro(vtkTrackedScreenARPosePredictor, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Prediction model, PredictionOff by default
+  vtkSetClampMacro(PredictionMode, int, PredictionOff, PredictionMode_Last - 1);
+  vtkGetMacro(PredictionMode, int);
+  static const char* GetPredictionModeAsString(int mode);
+
+  /// Predictions never extrapolate further than this many seconds past the latest measurement
+  vtkSetClampMacro(MaximumPredictionHorizon, double, 0.0, 1.0);
+  vtkGetMacro(MaximumPredictionHorizon, double);
+
+  /// Kalman filter tuning: acceleration noise (mm/s^2 and rad/s^2) and measurement noise (mm and rad)
+  vtkSetMacro(TranslationProcessNoise, double);
+  vtkGetMacro(TranslationProcessNoise, double);
+  vtkSetMacro(TranslationMeasurementNoise, double);
+  vtkGetMacro(TranslationMeasurementNoise, double);
+  vtkSetMacro(RotationProcessNoise, double);
+  vtkGetMacro(RotationProcessNoise, double);
+  vtkSetMacro(RotationMeasurementNoise, double);
+  vtkGetMacro(RotationMeasurementNoise, double);
+
+  /// Feed a measured pose. Also scores pending predictions whose time has come.
+  void AddMeasurement(double timestamp, vtkMatrix4x4* matrix);
+
+  /// Pose extrapolated to the given time. If prediction is off or no velocity is known yet,
+  /// the latest measurement is returned. Returns false if there is no measurement.
+  bool PredictPose(double timestamp, vtkMatrix4x4* matrix);
+
+  /// Timestamp of the latest measurement, negative if none
+  vtkGetMacro(LatestTimestamp, double);
+
+  /// Residual error of the most recently scored prediction (mm and degrees)
+  vtkGetMacro(LastTranslationResidual, double);
+  vtkGetMacro(LastRotationResidual, double);
+
+  /// RMS residual error over all scored predictions since the last reset (mm and degrees)
+  double GetRMSTranslationResidual() const;
+  double GetRMSRotationResidual() const;
+  vtkGetMacro(NumberOfResiduals, unsigned long);
+
+  /// RMS error of the unpredicted latest pose at the same target times (mm and degrees)
+  double GetRMSBaselineTranslationResidual() const;
+  double GetRMSBaselineRotationResidual() const;
+
+  void ResetResiduals();
+
+  /// Forget the motion state and pending predictions
+  void Reset();
+
+protected:
+  vtkTrackedScreenARPosePredictor();
+  virtual ~vtkTrackedScreenARPosePredictor();
+
+  struct Pose
+  {
+    double Timestamp;
+    double Orientation[4];
+    double Position[3];
+  };
+
+  struct PendingPrediction
+  {
+    Pose Predicted;
+    Pose Baseline;
+  };
+
+  static void MatrixToPose(vtkMatrix4x4* matrix, double timestamp, Pose& pose);
+  static void PoseToMatrix(const Pose& pose, vtkMatrix4x4* matrix);
+  static void ComputePoseError(const Pose& pose, const Pose& reference, double& translationError, double& rotationError);
+  void Extrapolate(double timestamp, Pose& pose) const;
+  void ScorePredictions(const Pose& previous, const Pose& current);
+
+protected:
+  int PredictionMode;
+  double MaximumPredictionHorizon;
+
+  double TranslationProcessNoise;
+  double TranslationMeasurementNoise;
+  double RotationProcessNoise;
+  double RotationMeasurementNoise;
+
+  int NumberOfMeasurements;
+  Pose Latest;
+  double LatestTimestamp;
+
+  // Constant velocity estimate
+  double LinearVelocity[3];
+  double AngularVelocity[3];
+
+  // Kalman state: per-axis position/velocity and their 2x2 covariance
+  double FilteredPosition[3];
+  double FilteredLinearVelocity[3];
+  double TranslationCovariance[3][4];
+  double FilteredAngularVelocity[3];
+  double AngularVelocityVariance[3];
+
+  // Predictions waiting for the measurement at their target time
+  std::deque<PendingPrediction> PendingPredictions;
+
+  double LastTranslationResidual;
+  double LastRotationResidual;
+  double SumSquaredTranslationResidual;
+  double SumSquaredRotationResidual;
+  double SumSquaredBaselineTranslationResidual;
+  double SumSquaredBaselineRotationResidual;
+  unsigned long NumberOfResiduals;
+
+private:
+  vtkTrackedScreenARPosePredictor(const vtkTrackedScreenARPosePredictor&); // Not implemented
+  void operator=(const vtkTrackedScreenARPosePredictor&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,227 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARProjection.h"
+
+// VTK includes
+#include <vtkCamera.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARProjection);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARProjection::vtkTrackedScreenARProjection()
+  : HasComputed(false)
+  , Valid(false)
+  , ViewAngle(30.0)
+  , ScalingFactor(1.0)
+  , LetterboxOffset(0)
+  , ComputeCount(0)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    this->Intrinsics[i] = 0.0;
+    this->ComputedIntrinsics[i] = 0.0;
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    this->ImageSize[i] = 0;
+    this->ViewportSize[i] = 0;
+    this->ComputedImageSize[i] = 0;
+    this->ComputedViewportSize[i] = 0;
+    this->WindowCenter[i] = 0.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARProjection::~vtkTrackedScreenARProjection()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARProjection::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Intrinsics: " << this->Intrinsics[0] << " " << this->Intrinsics[1] << " "
+     << this->Intrinsics[2] << " " << this->Intrinsics[3] << std::endl;
+  os << indent << "ImageSize: " << this->ImageSize[0] << " " << this->ImageSize[1] << std::endl;
+  os << indent << "ViewportSize: " << this->ViewportSize[0] << " " << this->ViewportSize[1] << std::endl;
+  os << indent << "Valid: " << (this->Valid ? "true" : "false") << std::endl;
+  os << indent << "ViewAngle: " << this->ViewAngle << std::endl;
+  os << indent << "WindowCenter: " << this->WindowCenter[0] << " " << this->WindowCenter[1] << std::endl;
+  os << indent << "ScalingFactor: " << this->ScalingFactor << std::endl;
+  os << indent << "LetterboxOffset: " << this->LetterboxOffset << std::endl;
+  os << indent << "ComputeCount: " << this->ComputeCount << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARProjection::SetIntrinsics(double fx, double fy, double cx, double cy)
+{
+  if (this->Intrinsics[0] == fx && this->Intrinsics[1] == fy && this->Intrinsics[2] == cx && this->Intrinsics[3] == cy)
+  {
+    return;
+  }
+  this->Intrinsics[0] = fx;
+  this->Intrinsics[1] = fy;
+  this->Intrinsics[2] = cx;
+  this->Intrinsics[3] = cy;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARProjection::SetImageSize(int width, int height)
+{
+  if (this->ImageSize[0] == width && this->ImageSize[1] == height)
+  {
+    return;
+  }
+  this->ImageSize[0] = width;
+  this->ImageSize[1] = height;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARProjection::SetViewportSize(int width, int height)
+{
+  if (this->ViewportSize[0] == width && this->ViewportSize[1] == height)
+  {
+    return;
+  }
+  this->ViewportSize[0] = width;
+  this->ViewportSize[1] = height;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARProjection::Update()
+{
+  if (this->HasComputed &&
+      this->ComputedIntrinsics[0] == this->Intrinsics[0] &&
+      this->ComputedIntrinsics[1] == this->Intrinsics[1] &&
+      this->ComputedIntrinsics[2] == this->Intrinsics[2] &&
+      this->ComputedIntrinsics[3] == this->Intrinsics[3] &&
+      this->ComputedImageSize[0] == this->ImageSize[0] &&
+      this->ComputedImageSize[1] == this->ImageSize[1] &&
+      this->ComputedViewportSize[0] == this->ViewportSize[0] &&
+      this->ComputedViewportSize[1] == this->ViewportSize[1])
+  {
+    return false;
+  }
+
+  this->Valid = vtkTrackedScreenARProjection::ComputeProjection(this->Intrinsics, this->ImageSize, this->ViewportSize,
+                this->ViewAngle, this->WindowCenter, this->ScalingFactor, this->LetterboxOffset);
+
+  for (int i = 0; i < 4; ++i)
+  {
+    this->ComputedIntrinsics[i] = this->Intrinsics[i];
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    this->ComputedImageSize[i] = this->ImageSize[i];
+    this->ComputedViewportSize[i] = this->ViewportSize[i];
+  }
+  this->HasComputed = true;
+  this->ComputeCount++;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARProjection::ApplyToCamera(vtkCamera* camera)
+{
+  if (camera == nullptr || !this->Valid)
+  {
+    return;
+  }
+
+  // vtkCamera only fires Modified if the values actually change
+  camera->SetViewAngle(this->ViewAngle);
+  camera->SetWindowCenter(this->WindowCenter[0], this->WindowCenter[1]);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARProjection::ComputeProjection(const double intrinsics[4], const int imageSize[2], const int viewportSize[2],
+    double& viewAngle, double windowCenter[2], double& scalingFactor, int& letterboxOffset)
+{
+  const double imageWidth = imageSize[0];
+  const double imageHeight = imageSize[1];
+  const double windowWidth = viewportSize[0];
+  const double windowHeight = viewportSize[1];
+
+  // Window center normalization divides by (size - 1), so anything below 2 pixels is degenerate
+  if (imageWidth < 2 || imageHeight < 2 || windowWidth < 2 || windowHeight < 2 || intrinsics[1] <= 0.0)
+  {
+    return false;
+  }
+
+  scalingFactor = 1.0;
+  letterboxOffset = 0;
+
+  double focalLengthY = intrinsics[1];
+  if (windowHeight != imageHeight)
+  {
+    scalingFactor = windowHeight / imageHeight;
+    focalLengthY = focalLengthY * scalingFactor;
+  }
+
+  viewAngle = vtkMath::DegreesFromRadians(2.0 * atan((windowHeight / 2.0) / focalLengthY));
+
+  // Calculate window center
+  double px = 0;
+  double width = 0;
+
+  double py = 0;
+  double height = 0;
+
+  if (imageWidth != windowWidth || imageHeight != windowHeight)
+  {
+    px = scalingFactor * intrinsics[2];
+    width = windowWidth;
+    int expectedWindowSize = vtkMath::Round(scalingFactor * imageWidth);
+    if (expectedWindowSize != windowWidth)
+    {
+      letterboxOffset = static_cast<int>((windowWidth - expectedWindowSize) / 2);
+      px = px + letterboxOffset;
+    }
+
+    py = scalingFactor * intrinsics[3];
+    height = windowHeight;
+  }
+  else
+  {
+    px = intrinsics[2];
+    width = imageWidth;
+
+    py = intrinsics[3];
+    height = imageHeight;
+  }
+
+  double cx = width - px;
+  double cy = py;
+
+  windowCenter[0] = cx / ((width - 1) / 2) - 1;
+  windowCenter[1] = cy / ((height - 1) / 2) - 1;
+
+  return true;
+}
@@ -0,0 +1,114 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARProjection - pinhole intrinsics to VTK camera projection
+// .SECTION Description
+// Computes the VTK camera view angle and window center that reproduce a pinhole
+// camera (fx, fy, cx, cy) for a given video image size and viewport size. The last
+// result is memoized, so calling Update() every frame only costs a key comparison
+// unless one of the inputs actually changed.
+
+#ifndef __vtkTrackedScreenARProjection_h
+#define __vtkTrackedScreenARProjection_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkCamera;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARProjection : public vtkObject
+{
+public:
+  static vtkTrackedScreenARProjection* New();
+  vtkTypeMacro(vtkTrackedScreenARProjection, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Pinhole intrinsics, in video image pixels
+  void SetIntrinsics(double fx, double fy, double cx, double cy);
+  vtkGetVector4Macro(Intrinsics, double);
+
+  /// Size of the video image the intrinsics were calibrated for
+  void SetImageSize(int width, int height);
+  vtkGetVector2Macro(ImageSize, int);
+
+  /// Size of the render window the video is displayed in
+  void SetViewportSize(int width, int height);
+  vtkGetVector2Macro(ViewportSize, int);
+
+  /// Recompute the projection if any input differs from the memoized one.
+  /// Returns true if a new projection was computed.
+  bool Update();
+
+  /// Set view angle and window center of the camera from the current projection.
+  /// Does nothing if the projection is not valid.
+  void ApplyToCamera(vtkCamera* camera);
+
+  /// True if the inputs describe a usable projection
+  vtkGetMacro(Valid, bool);
+
+  /// Vertical view angle in degrees
+  vtkGetMacro(ViewAngle, double);
+
+  /// Normalized window center, as expected by vtkCamera::SetWindowCenter
+  vtkGetVector2Macro(WindowCenter, double);
+
+  /// Ratio between viewport height and image height (1 if they match)
+  vtkGetMacro(ScalingFactor, double);
+
+  /// Horizontal offset in viewport pixels of the scaled image inside the viewport
+  vtkGetMacro(LetterboxOffset, int);
+
+  /// Number of times the projection was actually computed, for profiling the cache
+  vtkGetMacro(ComputeCount, unsigned long);
+
+  /// Compute the projection for the given inputs without touching the memoized state.
+  /// Returns false if the inputs cannot produce a projection.
+  static bool ComputeProjection(const double intrinsics[4], const int imageSize[2], const int viewportSize[2],
+                                double& viewAngle, double windowCenter[2], double& scalingFactor, int& letterboxOffset);
+
+protected:
+  vtkTrackedScreenARProjection();
+  virtual ~vtkTrackedScreenARProjection();
+
+protected:
+  double Intrinsics[4];
+  int ImageSize[2];
+  int ViewportSize[2];
+
+  // Inputs that produced the memoized result
+  double ComputedIntrinsics[4];
+  int ComputedImageSize[2];
+  int ComputedViewportSize[2];
+  bool HasComputed;
+
+  bool Valid;
+  double ViewAngle;
+  double WindowCenter[2];
+  double ScalingFactor;
+  int LetterboxOffset;
+
+  unsigned long ComputeCount;
+
+private:
+  vtkTrackedScreenARProjection(const vtkTrackedScreenARProjection&); // Not implemented
+  void operator=(const vtkTrackedScreenARProjection&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARQualityGovernor.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+namespace
+{
+// Upper bound of the recovery backoff, in multiples of RecoverFrameCount
+const int MaximumRecoverBackoff = 16;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARQualityGovernor);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARQualityGovernor::vtkTrackedScreenARQualityGovernor()
+  : Enabled(false)
+  , TargetFrameTime(1.0 / 30.0)
+  , DegradeThreshold(1.0)
+  , RecoverThreshold(0.6)
+  , DegradeFrameCount(15)
+  , RecoverFrameCount(90)
+  , MaximumLevel(QualityLevel_Last - 1)
+  , Level(FullQuality)
+  , SmoothedFrameTime(0.0)
+  , FramesAtLevel(0)
+  , OverBudgetFrames(0)
+  , UnderBudgetFrames(0)
+  , RecoverBackoff(1)
+  , LastChangeWasRecovery(false)
+  , LevelChangeCount(0)
+{
+  std::fill(this->SkippedLevels, this->SkippedLevels + QualityLevel_Last, false);
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARQualityGovernor::~vtkTrackedScreenARQualityGovernor()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARQualityGovernor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Enabled: " << (this->Enabled ? "true" : "false") << std::endl;
+  os << indent << "TargetFrameTime: " << this->TargetFrameTime << std::endl;
+  os << indent << "DegradeThreshold: " << this->DegradeThreshold << std::endl;
+  os << indent << "RecoverThreshold: " << this->RecoverThreshold << std::endl;
+  os << indent << "DegradeFrameCount: " << this->DegradeFrameCount << std::endl;
+  os << indent << "RecoverFrameCount: " << this->RecoverFrameCount << std::endl;
+  os << indent << "MaximumLevel: " << GetQualityLevelAsString(this->MaximumLevel) << std::endl;
+  os << indent << "SkippedLevels:";
+  for (int level = FullQuality; level < QualityLevel_Last; ++level)
+  {
+    if (this->SkippedLevels[level])
+    {
+      os << " " << GetQualityLevelAsString(level);
+    }
+  }
+  os << std::endl;
+  os << indent << "Level: " << GetQualityLevelAsString(this->Level) << std::endl;
+  os << indent << "SmoothedFrameTime: " << this->SmoothedFrameTime << std::endl;
+  os << indent << "RecoverBackoff: " << this->RecoverBackoff << std::endl;
+  os << indent << "LevelChangeCount: " << this->LevelChangeCount << std::endl;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTrackedScreenARQualityGovernor::GetQualityLevelAsString(int level)
+{
+  switch (level)
+  {
+    case FullQuality:
+      return "FullQuality";
+    case DownscaledVideo:
+      return "DownscaledVideo";
+    case HalfResolutionVideo:
+      return "HalfResolutionVideo";
+    case ReducedDetail:
+      return "ReducedDetail";
+    case NoExpensivePasses:
+      return "NoExpensivePasses";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARQualityGovernor::SetLevelSkipped(int level, bool skipped)
+{
+  if (level <= FullQuality || level >= QualityLevel_Last || this->SkippedLevels[level] == skipped)
+  {
+    return;
+  }
+  this->SkippedLevels[level] = skipped;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARQualityGovernor::GetLevelSkipped(int level)
+{
+  return (level > FullQuality && level < QualityLevel_Last && this->SkippedLevels[level]);
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARQualityGovernor::GetNextLevel(int direction)
+{
+  for (int level = this->Level + direction; level >= FullQuality && level <= this->MaximumLevel; level += direction)
+  {
+    if (!this->SkippedLevels[level])
+    {
+      return level;
+    }
+  }
+  return this->Level;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARQualityGovernor::AddFrameTime(double frameTime)
+{
+  if (!this->Enabled || frameTime < 0.0)
+  {
+    return false;
+  }
+  if (this->Level > this->MaximumLevel)
+  {
+    this->ChangeLevel(this->MaximumLevel, true);
+    return true;
+  }
+
+  // Exponential average over about DegradeFrameCount frames, restarted at each level as the cost changed
+  if (this->FramesAtLevel == 0)
+  {
+    this->SmoothedFrameTime = frameTime;
+  }
+  else
+  {
+    double alpha = 2.0 / (this->DegradeFrameCount + 1);
+    this->SmoothedFrameTime += alpha * (frameTime - this->SmoothedFrameTime);
+  }
+  this->FramesAtLevel++;
+
+  if (this->SmoothedFrameTime > this->TargetFrameTime * this->DegradeThreshold)
+  {
+    this->OverBudgetFrames++;
+    this->UnderBudgetFrames = 0;
+  }
+  else if (this->SmoothedFrameTime < this->TargetFrameTime * this->RecoverThreshold)
+  {
+    this->UnderBudgetFrames++;
+    this->OverBudgetFrames = 0;
+  }
+  else
+  {
+    this->OverBudgetFrames = 0;
+    this->UnderBudgetFrames = 0;
+  }
+
+  if (this->LastChangeWasRecovery && this->FramesAtLevel >= this->RecoverFrameCount)
+  {
+    // The recovered level held, recover at the normal pace again
+    this->RecoverBackoff = 1;
+  }
+
+  int lowerLevel = this->GetNextLevel(1);
+  if (this->OverBudgetFrames >= this->DegradeFrameCount && lowerLevel != this->Level)
+  {
+    if (this->LastChangeWasRecovery && this->FramesAtLevel < this->RecoverFrameCount)
+    {
+      this->RecoverBackoff = std::min(2 * this->RecoverBackoff, MaximumRecoverBackoff);
+    }
+    this->ChangeLevel(lowerLevel, false);
+    return true;
+  }
+  int higherLevel = this->GetNextLevel(-1);
+  if (this->UnderBudgetFrames >= this->RecoverFrameCount * this->RecoverBackoff && higherLevel != this->Level)
+  {
+    this->ChangeLevel(higherLevel, true);
+    return true;
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARQualityGovernor::ChangeLevel(int level, bool recovery)
+{
+  this->Level = level;
+  this->FramesAtLevel = 0;
+  this->OverBudgetFrames = 0;
+  this->UnderBudgetFrames = 0;
+  this->LastChangeWasRecovery = recovery;
+  this->LevelChangeCount++;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARQualityGovernor::Reset()
+{
+  this->Level = FullQuality;
+  this->SmoothedFrameTime = 0.0;
+  this->FramesAtLevel = 0;
+  this->OverBudgetFrames = 0;
+  this->UnderBudgetFrames = 0;
+  this->RecoverBackoff = 1;
+  this->LastChangeWasRecovery = false;
+  this->LevelChangeCount = 0;
+  this->Modified();
+}
@@ -0,0 +1,155 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// .NAME vtkTrackedScreenARQualityGovernor - adapts the rendering quality of a view to a frame budget
+// .SECTION Description
+// The measured cost of each frame of a view (video conversion, texture upload and render)
+// is smoothed and compared to a target frame time. While the smoothed cost stays above the
+// target, the governor steps down one quality level at a time, cheapest loss of quality
+// first. Once the cost stays well below the target for a longer time, it steps back up.
+// The gap between both thresholds and the longer recovery period keep it from oscillating,
+// and a recovery that has to be undone right away makes the next one wait longer.
+// Levels that would change nothing for the view, e.g. a video already downscaled, are skipped.
+//
+// The governor only decides on the level, vtkSlicerTrackedScreenARLogic applies it to the view.
+
+#ifndef __vtkTrackedScreenARQualityGovernor_h
+#define __vtkTrackedScreenARQualityGovernor_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARQualityGovernor : public vtkObject
+{
+public:
+  /// Quality levels, each one keeps the degradations of the previous ones
+  enum QualityLevel
+  {
+    FullQuality = 0,
+    /// Video shrunk to the size of the view
+    DownscaledVideo,
+    /// Video shrunk to half the size of the view
+    HalfResolutionVideo,
+    /// Models and volumes rendered at their interactive level of detail
+    ReducedDetail,
+    /// Depth peeling and ambient shadows turned off
+    NoExpensivePasses,
+    QualityLevel_Last
+  };
+
+  static vtkTrackedScreenARQualityGovernor* New();
+  vtkTypeMacro(vtkTrackedScreenARQualityGovernor, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  static const char* GetQualityLevelAsString(int level);
+
+  /// Adapt the quality level to the frame times. Off by default.
+  vtkSetMacro(Enabled, bool);
+  vtkGetMacro(Enabled, bool);
+  vtkBooleanMacro(Enabled, bool);
+
+  /// Frame budget, in seconds. 1/30 s by default.
+  vtkSetClampMacro(TargetFrameTime, double, 0.001, 1.0);
+  vtkGetMacro(TargetFrameTime, double);
+
+  /// Fraction of the target above which a frame is over budget. 1 by default.
+  vtkSetClampMacro(DegradeThreshold, double, 0.5, 2.0);
+  vtkGetMacro(DegradeThreshold, double);
+
+  /// Fraction of the target below which there is headroom to recover a level. 0.6 by default.
+  vtkSetClampMacro(RecoverThreshold, double, 0.1, 1.0);
+  vtkGetMacro(RecoverThreshold, double);
+
+  /// Consecutive over budget frames before stepping down a level, also the smoothing length. 15 by default.
+  vtkSetClampMacro(DegradeFrameCount, int, 1, 1000);
+  vtkGetMacro(DegradeFrameCount, int);
+
+  /// Consecutive frames with headroom before stepping up a level. 90 by default.
+  vtkSetClampMacro(RecoverFrameCount, int, 1, 10000);
+  vtkGetMacro(RecoverFrameCount, int);
+
+  /// Lowest quality level the governor may step down to
+  vtkSetClampMacro(MaximumLevel, int, FullQuality, QualityLevel_Last - 1);
+  vtkGetMacro(MaximumLevel, int);
+
+  /// Skip a level when stepping down or up, for levels that would not change the cost of the view.
+  /// Full quality cannot be skipped. No level is skipped by default.
+  void SetLevelSkipped(int level, bool skipped);
+  bool GetLevelSkipped(int level);
+
+  /// Account for the cost of a frame, in seconds.
+  /// Returns true if the quality level changed. Does nothing if not enabled.
+  bool AddFrameTime(double frameTime);
+
+  /// Current quality level, a QualityLevel value
+  vtkGetMacro(Level, int);
+
+  /// Smoothed frame time at the current level, in seconds
+  vtkGetMacro(SmoothedFrameTime, double);
+
+  /// Number of level changes since the last reset
+  vtkGetMacro(LevelChangeCount, unsigned long);
+
+  /// Multiple of RecoverFrameCount the next recovery waits for, doubled up to 16 each time a
+  /// recovery is undone before RecoverFrameCount frames
+  vtkGetMacro(RecoverBackoff, int);
+
+  /// Back to full quality, forgetting the frame history
+  void Reset();
+
+protected:
+  vtkTrackedScreenARQualityGovernor();
+  virtual ~vtkTrackedScreenARQualityGovernor();
+
+  void ChangeLevel(int level, bool recovery);
+
+  /// Nearest level in the given direction (+1 or -1) that is not skipped, or the current
+  /// level if there is none between FullQuality and MaximumLevel
+  int GetNextLevel(int direction);
+
+protected:
+  bool Enabled;
+  double TargetFrameTime;
+  double DegradeThreshold;
+  double RecoverThreshold;
+  int DegradeFrameCount;
+  int RecoverFrameCount;
+  int MaximumLevel;
+  bool SkippedLevels[QualityLevel_Last];
+
+  int Level;
+  double SmoothedFrameTime;
+  int FramesAtLevel;
+  int OverBudgetFrames;
+  int UnderBudgetFrames;
+
+  // Multiplies RecoverFrameCount, doubled each time a recovery is undone before it held
+  int RecoverBackoff;
+  bool LastChangeWasRecovery;
+
+  unsigned long LevelChangeCount;
+
+private:
+  vtkTrackedScreenARQualityGovernor(const vtkTrackedScreenARQualityGovernor&); // Not implemented
+  void operator=(const vtkTrackedScreenARQualityGovernor&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,310 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARRigidTransform - fixed-size 4x4 and quaternion math of the per-frame pose path
+// .SECTION Description
+// Header-only value type holding a 4x4 homogeneous matrix in the row-major layout of
+// vtkMatrix4x4::Element, aligned so that half rows load as SSE2 registers. Conversions
+// from and to vtkMatrix4x4 are a single block copy instead of one virtual GetElement/SetElement
+// (and one Modified()) per element. Composition is a general 4x4 product, vectorized with SSE2
+// where available. Inverse() and GetQuaternion() assume the upper 3x3 is a rotation: the
+// inverse is the closed form (R^T, -R^T p), no general matrix inversion is involved.
+//
+// Quaternions are double[4] stored as (w, x, y, z), like vtkMath.
+
+#ifndef __vtkTrackedScreenARRigidTransform_h
+#define __vtkTrackedScreenARRigidTransform_h
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+
+// STD includes
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define TRACKEDSCREENAR_RIGID_TRANSFORM_SSE2
+#endif
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class vtkTrackedScreenARRigidTransform
+{
+public:
+  /// Row-major elements, Element[4 * row + column]
+  alignas(16) double Element[16];
+
+  /// Identity
+  constexpr vtkTrackedScreenARRigidTransform()
+    : Element{1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0}
+  {
+  }
+
+  /// Copy of a VTK matrix
+  static vtkTrackedScreenARRigidTransform FromMatrix(const vtkMatrix4x4* matrix)
+  {
+    vtkTrackedScreenARRigidTransform transform;
+    memcpy(transform.Element, &matrix->Element[0][0], sizeof(transform.Element));
+    return transform;
+  }
+
+  /// Copy into a VTK matrix, which is marked modified once
+  void ToMatrix(vtkMatrix4x4* matrix) const
+  {
+    memcpy(&matrix->Element[0][0], this->Element, sizeof(this->Element));
+    matrix->Modified();
+  }
+
+  /// Pose of a unit quaternion rotation followed by a translation
+  static vtkTrackedScreenARRigidTransform FromQuaternion(const double q[4], const double translation[3])
+  {
+    vtkTrackedScreenARRigidTransform transform;
+    double* e = transform.Element;
+    const double ww = q[0] * q[0], xx = q[1] * q[1], yy = q[2] * q[2], zz = q[3] * q[3];
+    const double wx = q[0] * q[1], wy = q[0] * q[2], wz = q[0] * q[3];
+    const double xy = q[1] * q[2], xz = q[1] * q[3], yz = q[2] * q[3];
+    e[0] = ww + xx - yy - zz;  e[1] = 2.0 * (xy - wz);     e[2] = 2.0 * (xz + wy);     e[3] = translation[0];
+    e[4] = 2.0 * (xy + wz);    e[5] = ww - xx + yy - zz;  e[6] = 2.0 * (yz - wx);     e[7] = translation[1];
+    e[8] = 2.0 * (xz - wy);    e[9] = 2.0 * (yz + wx);    e[10] = ww - xx - yy + zz; e[11] = translation[2];
+    return transform;
+  }
+
+  /// Unit quaternion of the rotation part (Shepperd's method, branching on the largest diagonal term)
+  void GetQuaternion(double q[4]) const
+  {
+    const double* e = this->Element;
+    const double trace = e[0] + e[5] + e[10];
+    if (trace >= e[0] && trace >= e[5] && trace >= e[10])
+    {
+      const double s = 2.0 * sqrt(1.0 + trace);
+      q[0] = 0.25 * s;
+      q[1] = (e[9] - e[6]) / s;
+      q[2] = (e[2] - e[8]) / s;
+      q[3] = (e[4] - e[1]) / s;
+    }
+    else if (e[0] >= e[5] && e[0] >= e[10])
+    {
+      const double s = 2.0 * sqrt(1.0 + e[0] - e[5] - e[10]);
+      q[0] = (e[9] - e[6]) / s;
+      q[1] = 0.25 * s;
+      q[2] = (e[1] + e[4]) / s;
+      q[3] = (e[2] + e[8]) / s;
+    }
+    else if (e[5] >= e[10])
+    {
+      const double s = 2.0 * sqrt(1.0 + e[5] - e[0] - e[10]);
+      q[0] = (e[2] - e[8]) / s;
+      q[1] = (e[1] + e[4]) / s;
+      q[2] = 0.25 * s;
+      q[3] = (e[6] + e[9]) / s;
+    }
+    else
+    {
+      const double s = 2.0 * sqrt(1.0 + e[10] - e[0] - e[5]);
+      q[0] = (e[4] - e[1]) / s;
+      q[1] = (e[2] + e[8]) / s;
+      q[2] = (e[6] + e[9]) / s;
+      q[3] = 0.25 * s;
+    }
+    QuaternionNormalize(q);
+  }
+
+  void GetTranslation(double translation[3]) const
+  {
+    translation[0] = this->Element[3];
+    translation[1] = this->Element[7];
+    translation[2] = this->Element[11];
+  }
+
+  /// a * b: applies b first, then a
+  static vtkTrackedScreenARRigidTransform Compose(const vtkTrackedScreenARRigidTransform& a, const vtkTrackedScreenARRigidTransform& b)
+  {
+    vtkTrackedScreenARRigidTransform result;
+#ifdef TRACKEDSCREENAR_RIGID_TRANSFORM_SSE2
+    // Each result row is a linear combination of the rows of b, two doubles per register
+    for (int row = 0; row < 4; ++row)
+    {
+      __m128d low = _mm_setzero_pd();
+      __m128d high = _mm_setzero_pd();
+      for (int k = 0; k < 4; ++k)
+      {
+        const __m128d factor = _mm_set1_pd(a.Element[4 * row + k]);
+        low = _mm_add_pd(low, _mm_mul_pd(factor, _mm_load_pd(b.Element + 4 * k)));
+        high = _mm_add_pd(high, _mm_mul_pd(factor, _mm_load_pd(b.Element + 4 * k + 2)));
+      }
+      _mm_store_pd(result.Element + 4 * row, low);
+      _mm_store_pd(result.Element + 4 * row + 2, high);
+    }
+#else
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        result.Element[4 * row + column] = a.Element[4 * row] * b.Element[column]
+          + a.Element[4 * row + 1] * b.Element[4 + column]
+          + a.Element[4 * row + 2] * b.Element[8 + column]
+          + a.Element[4 * row + 3] * b.Element[12 + column];
+      }
+    }
+#endif
+    return result;
+  }
+
+  /// Closed-form inverse of a rigid transform: (R^T, -R^T p)
+  vtkTrackedScreenARRigidTransform Inverse() const
+  {
+    vtkTrackedScreenARRigidTransform inverse;
+    const double* e = this->Element;
+    double* r = inverse.Element;
+    r[0] = e[0]; r[1] = e[4]; r[2] = e[8];
+    r[4] = e[1]; r[5] = e[5]; r[6] = e[9];
+    r[8] = e[2]; r[9] = e[6]; r[10] = e[10];
+    r[3] = -(r[0] * e[3] + r[1] * e[7] + r[2] * e[11]);
+    r[7] = -(r[4] * e[3] + r[5] * e[7] + r[6] * e[11]);
+    r[11] = -(r[8] * e[3] + r[9] * e[7] + r[10] * e[11]);
+    return inverse;
+  }
+
+  void TransformPoint(const double in[3], double out[3]) const
+  {
+    const double* e = this->Element;
+    const double x = in[0], y = in[1], z = in[2];
+    out[0] = e[0] * x + e[1] * y + e[2] * z + e[3];
+    out[1] = e[4] * x + e[5] * y + e[6] * z + e[7];
+    out[2] = e[8] * x + e[9] * y + e[10] * z + e[11];
+  }
+
+  /// Rigid interpolation between two poses, t in [0, 1]: SLERP of the rotations,
+  /// linear interpolation of the translations
+  static vtkTrackedScreenARRigidTransform Interpolate(const vtkTrackedScreenARRigidTransform& a, const vtkTrackedScreenARRigidTransform& b, double t)
+  {
+    double q0[4], q1[4], q[4];
+    a.GetQuaternion(q0);
+    b.GetQuaternion(q1);
+    QuaternionSlerp(q0, q1, t, q);
+    double translation[3];
+    for (int i = 0; i < 3; ++i)
+    {
+      translation[i] = (1.0 - t) * a.Element[4 * i + 3] + t * b.Element[4 * i + 3];
+    }
+    return FromQuaternion(q, translation);
+  }
+
+  //----------------------------------------------------------------------------
+  // Quaternions
+
+  static constexpr double QuaternionDot(const double a[4], const double b[4])
+  {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+  }
+
+  static void QuaternionNormalize(double q[4])
+  {
+    const double norm = sqrt(QuaternionDot(q, q));
+    for (int i = 0; i < 4; ++i)
+    {
+      q[i] /= norm;
+    }
+  }
+
+  static void QuaternionConjugate(const double q[4], double conjugate[4])
+  {
+    conjugate[0] = q[0];
+    conjugate[1] = -q[1];
+    conjugate[2] = -q[2];
+    conjugate[3] = -q[3];
+  }
+
+  /// a * b, q may be one of the inputs
+  static void QuaternionMultiply(const double a[4], const double b[4], double q[4])
+  {
+    const double result[4] =
+    {
+      a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+      a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+      a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+      a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0]
+    };
+    memcpy(q, result, sizeof(result));
+  }
+
+  /// Spherical linear interpolation along the shortest arc, t is clamped to [0, 1]
+  static void QuaternionSlerp(const double q0[4], const double q1[4], double t, double q[4])
+  {
+    t = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+
+    double cosTheta = QuaternionDot(q0, q1);
+    double sign = 1.0;
+    if (cosTheta < 0.0)
+    {
+      cosTheta = -cosTheta;
+      sign = -1.0;
+    }
+
+    double w0 = 1.0 - t;
+    double w1 = t;
+    if (cosTheta < 0.9995)
+    {
+      const double theta = acos(cosTheta);
+      const double sinTheta = sin(theta);
+      w0 = sin((1.0 - t) * theta) / sinTheta;
+      w1 = sin(t * theta) / sinTheta;
+    }
+    // else nearly parallel: normalized linear interpolation is accurate and avoids dividing by ~0
+
+    for (int i = 0; i < 4; ++i)
+    {
+      q[i] = w0 * q0[i] + sign * w1 * q1[i];
+    }
+    QuaternionNormalize(q);
+  }
+
+  /// Rotation vector (axis * angle) of a unit quaternion, taking the shortest arc
+  static void QuaternionToRotationVector(const double q[4], double v[3])
+  {
+    const double sign = (q[0] < 0.0) ? -1.0 : 1.0;
+    const double sinHalfAngle = sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (sinHalfAngle < 1e-12)
+    {
+      v[0] = v[1] = v[2] = 0.0;
+      return;
+    }
+    const double angle = 2.0 * atan2(sinHalfAngle, sign * q[0]);
+    for (int i = 0; i < 3; ++i)
+    {
+      v[i] = sign * q[i + 1] / sinHalfAngle * angle;
+    }
+  }
+
+  static void RotationVectorToQuaternion(const double v[3], double q[4])
+  {
+    const double angle = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (angle < 1e-12)
+    {
+      q[0] = 1.0;
+      q[1] = q[2] = q[3] = 0.0;
+      return;
+    }
+    const double s = sin(angle / 2.0) / angle;
+    q[0] = cos(angle / 2.0);
+    q[1] = v[0] * s;
+    q[2] = v[1] * s;
+    q[3] = v[2] * s;
+  }
+};
+
+#endif
@@ -0,0 +1,390 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARSceneLayerPass.h"
+
+// VTK includes
+#include <vtkCamera.h>
+#include <vtkDualDepthPeelingPass.h>
+#include <vtkLight.h>
+#include <vtkLightCollection.h>
+#include <vtkObjectFactory.h>
+#include <vtkOpenGLFramebufferObject.h>
+#include <vtkOpenGLQuadHelper.h>
+#include <vtkOpenGLRenderUtilities.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtkOpenGLShaderCache.h>
+#include <vtkOpenGLState.h>
+#include <vtkProp.h>
+#include <vtkRenderState.h>
+#include <vtkRenderStepsPass.h>
+#include <vtkRenderer.h>
+#include <vtkShaderProgram.h>
+#include <vtkTextureObject.h>
+#include <vtk_glew.h>
+
+// STD includes
+#include <algorithm>
+#include <string>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARSceneLayerPass);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSceneLayerPass::vtkTrackedScreenARSceneLayerPass()
+  : DelegatePass(nullptr)
+  , DefaultDelegatePass(vtkRenderStepsPass::New())
+  , DepthPeelingDelegatePass(vtkRenderStepsPass::New())
+  , DepthPeelingPass(vtkDualDepthPeelingPass::New())
+  , VolumetricPass(nullptr)
+  , FrameBufferObject(nullptr)
+  , ColorTexture(nullptr)
+  , DepthTexture(nullptr)
+  , QuadHelper(nullptr)
+  , LayerValid(false)
+  , LayerSceneMTime(0)
+  , LayerPropCount(0)
+  , LayerDepthPeeling(false)
+  , LayerRenderedProps(0)
+  , NumberOfLayerRenders(0)
+  , NumberOfCompositedFrames(0)
+{
+  this->LayerSize[0] = 0;
+  this->LayerSize[1] = 0;
+
+  // Same steps, the translucent ones peeled: how a renderer without pass renders with depth peeling
+  this->VolumetricPass = this->DepthPeelingDelegatePass->GetVolumetricPass();
+  this->VolumetricPass->Register(this);
+  this->DepthPeelingPass->SetTranslucentPass(this->DepthPeelingDelegatePass->GetTranslucentPass());
+  this->DepthPeelingDelegatePass->SetTranslucentPass(this->DepthPeelingPass);
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSceneLayerPass::~vtkTrackedScreenARSceneLayerPass()
+{
+  this->SetDelegatePass(nullptr);
+  this->DefaultDelegatePass->Delete();
+  this->DefaultDelegatePass = nullptr;
+  this->DepthPeelingDelegatePass->Delete();
+  this->DepthPeelingDelegatePass = nullptr;
+  this->DepthPeelingPass->Delete();
+  this->DepthPeelingPass = nullptr;
+  this->VolumetricPass->UnRegister(this);
+  this->VolumetricPass = nullptr;
+
+  if (this->FrameBufferObject != nullptr || this->QuadHelper != nullptr)
+  {
+    vtkErrorMacro("FrameBufferObject should have been deleted in ReleaseGraphicsResources().");
+  }
+  if (this->ColorTexture != nullptr)
+  {
+    this->ColorTexture->Delete();
+    this->ColorTexture = nullptr;
+  }
+  if (this->DepthTexture != nullptr)
+  {
+    this->DepthTexture->Delete();
+    this->DepthTexture = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "DelegatePass: " << (this->DelegatePass != nullptr ? this->DelegatePass->GetClassName() : "(default)") << std::endl;
+  os << indent << "LayerValid: " << (this->LayerValid ? "true" : "false") << std::endl;
+  os << indent << "LayerSize: " << this->LayerSize[0] << " " << this->LayerSize[1] << std::endl;
+  os << indent << "LayerDepthPeeling: " << (this->LayerDepthPeeling ? "true" : "false") << std::endl;
+  os << indent << "NumberOfLayerRenders: " << this->NumberOfLayerRenders << std::endl;
+  os << indent << "NumberOfCompositedFrames: " << this->NumberOfCompositedFrames << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::SetDelegatePass(vtkRenderPass* delegatePass)
+{
+  if (delegatePass == this->DelegatePass || delegatePass == this)
+  {
+    return;
+  }
+  if (this->DelegatePass != nullptr)
+  {
+    this->DelegatePass->UnRegister(this);
+  }
+  this->DelegatePass = delegatePass;
+  if (this->DelegatePass != nullptr)
+  {
+    this->DelegatePass->Register(this);
+  }
+  this->LayerValid = false;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::Invalidate()
+{
+  this->LayerValid = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::ResetFrameCounts()
+{
+  this->NumberOfLayerRenders = 0;
+  this->NumberOfCompositedFrames = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkMTimeType vtkTrackedScreenARSceneLayerPass::ComputeSceneMTime(const vtkRenderState* s)
+{
+  vtkRenderer* renderer = s->GetRenderer();
+  vtkMTimeType sceneMTime = renderer->GetActiveCamera()->GetMTime();
+
+  vtkCollectionSimpleIterator lightIterator;
+  vtkLightCollection* lights = renderer->GetLights();
+  lights->InitTraversal(lightIterator);
+  while (vtkLight* light = lights->GetNextLight(lightIterator))
+  {
+    sceneMTime = std::max(sceneMTime, light->GetMTime());
+  }
+
+  // The redraw time of a prop includes its mapper and the data it renders
+  for (int i = 0; i < s->GetPropArrayCount(); ++i)
+  {
+    sceneMTime = std::max(sceneMTime, s->GetPropArray()[i]->GetRedrawMTime());
+  }
+  return sceneMTime;
+}
+
+//----------------------------------------------------------------------------
+vtkRenderPass* vtkTrackedScreenARSceneLayerPass::GetLayerDelegatePass(vtkRenderer* renderer)
+{
+  if (this->DelegatePass != nullptr)
+  {
+    return this->DelegatePass;
+  }
+  if (!renderer->GetUseDepthPeeling())
+  {
+    return this->DefaultDelegatePass;
+  }
+
+  // Volumes are peeled with the translucent geometry only if the renderer asks for it
+  bool peelVolumes = (renderer->GetUseDepthPeelingForVolumes() != 0);
+  this->DepthPeelingPass->SetVolumetricPass(peelVolumes ? this->VolumetricPass : nullptr);
+  this->DepthPeelingDelegatePass->SetVolumetricPass(peelVolumes ? nullptr : this->VolumetricPass);
+  this->DepthPeelingPass->SetMaximumNumberOfPeels(renderer->GetMaximumNumberOfPeels());
+  this->DepthPeelingPass->SetOcclusionRatio(renderer->GetOcclusionRatio());
+  return this->DepthPeelingDelegatePass;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::Render(const vtkRenderState* s)
+{
+  vtkRenderer* renderer = s->GetRenderer();
+  vtkRenderPass* delegatePass = this->GetLayerDelegatePass(renderer);
+  vtkOpenGLRenderWindow* renderWindow = vtkOpenGLRenderWindow::SafeDownCast(renderer->GetRenderWindow());
+  if (renderer->GetSelector() != nullptr || s->GetFrameBuffer() != nullptr || renderWindow == nullptr)
+  {
+    // Picking, or rendered into another pass' framebuffer: not what the view shows
+    delegatePass->Render(s);
+    this->NumberOfRenderedProps = delegatePass->GetNumberOfRenderedProps();
+    return;
+  }
+
+  int width = 0;
+  int height = 0;
+  int originX = 0;
+  int originY = 0;
+  renderer->GetTiledSizeAndOrigin(&width, &height, &originX, &originY);
+  if (width <= 0 || height <= 0)
+  {
+    this->NumberOfRenderedProps = 0;
+    return;
+  }
+
+  vtkMTimeType sceneMTime = this->ComputeSceneMTime(s);
+  bool depthPeeling = (renderer->GetUseDepthPeeling() != 0);
+  if (!this->LayerValid || sceneMTime != this->LayerSceneMTime || s->GetPropArrayCount() != this->LayerPropCount
+      || width != this->LayerSize[0] || height != this->LayerSize[1] || depthPeeling != this->LayerDepthPeeling)
+  {
+    this->RenderLayer(s, delegatePass, width, height);
+    this->LayerValid = true;
+    // Rendering may have updated pipelines, take the time after it
+    this->LayerSceneMTime = this->ComputeSceneMTime(s);
+    this->LayerPropCount = s->GetPropArrayCount();
+    this->LayerSize[0] = width;
+    this->LayerSize[1] = height;
+    this->LayerDepthPeeling = depthPeeling;
+    ++this->NumberOfLayerRenders;
+  }
+  else
+  {
+    ++this->NumberOfCompositedFrames;
+  }
+
+  this->CompositeLayer(s, width, height, originX, originY);
+  this->NumberOfRenderedProps = this->LayerRenderedProps;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::RenderLayer(const vtkRenderState* s, vtkRenderPass* delegatePass, int width, int height)
+{
+  vtkRenderer* renderer = s->GetRenderer();
+  vtkOpenGLRenderWindow* renderWindow = vtkOpenGLRenderWindow::SafeDownCast(renderer->GetRenderWindow());
+  vtkOpenGLState* state = renderWindow->GetState();
+
+  if (this->ColorTexture == nullptr)
+  {
+    this->ColorTexture = vtkTextureObject::New();
+    this->ColorTexture->SetContext(renderWindow);
+    this->ColorTexture->SetMinificationFilter(vtkTextureObject::Nearest);
+    this->ColorTexture->SetMagnificationFilter(vtkTextureObject::Nearest);
+    this->ColorTexture->SetWrapS(vtkTextureObject::ClampToEdge);
+    this->ColorTexture->SetWrapT(vtkTextureObject::ClampToEdge);
+    this->ColorTexture->Allocate2D(width, height, 4, VTK_UNSIGNED_CHAR);
+  }
+  else
+  {
+    this->ColorTexture->Resize(width, height);
+  }
+  if (this->DepthTexture == nullptr)
+  {
+    this->DepthTexture = vtkTextureObject::New();
+    this->DepthTexture->SetContext(renderWindow);
+    this->DepthTexture->AllocateDepth(width, height, vtkTextureObject::Float32);
+  }
+  else
+  {
+    this->DepthTexture->Resize(width, height);
+  }
+  if (this->FrameBufferObject == nullptr)
+  {
+    this->FrameBufferObject = vtkOpenGLFramebufferObject::New();
+    this->FrameBufferObject->SetContext(renderWindow);
+  }
+
+  state->PushFramebufferBindings();
+  this->FrameBufferObject->Bind();
+  this->FrameBufferObject->AddColorAttachment(0, this->ColorTexture);
+  this->FrameBufferObject->ActivateDrawBuffers(1);
+  this->FrameBufferObject->AddDepthAttachment(this->DepthTexture);
+  this->FrameBufferObject->StartNonOrtho(width, height);
+
+  // Transparent black, so the layer holds premultiplied colors and the video shows through
+  state->vtkglViewport(0, 0, width, height);
+  state->vtkglScissor(0, 0, width, height);
+  state->vtkglClearColor(0.0, 0.0, 0.0, 0.0);
+  state->vtkglClearDepth(1.0);
+  state->vtkglDepthMask(GL_TRUE);
+  state->vtkglColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  state->vtkglClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  // The renderer would clear to its background, video included
+  vtkRenderState layerState(renderer);
+  layerState.SetPropArrayAndCount(s->GetPropArray(), s->GetPropArrayCount());
+  layerState.SetFrameBuffer(this->FrameBufferObject);
+  int erase = renderer->GetErase();
+  renderer->SetErase(0);
+  delegatePass->Render(&layerState);
+  renderer->SetErase(erase);
+  this->LayerRenderedProps = delegatePass->GetNumberOfRenderedProps();
+
+  state->PopFramebufferBindings();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::CompositeLayer(const vtkRenderState* s, int width, int height, int originX, int originY)
+{
+  vtkRenderer* renderer = s->GetRenderer();
+  vtkOpenGLRenderWindow* renderWindow = vtkOpenGLRenderWindow::SafeDownCast(renderer->GetRenderWindow());
+  vtkOpenGLState* state = renderWindow->GetState();
+
+  state->vtkglViewport(originX, originY, width, height);
+  state->vtkglScissor(originX, originY, width, height);
+  vtkOpenGLState::ScopedglEnableDisable scissorSaver(state, GL_SCISSOR_TEST);
+  state->vtkglEnable(GL_SCISSOR_TEST);
+  if (renderWindow->GetErase() && renderer->GetErase())
+  {
+    // Background, the video frame when the view shows one
+    renderer->Clear();
+  }
+
+  if (this->QuadHelper == nullptr)
+  {
+    std::string fragmentShader = vtkOpenGLRenderUtilities::GetFullScreenQuadFragmentShaderTemplate();
+    vtkShaderProgram::Substitute(fragmentShader, "//VTK::FSQ::Decl", "uniform sampler2D layerTexture;");
+    vtkShaderProgram::Substitute(fragmentShader, "//VTK::FSQ::Impl", "gl_FragData[0] = texture2D(layerTexture, texCoord);");
+    this->QuadHelper = new vtkOpenGLQuadHelper(renderWindow, vtkOpenGLRenderUtilities::GetFullScreenQuadVertexShader().c_str(),
+                                               fragmentShader.c_str(), "");
+  }
+  else
+  {
+    renderWindow->GetShaderCache()->ReadyShaderProgram(this->QuadHelper->Program);
+  }
+  if (this->QuadHelper->Program == nullptr || !this->QuadHelper->Program->GetCompiled())
+  {
+    vtkErrorMacro("CompositeLayer: could not compile the composite shader");
+    return;
+  }
+
+  vtkOpenGLState::ScopedglEnableDisable depthTestSaver(state, GL_DEPTH_TEST);
+  vtkOpenGLState::ScopedglEnableDisable blendSaver(state, GL_BLEND);
+  vtkOpenGLState::ScopedglBlendFuncSeparate blendFuncSaver(state);
+  state->vtkglDisable(GL_DEPTH_TEST);
+  state->vtkglEnable(GL_BLEND);
+  state->vtkglBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  this->ColorTexture->Activate();
+  this->QuadHelper->Program->SetUniformi("layerTexture", this->ColorTexture->GetTextureUnit());
+  this->QuadHelper->Render();
+  this->ColorTexture->Deactivate();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSceneLayerPass::ReleaseGraphicsResources(vtkWindow* w)
+{
+  this->DefaultDelegatePass->ReleaseGraphicsResources(w);
+  this->DepthPeelingDelegatePass->ReleaseGraphicsResources(w);
+  this->VolumetricPass->ReleaseGraphicsResources(w);
+  if (this->DelegatePass != nullptr)
+  {
+    this->DelegatePass->ReleaseGraphicsResources(w);
+  }
+  if (this->QuadHelper != nullptr)
+  {
+    delete this->QuadHelper;
+    this->QuadHelper = nullptr;
+  }
+  if (this->FrameBufferObject != nullptr)
+  {
+    this->FrameBufferObject->Delete();
+    this->FrameBufferObject = nullptr;
+  }
+  if (this->ColorTexture != nullptr)
+  {
+    this->ColorTexture->Delete();
+    this->ColorTexture = nullptr;
+  }
+  if (this->DepthTexture != nullptr)
+  {
+    this->DepthTexture->Delete();
+    this->DepthTexture = nullptr;
+  }
+  this->LayerValid = false;
+}
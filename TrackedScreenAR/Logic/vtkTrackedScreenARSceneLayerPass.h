@@ -0,0 +1,123 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// .NAME vtkTrackedScreenARSceneLayerPass - render pass caching the virtual scene of a view in a layer
+// .SECTION Description
+// Renders the props of the renderer through its delegate pass into an offscreen color+alpha
+// layer, then composites that layer over the background of the renderer, i.e. the video.
+// The layer is kept as long as the scene looks the same: the active camera, the lights,
+// the set of visible props and their redraw time (which includes their mappers and input
+// data) and the viewport size. A render with an unchanged scene, typically one triggered by
+// a new video frame, then costs a background refresh and a blit of the layer instead of
+// a full render of the scene. With a tracked camera, the camera only stays unchanged if tracker
+// jitter is not presented (see vtkTrackedScreenARViewBinding::SetPoseTranslationDeadband);
+// every render after a camera change costs a full render of the layer plus the blit.
+//
+// The layer is rendered without multisampling. Without a delegate pass, translucent geometry is
+// depth peeled when the renderer uses depth peeling, like a renderer without pass would do. FXAA
+// and other view effects applied outside the render pass are not applied to the layer. Picking
+// renders bypass the cache.
+
+#ifndef __vtkTrackedScreenARSceneLayerPass_h
+#define __vtkTrackedScreenARSceneLayerPass_h
+
+// VTK includes
+#include <vtkRenderPass.h>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkDualDepthPeelingPass;
+class vtkOpenGLFramebufferObject;
+class vtkOpenGLQuadHelper;
+class vtkRenderStepsPass;
+class vtkRenderer;
+class vtkTextureObject;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARSceneLayerPass : public vtkRenderPass
+{
+public:
+  static vtkTrackedScreenARSceneLayerPass* New();
+  vtkTypeMacro(vtkTrackedScreenARSceneLayerPass, vtkRenderPass);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Render the layer if the scene changed, then composite it over the renderer background
+  virtual void Render(const vtkRenderState* s);
+
+  /// Release the layer and the graphics resources of the delegate pass
+  virtual void ReleaseGraphicsResources(vtkWindow* w);
+
+  /// Pass rendering the scene into the layer. If none is set, a vtkRenderStepsPass is used,
+  /// with a vtkDualDepthPeelingPass for the translucent geometry if the renderer uses depth peeling.
+  void SetDelegatePass(vtkRenderPass* delegatePass);
+  vtkGetObjectMacro(DelegatePass, vtkRenderPass);
+
+  /// Render the layer again on next render, for scene changes the cache cannot see
+  void Invalidate();
+
+  /// True if the next render can reuse the layer, as far as known before the render
+  vtkGetMacro(LayerValid, bool);
+
+  /// Renders that rendered the scene into the layer, and renders that only composited it
+  vtkGetMacro(NumberOfLayerRenders, unsigned long long);
+  vtkGetMacro(NumberOfCompositedFrames, unsigned long long);
+  void ResetFrameCounts();
+
+protected:
+  vtkTrackedScreenARSceneLayerPass();
+  virtual ~vtkTrackedScreenARSceneLayerPass();
+
+  /// Latest modification time of what the layer shows
+  vtkMTimeType ComputeSceneMTime(const vtkRenderState* s);
+
+  /// Pass the layer is rendered with, set up for the depth peeling settings of the renderer
+  vtkRenderPass* GetLayerDelegatePass(vtkRenderer* renderer);
+
+  void RenderLayer(const vtkRenderState* s, vtkRenderPass* delegatePass, int width, int height);
+  void CompositeLayer(const vtkRenderState* s, int width, int height, int originX, int originY);
+
+protected:
+  vtkRenderPass* DelegatePass;
+  // Used when no delegate pass is set, the second one when the renderer uses depth peeling
+  vtkRenderStepsPass* DefaultDelegatePass;
+  vtkRenderStepsPass* DepthPeelingDelegatePass;
+  vtkDualDepthPeelingPass* DepthPeelingPass;
+  vtkRenderPass* VolumetricPass;
+
+  vtkOpenGLFramebufferObject* FrameBufferObject;
+  vtkTextureObject* ColorTexture;
+  vtkTextureObject* DepthTexture;
+  vtkOpenGLQuadHelper* QuadHelper;
+
+  bool LayerValid;
+  vtkMTimeType LayerSceneMTime;
+  int LayerPropCount;
+  int LayerSize[2];
+  bool LayerDepthPeeling;
+  // Props rendered into the layer, reported again when only compositing
+  int LayerRenderedProps;
+
+  unsigned long long NumberOfLayerRenders;
+  unsigned long long NumberOfCompositedFrames;
+
+private:
+  vtkTrackedScreenARSceneLayerPass(const vtkTrackedScreenARSceneLayerPass&); // Not implemented
+  void operator=(const vtkTrackedScreenARSceneLayerPass&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// .NAME vtkTrackedScreenARSessionFormat - on-disk layout of a recorded TrackedScreenAR session
+// .SECTION Description
+// A session file holds, in this order:
+//  - a vtkTrackedScreenARSessionHeader, padded to TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT bytes,
+//  - one chunk per sample in the order they were written, each starting on a
+//    TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT boundary: a vtkTrackedScreenARSessionChunkHeader, the
+//    record of the sample, then for frames padding and the raw video frame (FrameSize bytes) or the
+//    composited view frame (ViewFrameSize bytes of RGB pixels, bottom row first) at the Offset of
+//    the record,
+//  - NumberOfFrames vtkTrackedScreenARSessionFrameRecord at FrameTableOffset,
+//  - NumberOfPoses vtkTrackedScreenARSessionPoseRecord at PoseTableOffset,
+//  - NumberOfViewFrames vtkTrackedScreenARSessionViewFrameRecord at ViewFrameTableOffset.
+// All values are stored in the byte order of the recording machine. Timestamps are in seconds on
+// the vtkTimerLog::GetUniversalTime() clock, in arrival order: the arrival time of video frames and
+// poses, the end of the render for view frames.
+// The header is written again with the frame geometry once the first frame is written, and with
+// the counts and table offsets when the recording is closed. A file left with no frames was not
+// closed properly: its tables are rebuilt from the chunks, up to the last complete one.
+//
+// Written by vtkTrackedScreenARSessionRecorder, memory-mapped by vtkTrackedScreenARSessionPlayer.
+
+#ifndef __vtkTrackedScreenARSessionFormat_h
+#define __vtkTrackedScreenARSessionFormat_h
+
+// VTK includes
+#include <vtkType.h>
+
+/// Identifies a session file, followed by the format version
+#define TRACKEDSCREENAR_SESSION_MAGIC "TSARSESS"
+const vtkTypeUInt32 TRACKEDSCREENAR_SESSION_VERSION = 4;
+
+/// Frames are aligned for vectorized reads straight from the mapping
+const vtkTypeUInt64 TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT = 64;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+struct vtkTrackedScreenARSessionHeader
+{
+  char Magic[8];
+  vtkTypeUInt32 Version;
+  vtkTypeUInt32 HeaderSize;
+
+  // Geometry of every frame of the session
+  vtkTypeInt32 Dimensions[2];
+  vtkTypeInt32 NumberOfScalarComponents;
+  vtkTypeInt32 ScalarType;
+  vtkTypeUInt64 FrameSize;
+
+  vtkTypeUInt64 NumberOfFrames;
+  vtkTypeUInt64 FrameTableOffset;
+  vtkTypeUInt64 NumberOfPoses;
+  vtkTypeUInt64 PoseTableOffset;
+
+  // Composited view frames, RGB unsigned char. Zero if the view was not recorded.
+  vtkTypeInt32 ViewDimensions[2];
+  vtkTypeUInt64 ViewFrameSize;
+  vtkTypeUInt64 NumberOfViewFrames;
+  vtkTypeUInt64 ViewFrameTableOffset;
+
+  // Pinhole camera parameters at the start of the recording: fx, fy, cx, cy and k1, k2, p1, p2, k3
+  double Intrinsics[4];
+  double DistortionCoefficients[5];
+};
+
+/// Kind of sample in a chunk
+enum vtkTrackedScreenARSessionChunkType
+{
+  TRACKEDSCREENAR_SESSION_FRAME_CHUNK = 1,
+  TRACKEDSCREENAR_SESSION_POSE_CHUNK = 2,
+  TRACKEDSCREENAR_SESSION_VIEW_FRAME_CHUNK = 3
+};
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+struct vtkTrackedScreenARSessionChunkHeader
+{
+  vtkTypeUInt32 Type;
+  vtkTypeUInt32 Reserved;
+  // Bytes of frame data at the Offset of the record, zero for poses
+  vtkTypeUInt64 DataSize;
+};
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+struct vtkTrackedScreenARSessionFrameRecord
+{
+  double Timestamp;
+  vtkTypeUInt64 Offset;
+};
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+struct vtkTrackedScreenARSessionPoseRecord
+{
+  double Timestamp;
+  // Matrix to parent of the camera transform node, as set by the tracker, row major.
+  // Replayed onto the camera transform node, whose parents apply on top again.
+  double Matrix[16];
+};
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+struct vtkTrackedScreenARSessionViewFrameRecord
+{
+  double Timestamp;
+  vtkTypeUInt64 Offset;
+  // Acquisition time of the video frame shown in the background, negative if there was none
+  double VideoTimestamp;
+  // Presented camera to world, row major
+  double Matrix[16];
+};
+
+#endif
@@ -0,0 +1,699 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARSessionPlayer.h"
+#include "vtkSlicerTrackedScreenARLogic.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// Video cameras include
+#include <vtkMRMLPinholeCameraNode.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix3x3.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Map the whole file copy-on-write: the frames can be wrapped by writable VTK arrays,
+  // a consumer writing into them never reaches the file
+  char* MapFile(const std::string& fileName, vtkTypeUInt64& size)
+  {
+    size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      return nullptr;
+    }
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+      mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (mapping == nullptr)
+    {
+      return nullptr;
+    }
+    // The view keeps the mapping alive
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr)
+    {
+      return nullptr;
+    }
+    size = static_cast<vtkTypeUInt64>(fileSize.QuadPart);
+    return static_cast<char*>(data);
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+      return nullptr;
+    }
+    struct stat fileStatus;
+    void* data = MAP_FAILED;
+    if (fstat(file, &fileStatus) == 0 && fileStatus.st_size > 0)
+    {
+      data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if (data == MAP_FAILED)
+    {
+      return nullptr;
+    }
+    size = static_cast<vtkTypeUInt64>(fileStatus.st_size);
+    return static_cast<char*>(data);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  void UnmapFile(char* data, vtkTypeUInt64 size)
+  {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, static_cast<size_t>(size));
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  vtkTypeUInt64 AlignOffset(vtkTypeUInt64 offset)
+  {
+    return (offset + TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT - 1) / TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT * TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT;
+  }
+
+  //----------------------------------------------------------------------------
+  // Rebuild the tables of a session that was not stopped from its chunks. Reading stops at the
+  // first chunk that is incomplete or does not match the geometry in the header.
+  void ReadChunks(const char* data, vtkTypeUInt64 size, const vtkTrackedScreenARSessionHeader& header,
+                  std::vector<vtkTrackedScreenARSessionFrameRecord>& frameRecords,
+                  std::vector<vtkTrackedScreenARSessionPoseRecord>& poseRecords, vtkTypeUInt64& numberOfViewFrames)
+  {
+    numberOfViewFrames = 0;
+    vtkTypeUInt64 position = AlignOffset(header.HeaderSize);
+    while (position <= size && size - position >= sizeof(vtkTrackedScreenARSessionChunkHeader))
+    {
+      vtkTrackedScreenARSessionChunkHeader chunk;
+      memcpy(&chunk, data + position, sizeof(chunk));
+      vtkTypeUInt64 recordOffset = position + sizeof(chunk);
+      vtkTypeUInt64 recordSize = 0;
+      vtkTypeUInt64 dataSize = 0;
+      switch (chunk.Type)
+      {
+        case TRACKEDSCREENAR_SESSION_FRAME_CHUNK:
+          recordSize = sizeof(vtkTrackedScreenARSessionFrameRecord);
+          dataSize = header.FrameSize;
+          break;
+        case TRACKEDSCREENAR_SESSION_POSE_CHUNK:
+          recordSize = sizeof(vtkTrackedScreenARSessionPoseRecord);
+          break;
+        case TRACKEDSCREENAR_SESSION_VIEW_FRAME_CHUNK:
+          recordSize = sizeof(vtkTrackedScreenARSessionViewFrameRecord);
+          dataSize = header.ViewFrameSize;
+          break;
+        default:
+          return;
+      }
+      vtkTypeUInt64 dataOffset = AlignOffset(recordOffset + recordSize);
+      if (chunk.DataSize != dataSize || size - recordOffset < recordSize || dataOffset > size || dataSize > size - dataOffset)
+      {
+        return;
+      }
+
+      if (chunk.Type == TRACKEDSCREENAR_SESSION_FRAME_CHUNK)
+      {
+        vtkTrackedScreenARSessionFrameRecord record;
+        memcpy(&record, data + recordOffset, sizeof(record));
+        if (record.Offset != dataOffset)
+        {
+          return;
+        }
+        frameRecords.push_back(record);
+      }
+      else if (chunk.Type == TRACKEDSCREENAR_SESSION_POSE_CHUNK)
+      {
+        vtkTrackedScreenARSessionPoseRecord record;
+        memcpy(&record, data + recordOffset, sizeof(record));
+        poseRecords.push_back(record);
+      }
+      else
+      {
+        ++numberOfViewFrames;
+      }
+      position = AlignOffset(dataOffset + dataSize);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARSessionPlayer);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSessionPlayer::vtkTrackedScreenARSessionPlayer()
+  : VideoNode(nullptr)
+  , CameraTransformNode(nullptr)
+  , CameraParametersNode(nullptr)
+  , MappedData(nullptr)
+  , MappedSize(0)
+  , StartTime(0.0)
+  , FrameTable(nullptr)
+  , PoseTable(nullptr)
+  , Recovered(false)
+  , FrameScalars(nullptr)
+  , FrameIndex(0)
+  , PoseIndex(0)
+  , CameraParametersApplied(false)
+{
+  memset(&this->Header, 0, sizeof(this->Header));
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSessionPlayer::~vtkTrackedScreenARSessionPlayer()
+{
+  this->Close();
+  this->SetVideoNode(nullptr);
+  this->SetCameraTransformNode(nullptr);
+  this->SetCameraParametersNode(nullptr);
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "VideoNode: " << (this->VideoNode ? this->VideoNode->GetID() : "(none)") << std::endl;
+  os << indent << "CameraTransformNode: " << (this->CameraTransformNode ? this->CameraTransformNode->GetID() : "(none)") << std::endl;
+  os << indent << "CameraParametersNode: " << (this->CameraParametersNode ? this->CameraParametersNode->GetID() : "(none)") << std::endl;
+  os << indent << "Logic: " << this->Logic.GetPointer() << std::endl;
+  os << indent << "Open: " << (this->IsOpen() ? "true" : "false") << std::endl;
+  os << indent << "Recovered: " << (this->Recovered ? "true" : "false") << std::endl;
+  os << indent << "NumberOfFrames: " << this->GetNumberOfFrames() << std::endl;
+  os << indent << "NumberOfPoses: " << this->GetNumberOfPoses() << std::endl;
+  os << indent << "NumberOfViewFrames: " << this->GetNumberOfViewFrames() << std::endl;
+  os << indent << "FrameIndex: " << this->FrameIndex << std::endl;
+  os << indent << "PoseIndex: " << this->PoseIndex << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::SetVideoNode(vtkMRMLVolumeNode* node)
+{
+  if (node == this->VideoNode)
+  {
+    return;
+  }
+  this->DetachVideoImage();
+  vtkSetObjectBodyMacro(VideoNode, vtkMRMLVolumeNode, node);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLVolumeNode* vtkTrackedScreenARSessionPlayer::GetVideoNode()
+{
+  return this->VideoNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::SetCameraTransformNode(vtkMRMLLinearTransformNode* node)
+{
+  vtkSetObjectBodyMacro(CameraTransformNode, vtkMRMLLinearTransformNode, node);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkTrackedScreenARSessionPlayer::GetCameraTransformNode()
+{
+  return this->CameraTransformNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::SetCameraParametersNode(vtkMRMLPinholeCameraNode* node)
+{
+  vtkSetObjectBodyMacro(CameraParametersNode, vtkMRMLPinholeCameraNode, node);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLPinholeCameraNode* vtkTrackedScreenARSessionPlayer::GetCameraParametersNode()
+{
+  return this->CameraParametersNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::SetLogic(vtkSlicerTrackedScreenARLogic* logic)
+{
+  if (logic == this->Logic)
+  {
+    return;
+  }
+  this->Logic = logic;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerTrackedScreenARLogic* vtkTrackedScreenARSessionPlayer::GetLogic()
+{
+  return this->Logic;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionPlayer::Open(const std::string& fileName)
+{
+  this->Close();
+
+  vtkTypeUInt64 size = 0;
+  char* data = MapFile(fileName, size);
+  if (data == nullptr)
+  {
+    vtkErrorMacro("Open: cannot map session file " << fileName);
+    return false;
+  }
+
+  vtkTrackedScreenARSessionHeader header;
+  memset(&header, 0, sizeof(header));
+  if (size >= sizeof(header))
+  {
+    memcpy(&header, data, sizeof(header));
+  }
+
+  std::vector<vtkTrackedScreenARSessionFrameRecord> recoveredFrameRecords;
+  std::vector<vtkTrackedScreenARSessionPoseRecord> recoveredPoseRecords;
+  bool recovered = false;
+  const char* error = nullptr;
+  int scalarTypeSize = (header.ScalarType > 0 ? vtkDataArray::GetDataTypeSize(header.ScalarType) : 0);
+  if (size < sizeof(header) || memcmp(header.Magic, TRACKEDSCREENAR_SESSION_MAGIC, sizeof(header.Magic)) != 0)
+  {
+    error = "not a session file";
+  }
+  else if (header.Version != TRACKEDSCREENAR_SESSION_VERSION || header.HeaderSize != sizeof(header))
+  {
+    error = "unsupported session format version";
+  }
+  else if (header.FrameSize == 0)
+  {
+    error = "no frames";
+  }
+  else if (header.Dimensions[0] <= 0 || header.Dimensions[1] <= 0 || header.NumberOfScalarComponents <= 0 || scalarTypeSize <= 0
+           || header.FrameSize != static_cast<vtkTypeUInt64>(header.Dimensions[0]) * header.Dimensions[1] * header.NumberOfScalarComponents * scalarTypeSize)
+  {
+    error = "invalid frame geometry";
+  }
+  else if (header.NumberOfFrames == 0)
+  {
+    // Not stopped by the recorder
+    ReadChunks(data, size, header, recoveredFrameRecords, recoveredPoseRecords, header.NumberOfViewFrames);
+    header.NumberOfFrames = recoveredFrameRecords.size();
+    header.NumberOfPoses = recoveredPoseRecords.size();
+    recovered = true;
+    if (header.NumberOfFrames == 0)
+    {
+      error = "no complete frame, the recording was not stopped";
+    }
+  }
+  else if (header.FrameTableOffset > size || header.NumberOfFrames > (size - header.FrameTableOffset) / sizeof(vtkTrackedScreenARSessionFrameRecord)
+           || header.PoseTableOffset > size || header.NumberOfPoses > (size - header.PoseTableOffset) / sizeof(vtkTrackedScreenARSessionPoseRecord)
+           || header.ViewFrameTableOffset > size || header.NumberOfViewFrames > (size - header.ViewFrameTableOffset) / sizeof(vtkTrackedScreenARSessionViewFrameRecord))
+  {
+    error = "truncated sample tables";
+  }
+  else
+  {
+    const vtkTrackedScreenARSessionFrameRecord* frames = reinterpret_cast<const vtkTrackedScreenARSessionFrameRecord*>(data + header.FrameTableOffset);
+    for (vtkTypeUInt64 i = 0; i < header.NumberOfFrames; ++i)
+    {
+      if (frames[i].Offset > size || header.FrameSize > size - frames[i].Offset)
+      {
+        error = "truncated frame data";
+        break;
+      }
+    }
+  }
+  if (error != nullptr)
+  {
+    vtkErrorMacro("Open: cannot read session file " << fileName << ": " << error);
+    UnmapFile(data, size);
+    return false;
+  }
+
+  this->MappedData = data;
+  this->MappedSize = size;
+  this->Header = header;
+  this->Recovered = recovered;
+  if (recovered)
+  {
+    vtkWarningMacro("Open: session file " << fileName << " was not closed by the recorder, " << header.NumberOfFrames
+                    << " frames and " << header.NumberOfPoses << " poses were recovered");
+    this->RecoveredFrameRecords.swap(recoveredFrameRecords);
+    this->RecoveredPoseRecords.swap(recoveredPoseRecords);
+    this->FrameTable = &this->RecoveredFrameRecords[0];
+    this->PoseTable = (this->RecoveredPoseRecords.empty() ? nullptr : &this->RecoveredPoseRecords[0]);
+  }
+  else
+  {
+    this->FrameTable = reinterpret_cast<const vtkTrackedScreenARSessionFrameRecord*>(data + header.FrameTableOffset);
+    this->PoseTable = reinterpret_cast<const vtkTrackedScreenARSessionPoseRecord*>(data + header.PoseTableOffset);
+  }
+  this->StartTime = this->GetFrameRecord(0)->Timestamp;
+  if (this->Header.NumberOfPoses > 0)
+  {
+    this->StartTime = std::min(this->StartTime, this->GetPoseRecord(0)->Timestamp);
+  }
+
+  this->FrameScalars = vtkDataArray::CreateDataArray(this->Header.ScalarType);
+  this->FrameScalars->SetNumberOfComponents(this->Header.NumberOfScalarComponents);
+  this->FrameScalars->SetName("SessionFrame");
+
+  this->Rewind();
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::Close()
+{
+  if (!this->IsOpen())
+  {
+    return;
+  }
+  this->DetachVideoImage();
+  this->FrameScalars->Delete();
+  this->FrameScalars = nullptr;
+
+  UnmapFile(this->MappedData, this->MappedSize);
+  this->MappedData = nullptr;
+  this->MappedSize = 0;
+  memset(&this->Header, 0, sizeof(this->Header));
+  this->FrameTable = nullptr;
+  this->PoseTable = nullptr;
+  this->RecoveredFrameRecords.clear();
+  this->RecoveredPoseRecords.clear();
+  this->Recovered = false;
+  this->Rewind();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionPlayer::IsOpen() const
+{
+  return this->MappedData != nullptr;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionPlayer::IsRecovered() const
+{
+  return this->Recovered;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionPlayer::GetNumberOfFrames() const
+{
+  return this->Header.NumberOfFrames;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionPlayer::GetNumberOfPoses() const
+{
+  return this->Header.NumberOfPoses;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionPlayer::GetNumberOfViewFrames() const
+{
+  return this->Header.NumberOfViewFrames;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::GetFrameDimensions(int dimensions[2]) const
+{
+  dimensions[0] = this->Header.Dimensions[0];
+  dimensions[1] = this->Header.Dimensions[1];
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::GetIntrinsics(double intrinsics[4]) const
+{
+  std::copy(this->Header.Intrinsics, this->Header.Intrinsics + 4, intrinsics);
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::GetDistortionCoefficients(double distortionCoefficients[5]) const
+{
+  std::copy(this->Header.DistortionCoefficients, this->Header.DistortionCoefficients + 5, distortionCoefficients);
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARSessionPlayer::GetFrameTime(vtkTypeUInt64 frameIndex) const
+{
+  const vtkTrackedScreenARSessionFrameRecord* record = this->GetFrameRecord(frameIndex);
+  return (record != nullptr ? record->Timestamp - this->StartTime : -1.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARSessionPlayer::GetDuration() const
+{
+  if (!this->IsOpen())
+  {
+    return 0.0;
+  }
+  double endTime = this->GetFrameRecord(this->Header.NumberOfFrames - 1)->Timestamp;
+  if (this->Header.NumberOfPoses > 0)
+  {
+    endTime = std::max(endTime, this->GetPoseRecord(this->Header.NumberOfPoses - 1)->Timestamp);
+  }
+  return endTime - this->StartTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::Rewind()
+{
+  this->FrameIndex = 0;
+  this->PoseIndex = 0;
+  this->CameraParametersApplied = false;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARSessionPlayer::PlayUntil(double sessionTime)
+{
+  int numberOfFrames = 0;
+  while (!this->IsAtEnd() && this->GetNextSampleTime() <= sessionTime)
+  {
+    if (this->DeliverNextSample())
+    {
+      ++numberOfFrames;
+    }
+  }
+  return numberOfFrames;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionPlayer::StepFrame()
+{
+  if (!this->IsOpen() || this->FrameIndex >= this->Header.NumberOfFrames)
+  {
+    return false;
+  }
+  while (!this->DeliverNextSample())
+  {
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARSessionPlayer::GetNextSampleTime() const
+{
+  if (this->IsAtEnd())
+  {
+    return -1.0;
+  }
+  const vtkTrackedScreenARSessionFrameRecord* frame = this->GetFrameRecord(this->FrameIndex);
+  const vtkTrackedScreenARSessionPoseRecord* pose = this->GetPoseRecord(this->PoseIndex);
+  if (frame != nullptr && (pose == nullptr || frame->Timestamp < pose->Timestamp))
+  {
+    return frame->Timestamp - this->StartTime;
+  }
+  return pose->Timestamp - this->StartTime;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionPlayer::IsAtEnd() const
+{
+  return !this->IsOpen() || (this->FrameIndex >= this->Header.NumberOfFrames && this->PoseIndex >= this->Header.NumberOfPoses);
+}
+
+//----------------------------------------------------------------------------
+const vtkTrackedScreenARSessionFrameRecord* vtkTrackedScreenARSessionPlayer::GetFrameRecord(vtkTypeUInt64 frameIndex) const
+{
+  if (!this->IsOpen() || frameIndex >= this->Header.NumberOfFrames)
+  {
+    return nullptr;
+  }
+  return this->FrameTable + frameIndex;
+}
+
+//----------------------------------------------------------------------------
+const vtkTrackedScreenARSessionPoseRecord* vtkTrackedScreenARSessionPlayer::GetPoseRecord(vtkTypeUInt64 poseIndex) const
+{
+  if (!this->IsOpen() || poseIndex >= this->Header.NumberOfPoses)
+  {
+    return nullptr;
+  }
+  return this->PoseTable + poseIndex;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionPlayer::DeliverNextSample()
+{
+  if (!this->CameraParametersApplied)
+  {
+    this->ApplyCameraParameters();
+  }
+
+  // Same order as recorded, a pose arrived with a frame goes first so the frame sees it
+  const vtkTrackedScreenARSessionFrameRecord* frame = this->GetFrameRecord(this->FrameIndex);
+  const vtkTrackedScreenARSessionPoseRecord* pose = this->GetPoseRecord(this->PoseIndex);
+  if (pose != nullptr && (frame == nullptr || pose->Timestamp <= frame->Timestamp))
+  {
+    ++this->PoseIndex;
+    this->DeliverPose(pose);
+    return false;
+  }
+  ++this->FrameIndex;
+  this->DeliverFrame(frame);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::DeliverFrame(const vtkTrackedScreenARSessionFrameRecord* record)
+{
+  if (this->VideoNode == nullptr)
+  {
+    return;
+  }
+  vtkImageData* image = this->VideoNode->GetImageData();
+  if (image == nullptr)
+  {
+    vtkNew<vtkImageData> newImage;
+    this->VideoNode->SetAndObserveImageData(newImage.GetPointer());
+    image = newImage.GetPointer();
+  }
+
+  // The mapping is copy-on-write, the array may be handed out as writable
+  vtkIdType numberOfValues = static_cast<vtkIdType>(this->Header.FrameSize / this->FrameScalars->GetDataTypeSize());
+  this->FrameScalars->SetVoidArray(this->MappedData + record->Offset, numberOfValues, 1);
+  this->FrameScalars->Modified();
+  int* dimensions = image->GetDimensions();
+  if (image->GetPointData()->GetScalars() != this->FrameScalars
+      || dimensions[0] != this->Header.Dimensions[0] || dimensions[1] != this->Header.Dimensions[1] || dimensions[2] != 1)
+  {
+    image->SetDimensions(this->Header.Dimensions[0], this->Header.Dimensions[1], 1);
+    image->GetPointData()->SetScalars(this->FrameScalars);
+  }
+
+  if (this->Logic != nullptr)
+  {
+    this->Logic->SetArrivalTimeOverride(record->Timestamp);
+  }
+  image->Modified();
+  if (this->Logic != nullptr)
+  {
+    this->Logic->SetArrivalTimeOverride(-1.0);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::DeliverPose(const vtkTrackedScreenARSessionPoseRecord* record)
+{
+  if (this->CameraTransformNode == nullptr)
+  {
+    return;
+  }
+  vtkNew<vtkMatrix4x4> cameraToParent;
+  cameraToParent->DeepCopy(record->Matrix);
+
+  if (this->Logic != nullptr)
+  {
+    this->Logic->SetArrivalTimeOverride(record->Timestamp);
+  }
+  this->CameraTransformNode->SetMatrixTransformToParent(cameraToParent.GetPointer());
+  if (this->Logic != nullptr)
+  {
+    this->Logic->SetArrivalTimeOverride(-1.0);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::ApplyCameraParameters()
+{
+  this->CameraParametersApplied = true;
+  if (this->CameraParametersNode == nullptr)
+  {
+    return;
+  }
+
+  vtkNew<vtkMatrix3x3> intrinsicMatrix;
+  intrinsicMatrix->SetElement(0, 0, this->Header.Intrinsics[0]);
+  intrinsicMatrix->SetElement(1, 1, this->Header.Intrinsics[1]);
+  intrinsicMatrix->SetElement(0, 2, this->Header.Intrinsics[2]);
+  intrinsicMatrix->SetElement(1, 2, this->Header.Intrinsics[3]);
+  vtkNew<vtkDoubleArray> distortionCoefficients;
+  for (int i = 0; i < 5; ++i)
+  {
+    distortionCoefficients->InsertNextValue(this->Header.DistortionCoefficients[i]);
+  }
+
+  int wasModifying = this->CameraParametersNode->StartModify();
+  this->CameraParametersNode->SetAndObserveIntrinsicMatrix(intrinsicMatrix.GetPointer());
+  this->CameraParametersNode->SetAndObserveDistortionCoefficients(distortionCoefficients.GetPointer());
+  this->CameraParametersNode->EndModify(wasModifying);
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionPlayer::DetachVideoImage()
+{
+  vtkImageData* image = (this->VideoNode != nullptr ? this->VideoNode->GetImageData() : nullptr);
+  if (image == nullptr || this->FrameScalars == nullptr || image->GetPointData()->GetScalars() != this->FrameScalars)
+  {
+    return;
+  }
+  vtkSmartPointer<vtkDataArray> frameCopy = vtkSmartPointer<vtkDataArray>::Take(this->FrameScalars->NewInstance());
+  frameCopy->DeepCopy(this->FrameScalars);
+  image->GetPointData()->SetScalars(frameCopy);
+}
@@ -0,0 +1,177 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// .NAME vtkTrackedScreenARSessionPlayer - replays a recorded session into the TrackedScreenAR input nodes
+// .SECTION Description
+// Memory-maps a session file written by vtkTrackedScreenARSessionRecorder and delivers its frames
+// and poses, in recorded order, to a video volume and a camera transform node, the way a live
+// camera and tracker would. Frames are not copied: the image of the video volume wraps the
+// mapped frame, which is copied once by the video source of the logic.
+//
+// Samples are delivered either on the recorded timing (PlayUntil(), driven by a timer) or one
+// video frame at a time as fast as the caller renders (StepFrame()). If a logic is set, its
+// arrival time override is set to the recorded arrival time of each sample, so frames and poses
+// are matched exactly as they were live. Stepping frame by frame then presents the same pose
+// with the same frame in every run, whatever the build and the machine.
+//
+// The recorded camera parameters are applied to the camera parameters node before the first
+// sample is delivered.
+//
+// A session that the recorder did not stop, for example because the application crashed, has no
+// tables: they are rebuilt from the chunks of the file, up to the last complete one.
+
+#ifndef __vtkTrackedScreenARSessionPlayer_h
+#define __vtkTrackedScreenARSessionPlayer_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+#include "vtkTrackedScreenARSessionFormat.h"
+
+class vtkDataArray;
+class vtkMRMLLinearTransformNode;
+class vtkMRMLPinholeCameraNode;
+class vtkMRMLVolumeNode;
+class vtkSlicerTrackedScreenARLogic;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARSessionPlayer : public vtkObject
+{
+public:
+  static vtkTrackedScreenARSessionPlayer* New();
+  vtkTypeMacro(vtkTrackedScreenARSessionPlayer, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Video volume receiving the frames. Its image data is created if it has none.
+  void SetVideoNode(vtkMRMLVolumeNode* node);
+  vtkMRMLVolumeNode* GetVideoNode();
+
+  /// Transform node receiving the poses, as its transform to parent
+  void SetCameraTransformNode(vtkMRMLLinearTransformNode* node);
+  vtkMRMLLinearTransformNode* GetCameraTransformNode();
+
+  /// Node receiving the recorded camera parameters, optional
+  void SetCameraParametersNode(vtkMRMLPinholeCameraNode* node);
+  vtkMRMLPinholeCameraNode* GetCameraParametersNode();
+
+  /// Logic whose arrival time override follows the recorded timestamps, optional. Not registered,
+  /// the logic owns the player it drives.
+  void SetLogic(vtkSlicerTrackedScreenARLogic* logic);
+  vtkSlicerTrackedScreenARLogic* GetLogic();
+
+  /// Map a session file and rewind. Returns false if the file cannot be mapped or holds no complete frame.
+  bool Open(const std::string& fileName);
+
+  /// Unmap the session file. The video image keeps a copy of the last delivered frame.
+  void Close();
+
+  bool IsOpen() const;
+
+  /// True if the open session was not stopped by the recorder and its tables were rebuilt
+  bool IsRecovered() const;
+
+  /// Recorded content
+  vtkTypeUInt64 GetNumberOfFrames() const;
+  vtkTypeUInt64 GetNumberOfPoses() const;
+  /// Composited view frames are archived with the session, they are not replayed
+  vtkTypeUInt64 GetNumberOfViewFrames() const;
+  void GetFrameDimensions(int dimensions[2]) const;
+  void GetIntrinsics(double intrinsics[4]) const;
+  void GetDistortionCoefficients(double distortionCoefficients[5]) const;
+
+  /// Arrival time of the given frame relative to the first sample of the session, in seconds
+  double GetFrameTime(vtkTypeUInt64 frameIndex) const;
+
+  /// Time from the first to the last sample of the session, in seconds
+  double GetDuration() const;
+
+  /// Go back to the first sample
+  void Rewind();
+
+  /// Deliver every sample recorded up to the given time (relative to the first sample, in seconds).
+  /// Returns the number of frames delivered.
+  int PlayUntil(double sessionTime);
+
+  /// Deliver the next frame and the poses recorded before it.
+  /// Returns false if there is no frame left.
+  bool StepFrame();
+
+  /// Time of the next sample to deliver relative to the first sample, negative at the end of the session
+  double GetNextSampleTime() const;
+
+  bool IsAtEnd() const;
+
+  /// Samples delivered since the last rewind
+  vtkGetMacro(FrameIndex, vtkTypeUInt64);
+  vtkGetMacro(PoseIndex, vtkTypeUInt64);
+
+protected:
+  vtkTrackedScreenARSessionPlayer();
+  virtual ~vtkTrackedScreenARSessionPlayer();
+
+  const vtkTrackedScreenARSessionFrameRecord* GetFrameRecord(vtkTypeUInt64 frameIndex) const;
+  const vtkTrackedScreenARSessionPoseRecord* GetPoseRecord(vtkTypeUInt64 poseIndex) const;
+
+  /// Deliver the earlier of the next frame and the next pose, the pose if they arrived at the same time.
+  /// Returns true if it was a frame.
+  bool DeliverNextSample();
+  void DeliverFrame(const vtkTrackedScreenARSessionFrameRecord* record);
+  void DeliverPose(const vtkTrackedScreenARSessionPoseRecord* record);
+  void ApplyCameraParameters();
+
+  /// Give the video image its own copy of the frame it wraps, before the mapping goes away
+  void DetachVideoImage();
+
+protected:
+  vtkMRMLVolumeNode* VideoNode;
+  vtkMRMLLinearTransformNode* CameraTransformNode;
+  vtkMRMLPinholeCameraNode* CameraParametersNode;
+  vtkWeakPointer<vtkSlicerTrackedScreenARLogic> Logic;
+
+  // Read-only view of the session file, copy on write
+  char* MappedData;
+  vtkTypeUInt64 MappedSize;
+  vtkTrackedScreenARSessionHeader Header;
+  double StartTime;
+
+  // Tables in the mapping, or rebuilt from the chunks of a session that was not stopped
+  const vtkTrackedScreenARSessionFrameRecord* FrameTable;
+  const vtkTrackedScreenARSessionPoseRecord* PoseTable;
+  std::vector<vtkTrackedScreenARSessionFrameRecord> RecoveredFrameRecords;
+  std::vector<vtkTrackedScreenARSessionPoseRecord> RecoveredPoseRecords;
+  bool Recovered;
+
+  // Scalars of the video image, wrapping the delivered frame in the mapping
+  vtkDataArray* FrameScalars;
+
+  vtkTypeUInt64 FrameIndex;
+  vtkTypeUInt64 PoseIndex;
+  bool CameraParametersApplied;
+
+private:
+  vtkTrackedScreenARSessionPlayer(const vtkTrackedScreenARSessionPlayer&); // Not implemented
+  void operator=(const vtkTrackedScreenARSessionPlayer&); // Not implemented
+};
+
+#endif
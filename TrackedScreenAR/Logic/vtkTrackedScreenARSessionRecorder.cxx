@@ -0,0 +1,763 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARSessionRecorder.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// Video cameras include
+#include <vtkMRMLPinholeCameraNode.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix3x3.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkRenderWindow.h>
+#include <vtkTimerLog.h>
+#include <vtkUnsignedCharArray.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARSessionRecorder);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSessionRecorder::vtkTrackedScreenARSessionRecorder()
+  : VideoNode(nullptr)
+  , CameraTransformNode(nullptr)
+  , CameraParametersNode(nullptr)
+  , VideoNodeObserverTag(0)
+  , CameraTransformObserverTag(0)
+  , MaximumQueueSize(16)
+  , DropPolicy(DropOldest)
+  , RecordViewFrames(false)
+  , File(nullptr)
+  , WritePosition(0)
+  , ReadbackPixels(vtkUnsignedCharArray::New())
+  , QueueCapacity(16)
+  , TotalCaptureTime(0.0)
+  , MaximumCaptureTime(0.0)
+  , NumberOfCaptures(0)
+  , PeakQueueSize(0)
+  , StopRequested(false)
+  , Recording(false)
+  , WriteError(false)
+  , NumberOfRecordedFrames(0)
+  , NumberOfRecordedViewFrames(0)
+  , NumberOfRecordedPoses(0)
+  , NumberOfSkippedFrames(0)
+  , NumberOfDroppedFrames(0)
+  , NumberOfDroppedViewFrames(0)
+  , NumberOfBytesWritten(0)
+{
+  memset(&this->Header, 0, sizeof(this->Header));
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSessionRecorder::~vtkTrackedScreenARSessionRecorder()
+{
+  if (this->IsRecording())
+  {
+    this->Stop();
+  }
+  this->SetVideoNode(nullptr);
+  this->SetCameraTransformNode(nullptr);
+  this->SetCameraParametersNode(nullptr);
+  this->ReadbackPixels->Delete();
+  this->ReadbackPixels = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "VideoNode: " << (this->VideoNode ? this->VideoNode->GetID() : "(none)") << std::endl;
+  os << indent << "CameraTransformNode: " << (this->CameraTransformNode ? this->CameraTransformNode->GetID() : "(none)") << std::endl;
+  os << indent << "CameraParametersNode: " << (this->CameraParametersNode ? this->CameraParametersNode->GetID() : "(none)") << std::endl;
+  os << indent << "MaximumQueueSize: " << this->MaximumQueueSize << std::endl;
+  os << indent << "DropPolicy: " << GetDropPolicyAsString(this->DropPolicy) << std::endl;
+  os << indent << "RecordViewFrames: " << (this->RecordViewFrames ? "true" : "false") << std::endl;
+  os << indent << "Recording: " << (this->IsRecording() ? "true" : "false") << std::endl;
+  os << indent << "NumberOfRecordedFrames: " << this->GetNumberOfRecordedFrames() << std::endl;
+  os << indent << "NumberOfRecordedViewFrames: " << this->GetNumberOfRecordedViewFrames() << std::endl;
+  os << indent << "NumberOfRecordedPoses: " << this->GetNumberOfRecordedPoses() << std::endl;
+  os << indent << "NumberOfSkippedFrames: " << this->GetNumberOfSkippedFrames() << std::endl;
+  os << indent << "NumberOfDroppedFrames: " << this->GetNumberOfDroppedFrames() << std::endl;
+  os << indent << "NumberOfDroppedViewFrames: " << this->GetNumberOfDroppedViewFrames() << std::endl;
+  os << indent << "PeakQueueSize: " << this->GetPeakQueueSize() << std::endl;
+  os << indent << "NumberOfBytesWritten: " << this->GetNumberOfBytesWritten() << std::endl;
+  os << indent << "MeanCaptureTime: " << this->GetMeanCaptureTime() << " ms" << std::endl;
+  os << indent << "MaximumCaptureTime: " << this->GetMaximumCaptureTime() << " ms" << std::endl;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTrackedScreenARSessionRecorder::GetDropPolicyAsString(int policy)
+{
+  switch (policy)
+  {
+  case DropNewest: return "DropNewest";
+  case DropOldest: return "DropOldest";
+  default: return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::SetVideoNode(vtkMRMLVolumeNode* node)
+{
+  if (node == this->VideoNode)
+  {
+    return;
+  }
+  if (this->VideoNode != nullptr)
+  {
+    this->VideoNode->RemoveObserver(this->VideoNodeObserverTag);
+    this->VideoNode->UnRegister(this);
+  }
+  this->VideoNode = node;
+  if (this->VideoNode != nullptr)
+  {
+    this->VideoNode->Register(this);
+    this->VideoNodeObserverTag = this->VideoNode->AddObserver(vtkMRMLVolumeNode::ImageDataModifiedEvent, this, &vtkTrackedScreenARSessionRecorder::OnVideoImageDataModified);
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLVolumeNode* vtkTrackedScreenARSessionRecorder::GetVideoNode()
+{
+  return this->VideoNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::SetCameraTransformNode(vtkMRMLLinearTransformNode* node)
+{
+  if (node == this->CameraTransformNode)
+  {
+    return;
+  }
+  if (this->CameraTransformNode != nullptr)
+  {
+    this->CameraTransformNode->RemoveObserver(this->CameraTransformObserverTag);
+    this->CameraTransformNode->UnRegister(this);
+  }
+  this->CameraTransformNode = node;
+  if (this->CameraTransformNode != nullptr)
+  {
+    this->CameraTransformNode->Register(this);
+    this->CameraTransformObserverTag = this->CameraTransformNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this, &vtkTrackedScreenARSessionRecorder::OnCameraTransformModified);
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkTrackedScreenARSessionRecorder::GetCameraTransformNode()
+{
+  return this->CameraTransformNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::SetCameraParametersNode(vtkMRMLPinholeCameraNode* node)
+{
+  vtkSetObjectBodyMacro(CameraParametersNode, vtkMRMLPinholeCameraNode, node);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLPinholeCameraNode* vtkTrackedScreenARSessionRecorder::GetCameraParametersNode()
+{
+  return this->CameraParametersNode;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::Start(const std::string& fileName)
+{
+  if (this->IsRecording())
+  {
+    this->Stop();
+  }
+
+  this->File = fopen(fileName.c_str(), "wb");
+  if (this->File == nullptr)
+  {
+    vtkErrorMacro("Start: cannot create session file " << fileName);
+    return false;
+  }
+  this->WritePosition = 0;
+  this->WriteError = false;
+  this->FrameRecords.clear();
+  this->ViewFrameRecords.clear();
+  this->PoseRecords.clear();
+  this->PendingPoseRecords.clear();
+  this->NumberOfRecordedFrames = 0;
+  this->NumberOfRecordedViewFrames = 0;
+  this->NumberOfRecordedPoses = 0;
+  this->NumberOfSkippedFrames = 0;
+  this->NumberOfDroppedFrames = 0;
+  this->NumberOfDroppedViewFrames = 0;
+  this->NumberOfBytesWritten = 0;
+  this->TotalCaptureTime = 0.0;
+  this->MaximumCaptureTime = 0.0;
+  this->NumberOfCaptures = 0;
+  this->QueueCapacity = this->MaximumQueueSize;
+  this->PeakQueueSize = 0;
+  this->StopRequested = false;
+
+  memset(&this->Header, 0, sizeof(this->Header));
+  memcpy(this->Header.Magic, TRACKEDSCREENAR_SESSION_MAGIC, sizeof(this->Header.Magic));
+  this->Header.Version = TRACKEDSCREENAR_SESSION_VERSION;
+  this->Header.HeaderSize = sizeof(vtkTrackedScreenARSessionHeader);
+  if (this->CameraParametersNode != nullptr && this->CameraParametersNode->GetIntrinsicMatrix() != nullptr)
+  {
+    vtkMatrix3x3* intrinsicMatrix = this->CameraParametersNode->GetIntrinsicMatrix();
+    this->Header.Intrinsics[0] = intrinsicMatrix->GetElement(0, 0);
+    this->Header.Intrinsics[1] = intrinsicMatrix->GetElement(1, 1);
+    this->Header.Intrinsics[2] = intrinsicMatrix->GetElement(0, 2);
+    this->Header.Intrinsics[3] = intrinsicMatrix->GetElement(1, 2);
+    vtkDoubleArray* coefficients = this->CameraParametersNode->GetDistortionCoefficients();
+    if (coefficients != nullptr)
+    {
+      for (vtkIdType i = 0; i < std::min<vtkIdType>(5, coefficients->GetNumberOfValues()); ++i)
+      {
+        this->Header.DistortionCoefficients[i] = coefficients->GetValue(i);
+      }
+    }
+  }
+
+  // Written again with the frame geometry by the writer thread, and with the counts on Stop()
+  this->FileHeader = this->Header;
+  if (!this->Write(&this->Header, sizeof(this->Header)) || !this->WritePadding())
+  {
+    vtkErrorMacro("Start: cannot write to session file " << fileName);
+    fclose(this->File);
+    this->File = nullptr;
+    return false;
+  }
+
+  this->Recording = true;
+  this->WriterThread = std::thread(&vtkTrackedScreenARSessionRecorder::WriteQueuedFrames, this);
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::Stop()
+{
+  if (!this->IsRecording())
+  {
+    return false;
+  }
+
+  // The writer thread empties the queue before it exits
+  this->Recording = false;
+  {
+    std::lock_guard<std::mutex> lock(this->QueueMutex);
+    this->StopRequested = true;
+  }
+  this->QueueCondition.notify_all();
+  this->WriterThread.join();
+
+  this->Header.FrameTableOffset = this->WritePosition;
+  this->Header.NumberOfFrames = this->FrameRecords.size();
+  if (!this->FrameRecords.empty())
+  {
+    this->Write(&this->FrameRecords[0], this->FrameRecords.size() * sizeof(vtkTrackedScreenARSessionFrameRecord));
+  }
+  this->Header.PoseTableOffset = this->WritePosition;
+  this->Header.NumberOfPoses = this->PoseRecords.size();
+  if (!this->PoseRecords.empty())
+  {
+    this->Write(&this->PoseRecords[0], this->PoseRecords.size() * sizeof(vtkTrackedScreenARSessionPoseRecord));
+  }
+  this->Header.ViewFrameTableOffset = this->WritePosition;
+  this->Header.NumberOfViewFrames = this->ViewFrameRecords.size();
+  if (!this->ViewFrameRecords.empty())
+  {
+    this->Write(&this->ViewFrameRecords[0], this->ViewFrameRecords.size() * sizeof(vtkTrackedScreenARSessionViewFrameRecord));
+  }
+
+  if (fseek(this->File, 0, SEEK_SET) != 0 || fwrite(&this->Header, sizeof(this->Header), 1, this->File) != 1)
+  {
+    this->WriteError = true;
+  }
+  if (fclose(this->File) != 0)
+  {
+    this->WriteError = true;
+  }
+  this->File = nullptr;
+  if (this->WriteError)
+  {
+    vtkErrorMacro("Stop: writing the session file failed, the recording is incomplete");
+  }
+
+  this->FrameRecords.clear();
+  this->ViewFrameRecords.clear();
+  this->PoseRecords.clear();
+  for (std::vector<QueuedFrame*>::iterator it = this->FreeBuffers.begin(); it != this->FreeBuffers.end(); ++it)
+  {
+    delete *it;
+  }
+  this->FreeBuffers.clear();
+  this->Modified();
+  return !this->WriteError;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::IsRecording() const
+{
+  return this->Recording;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::RecordFrame(vtkImageData* image, double timestamp)
+{
+  vtkDataArray* scalars = (image != nullptr ? image->GetPointData()->GetScalars() : nullptr);
+  if (!this->IsRecording() || scalars == nullptr)
+  {
+    return false;
+  }
+  double startTime = vtkTimerLog::GetUniversalTime();
+
+  int* dimensions = image->GetDimensions();
+  vtkTypeUInt64 frameSize = static_cast<vtkTypeUInt64>(scalars->GetNumberOfValues()) * scalars->GetDataTypeSize();
+  if (this->Header.FrameSize == 0)
+  {
+    this->Header.Dimensions[0] = dimensions[0];
+    this->Header.Dimensions[1] = dimensions[1];
+    this->Header.NumberOfScalarComponents = scalars->GetNumberOfComponents();
+    this->Header.ScalarType = scalars->GetDataType();
+    this->Header.FrameSize = frameSize;
+  }
+  if (dimensions[2] != 1 || dimensions[0] != this->Header.Dimensions[0] || dimensions[1] != this->Header.Dimensions[1]
+      || scalars->GetNumberOfComponents() != this->Header.NumberOfScalarComponents || scalars->GetDataType() != this->Header.ScalarType
+      || frameSize != this->Header.FrameSize)
+  {
+    ++this->NumberOfSkippedFrames;
+    return false;
+  }
+
+  // The image is overwritten by the next frame, copy it before queuing
+  QueuedFrame* frame = this->AcquireBuffer(static_cast<size_t>(frameSize));
+  frame->IsViewFrame = false;
+  frame->Timestamp = timestamp;
+  frame->VideoTimestamp = timestamp;
+  memcpy(&frame->Data[0], scalars->GetVoidPointer(0), static_cast<size_t>(frameSize));
+  bool queued = this->Enqueue(frame);
+
+  this->RecordCaptureTime(startTime);
+  return queued;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::RecordPose(vtkMatrix4x4* cameraToParent, double timestamp)
+{
+  if (!this->IsRecording() || cameraToParent == nullptr)
+  {
+    return false;
+  }
+
+  // Poses are small, they are never dropped and the writer thread takes them all at once
+  vtkTrackedScreenARSessionPoseRecord record;
+  record.Timestamp = timestamp;
+  vtkMatrix4x4::DeepCopy(record.Matrix, cameraToParent);
+  {
+    std::lock_guard<std::mutex> lock(this->QueueMutex);
+    this->PendingPoseRecords.push_back(record);
+  }
+  this->QueueCondition.notify_one();
+  ++this->NumberOfRecordedPoses;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::RecordViewFrame(vtkRenderWindow* renderWindow, double videoTimestamp,
+                                                         vtkMatrix4x4* presentedCameraToWorld, double timestamp)
+{
+  if (!this->IsRecording() || !this->RecordViewFrames || renderWindow == nullptr)
+  {
+    return false;
+  }
+  double startTime = vtkTimerLog::GetUniversalTime();
+
+  int* size = renderWindow->GetSize();
+  if (this->Header.ViewFrameSize == 0)
+  {
+    this->Header.ViewDimensions[0] = size[0];
+    this->Header.ViewDimensions[1] = size[1];
+    this->Header.ViewFrameSize = static_cast<vtkTypeUInt64>(size[0]) * size[1] * 3;
+  }
+  if (size[0] <= 0 || size[1] <= 0 || size[0] != this->Header.ViewDimensions[0] || size[1] != this->Header.ViewDimensions[1])
+  {
+    ++this->NumberOfSkippedFrames;
+    return false;
+  }
+
+  // Read the pixels straight into the queued buffer. The array is already of the requested
+  // size, so the render window does not reallocate it.
+  QueuedFrame* frame = this->AcquireBuffer(static_cast<size_t>(this->Header.ViewFrameSize));
+  this->ReadbackPixels->SetNumberOfComponents(3);
+  this->ReadbackPixels->SetVoidArray(&frame->Data[0], static_cast<vtkIdType>(this->Header.ViewFrameSize), 1);
+  // Front buffer: the frame that was just presented
+  int status = renderWindow->GetPixelData(0, 0, size[0] - 1, size[1] - 1, 1, this->ReadbackPixels);
+  this->ReadbackPixels->SetVoidArray(nullptr, 0, 1);
+  if (status != VTK_OK)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->QueueMutex);
+      this->FreeBuffers.push_back(frame);
+    }
+    ++this->NumberOfSkippedFrames;
+    return false;
+  }
+
+  frame->IsViewFrame = true;
+  frame->Timestamp = timestamp;
+  frame->VideoTimestamp = videoTimestamp;
+  if (presentedCameraToWorld != nullptr)
+  {
+    vtkMatrix4x4::DeepCopy(frame->Matrix, presentedCameraToWorld);
+  }
+  else
+  {
+    vtkMatrix4x4::Identity(frame->Matrix);
+  }
+  bool queued = this->Enqueue(frame);
+
+  this->RecordCaptureTime(startTime);
+  return queued;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetNumberOfRecordedFrames() const
+{
+  return this->NumberOfRecordedFrames;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetNumberOfRecordedViewFrames() const
+{
+  return this->NumberOfRecordedViewFrames;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetNumberOfRecordedPoses() const
+{
+  return this->NumberOfRecordedPoses;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetNumberOfSkippedFrames() const
+{
+  return this->NumberOfSkippedFrames;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetNumberOfDroppedFrames() const
+{
+  return this->NumberOfDroppedFrames;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetNumberOfDroppedViewFrames() const
+{
+  return this->NumberOfDroppedViewFrames;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARSessionRecorder::GetQueueSize()
+{
+  std::lock_guard<std::mutex> lock(this->QueueMutex);
+  return static_cast<int>(this->Queue.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARSessionRecorder::GetPeakQueueSize()
+{
+  std::lock_guard<std::mutex> lock(this->QueueMutex);
+  return this->PeakQueueSize;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetNumberOfBytesWritten() const
+{
+  return this->NumberOfBytesWritten;
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARSessionRecorder::GetMeanCaptureTime() const
+{
+  return (this->NumberOfCaptures > 0 ? this->TotalCaptureTime / this->NumberOfCaptures : 0.0);
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARSessionRecorder::GetMaximumCaptureTime() const
+{
+  return this->MaximumCaptureTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::OnVideoImageDataModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  if (this->IsRecording())
+  {
+    this->RecordFrame(this->VideoNode->GetImageData(), vtkTimerLog::GetUniversalTime());
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::OnCameraTransformModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  if (!this->IsRecording())
+  {
+    return;
+  }
+  // The player sets the recorded matrix as the transform to parent of the camera transform node
+  vtkNew<vtkMatrix4x4> cameraToParent;
+  this->CameraTransformNode->GetMatrixTransformToParent(cameraToParent.GetPointer());
+  this->RecordPose(cameraToParent.GetPointer(), vtkTimerLog::GetUniversalTime());
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSessionRecorder::QueuedFrame* vtkTrackedScreenARSessionRecorder::AcquireBuffer(size_t size)
+{
+  QueuedFrame* frame = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(this->QueueMutex);
+    if (!this->FreeBuffers.empty())
+    {
+      frame = this->FreeBuffers.back();
+      this->FreeBuffers.pop_back();
+    }
+  }
+  if (frame == nullptr)
+  {
+    frame = new QueuedFrame;
+  }
+  // Pooled buffers keep their capacity, no allocation once every buffer served a frame
+  frame->Data.resize(size);
+  return frame;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::Enqueue(QueuedFrame* frame)
+{
+  bool queued = true;
+  {
+    std::lock_guard<std::mutex> lock(this->QueueMutex);
+    if (static_cast<int>(this->Queue.size()) >= this->QueueCapacity)
+    {
+      // Never wait for the writer: give up a frame instead
+      QueuedFrame* dropped = frame;
+      if (this->DropPolicy == DropOldest)
+      {
+        dropped = this->Queue.front();
+        this->Queue.pop_front();
+      }
+      if (dropped->IsViewFrame)
+      {
+        ++this->NumberOfDroppedViewFrames;
+      }
+      else
+      {
+        ++this->NumberOfDroppedFrames;
+      }
+      this->FreeBuffers.push_back(dropped);
+      queued = (dropped != frame);
+    }
+    if (queued)
+    {
+      this->Queue.push_back(frame);
+      this->PeakQueueSize = std::max(this->PeakQueueSize, static_cast<int>(this->Queue.size()));
+    }
+  }
+  if (queued)
+  {
+    this->QueueCondition.notify_one();
+  }
+  return queued;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::RecordCaptureTime(double startTime)
+{
+  double captureTime = (vtkTimerLog::GetUniversalTime() - startTime) * 1000.0;
+  this->TotalCaptureTime += captureTime;
+  this->MaximumCaptureTime = std::max(this->MaximumCaptureTime, captureTime);
+  ++this->NumberOfCaptures;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARSessionRecorder::WriteQueuedFrames()
+{
+  // Swapped with the pending poses, both vectors keep their capacity
+  std::vector<vtkTrackedScreenARSessionPoseRecord> poses;
+  while (true)
+  {
+    QueuedFrame* frame = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(this->QueueMutex);
+      this->QueueCondition.wait(lock, [this]() { return !this->Queue.empty() || !this->PendingPoseRecords.empty() || this->StopRequested; });
+      if (this->Queue.empty() && this->PendingPoseRecords.empty())
+      {
+        return;
+      }
+      poses.swap(this->PendingPoseRecords);
+      if (!this->Queue.empty())
+      {
+        frame = this->Queue.front();
+        this->Queue.pop_front();
+      }
+    }
+
+    // After a write error the queue is still drained, so that recording never blocks
+    for (std::vector<vtkTrackedScreenARSessionPoseRecord>::iterator it = poses.begin(); it != poses.end(); ++it)
+    {
+      if (this->WriteChunk(TRACKEDSCREENAR_SESSION_POSE_CHUNK, &(*it), sizeof(*it), nullptr, 0))
+      {
+        this->PoseRecords.push_back(*it);
+      }
+    }
+    poses.clear();
+
+    if (frame != nullptr)
+    {
+      if (frame->IsViewFrame)
+      {
+        if (this->FileHeader.ViewFrameSize == 0)
+        {
+          this->FileHeader.ViewDimensions[0] = this->Header.ViewDimensions[0];
+          this->FileHeader.ViewDimensions[1] = this->Header.ViewDimensions[1];
+          this->FileHeader.ViewFrameSize = this->Header.ViewFrameSize;
+          this->WriteFileHeader();
+        }
+        vtkTrackedScreenARSessionViewFrameRecord record;
+        record.Timestamp = frame->Timestamp;
+        record.Offset = this->GetChunkDataOffset(sizeof(record));
+        record.VideoTimestamp = frame->VideoTimestamp;
+        std::copy(frame->Matrix, frame->Matrix + 16, record.Matrix);
+        if (this->WriteChunk(TRACKEDSCREENAR_SESSION_VIEW_FRAME_CHUNK, &record, sizeof(record), &frame->Data[0], frame->Data.size()))
+        {
+          this->ViewFrameRecords.push_back(record);
+          ++this->NumberOfRecordedViewFrames;
+        }
+      }
+      else
+      {
+        // The player needs the geometry to read the frames of a recording that is not stopped
+        if (this->FileHeader.FrameSize == 0)
+        {
+          this->FileHeader.Dimensions[0] = this->Header.Dimensions[0];
+          this->FileHeader.Dimensions[1] = this->Header.Dimensions[1];
+          this->FileHeader.NumberOfScalarComponents = this->Header.NumberOfScalarComponents;
+          this->FileHeader.ScalarType = this->Header.ScalarType;
+          this->FileHeader.FrameSize = this->Header.FrameSize;
+          this->WriteFileHeader();
+        }
+        vtkTrackedScreenARSessionFrameRecord record;
+        record.Timestamp = frame->Timestamp;
+        record.Offset = this->GetChunkDataOffset(sizeof(record));
+        if (this->WriteChunk(TRACKEDSCREENAR_SESSION_FRAME_CHUNK, &record, sizeof(record), &frame->Data[0], frame->Data.size()))
+        {
+          this->FrameRecords.push_back(record);
+          ++this->NumberOfRecordedFrames;
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(this->QueueMutex);
+      this->FreeBuffers.push_back(frame);
+    }
+
+    // Hand the written samples to the system, they survive the application
+    if (!this->WriteError && fflush(this->File) != 0)
+    {
+      this->WriteError = true;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkTrackedScreenARSessionRecorder::GetChunkDataOffset(size_t recordSize) const
+{
+  vtkTypeUInt64 recordEnd = this->WritePosition + sizeof(vtkTrackedScreenARSessionChunkHeader) + recordSize;
+  return (recordEnd + TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT - 1) / TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT * TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::WriteChunk(vtkTypeUInt32 type, const void* record, size_t recordSize, const void* data, vtkTypeUInt64 dataSize)
+{
+  vtkTrackedScreenARSessionChunkHeader chunk;
+  chunk.Type = type;
+  chunk.Reserved = 0;
+  chunk.DataSize = dataSize;
+  if (!this->Write(&chunk, sizeof(chunk)) || !this->Write(record, recordSize) || !this->WritePadding())
+  {
+    return false;
+  }
+  return (dataSize == 0 || (this->Write(data, dataSize) && this->WritePadding()));
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::WriteFileHeader()
+{
+  if (this->WriteError)
+  {
+    return false;
+  }
+  if (fseek(this->File, 0, SEEK_SET) != 0 || fwrite(&this->FileHeader, sizeof(this->FileHeader), 1, this->File) != 1
+      || fseek(this->File, 0, SEEK_END) != 0)
+  {
+    this->WriteError = true;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::Write(const void* data, vtkTypeUInt64 size)
+{
+  // Called from the writer thread, errors are reported by Start() and Stop()
+  if (this->WriteError)
+  {
+    return false;
+  }
+  if (size > 0 && fwrite(data, 1, static_cast<size_t>(size), this->File) != size)
+  {
+    this->WriteError = true;
+    return false;
+  }
+  this->WritePosition += size;
+  this->NumberOfBytesWritten += size;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARSessionRecorder::WritePadding()
+{
+  static const char zeros[TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT] = { 0 };
+  vtkTypeUInt64 padding = (TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT - this->WritePosition % TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT) % TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT;
+  return this->Write(zeros, padding);
+}
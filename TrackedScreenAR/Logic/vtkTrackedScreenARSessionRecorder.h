@@ -0,0 +1,253 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// .NAME vtkTrackedScreenARSessionRecorder - records video frames, tracker poses and the composited view to a session file
+// .SECTION Description
+// Observes a video volume and a tracked camera transform and records every frame and pose with
+// its arrival time, plus the composited frames of one AR view with the pose and video frame they
+// show, to a session file (see vtkTrackedScreenARSessionFormat.h). The raw frames and poses can be
+// replayed by vtkTrackedScreenARSessionPlayer without the camera and tracker. The camera parameters
+// are taken when the recording starts.
+//
+// Recording never waits for the disk: frames are copied into pooled buffers and handed to a
+// bounded queue, which a writer thread drains into the file. When the queue is full a frame is
+// dropped according to the drop policy and counted. Poses are handed to the writer thread too.
+// Each sample is written with its record as soon as the writer thread gets to it and the file is
+// flushed, so a recording that is never stopped can still be replayed up to its last written
+// sample. The time spent on the calling thread to capture a frame is measured.
+//
+// View frames are only recorded when RecordViewFrames is on. They are read back synchronously
+// with vtkRenderWindow::GetPixelData(), which stalls the render until the GPU finished the frame
+// and then copies it over the bus, so every recorded render takes longer and the capture time
+// statistics include that stall. They are stored as uncompressed RGB: about 6 MB per 1080p frame,
+// 180 MB/s at 30 Hz. Record the view only to review what was displayed, and only when the disk
+// keeps up, the dropped view frame count tells when it does not.
+//
+// The geometry of the video frames and of the view frames is fixed by the first recorded frame
+// of each, later frames of a different size or type are skipped and counted.
+
+#ifndef __vtkTrackedScreenARSessionRecorder_h
+#define __vtkTrackedScreenARSessionRecorder_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+#include "vtkTrackedScreenARSessionFormat.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkMRMLLinearTransformNode;
+class vtkMRMLPinholeCameraNode;
+class vtkMRMLVolumeNode;
+class vtkRenderWindow;
+class vtkUnsignedCharArray;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARSessionRecorder : public vtkObject
+{
+public:
+  static vtkTrackedScreenARSessionRecorder* New();
+  vtkTypeMacro(vtkTrackedScreenARSessionRecorder, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum DropPolicyType
+  {
+    /// A frame arriving while the queue is full is dropped
+    DropNewest,
+    /// The oldest queued frame is dropped to make room, the file keeps the most recent frames
+    DropOldest,
+    DropPolicy_Last
+  };
+
+  /// Video volume whose image frames are recorded
+  void SetVideoNode(vtkMRMLVolumeNode* node);
+  vtkMRMLVolumeNode* GetVideoNode();
+
+  /// Tracked camera transform whose poses (to parent) are recorded
+  void SetCameraTransformNode(vtkMRMLLinearTransformNode* node);
+  vtkMRMLLinearTransformNode* GetCameraTransformNode();
+
+  /// Camera parameters stored in the session header, zero if not set
+  void SetCameraParametersNode(vtkMRMLPinholeCameraNode* node);
+  vtkMRMLPinholeCameraNode* GetCameraParametersNode();
+
+  /// Number of frames (video and view) waiting for the writer thread before frames are dropped. 16 by default.
+  /// Takes effect on the next Start().
+  vtkSetClampMacro(MaximumQueueSize, int, 1, 1024);
+  vtkGetMacro(MaximumQueueSize, int);
+
+  /// What to drop when the queue is full, DropOldest by default
+  vtkSetClampMacro(DropPolicy, int, DropNewest, DropPolicy_Last - 1);
+  vtkGetMacro(DropPolicy, int);
+  static const char* GetDropPolicyAsString(int policy);
+
+  /// Read back and record the composited frames passed to RecordViewFrame(), off by default.
+  /// The readback stalls the render that is recorded, see the class description.
+  vtkSetMacro(RecordViewFrames, bool);
+  vtkGetMacro(RecordViewFrames, bool);
+  vtkBooleanMacro(RecordViewFrames, bool);
+
+  /// Create the session file and start the writer thread. Returns false if the file cannot be created.
+  bool Start(const std::string& fileName);
+
+  /// Let the writer thread write the queued frames, then write the tables and the final header and
+  /// close the file. Returns false if writing failed.
+  bool Stop();
+
+  bool IsRecording() const;
+
+  /// Record a video frame or a pose arrived at the given time. Called by the observers of the nodes,
+  /// public so sources that are not MRML nodes can be recorded too. The pose is the matrix to parent
+  /// of the camera transform node, which the player sets back on replay.
+  /// Return false if not recording or the sample was skipped or dropped.
+  bool RecordFrame(vtkImageData* image, double timestamp);
+  bool RecordPose(vtkMatrix4x4* cameraToParent, double timestamp);
+
+  /// Read back the frame just displayed by the render window and record it with the presented
+  /// camera pose and the acquisition time of the video frame in its background.
+  /// Returns false if not recording, RecordViewFrames is off or the frame was skipped or dropped.
+  bool RecordViewFrame(vtkRenderWindow* renderWindow, double videoTimestamp, vtkMatrix4x4* presentedCameraToWorld, double timestamp);
+
+  /// Frames written to the file, poses recorded, frames skipped because their geometry changed or
+  /// they could not be read back, and frames dropped because the queue was full, in the current or
+  /// last recording
+  vtkTypeUInt64 GetNumberOfRecordedFrames() const;
+  vtkTypeUInt64 GetNumberOfRecordedViewFrames() const;
+  vtkTypeUInt64 GetNumberOfRecordedPoses() const;
+  vtkTypeUInt64 GetNumberOfSkippedFrames() const;
+  vtkTypeUInt64 GetNumberOfDroppedFrames() const;
+  vtkTypeUInt64 GetNumberOfDroppedViewFrames() const;
+
+  /// Backpressure: frames currently queued, and the most ever queued at once
+  int GetQueueSize();
+  int GetPeakQueueSize();
+
+  /// Bytes written to the file so far
+  vtkTypeUInt64 GetNumberOfBytesWritten() const;
+
+  /// Time spent on the calling thread by RecordFrame() and RecordViewFrame(), in milliseconds
+  double GetMeanCaptureTime() const;
+  double GetMaximumCaptureTime() const;
+
+protected:
+  vtkTrackedScreenARSessionRecorder();
+  virtual ~vtkTrackedScreenARSessionRecorder();
+
+  struct QueuedFrame
+  {
+    bool IsViewFrame;
+    double Timestamp;
+    double VideoTimestamp;
+    double Matrix[16];
+    std::vector<unsigned char> Data;
+  };
+
+  void OnVideoImageDataModified(vtkObject* caller, unsigned long event, void* callData);
+  void OnCameraTransformModified(vtkObject* caller, unsigned long event, void* callData);
+
+  /// Buffer to fill with a frame of the given size, recycled from the pool if possible
+  QueuedFrame* AcquireBuffer(size_t size);
+
+  /// Hand a filled buffer to the writer thread, or drop a frame if the queue is full.
+  /// Returns false if the given frame was dropped.
+  bool Enqueue(QueuedFrame* frame);
+
+  void RecordCaptureTime(double startTime);
+
+  /// Writer thread: write queued frames and poses until stopped and the queue is empty
+  void WriteQueuedFrames();
+
+  /// Offset of the frame data of a chunk with a record of the given size written at the write position
+  vtkTypeUInt64 GetChunkDataOffset(size_t recordSize) const;
+
+  /// Write a chunk header, the record of a sample and its frame data, each padded. Returns false on error.
+  /// Called by the writer thread, virtual so tests can hold it back and fill the queue.
+  virtual bool WriteChunk(vtkTypeUInt32 type, const void* record, size_t recordSize, const void* data, vtkTypeUInt64 dataSize);
+
+  /// Rewrite the file header at the start of the file, then go back to the end. Returns false on error.
+  bool WriteFileHeader();
+
+  /// Write at the end of the file and advance the write position. Returns false on error.
+  bool Write(const void* data, vtkTypeUInt64 size);
+  bool WritePadding();
+
+protected:
+  vtkMRMLVolumeNode* VideoNode;
+  vtkMRMLLinearTransformNode* CameraTransformNode;
+  vtkMRMLPinholeCameraNode* CameraParametersNode;
+  unsigned long VideoNodeObserverTag;
+  unsigned long CameraTransformObserverTag;
+
+  int MaximumQueueSize;
+  int DropPolicy;
+  bool RecordViewFrames;
+
+  // Set by Start() before the writer thread starts, then only touched by the writer thread until it is joined
+  FILE* File;
+  vtkTypeUInt64 WritePosition;
+  vtkTrackedScreenARSessionHeader FileHeader;
+  std::vector<vtkTrackedScreenARSessionFrameRecord> FrameRecords;
+  std::vector<vtkTrackedScreenARSessionPoseRecord> PoseRecords;
+  std::vector<vtkTrackedScreenARSessionViewFrameRecord> ViewFrameRecords;
+
+  // Owned by the recording thread. The frame geometry is set once, before the first frame of each
+  // kind is queued, and read by the writer thread after it took that frame.
+  vtkTrackedScreenARSessionHeader Header;
+  vtkUnsignedCharArray* ReadbackPixels;
+  int QueueCapacity;
+  double TotalCaptureTime;
+  double MaximumCaptureTime;
+  vtkTypeUInt64 NumberOfCaptures;
+
+  // Shared with the writer thread, guarded by QueueMutex
+  std::thread WriterThread;
+  std::mutex QueueMutex;
+  std::condition_variable QueueCondition;
+  std::deque<QueuedFrame*> Queue;
+  std::vector<vtkTrackedScreenARSessionPoseRecord> PendingPoseRecords;
+  std::vector<QueuedFrame*> FreeBuffers;
+  int PeakQueueSize;
+  bool StopRequested;
+
+  std::atomic<bool> Recording;
+  std::atomic<bool> WriteError;
+  std::atomic<vtkTypeUInt64> NumberOfRecordedFrames;
+  std::atomic<vtkTypeUInt64> NumberOfRecordedViewFrames;
+  std::atomic<vtkTypeUInt64> NumberOfRecordedPoses;
+  std::atomic<vtkTypeUInt64> NumberOfSkippedFrames;
+  std::atomic<vtkTypeUInt64> NumberOfDroppedFrames;
+  std::atomic<vtkTypeUInt64> NumberOfDroppedViewFrames;
+  std::atomic<vtkTypeUInt64> NumberOfBytesWritten;
+
+private:
+  vtkTrackedScreenARSessionRecorder(const vtkTrackedScreenARSessionRecorder&); // Not implemented
+  void operator=(const vtkTrackedScreenARSessionRecorder&); // Not implemented
+};
+
+#endif
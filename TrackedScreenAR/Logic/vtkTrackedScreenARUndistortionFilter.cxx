@@ -0,0 +1,365 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARUndistortionFilter.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Bilinear weights are stored with 8 fractional bits
+  const int WEIGHT_BITS = 8;
+  const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+  //----------------------------------------------------------------------------
+  struct RemapTableBuilder
+  {
+    const double* Intrinsics;
+    const double* Coefficients;
+    int Width;
+    int Height;
+    int* SourceIndex;
+    unsigned char* WeightX;
+    unsigned char* WeightY;
+
+    void operator()(vtkIdType beginRow, vtkIdType endRow) const
+    {
+      const double fx = this->Intrinsics[0];
+      const double fy = this->Intrinsics[1];
+      const double cx = this->Intrinsics[2];
+      const double cy = this->Intrinsics[3];
+      const double k1 = this->Coefficients[0];
+      const double k2 = this->Coefficients[1];
+      const double p1 = this->Coefficients[2];
+      const double p2 = this->Coefficients[3];
+      const double k3 = this->Coefficients[4];
+
+      for (vtkIdType row = beginRow; row < endRow; ++row)
+      {
+        const double y = (row - cy) / fy;
+        vtkIdType entry = row * this->Width;
+        for (int column = 0; column < this->Width; ++column, ++entry)
+        {
+          // Project the ideal pinhole ray through the lens model to find where it landed on the sensor
+          const double x = (column - cx) / fx;
+          const double r2 = x * x + y * y;
+          const double radial = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+          const double xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+          const double yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+          double sourceX = fx * xd + cx;
+          double sourceY = fy * yd + cy;
+
+          // Positions within half a pixel of the border are clamped onto it
+          if (!(sourceX >= -0.5 && sourceX < this->Width - 0.5 && sourceY >= -0.5 && sourceY < this->Height - 0.5))
+          {
+            this->SourceIndex[entry] = -1;
+            this->WeightX[entry] = 0;
+            this->WeightY[entry] = 0;
+            continue;
+          }
+
+          // Round to fixed point before splitting, so a position just below a pixel center snaps onto it
+          int fixedX = std::max(0, static_cast<int>(floor(sourceX * WEIGHT_ONE + 0.5)));
+          int fixedY = std::max(0, static_cast<int>(floor(sourceY * WEIGHT_ONE + 0.5)));
+          int x0 = fixedX >> WEIGHT_BITS;
+          int y0 = fixedY >> WEIGHT_BITS;
+          int wx = fixedX & (WEIGHT_ONE - 1);
+          int wy = fixedY & (WEIGHT_ONE - 1);
+
+          // Keep the 2x2 neighborhood inside the image, the last row/column is taken from the previous one at full weight
+          if (x0 > this->Width - 2)
+          {
+            x0 = std::max(0, this->Width - 2);
+            wx = WEIGHT_ONE - 1;
+          }
+          if (y0 > this->Height - 2)
+          {
+            y0 = std::max(0, this->Height - 2);
+            wy = WEIGHT_ONE - 1;
+          }
+          this->SourceIndex[entry] = y0 * this->Width + x0;
+          this->WeightX[entry] = static_cast<unsigned char>(wx);
+          this->WeightY[entry] = static_cast<unsigned char>(wy);
+        }
+      }
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  // Generic bilinear gather, used for scalar types other than unsigned char
+  template <class T>
+  struct RemapFunctor
+  {
+    const T* Input;
+    T* Output;
+    int Width;
+    int Height;
+    int NumberOfComponents;
+    const int* SourceIndex;
+    const unsigned char* WeightX;
+    const unsigned char* WeightY;
+
+    void operator()(vtkIdType beginRow, vtkIdType endRow) const
+    {
+      const int nc = this->NumberOfComponents;
+      const vtkIdType rowStride = static_cast<vtkIdType>(this->Width) * nc;
+      for (vtkIdType entry = beginRow * this->Width; entry < endRow * this->Width; ++entry)
+      {
+        T* out = this->Output + entry * nc;
+        const int index = this->SourceIndex[entry];
+        if (index < 0)
+        {
+          std::fill(out, out + nc, static_cast<T>(0));
+          continue;
+        }
+        const double wx = this->WeightX[entry] / static_cast<double>(WEIGHT_ONE);
+        const double wy = this->WeightY[entry] / static_cast<double>(WEIGHT_ONE);
+        const T* a = this->Input + static_cast<vtkIdType>(index) * nc;
+        const T* c = a + rowStride;
+        for (int component = 0; component < nc; ++component)
+        {
+          double top = a[component] + wx * (a[component + nc] - a[component]);
+          double bottom = c[component] + wx * (c[component + nc] - c[component]);
+          out[component] = static_cast<T>(top + wy * (bottom - top));
+        }
+      }
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  // Video frames are 8-bit: fixed-point weights keep the inner loop in integer arithmetic.
+  // The component loop has a compile-time trip count so the compiler can unroll and vectorize it.
+  template <int NC>
+  struct RemapUnsignedCharFunctor
+  {
+    const unsigned char* Input;
+    unsigned char* Output;
+    int Width;
+    const int* SourceIndex;
+    const unsigned char* WeightX;
+    const unsigned char* WeightY;
+
+    void operator()(vtkIdType beginRow, vtkIdType endRow) const
+    {
+      const vtkIdType rowStride = static_cast<vtkIdType>(this->Width) * NC;
+      const vtkIdType endEntry = endRow * this->Width;
+      for (vtkIdType entry = beginRow * this->Width; entry < endEntry; ++entry)
+      {
+        unsigned char* out = this->Output + entry * NC;
+        const int index = this->SourceIndex[entry];
+        if (index < 0)
+        {
+          for (int component = 0; component < NC; ++component)
+          {
+            out[component] = 0;
+          }
+          continue;
+        }
+        const unsigned int wx1 = this->WeightX[entry];
+        const unsigned int wx0 = WEIGHT_ONE - wx1;
+        const unsigned int wy1 = this->WeightY[entry];
+        const unsigned int wy0 = WEIGHT_ONE - wy1;
+        const unsigned char* a = this->Input + static_cast<vtkIdType>(index) * NC;
+        const unsigned char* c = a + rowStride;
+        for (int component = 0; component < NC; ++component)
+        {
+          unsigned int top = a[component] * wx0 + a[component + NC] * wx1;
+          unsigned int bottom = c[component] * wx0 + c[component + NC] * wx1;
+          out[component] = static_cast<unsigned char>((top * wy0 + bottom * wy1 + (1u << (2 * WEIGHT_BITS - 1))) >> (2 * WEIGHT_BITS));
+        }
+      }
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  template <int NC>
+  void RemapUnsignedChar(const unsigned char* input, unsigned char* output, int width, int height,
+                         const int* sourceIndex, const unsigned char* weightX, const unsigned char* weightY)
+  {
+    RemapUnsignedCharFunctor<NC> functor = { input, output, width, sourceIndex, weightX, weightY };
+    vtkSMPTools::For(0, height, functor);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARUndistortionFilter);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARUndistortionFilter::vtkTrackedScreenARUndistortionFilter()
+  : Enabled(true)
+  , RemapTableBuildCount(0)
+{
+  std::fill(this->Intrinsics, this->Intrinsics + 4, 0.0);
+  std::fill(this->DistortionCoefficients, this->DistortionCoefficients + 5, 0.0);
+  std::fill(this->TableIntrinsics, this->TableIntrinsics + 4, 0.0);
+  std::fill(this->TableDistortionCoefficients, this->TableDistortionCoefficients + 5, 0.0);
+  this->TableSize[0] = this->TableSize[1] = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARUndistortionFilter::~vtkTrackedScreenARUndistortionFilter()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARUndistortionFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Enabled: " << (this->Enabled ? "true" : "false") << std::endl;
+  os << indent << "Intrinsics: " << this->Intrinsics[0] << " " << this->Intrinsics[1] << " "
+     << this->Intrinsics[2] << " " << this->Intrinsics[3] << std::endl;
+  os << indent << "DistortionCoefficients:";
+  for (int i = 0; i < 5; ++i)
+  {
+    os << " " << this->DistortionCoefficients[i];
+  }
+  os << std::endl;
+  os << indent << "RemapTableSize: " << this->TableSize[0] << "x" << this->TableSize[1] << std::endl;
+  os << indent << "RemapTableBuildCount: " << this->RemapTableBuildCount << std::endl;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARUndistortionFilter::IsDistortionActive()
+{
+  if (!this->Enabled || this->Intrinsics[0] <= 0.0 || this->Intrinsics[1] <= 0.0)
+  {
+    return false;
+  }
+  for (int i = 0; i < 5; ++i)
+  {
+    if (this->DistortionCoefficients[i] != 0.0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARUndistortionFilter::UpdateRemapTable(int width, int height)
+{
+  if (width == this->TableSize[0] && height == this->TableSize[1]
+      && std::equal(this->Intrinsics, this->Intrinsics + 4, this->TableIntrinsics)
+      && std::equal(this->DistortionCoefficients, this->DistortionCoefficients + 5, this->TableDistortionCoefficients))
+  {
+    return;
+  }
+
+  size_t numberOfPixels = static_cast<size_t>(width) * height;
+  this->SourceIndex.resize(numberOfPixels);
+  this->WeightX.resize(numberOfPixels);
+  this->WeightY.resize(numberOfPixels);
+
+  RemapTableBuilder builder = { this->Intrinsics, this->DistortionCoefficients, width, height,
+                                this->SourceIndex.data(), this->WeightX.data(), this->WeightY.data() };
+  vtkSMPTools::For(0, height, builder);
+
+  std::copy(this->Intrinsics, this->Intrinsics + 4, this->TableIntrinsics);
+  std::copy(this->DistortionCoefficients, this->DistortionCoefficients + 5, this->TableDistortionCoefficients);
+  this->TableSize[0] = width;
+  this->TableSize[1] = height;
+  ++this->RemapTableBuildCount;
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARUndistortionFilter::RequestData(vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector,
+    vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkImageData* output = vtkImageData::GetData(outputVector);
+  if (input == nullptr || output == nullptr)
+  {
+    return 0;
+  }
+
+  int* dimensions = input->GetDimensions();
+  if (!this->IsDistortionActive() || input->GetPointData()->GetScalars() == nullptr
+      || dimensions[0] < 2 || dimensions[1] < 2 || dimensions[2] != 1)
+  {
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  const int width = dimensions[0];
+  const int height = dimensions[1];
+  this->UpdateRemapTable(width, height);
+
+  // AllocateScalars reuses the output array while type and size are unchanged, so steady state does not allocate
+  const int numberOfComponents = input->GetNumberOfScalarComponents();
+  output->CopyStructure(input);
+  output->AllocateScalars(input->GetScalarType(), numberOfComponents);
+
+  void* inPtr = input->GetScalarPointer();
+  void* outPtr = output->GetScalarPointer();
+  const int* sourceIndex = this->SourceIndex.data();
+  const unsigned char* weightX = this->WeightX.data();
+  const unsigned char* weightY = this->WeightY.data();
+
+  if (input->GetScalarType() == VTK_UNSIGNED_CHAR && numberOfComponents >= 1 && numberOfComponents <= 4)
+  {
+    const unsigned char* in = static_cast<const unsigned char*>(inPtr);
+    unsigned char* out = static_cast<unsigned char*>(outPtr);
+    switch (numberOfComponents)
+    {
+      case 1:
+        RemapUnsignedChar<1>(in, out, width, height, sourceIndex, weightX, weightY);
+        break;
+      case 2:
+        RemapUnsignedChar<2>(in, out, width, height, sourceIndex, weightX, weightY);
+        break;
+      case 3:
+        RemapUnsignedChar<3>(in, out, width, height, sourceIndex, weightX, weightY);
+        break;
+      default:
+        RemapUnsignedChar<4>(in, out, width, height, sourceIndex, weightX, weightY);
+        break;
+    }
+    return 1;
+  }
+
+  switch (input->GetScalarType())
+  {
+    vtkTemplateMacro(
+      RemapFunctor<VTK_TT> functor;
+      functor.Input = static_cast<const VTK_TT*>(inPtr);
+      functor.Output = static_cast<VTK_TT*>(outPtr);
+      functor.Width = width;
+      functor.Height = height;
+      functor.NumberOfComponents = numberOfComponents;
+      functor.SourceIndex = sourceIndex;
+      functor.WeightX = weightX;
+      functor.WeightY = weightY;
+      vtkSMPTools::For(0, height, functor));
+    default:
+      vtkErrorMacro("RequestData: unsupported scalar type " << input->GetScalarTypeAsString());
+      return 0;
+  }
+
+  return 1;
+}
@@ -0,0 +1,99 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARUndistortionFilter - removes lens distortion from video frames
+// .SECTION Description
+// Resamples a video frame so that it matches an ideal pinhole camera with the same
+// intrinsics, using the OpenCV radial/tangential model (k1, k2, p1, p2, k3).
+// For every output pixel the source position and bilinear weights are computed once
+// and stored in a remap table, which is only rebuilt when the intrinsics, distortion
+// coefficients or image size change. Each frame then costs one table-driven bilinear
+// gather, split across cores with vtkSMPTools.
+//
+// Image rows are assumed to be stored in the same order as the calibration images.
+// If the filter is disabled or all coefficients are zero, the input is passed through
+// without copying.
+
+#ifndef __vtkTrackedScreenARUndistortionFilter_h
+#define __vtkTrackedScreenARUndistortionFilter_h
+
+// VTK includes
+#include <vtkImageAlgorithm.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARUndistortionFilter : public vtkImageAlgorithm
+{
+public:
+  static vtkTrackedScreenARUndistortionFilter* New();
+  vtkTypeMacro(vtkTrackedScreenARUndistortionFilter, vtkImageAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Pinhole intrinsics, in image pixels
+  vtkSetVector4Macro(Intrinsics, double);
+  vtkGetVector4Macro(Intrinsics, double);
+
+  /// Distortion coefficients k1, k2, p1, p2, k3
+  vtkSetVectorMacro(DistortionCoefficients, double, 5);
+  vtkGetVectorMacro(DistortionCoefficients, double, 5);
+
+  /// If off, the input is passed through unchanged
+  vtkSetMacro(Enabled, bool);
+  vtkGetMacro(Enabled, bool);
+  vtkBooleanMacro(Enabled, bool);
+
+  /// True if the current parameters actually change the image
+  bool IsDistortionActive();
+
+  /// Number of times the remap table was built, for profiling
+  vtkGetMacro(RemapTableBuildCount, unsigned long);
+
+protected:
+  vtkTrackedScreenARUndistortionFilter();
+  virtual ~vtkTrackedScreenARUndistortionFilter();
+
+  virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+
+  /// Rebuild the remap table if any parameter changed since it was built
+  void UpdateRemapTable(int width, int height);
+
+protected:
+  double Intrinsics[4];
+  double DistortionCoefficients[5];
+  bool Enabled;
+
+  // Remap table: index of the top-left source pixel (-1 if outside the image) and 8-bit bilinear weights
+  std::vector<int> SourceIndex;
+  std::vector<unsigned char> WeightX;
+  std::vector<unsigned char> WeightY;
+
+  // Parameters the remap table was built for
+  double TableIntrinsics[4];
+  double TableDistortionCoefficients[5];
+  int TableSize[2];
+  unsigned long RemapTableBuildCount;
+
+private:
+  vtkTrackedScreenARUndistortionFilter(const vtkTrackedScreenARUndistortionFilter&); // Not implemented
+  void operator=(const vtkTrackedScreenARUndistortionFilter&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,282 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARVideoSource.h"
+#include "vtkTrackedScreenARDownscaleFilter.h"
+#include "vtkTrackedScreenARFrameExchange.h"
+#include "vtkTrackedScreenARPixelFormatConverter.h"
+#include "vtkTrackedScreenARUndistortionFilter.h"
+
+// Telemetry includes
+#include <vtkAugmentedRealityTelemetry.h>
+
+// MRML includes
+#include <vtkMRMLVolumeNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARVideoSource);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARVideoSource::vtkTrackedScreenARVideoSource()
+  : VideoSourceNode(nullptr)
+  , FrameExchange(vtkTrackedScreenARFrameExchange::New())
+  , PixelFormatConverter(vtkTrackedScreenARPixelFormatConverter::New())
+  , DownscaleFilter(vtkTrackedScreenARDownscaleFilter::New())
+  , UndistortionFilter(vtkTrackedScreenARUndistortionFilter::New())
+  , Frame(vtkImageData::New())
+  , AcquisitionDelay(0.0)
+  , FrameTimestamp(-1.0)
+  , PipelineCallback(vtkCallbackCommand::New())
+  , PipelineStartTelemetryTime(-1.0)
+{
+  this->InputDimensions[0] = 0;
+  this->InputDimensions[1] = 0;
+  std::fill(this->LensIntrinsics, this->LensIntrinsics + 4, 0.0);
+  std::fill(this->LensDistortionCoefficients, this->LensDistortionCoefficients + 5, 0.0);
+
+  // The pipeline always reads the same image object, frames are swapped into it by shallow copy.
+  // Shrink before undistorting, so the remap also runs on the smaller frame.
+  this->PixelFormatConverter->SetInputDataObject(this->Frame);
+  this->DownscaleFilter->SetInputConnection(this->PixelFormatConverter->GetOutputPort());
+  this->UndistortionFilter->SetInputConnection(this->DownscaleFilter->GetOutputPort());
+
+  // Upstream stages only run when their input changed, the run starts with the first stage that does
+  this->PipelineCallback->SetClientData(this);
+  this->PipelineCallback->SetCallback(vtkTrackedScreenARVideoSource::OnPipelineEvent);
+  this->PixelFormatConverter->AddObserver(vtkCommand::StartEvent, this->PipelineCallback);
+  this->DownscaleFilter->AddObserver(vtkCommand::StartEvent, this->PipelineCallback);
+  this->UndistortionFilter->AddObserver(vtkCommand::StartEvent, this->PipelineCallback);
+  this->UndistortionFilter->AddObserver(vtkCommand::EndEvent, this->PipelineCallback);
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARVideoSource::~vtkTrackedScreenARVideoSource()
+{
+  this->PixelFormatConverter->RemoveObserver(this->PipelineCallback);
+  this->DownscaleFilter->RemoveObserver(this->PipelineCallback);
+  this->UndistortionFilter->RemoveObserver(this->PipelineCallback);
+  this->PipelineCallback->Delete();
+  this->PipelineCallback = nullptr;
+  this->FrameExchange->Delete();
+  this->FrameExchange = nullptr;
+  this->PixelFormatConverter->Delete();
+  this->PixelFormatConverter = nullptr;
+  this->DownscaleFilter->Delete();
+  this->DownscaleFilter = nullptr;
+  this->UndistortionFilter->Delete();
+  this->UndistortionFilter = nullptr;
+  this->Frame->Delete();
+  this->Frame = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARVideoSource::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "VideoSourceNodeID: " << this->VideoSourceNodeID << std::endl;
+  os << indent << "InputDimensions: " << this->InputDimensions[0] << " " << this->InputDimensions[1] << std::endl;
+  os << indent << "AcquisitionDelay: " << this->AcquisitionDelay << std::endl;
+  os << indent << "FrameTimestamp: " << this->FrameTimestamp << std::endl;
+  os << indent << "FrameExchange:" << std::endl;
+  this->FrameExchange->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "PixelFormatConverter:" << std::endl;
+  this->PixelFormatConverter->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "DownscaleFilter:" << std::endl;
+  this->DownscaleFilter->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "UndistortionFilter:" << std::endl;
+  this->UndistortionFilter->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkTrackedScreenARVideoSource::GetVideoSourceNodeID() const
+{
+  return this->VideoSourceNodeID;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARVideoSource::SetVideoSourceNodeID(const std::string& nodeID)
+{
+  if (nodeID == this->VideoSourceNodeID)
+  {
+    return;
+  }
+  this->VideoSourceNodeID = nodeID;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLVolumeNode* vtkTrackedScreenARVideoSource::GetVideoSourceNode()
+{
+  return this->VideoSourceNode;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkTrackedScreenARVideoSource::GetInputImage()
+{
+  return (this->VideoSourceNode != nullptr ? this->VideoSourceNode->GetImageData() : nullptr);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARVideoSource::PushFrame(vtkImageData* image, double arrivalTime)
+{
+  if (!this->FrameExchange->ShareFrame(image, arrivalTime - this->AcquisitionDelay))
+  {
+    return false;
+  }
+  int* dimensions = image->GetDimensions();
+  this->InputDimensions[0] = dimensions[0];
+  this->InputDimensions[1] = dimensions[1];
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARVideoSource::AcquireFrame()
+{
+  if (!this->FrameExchange->AcquireLatestFrame())
+  {
+    return false;
+  }
+
+  // No pixel copy: the pipeline reads the exchange slot until the next frame is acquired.
+  // The producer allocates fresh scalars instead of overwriting a slot still referenced downstream.
+  this->Frame->ShallowCopy(this->FrameExchange->GetReadFrame());
+  this->FrameTimestamp = this->FrameExchange->GetReadFrameTimestamp();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkAlgorithmOutput* vtkTrackedScreenARVideoSource::GetOutputPort()
+{
+  return this->UndistortionFilter->GetOutputPort();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARVideoSource::GetFrameSize(int frameSize[2])
+{
+  if (this->InputDimensions[0] <= 0 || this->InputDimensions[1] <= 0)
+  {
+    return false;
+  }
+  vtkTrackedScreenARPixelFormatConverter::ComputeFrameSize(this->PixelFormatConverter->GetPixelFormat(), this->InputDimensions, frameSize);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARVideoSource::SetLensParameters(const double intrinsics[4], const double distortionCoefficients[5])
+{
+  std::copy(intrinsics, intrinsics + 4, this->LensIntrinsics);
+  std::copy(distortionCoefficients, distortionCoefficients + 5, this->LensDistortionCoefficients);
+  return this->UpdateUndistortionParameters();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARVideoSource::SetShrinkFactor(int shrinkFactor)
+{
+  vtkMTimeType downscaleMTime = this->DownscaleFilter->GetMTime();
+  this->DownscaleFilter->SetShrinkFactor(shrinkFactor);
+  bool undistortionChanged = this->UpdateUndistortionParameters();
+  return this->DownscaleFilter->GetMTime() > downscaleMTime || undistortionChanged;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARVideoSource::UpdateUndistortionParameters()
+{
+  vtkMTimeType undistortionMTime = this->UndistortionFilter->GetMTime();
+
+  double shrunkIntrinsics[4];
+  vtkTrackedScreenARDownscaleFilter::ShrinkIntrinsics(this->LensIntrinsics, this->DownscaleFilter->GetShrinkFactor(), shrunkIntrinsics);
+  this->UndistortionFilter->SetIntrinsics(shrunkIntrinsics);
+  this->UndistortionFilter->SetDistortionCoefficients(this->LensDistortionCoefficients);
+
+  return this->UndistortionFilter->GetMTime() > undistortionMTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARVideoSource::SetTelemetry(vtkAugmentedRealityTelemetry* telemetry)
+{
+  if (telemetry == this->Telemetry)
+  {
+    return;
+  }
+  this->Telemetry = telemetry;
+  this->PipelineStartTelemetryTime = -1.0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkAugmentedRealityTelemetry* vtkTrackedScreenARVideoSource::GetTelemetry()
+{
+  return this->Telemetry;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARVideoSource::OnPipelineEvent(vtkObject* caller, unsigned long event, void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTrackedScreenARVideoSource* self = static_cast<vtkTrackedScreenARVideoSource*>(clientData);
+  if (self->Telemetry == nullptr || !self->Telemetry->GetEnabled())
+  {
+    self->PipelineStartTelemetryTime = -1.0;
+    return;
+  }
+
+  if (event == vtkCommand::StartEvent)
+  {
+    if (self->PipelineStartTelemetryTime < 0.0)
+    {
+      self->PipelineStartTelemetryTime = self->Telemetry->GetTime();
+    }
+  }
+  else if (event == vtkCommand::EndEvent && caller == self->UndistortionFilter && self->PipelineStartTelemetryTime >= 0.0)
+  {
+    self->Telemetry->RecordEvent(vtkAugmentedRealityTelemetry::PixelConversion, self->PipelineStartTelemetryTime, self->Telemetry->GetTime());
+    self->PipelineStartTelemetryTime = -1.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARFrameExchange* vtkTrackedScreenARVideoSource::GetFrameExchange()
+{
+  return this->FrameExchange;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPixelFormatConverter* vtkTrackedScreenARVideoSource::GetPixelFormatConverter()
+{
+  return this->PixelFormatConverter;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARDownscaleFilter* vtkTrackedScreenARVideoSource::GetDownscaleFilter()
+{
+  return this->DownscaleFilter;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARUndistortionFilter* vtkTrackedScreenARVideoSource::GetUndistortionFilter()
+{
+  return this->UndistortionFilter;
+}
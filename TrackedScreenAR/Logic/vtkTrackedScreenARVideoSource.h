@@ -0,0 +1,155 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARVideoSource - video pipeline of one video volume, shared by the views showing it
+// .SECTION Description
+// Takes frames from a video volume image through a vtkTrackedScreenARFrameExchange and runs
+// them through pixel format conversion, downscaling and lens undistortion. Every 3D view
+// bound to the same video volume connects its background texture to the same output port,
+// so each frame is converted and undistorted once whatever the number of views.
+// The pipeline runs when the first texture pulls its output during a render, the time it
+// takes is recorded there as the pixel conversion stage of the telemetry.
+//
+// Instances are created and owned by vtkSlicerTrackedScreenARLogic, which observes the
+// video volume node and pushes the frames of its image.
+
+#ifndef __vtkTrackedScreenARVideoSource_h
+#define __vtkTrackedScreenARVideoSource_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <string>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkAlgorithmOutput;
+class vtkAugmentedRealityTelemetry;
+class vtkCallbackCommand;
+class vtkImageData;
+class vtkMRMLVolumeNode;
+class vtkTrackedScreenARDownscaleFilter;
+class vtkTrackedScreenARFrameExchange;
+class vtkTrackedScreenARPixelFormatConverter;
+class vtkTrackedScreenARUndistortionFilter;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARVideoSource : public vtkObject
+{
+public:
+  static vtkTrackedScreenARVideoSource* New();
+  vtkTypeMacro(vtkTrackedScreenARVideoSource, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// ID of the video volume node the frames come from
+  const std::string& GetVideoSourceNodeID() const;
+  void SetVideoSourceNodeID(const std::string& nodeID);
+
+  /// Video volume node the frames come from, observed by the logic
+  vtkMRMLVolumeNode* GetVideoSourceNode();
+
+  /// Current image of the video volume node, which may be set after the node was bound
+  vtkImageData* GetInputImage();
+
+  /// Publish a new frame arrived at the given time (vtkTimerLog::GetUniversalTime clock) to the
+  /// frame exchange. Must be called on the thread the views render on, as the logic does from its
+  /// node observers: the frame shares the image scalars instead of copying them (see
+  /// vtkTrackedScreenARFrameExchange::ShareFrame). Returns false if there is no image or it has no scalars.
+  bool PushFrame(vtkImageData* image, double arrivalTime);
+
+  /// Feed the newest exchanged frame to the pipeline. Returns false if there was none.
+  bool AcquireFrame();
+
+  /// Port the background textures connect to
+  vtkAlgorithmOutput* GetOutputPort();
+
+  /// Size of the frame held by the most recently pushed image, which differs from the image
+  /// dimensions for planar pixel formats. Returns false if no frame was pushed.
+  bool GetFrameSize(int frameSize[2]);
+
+  /// Delay in seconds between acquisition of a video frame and its arrival in the scene
+  vtkSetMacro(AcquisitionDelay, double);
+  vtkGetMacro(AcquisitionDelay, double);
+
+  /// Acquisition time of the frame in the pipeline (same clock as vtkTimerLog::GetUniversalTime),
+  /// negative if no frame was acquired yet
+  vtkGetMacro(FrameTimestamp, double);
+
+  /// Lens intrinsics (fx, fy, cx, cy) and distortion coefficients (k1, k2, p1, p2, k3) of the
+  /// full-resolution video frame. Returns true if the pipeline changed.
+  bool SetLensParameters(const double intrinsics[4], const double distortionCoefficients[5]);
+
+  /// Set the downscale factor and give the undistortion stage the intrinsics of the frames it
+  /// actually receives. Returns true if the pipeline changed.
+  bool SetShrinkFactor(int shrinkFactor);
+
+  /// Telemetry the runs of the pipeline are recorded in, as the pixel conversion stage
+  void SetTelemetry(vtkAugmentedRealityTelemetry* telemetry);
+  vtkAugmentedRealityTelemetry* GetTelemetry();
+
+  /// Pipeline stages
+  vtkTrackedScreenARFrameExchange* GetFrameExchange();
+  vtkTrackedScreenARPixelFormatConverter* GetPixelFormatConverter();
+  vtkTrackedScreenARDownscaleFilter* GetDownscaleFilter();
+  vtkTrackedScreenARUndistortionFilter* GetUndistortionFilter();
+
+protected:
+  vtkTrackedScreenARVideoSource();
+  virtual ~vtkTrackedScreenARVideoSource();
+
+  bool UpdateUndistortionParameters();
+
+  /// Start and end events of the pipeline stages
+  static void OnPipelineEvent(vtkObject* caller, unsigned long event, void* clientData, void* callData);
+
+protected:
+  std::string VideoSourceNodeID;
+
+  // Registered and observed by the logic
+  vtkMRMLVolumeNode* VideoSourceNode;
+
+  vtkTrackedScreenARFrameExchange* FrameExchange;
+  vtkTrackedScreenARPixelFormatConverter* PixelFormatConverter;
+  vtkTrackedScreenARDownscaleFilter* DownscaleFilter;
+  vtkTrackedScreenARUndistortionFilter* UndistortionFilter;
+
+  // Stable input of the pipeline, shallow copy of the frame taken from the exchange
+  vtkImageData* Frame;
+  // Dimensions of the most recently pushed image, 0 before the first frame
+  int InputDimensions[2];
+
+  double AcquisitionDelay;
+  double FrameTimestamp;
+
+  double LensIntrinsics[4];
+  double LensDistortionCoefficients[5];
+
+  vtkSmartPointer<vtkAugmentedRealityTelemetry> Telemetry;
+  vtkCallbackCommand* PipelineCallback;
+  // Telemetry time the first stage of the current pipeline run started, negative outside runs
+  double PipelineStartTelemetryTime;
+
+  friend class vtkSlicerTrackedScreenARLogic;
+
+private:
+  vtkTrackedScreenARVideoSource(const vtkTrackedScreenARVideoSource&); // Not implemented
+  void operator=(const vtkTrackedScreenARVideoSource&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,393 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARViewBinding.h"
+#include "vtkTrackedScreenARFramePacer.h"
+#include "vtkTrackedScreenARLatencyMonitor.h"
+#include "vtkTrackedScreenARPoseBuffer.h"
+#include "vtkTrackedScreenARPosePredictor.h"
+#include "vtkTrackedScreenARProjection.h"
+#include "vtkTrackedScreenARQualityGovernor.h"
+#include "vtkTrackedScreenARRigidTransform.h"
+#include "vtkTrackedScreenARSceneLayerPass.h"
+#include "vtkTrackedScreenARVideoSource.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLTransformNode.h>
+
+// Video cameras include
+#include <vtkMRMLPinholeCameraNode.h>
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkRenderWindow.h>
+#include <vtkTexture.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTrackedScreenARViewBinding);
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARViewBinding::vtkTrackedScreenARViewBinding()
+  : VideoSource(nullptr)
+  , VideoSourceConflicts(0)
+  , CameraParametersNode(nullptr)
+  , CameraTransformNode(nullptr)
+  , CameraParentTransformNode(nullptr)
+  , RenderWindow(nullptr)
+  , BackgroundTexture(vtkTexture::New())
+  , CameraParentToWorld(vtkMatrix4x4::New())
+  , CameraParentToWorldValid(false)
+  , ProjectionUpdatePending(false)
+  , PresentingCameraPose(false)
+  , RenderStartTelemetryTime(-1.0)
+  , RenderStartTime(-1.0)
+  , FrameWorkTime(0.0)
+  , AppliedQualityLevel(vtkTrackedScreenARQualityGovernor::FullQuality)
+  , SavedStillUpdateRate(-1.0)
+  , SavedUseDepthPeeling(false)
+  , SavedShadowsVisibility(false)
+  , Projection(vtkTrackedScreenARProjection::New())
+  , FramePacer(vtkTrackedScreenARFramePacer::New())
+  , LatencyMonitor(vtkTrackedScreenARLatencyMonitor::New())
+  , PoseBuffer(vtkTrackedScreenARPoseBuffer::New())
+  , PosePredictor(vtkTrackedScreenARPosePredictor::New())
+  , QualityGovernor(vtkTrackedScreenARQualityGovernor::New())
+  , SceneLayerPass(vtkTrackedScreenARSceneLayerPass::New())
+  , SynchronizePoseToVideo(true)
+  , PredictionHorizon(-1.0)
+  , PoseTranslationDeadband(0.2)
+  , PoseRotationDeadband(0.05)
+  , DownscaleVideoToView(false)
+  , LayeredRendering(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARViewBinding::~vtkTrackedScreenARViewBinding()
+{
+  this->SetVideoSource(nullptr);
+
+  this->BackgroundTexture->Delete();
+  this->BackgroundTexture = nullptr;
+  this->CameraParentToWorld->Delete();
+  this->CameraParentToWorld = nullptr;
+
+  this->Projection->Delete();
+  this->Projection = nullptr;
+  this->FramePacer->Delete();
+  this->FramePacer = nullptr;
+  this->LatencyMonitor->Delete();
+  this->LatencyMonitor = nullptr;
+  this->PoseBuffer->Delete();
+  this->PoseBuffer = nullptr;
+  this->PosePredictor->Delete();
+  this->PosePredictor = nullptr;
+  this->QualityGovernor->Delete();
+  this->QualityGovernor = nullptr;
+  this->SceneLayerPass->Delete();
+  this->SceneLayerPass = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARViewBinding::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "ViewNodeID: " << this->ViewNodeID << std::endl;
+  os << indent << "VideoSourceNodeID: " << (this->VideoSource ? this->VideoSource->GetVideoSourceNodeID() : "(none)") << std::endl;
+  os << indent << "VideoSourceConflicts: " << this->VideoSourceConflicts << std::endl;
+  os << indent << "CameraParametersNode: " << (this->CameraParametersNode ? this->CameraParametersNode->GetID() : "(none)") << std::endl;
+  os << indent << "CameraTransformNode: " << (this->CameraTransformNode ? this->CameraTransformNode->GetID() : "(none)") << std::endl;
+  os << indent << "CameraParentTransformNode: " << (this->CameraParentTransformNode ? this->CameraParentTransformNode->GetID() : "(none)") << std::endl;
+  os << indent << "CameraParentToWorldValid: " << (this->CameraParentToWorldValid ? "true" : "false") << std::endl;
+  os << indent << "PresentedCameraTransformNodeID: " << this->PresentedCameraTransformNodeID << std::endl;
+  os << indent << "ParametersNodeID: " << this->ParametersNodeID << std::endl;
+  os << indent << "ProjectionUpdatePending: " << (this->ProjectionUpdatePending ? "true" : "false") << std::endl;
+  os << indent << "Projection:" << std::endl;
+  this->Projection->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "FramePacer:" << std::endl;
+  this->FramePacer->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "LatencyMonitor:" << std::endl;
+  this->LatencyMonitor->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "PoseBuffer:" << std::endl;
+  this->PoseBuffer->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "SynchronizePoseToVideo: " << (this->SynchronizePoseToVideo ? "true" : "false") << std::endl;
+  os << indent << "PosePredictor:" << std::endl;
+  this->PosePredictor->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "PredictionHorizon: " << this->PredictionHorizon << std::endl;
+  os << indent << "PoseTranslationDeadband: " << this->PoseTranslationDeadband << std::endl;
+  os << indent << "PoseRotationDeadband: " << this->PoseRotationDeadband << std::endl;
+  os << indent << "DownscaleVideoToView: " << (this->DownscaleVideoToView ? "true" : "false") << std::endl;
+  os << indent << "LayeredRendering: " << (this->LayeredRendering ? "true" : "false") << std::endl;
+  os << indent << "QualityGovernor:" << std::endl;
+  this->QualityGovernor->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "AppliedQualityLevel: " << vtkTrackedScreenARQualityGovernor::GetQualityLevelAsString(this->AppliedQualityLevel) << std::endl;
+  os << indent << "SceneLayerPass:" << std::endl;
+  this->SceneLayerPass->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkTrackedScreenARViewBinding::GetViewNodeID() const
+{
+  return this->ViewNodeID;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARViewBinding::SetViewNodeID(const std::string& nodeID)
+{
+  if (nodeID == this->ViewNodeID)
+  {
+    return;
+  }
+  this->ViewNodeID = nodeID;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARVideoSource* vtkTrackedScreenARViewBinding::GetVideoSource()
+{
+  return this->VideoSource;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARViewBinding::SetVideoSource(vtkTrackedScreenARVideoSource* source)
+{
+  if (source != this->VideoSource)
+  {
+    // Conflicts are between the views sharing a source
+    this->VideoSourceConflicts = 0;
+  }
+  vtkSetObjectBodyMacro(VideoSource, vtkTrackedScreenARVideoSource, source);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLPinholeCameraNode* vtkTrackedScreenARViewBinding::GetCameraParametersNode()
+{
+  return this->CameraParametersNode;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkTrackedScreenARViewBinding::GetCameraTransformNode()
+{
+  return this->CameraTransformNode;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTransformNode* vtkTrackedScreenARViewBinding::GetCameraParentTransformNode()
+{
+  return this->CameraParentTransformNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARViewBinding::InvalidateCameraParentToWorld()
+{
+  this->CameraParentToWorldValid = false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARViewBinding::GetCameraTransformToWorld(vtkMatrix4x4* cameraToWorld)
+{
+  if (this->CameraTransformNode == nullptr)
+  {
+    return false;
+  }
+  if (this->CameraParentTransformNode == nullptr)
+  {
+    this->CameraTransformNode->GetMatrixTransformToParent(cameraToWorld);
+    return true;
+  }
+
+  // Walk the hierarchy only when a parent changed, tracker updates only change the leaf
+  if (!this->CameraParentToWorldValid)
+  {
+    this->CameraParentTransformNode->GetMatrixTransformToWorld(this->CameraParentToWorld);
+    this->CameraParentToWorldValid = true;
+  }
+  this->CameraTransformNode->GetMatrixTransformToParent(cameraToWorld);
+  vtkTrackedScreenARRigidTransform::Compose(vtkTrackedScreenARRigidTransform::FromMatrix(this->CameraParentToWorld),
+    vtkTrackedScreenARRigidTransform::FromMatrix(cameraToWorld)).ToMatrix(cameraToWorld);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkRenderWindow* vtkTrackedScreenARViewBinding::GetRenderWindow()
+{
+  return this->RenderWindow;
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkTrackedScreenARViewBinding::GetPresentedCameraTransformNodeID() const
+{
+  return this->PresentedCameraTransformNodeID;
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkTrackedScreenARViewBinding::GetParametersNodeID() const
+{
+  return this->ParametersNodeID;
+}
+
+//----------------------------------------------------------------------------
+vtkTexture* vtkTrackedScreenARViewBinding::GetBackgroundTexture()
+{
+  return this->BackgroundTexture;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARProjection* vtkTrackedScreenARViewBinding::GetProjection()
+{
+  return this->Projection;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARFramePacer* vtkTrackedScreenARViewBinding::GetFramePacer()
+{
+  return this->FramePacer;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARLatencyMonitor* vtkTrackedScreenARViewBinding::GetLatencyMonitor()
+{
+  return this->LatencyMonitor;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPoseBuffer* vtkTrackedScreenARViewBinding::GetPoseBuffer()
+{
+  return this->PoseBuffer;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARPosePredictor* vtkTrackedScreenARViewBinding::GetPosePredictor()
+{
+  return this->PosePredictor;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARQualityGovernor* vtkTrackedScreenARViewBinding::GetQualityGovernor()
+{
+  return this->QualityGovernor;
+}
+
+//----------------------------------------------------------------------------
+vtkTrackedScreenARSceneLayerPass* vtkTrackedScreenARViewBinding::GetSceneLayerPass()
+{
+  return this->SceneLayerPass;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrackedScreenARViewBinding::RequestRender(int source)
+{
+  // Not an arrival: settings changes and stale frames request renders too. The logic records arrivals
+  // where frames and poses come in.
+  if (!this->FramePacer->MarkDirty(source))
+  {
+    // A render is already scheduled, this update rides along with it
+    return;
+  }
+
+  double delay = this->FramePacer->GetDelayToNextFrame(vtkTimerLog::GetUniversalTime());
+  this->InvokeEvent(RenderRequestedEvent, &delay);
+}
+
+//----------------------------------------------------------------------------
+double vtkTrackedScreenARViewBinding::GetEffectivePredictionHorizon()
+{
+  if (this->PredictionHorizon >= 0.0)
+  {
+    return this->PredictionHorizon;
+  }
+  return this->LatencyMonitor->GetMean(vtkTrackedScreenARLatencyMonitor::PoseLatency) / 1000.0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARViewBinding::ComputeCameraPose(vtkMatrix4x4* cameraToWorld, double& poseTimestamp)
+{
+  if (this->PosePredictor->GetPredictionMode() != vtkTrackedScreenARPosePredictor::PredictionOff)
+  {
+    // Where the tracked screen will be by the time this frame is displayed. The latency is still counted
+    // from the measurement, it is what the prediction horizon has to cover.
+    double targetTimestamp = this->PosePredictor->GetLatestTimestamp() + this->GetEffectivePredictionHorizon();
+    if (this->PosePredictor->PredictPose(targetTimestamp, cameraToWorld))
+    {
+      poseTimestamp = this->PosePredictor->GetLatestTimestamp();
+      return true;
+    }
+  }
+  if (this->SynchronizePoseToVideo && this->VideoSource != nullptr && this->VideoSource->GetFrameTimestamp() >= 0.0)
+  {
+    // Pose of the tracker when the displayed frame was acquired, the latest one if the frame is stale
+    if (this->PoseBuffer->GetSynchronizedPose(this->VideoSource->GetFrameTimestamp(), cameraToWorld, poseTimestamp))
+    {
+      return true;
+    }
+  }
+  if (!this->PoseBuffer->GetLatestPose(nullptr, poseTimestamp))
+  {
+    poseTimestamp = -1.0;
+  }
+  return this->GetCameraTransformToWorld(cameraToWorld);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrackedScreenARViewBinding::IsPoseInDeadband(vtkMatrix4x4* pose, vtkMatrix4x4* presentedPose)
+{
+  double squaredDistance = 0.0;
+  // Trace of presentedRotation^T * rotation, 1 + 2 cos(angle between the rotations)
+  double trace = 0.0;
+  for (int row = 0; row < 3; ++row)
+  {
+    double offset = pose->GetElement(row, 3) - presentedPose->GetElement(row, 3);
+    squaredDistance += offset * offset;
+    for (int column = 0; column < 3; ++column)
+    {
+      trace += pose->GetElement(row, column) * presentedPose->GetElement(row, column);
+    }
+  }
+  if (squaredDistance > this->PoseTranslationDeadband * this->PoseTranslationDeadband)
+  {
+    return false;
+  }
+  // Compared as cosines, acos is ill-conditioned for the small angles of interest
+  return 0.5 * (trace - 1.0) >= cos(vtkMath::RadiansFromDegrees(this->PoseRotationDeadband));
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARViewBinding::GetRequestedShrinkFactor()
+{
+  bool downscale = this->DownscaleVideoToView || this->AppliedQualityLevel >= vtkTrackedScreenARQualityGovernor::DownscaledVideo;
+  if (!downscale || !this->Projection->GetValid() || this->Projection->GetScalingFactor() <= 0.0)
+  {
+    return 1;
+  }
+  // Largest integer factor that keeps the frame at least as high as the view
+  int shrinkFactor = std::max(1, static_cast<int>(floor(1.0 / this->Projection->GetScalingFactor() + 1e-6)));
+  if (this->AppliedQualityLevel >= vtkTrackedScreenARQualityGovernor::HalfResolutionVideo)
+  {
+    shrinkFactor *= 2;
+  }
+  return shrinkFactor;
+}
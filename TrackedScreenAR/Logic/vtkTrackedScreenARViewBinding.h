@@ -0,0 +1,270 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkTrackedScreenARViewBinding - AR state of one 3D view
+// .SECTION Description
+// Binds a 3D view (identified by its view node ID) to a video source, pinhole camera
+// parameters and a tracked camera transform, and holds the per-view state derived from
+// them: the projection, the background texture, the frame pacer and latency statistics
+// of its render window, and the pose history used to present the camera.
+//
+// Bindings are created and owned by vtkSlicerTrackedScreenARLogic, which sets and
+// observes the bound nodes, usually from a vtkMRMLTrackedScreenARParametersNode.
+// Views bound to the same video volume share its vtkTrackedScreenARVideoSource.
+
+#ifndef __vtkTrackedScreenARViewBinding_h
+#define __vtkTrackedScreenARViewBinding_h
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkObject.h>
+
+// STD includes
+#include <string>
+
+#include "vtkSlicerTrackedScreenARModuleLogicExport.h"
+
+class vtkMatrix4x4;
+class vtkMRMLLinearTransformNode;
+class vtkMRMLPinholeCameraNode;
+class vtkMRMLTransformNode;
+class vtkRenderWindow;
+class vtkTexture;
+class vtkTrackedScreenARFramePacer;
+class vtkTrackedScreenARLatencyMonitor;
+class vtkTrackedScreenARPoseBuffer;
+class vtkTrackedScreenARPosePredictor;
+class vtkTrackedScreenARProjection;
+class vtkTrackedScreenARQualityGovernor;
+class vtkTrackedScreenARSceneLayerPass;
+class vtkTrackedScreenARVideoSource;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_LOGIC_EXPORT vtkTrackedScreenARViewBinding : public vtkObject
+{
+public:
+  static vtkTrackedScreenARViewBinding* New();
+  vtkTypeMacro(vtkTrackedScreenARViewBinding, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum Events
+  {
+    /// Fired when a render of the view has to be scheduled, call data is a double* holding the delay in seconds.
+    /// The observer is expected to call vtkSlicerTrackedScreenARLogic::BeginFrame() once the delay elapsed,
+    /// and render the view if it returns non-zero.
+    RenderRequestedEvent = vtkCommand::UserEvent + 1,
+    /// Fired when the video frame size, the camera parameters or the render window size changed.
+    /// The logic updates the projection with the next frame it begins.
+    ProjectionInputModifiedEvent
+  };
+
+  enum VideoSourceConflictFlags
+  {
+    /// Another view sharing the video source uses camera parameters with a different lens model
+    LensParametersConflict = 0x1,
+    /// Another view sharing the video source asks for a different pixel format
+    PixelFormatConflict = 0x2
+  };
+
+  /// ID of the view node of the bound 3D view
+  const std::string& GetViewNodeID() const;
+  void SetViewNodeID(const std::string& nodeID);
+
+  /// Bound nodes, set through vtkSlicerTrackedScreenARLogic
+  vtkTrackedScreenARVideoSource* GetVideoSource();
+  vtkMRMLPinholeCameraNode* GetCameraParametersNode();
+  vtkMRMLLinearTransformNode* GetCameraTransformNode();
+  vtkRenderWindow* GetRenderWindow();
+
+  /// Settings of the shared video source this view asks for but that were not applied because another
+  /// view showing the same video asks for different ones, see VideoSourceConflictFlags. 0 if none.
+  vtkGetMacro(VideoSourceConflicts, int);
+
+  /// ID of the hidden transform node the view camera is parented to, empty until the logic created it
+  const std::string& GetPresentedCameraTransformNodeID() const;
+
+  /// ID of the parameters node the binding was created from, empty if it is driven through the logic API only
+  const std::string& GetParametersNodeID() const;
+
+  /// Background texture of the render window, fed by the video source. Each view has its own GL context,
+  /// so its own texture.
+  vtkTexture* GetBackgroundTexture();
+
+  /// Projection engine mapping the video camera intrinsics onto the view camera
+  vtkTrackedScreenARProjection* GetProjection();
+
+  /// Frame pacer that coalesces video, pose and scene updates into one render per tick of this view
+  vtkTrackedScreenARFramePacer* GetFramePacer();
+
+  /// Glass-to-glass latency statistics of the video frames and poses displayed in this view
+  vtkTrackedScreenARLatencyMonitor* GetLatencyMonitor();
+
+  /// Timestamped history of the camera transform, filled as tracker updates arrive
+  vtkTrackedScreenARPoseBuffer* GetPoseBuffer();
+
+  /// Extrapolates the camera pose to compensate pipeline latency, off by default
+  vtkTrackedScreenARPosePredictor* GetPosePredictor();
+
+  /// Adapts the quality of the view to a frame budget, off by default. Its level is applied by the logic.
+  vtkTrackedScreenARQualityGovernor* GetQualityGovernor();
+
+  /// Render pass caching the virtual scene between video frames, installed on the renderer
+  /// by the logic while LayeredRendering is on
+  vtkTrackedScreenARSceneLayerPass* GetSceneLayerPass();
+
+  /// Mark a source dirty (see vtkTrackedScreenARFramePacer::DirtySource) and request a render if none is pending
+  void RequestRender(int source);
+
+  /// True while the logic moves the view camera to a newly presented pose. Renders the view asks for
+  /// because of this camera change are part of the frame being prepared and must not mark the scene dirty.
+  vtkGetMacro(PresentingCameraPose, bool);
+
+  /// Pose the camera at the acquisition time of the displayed video frame instead of the latest pose.
+  /// On by default.
+  vtkSetMacro(SynchronizePoseToVideo, bool);
+  vtkGetMacro(SynchronizePoseToVideo, bool);
+  vtkBooleanMacro(SynchronizePoseToVideo, bool);
+
+  /// Seconds the pose is extrapolated past the latest tracker pose. If negative (default),
+  /// the mean pose latency measured by the latency monitor is used.
+  vtkSetMacro(PredictionHorizon, double);
+  vtkGetMacro(PredictionHorizon, double);
+
+  /// Horizon actually used for the next prediction, in seconds
+  double GetEffectivePredictionHorizon();
+
+  /// Camera transform to world, from its matrix to parent and the cached world matrix of its parent
+  /// transforms: a single 4x4 multiply per tracker update. Returns false if there is no camera transform.
+  bool GetCameraTransformToWorld(vtkMatrix4x4* cameraToWorld);
+
+  /// Parent of the camera transform whose world matrix is cached, observed by the logic
+  vtkMRMLTransformNode* GetCameraParentTransformNode();
+
+  /// Recompute the cached parent world matrix on next use. Called by the logic when a parent transform changed.
+  void InvalidateCameraParentToWorld();
+
+  /// Camera pose to present: predicted if pose prediction is enabled, otherwise interpolated at the
+  /// acquisition time of the displayed video frame if SynchronizePoseToVideo is enabled and the frame is
+  /// recent (see vtkTrackedScreenARPoseBuffer::GetSynchronizedPose), otherwise the latest camera transform. Returns false if there is no pose at all.
+  /// poseTimestamp is set to the tracker time the pose is based on: the latest measurement for a predicted pose,
+  /// the time of the synchronized pose, or the latest pose arrival. It is negative if no pose arrived yet.
+  bool ComputeCameraPose(vtkMatrix4x4* cameraToWorld, double& poseTimestamp);
+
+  /// Camera poses closer than this to the presented pose are not presented, so tracker jitter of a still
+  /// tracked screen neither moves the camera nor invalidates the scene layer. Set it above the jitter of the
+  /// tracker: a pose drifting slowly is still followed once it is this far from the presented one.
+  /// In mm, 0.2 by default, a fraction of a pixel at usual working distances.
+  vtkSetMacro(PoseTranslationDeadband, double);
+  vtkGetMacro(PoseTranslationDeadband, double);
+
+  /// Rotation counterpart of PoseTranslationDeadband, in degrees. 0.05 by default, under a pixel for
+  /// focal lengths up to 1000 pixels.
+  vtkSetMacro(PoseRotationDeadband, double);
+  vtkGetMacro(PoseRotationDeadband, double);
+
+  /// True if pose is within the deadband of presentedPose
+  bool IsPoseInDeadband(vtkMatrix4x4* pose, vtkMatrix4x4* presentedPose);
+
+  /// Shrink the video by the largest integer factor that keeps it at least as large as this view.
+  /// Views sharing a video source use the smallest factor any of them asks for. Off by default.
+  vtkSetMacro(DownscaleVideoToView, bool);
+  vtkGetMacro(DownscaleVideoToView, bool);
+  vtkBooleanMacro(DownscaleVideoToView, bool);
+
+  /// Downscale factor this view asks for given its current projection and applied quality level,
+  /// 1 if DownscaleVideoToView is off and the video is not degraded
+  int GetRequestedShrinkFactor();
+
+  /// Quality level of vtkTrackedScreenARQualityGovernor the view is currently rendered with
+  vtkGetMacro(AppliedQualityLevel, int);
+
+  /// Render the virtual scene into a cached layer and only composite it over the video while the
+  /// scene is unchanged, see vtkTrackedScreenARSceneLayerPass. This pays off when the scene is expensive
+  /// to render and the camera is still between video frames, i.e. the tracked screen is held still and
+  /// the pose deadbands absorb the tracker jitter. While the camera moves every frame, each frame renders
+  /// the layer and composites it, slightly more than a plain render. Off by default.
+  vtkSetMacro(LayeredRendering, bool);
+  vtkGetMacro(LayeredRendering, bool);
+  vtkBooleanMacro(LayeredRendering, bool);
+
+protected:
+  vtkTrackedScreenARViewBinding();
+  virtual ~vtkTrackedScreenARViewBinding();
+
+  void SetVideoSource(vtkTrackedScreenARVideoSource* source);
+
+protected:
+  std::string ViewNodeID;
+  std::string PresentedCameraTransformNodeID;
+  std::string ParametersNodeID;
+
+  vtkTrackedScreenARVideoSource* VideoSource;
+  int VideoSourceConflicts;
+
+  // Registered and observed by the logic
+  vtkMRMLPinholeCameraNode* CameraParametersNode;
+  vtkMRMLLinearTransformNode* CameraTransformNode;
+  vtkMRMLTransformNode* CameraParentTransformNode;
+  vtkRenderWindow* RenderWindow;
+  vtkTexture* BackgroundTexture;
+
+  // Flattened parent chain of the camera transform, identity if it has no parent
+  vtkMatrix4x4* CameraParentToWorld;
+  bool CameraParentToWorldValid;
+
+  // Set when a projection input changed, the projection is updated once by the next frame
+  bool ProjectionUpdatePending;
+
+  // Set by the logic while it modifies the presented camera transform
+  bool PresentingCameraPose;
+
+  // Telemetry time of the start of the current render, negative outside renders
+  double RenderStartTelemetryTime;
+
+  // Start of the current render and time spent preparing its frame, fed to the quality governor
+  double RenderStartTime;
+  double FrameWorkTime;
+
+  // Quality level applied to the view and the window and view node settings it overrode
+  int AppliedQualityLevel;
+  double SavedStillUpdateRate;
+  bool SavedUseDepthPeeling;
+  bool SavedShadowsVisibility;
+
+  vtkTrackedScreenARProjection* Projection;
+  vtkTrackedScreenARFramePacer* FramePacer;
+  vtkTrackedScreenARLatencyMonitor* LatencyMonitor;
+  vtkTrackedScreenARPoseBuffer* PoseBuffer;
+  vtkTrackedScreenARPosePredictor* PosePredictor;
+  vtkTrackedScreenARQualityGovernor* QualityGovernor;
+  vtkTrackedScreenARSceneLayerPass* SceneLayerPass;
+
+  bool SynchronizePoseToVideo;
+  double PredictionHorizon;
+  double PoseTranslationDeadband;
+  double PoseRotationDeadband;
+  bool DownscaleVideoToView;
+  bool LayeredRendering;
+
+  friend class vtkSlicerTrackedScreenARLogic;
+
+private:
+  vtkTrackedScreenARViewBinding(const vtkTrackedScreenARViewBinding&); // Not implemented
+  void operator=(const vtkTrackedScreenARViewBinding&); // Not implemented
+};
+
+#endif
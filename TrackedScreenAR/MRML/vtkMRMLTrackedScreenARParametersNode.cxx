@@ -0,0 +1,266 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR MRML includes
+#include "vtkMRMLTrackedScreenARParametersNode.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLViewNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// Video cameras include
+#include <vtkMRMLPinholeCameraNode.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLTrackedScreenARParametersNode::ViewNodeReferenceRole = "view";
+const char* vtkMRMLTrackedScreenARParametersNode::VideoSourceNodeReferenceRole = "videoSource";
+const char* vtkMRMLTrackedScreenARParametersNode::CameraParametersNodeReferenceRole = "cameraParameters";
+const char* vtkMRMLTrackedScreenARParametersNode::CameraTransformNodeReferenceRole = "cameraTransform";
+
+//----------------------------------------------------------------------------
+vtkMRMLNodeNewMacro(vtkMRMLTrackedScreenARParametersNode);
+
+//----------------------------------------------------------------------------
+vtkMRMLTrackedScreenARParametersNode::vtkMRMLTrackedScreenARParametersNode()
+  : PixelFormat(0)
+  , DownscaleVideoToView(false)
+  , SynchronizePoseToVideo(true)
+  , LayeredRendering(false)
+  , AdaptiveQuality(false)
+  , TargetFrameTime(1.0 / 30.0)
+  , PredictionMode(0)
+  , PredictionHorizon(-1.0)
+  , TargetFPS(60.0)
+  , PoseTranslationDeadband(0.2)
+  , PoseRotationDeadband(0.05)
+{
+  this->SetHideFromEditors(true);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTrackedScreenARParametersNode::~vtkMRMLTrackedScreenARParametersNode()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "PixelFormat: " << this->PixelFormat << std::endl;
+  os << indent << "DownscaleVideoToView: " << (this->DownscaleVideoToView ? "true" : "false") << std::endl;
+  os << indent << "SynchronizePoseToVideo: " << (this->SynchronizePoseToVideo ? "true" : "false") << std::endl;
+  os << indent << "LayeredRendering: " << (this->LayeredRendering ? "true" : "false") << std::endl;
+  os << indent << "AdaptiveQuality: " << (this->AdaptiveQuality ? "true" : "false") << std::endl;
+  os << indent << "TargetFrameTime: " << this->TargetFrameTime << std::endl;
+  os << indent << "PredictionMode: " << this->PredictionMode << std::endl;
+  os << indent << "PredictionHorizon: " << this->PredictionHorizon << std::endl;
+  os << indent << "TargetFPS: " << this->TargetFPS << std::endl;
+  os << indent << "PoseTranslationDeadband: " << this->PoseTranslationDeadband << std::endl;
+  os << indent << "PoseRotationDeadband: " << this->PoseRotationDeadband << std::endl;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLTrackedScreenARParametersNode::GetNodeTagName()
+{
+  return "TrackedScreenARParameters";
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::ReadXMLAttributes(const char** atts)
+{
+  int wasModifying = this->StartModify();
+  this->Superclass::ReadXMLAttributes(atts);
+
+  const char* attName = nullptr;
+  const char* attValue = nullptr;
+  while (*atts != nullptr)
+  {
+    attName = *(atts++);
+    attValue = *(atts++);
+    if (!strcmp(attName, "pixelFormat"))
+    {
+      this->SetPixelFormat(atoi(attValue));
+    }
+    else if (!strcmp(attName, "downscaleVideoToView"))
+    {
+      this->SetDownscaleVideoToView(!strcmp(attValue, "true"));
+    }
+    else if (!strcmp(attName, "synchronizePoseToVideo"))
+    {
+      this->SetSynchronizePoseToVideo(!strcmp(attValue, "true"));
+    }
+    else if (!strcmp(attName, "layeredRendering"))
+    {
+      this->SetLayeredRendering(!strcmp(attValue, "true"));
+    }
+    else if (!strcmp(attName, "adaptiveQuality"))
+    {
+      this->SetAdaptiveQuality(!strcmp(attValue, "true"));
+    }
+    else if (!strcmp(attName, "targetFrameTime"))
+    {
+      this->SetTargetFrameTime(atof(attValue));
+    }
+    else if (!strcmp(attName, "predictionMode"))
+    {
+      this->SetPredictionMode(atoi(attValue));
+    }
+    else if (!strcmp(attName, "predictionHorizon"))
+    {
+      this->SetPredictionHorizon(atof(attValue));
+    }
+    else if (!strcmp(attName, "targetFPS"))
+    {
+      this->SetTargetFPS(atof(attValue));
+    }
+    else if (!strcmp(attName, "poseTranslationDeadband"))
+    {
+      this->SetPoseTranslationDeadband(atof(attValue));
+    }
+    else if (!strcmp(attName, "poseRotationDeadband"))
+    {
+      this->SetPoseRotationDeadband(atof(attValue));
+    }
+  }
+
+  this->EndModify(wasModifying);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::WriteXML(ostream& of, int nIndent)
+{
+  this->Superclass::WriteXML(of, nIndent);
+
+  of << " pixelFormat=\"" << this->PixelFormat << "\"";
+  of << " downscaleVideoToView=\"" << (this->DownscaleVideoToView ? "true" : "false") << "\"";
+  of << " synchronizePoseToVideo=\"" << (this->SynchronizePoseToVideo ? "true" : "false") << "\"";
+  of << " layeredRendering=\"" << (this->LayeredRendering ? "true" : "false") << "\"";
+  of << " adaptiveQuality=\"" << (this->AdaptiveQuality ? "true" : "false") << "\"";
+  of << " targetFrameTime=\"" << this->TargetFrameTime << "\"";
+  of << " predictionMode=\"" << this->PredictionMode << "\"";
+  of << " predictionHorizon=\"" << this->PredictionHorizon << "\"";
+  of << " targetFPS=\"" << this->TargetFPS << "\"";
+  of << " poseTranslationDeadband=\"" << this->PoseTranslationDeadband << "\"";
+  of << " poseRotationDeadband=\"" << this->PoseRotationDeadband << "\"";
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::Copy(vtkMRMLNode* anode)
+{
+  int wasModifying = this->StartModify();
+  this->Superclass::Copy(anode);
+
+  vtkMRMLTrackedScreenARParametersNode* node = vtkMRMLTrackedScreenARParametersNode::SafeDownCast(anode);
+  if (node != nullptr)
+  {
+    this->SetPixelFormat(node->GetPixelFormat());
+    this->SetDownscaleVideoToView(node->GetDownscaleVideoToView());
+    this->SetSynchronizePoseToVideo(node->GetSynchronizePoseToVideo());
+    this->SetLayeredRendering(node->GetLayeredRendering());
+    this->SetAdaptiveQuality(node->GetAdaptiveQuality());
+    this->SetTargetFrameTime(node->GetTargetFrameTime());
+    this->SetPredictionMode(node->GetPredictionMode());
+    this->SetPredictionHorizon(node->GetPredictionHorizon());
+    this->SetTargetFPS(node->GetTargetFPS());
+    this->SetPoseTranslationDeadband(node->GetPoseTranslationDeadband());
+    this->SetPoseRotationDeadband(node->GetPoseRotationDeadband());
+  }
+
+  this->EndModify(wasModifying);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLViewNode* vtkMRMLTrackedScreenARParametersNode::GetViewNode()
+{
+  return vtkMRMLViewNode::SafeDownCast(this->GetNodeReference(ViewNodeReferenceRole));
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLTrackedScreenARParametersNode::GetViewNodeID()
+{
+  return this->GetNodeReferenceID(ViewNodeReferenceRole);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::SetViewNodeID(const char* nodeID)
+{
+  this->SetNodeReferenceID(ViewNodeReferenceRole, nodeID);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLVolumeNode* vtkMRMLTrackedScreenARParametersNode::GetVideoSourceNode()
+{
+  return vtkMRMLVolumeNode::SafeDownCast(this->GetNodeReference(VideoSourceNodeReferenceRole));
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLTrackedScreenARParametersNode::GetVideoSourceNodeID()
+{
+  return this->GetNodeReferenceID(VideoSourceNodeReferenceRole);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::SetVideoSourceNodeID(const char* nodeID)
+{
+  this->SetNodeReferenceID(VideoSourceNodeReferenceRole, nodeID);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLPinholeCameraNode* vtkMRMLTrackedScreenARParametersNode::GetCameraParametersNode()
+{
+  return vtkMRMLPinholeCameraNode::SafeDownCast(this->GetNodeReference(CameraParametersNodeReferenceRole));
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLTrackedScreenARParametersNode::GetCameraParametersNodeID()
+{
+  return this->GetNodeReferenceID(CameraParametersNodeReferenceRole);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::SetCameraParametersNodeID(const char* nodeID)
+{
+  this->SetNodeReferenceID(CameraParametersNodeReferenceRole, nodeID);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkMRMLTrackedScreenARParametersNode::GetCameraTransformNode()
+{
+  return vtkMRMLLinearTransformNode::SafeDownCast(this->GetNodeReference(CameraTransformNodeReferenceRole));
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLTrackedScreenARParametersNode::GetCameraTransformNodeID()
+{
+  return this->GetNodeReferenceID(CameraTransformNodeReferenceRole);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTrackedScreenARParametersNode::SetCameraTransformNodeID(const char* nodeID)
+{
+  this->SetNodeReferenceID(CameraTransformNodeReferenceRole, nodeID);
+}
@@ -0,0 +1,151 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// .NAME vtkMRMLTrackedScreenARParametersNode - AR configuration of one 3D view, saved with the scene
+// .SECTION Description
+// References the 3D view shown as tracked screen, the video volume displayed in its background,
+// the pinhole camera parameters of the video camera and the tracked camera transform, and holds
+// the per-view pipeline options.
+//
+// vtkSlicerTrackedScreenARLogic observes these nodes and binds their view as soon as they are in
+// the scene, so a saved AR setup comes back with the scene whether the module panel is opened or not.
+
+#ifndef __vtkMRMLTrackedScreenARParametersNode_h
+#define __vtkMRMLTrackedScreenARParametersNode_h
+
+// MRML includes
+#include <vtkMRMLNode.h>
+
+#include "vtkSlicerTrackedScreenARModuleMRMLExport.h"
+
+class vtkMRMLLinearTransformNode;
+class vtkMRMLPinholeCameraNode;
+class vtkMRMLViewNode;
+class vtkMRMLVolumeNode;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class VTK_SLICER_TRACKEDSCREENAR_MODULE_MRML_EXPORT vtkMRMLTrackedScreenARParametersNode : public vtkMRMLNode
+{
+public:
+  static vtkMRMLTrackedScreenARParametersNode* New();
+  vtkTypeMacro(vtkMRMLTrackedScreenARParametersNode, vtkMRMLNode);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  virtual vtkMRMLNode* CreateNodeInstance();
+  virtual const char* GetNodeTagName();
+
+  virtual void ReadXMLAttributes(const char** atts);
+  virtual void WriteXML(ostream& of, int indent);
+  virtual void Copy(vtkMRMLNode* node);
+
+  /// 3D view showing the AR scene
+  vtkMRMLViewNode* GetViewNode();
+  const char* GetViewNodeID();
+  void SetViewNodeID(const char* nodeID);
+
+  /// Video volume shown in the background of the view
+  vtkMRMLVolumeNode* GetVideoSourceNode();
+  const char* GetVideoSourceNodeID();
+  void SetVideoSourceNodeID(const char* nodeID);
+
+  /// Intrinsics and distortion of the video camera
+  vtkMRMLPinholeCameraNode* GetCameraParametersNode();
+  const char* GetCameraParametersNodeID();
+  void SetCameraParametersNodeID(const char* nodeID);
+
+  /// Tracked transform driving the view camera
+  vtkMRMLLinearTransformNode* GetCameraTransformNode();
+  const char* GetCameraTransformNodeID();
+  void SetCameraTransformNodeID(const char* nodeID);
+
+  /// Pixel layout of the video frames, a vtkTrackedScreenARPixelFormatConverter::PixelFormat value. RGB (0) by default.
+  vtkSetMacro(PixelFormat, int);
+  vtkGetMacro(PixelFormat, int);
+
+  /// See vtkTrackedScreenARViewBinding::SetDownscaleVideoToView(). Off by default.
+  vtkSetMacro(DownscaleVideoToView, bool);
+  vtkGetMacro(DownscaleVideoToView, bool);
+  vtkBooleanMacro(DownscaleVideoToView, bool);
+
+  /// See vtkTrackedScreenARViewBinding::SetSynchronizePoseToVideo(). On by default.
+  vtkSetMacro(SynchronizePoseToVideo, bool);
+  vtkGetMacro(SynchronizePoseToVideo, bool);
+  vtkBooleanMacro(SynchronizePoseToVideo, bool);
+
+  /// See vtkTrackedScreenARViewBinding::SetLayeredRendering(). Off by default.
+  vtkSetMacro(LayeredRendering, bool);
+  vtkGetMacro(LayeredRendering, bool);
+  vtkBooleanMacro(LayeredRendering, bool);
+
+  /// See vtkSlicerTrackedScreenARLogic::SetAdaptiveQuality(). Off by default.
+  vtkSetMacro(AdaptiveQuality, bool);
+  vtkGetMacro(AdaptiveQuality, bool);
+  vtkBooleanMacro(AdaptiveQuality, bool);
+
+  /// Frame budget of the adaptive quality, in seconds. 1/30 s by default.
+  vtkSetMacro(TargetFrameTime, double);
+  vtkGetMacro(TargetFrameTime, double);
+
+  /// Camera pose prediction model, a vtkTrackedScreenARPosePredictor::PredictionMode value. Off (0) by default.
+  vtkSetMacro(PredictionMode, int);
+  vtkGetMacro(PredictionMode, int);
+
+  /// See vtkTrackedScreenARViewBinding::SetPredictionHorizon(), in seconds. Negative (measured pose latency) by default.
+  vtkSetMacro(PredictionHorizon, double);
+  vtkGetMacro(PredictionHorizon, double);
+
+  /// Render rate of the view, see vtkTrackedScreenARFramePacer::SetTargetFPS(). 60 by default.
+  vtkSetMacro(TargetFPS, double);
+  vtkGetMacro(TargetFPS, double);
+
+  /// See vtkTrackedScreenARViewBinding::SetPoseTranslationDeadband(), in mm. 0.2 mm by default.
+  vtkSetMacro(PoseTranslationDeadband, double);
+  vtkGetMacro(PoseTranslationDeadband, double);
+
+  /// See vtkTrackedScreenARViewBinding::SetPoseRotationDeadband(), in degrees. 0.05 degrees by default.
+  vtkSetMacro(PoseRotationDeadband, double);
+  vtkGetMacro(PoseRotationDeadband, double);
+
+protected:
+  vtkMRMLTrackedScreenARParametersNode();
+  virtual ~vtkMRMLTrackedScreenARParametersNode();
+
+  static const char* ViewNodeReferenceRole;
+  static const char* VideoSourceNodeReferenceRole;
+  static const char* CameraParametersNodeReferenceRole;
+  static const char* CameraTransformNodeReferenceRole;
+
+protected:
+  int PixelFormat;
+  bool DownscaleVideoToView;
+  bool SynchronizePoseToVideo;
+  bool LayeredRendering;
+  bool AdaptiveQuality;
+  double TargetFrameTime;
+  int PredictionMode;
+  double PredictionHorizon;
+  double TargetFPS;
+  double PoseTranslationDeadband;
+  double PoseRotationDeadband;
+
+private:
+  vtkMRMLTrackedScreenARParametersNode(const vtkMRMLTrackedScreenARParametersNode&); // Not implemented
+  void operator=(const vtkMRMLTrackedScreenARParametersNode&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+// TrackedScreenAR MRML includes
+#include "vtkMRMLTrackedScreenARParametersNode.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLViewNode.h>
+
+// Video cameras include
+#include <vtkMRMLPinholeCameraNode.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const double TOLERANCE = 1e-9;
+
+  //----------------------------------------------------------------------------
+  // Read back what WriteXML wrote, split into the name, value list ReadXMLAttributes expects
+  void ReadXML(vtkMRMLNode* node, const std::string& xml)
+  {
+    std::vector<std::string> attributes;
+    std::string::size_type separator = xml.find("=\"");
+    while (separator != std::string::npos)
+    {
+      std::string::size_type nameStart = xml.find_last_of(' ', separator) + 1;
+      std::string::size_type valueEnd = xml.find('"', separator + 2);
+      attributes.push_back(xml.substr(nameStart, separator - nameStart));
+      attributes.push_back(xml.substr(separator + 2, valueEnd - separator - 2));
+      separator = xml.find("=\"", valueEnd + 1);
+    }
+    std::vector<const char*> atts;
+    for (std::vector<std::string>::iterator it = attributes.begin(); it != attributes.end(); ++it)
+    {
+      atts.push_back(it->c_str());
+    }
+    atts.push_back(nullptr);
+    node->ReadXMLAttributes(&atts[0]);
+  }
+
+  //----------------------------------------------------------------------------
+  // Parameters node with every attribute away from its default and every reference set
+  vtkMRMLTrackedScreenARParametersNode* AddParametersNode(vtkMRMLScene* scene)
+  {
+    vtkMRMLViewNode* viewNode = vtkMRMLViewNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLViewNode"));
+    vtkMRMLScalarVolumeNode* videoNode = vtkMRMLScalarVolumeNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLScalarVolumeNode"));
+    vtkNew<vtkMRMLPinholeCameraNode> cameraParametersNode;
+    scene->AddNode(cameraParametersNode.GetPointer());
+    vtkMRMLLinearTransformNode* cameraTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLLinearTransformNode"));
+
+    vtkNew<vtkMRMLTrackedScreenARParametersNode> node;
+    scene->AddNode(node.GetPointer());
+    node->SetViewNodeID(viewNode->GetID());
+    node->SetVideoSourceNodeID(videoNode->GetID());
+    node->SetCameraParametersNodeID(cameraParametersNode->GetID());
+    node->SetCameraTransformNodeID(cameraTransformNode->GetID());
+    node->SetPixelFormat(3);
+    node->SetDownscaleVideoToView(true);
+    node->SetSynchronizePoseToVideo(false);
+    node->SetLayeredRendering(true);
+    node->SetAdaptiveQuality(true);
+    node->SetTargetFrameTime(0.025);
+    node->SetPredictionMode(2);
+    node->SetPredictionHorizon(0.035);
+    node->SetTargetFPS(90.0);
+    node->SetPoseTranslationDeadband(0.5);
+    node->SetPoseRotationDeadband(0.1);
+    return node.GetPointer();
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckParameters(vtkMRMLTrackedScreenARParametersNode* node, vtkMRMLTrackedScreenARParametersNode* expectedNode)
+  {
+    CHECK_INT(node->GetPixelFormat(), expectedNode->GetPixelFormat());
+    CHECK_BOOL(node->GetDownscaleVideoToView(), expectedNode->GetDownscaleVideoToView());
+    CHECK_BOOL(node->GetSynchronizePoseToVideo(), expectedNode->GetSynchronizePoseToVideo());
+    CHECK_BOOL(node->GetLayeredRendering(), expectedNode->GetLayeredRendering());
+    CHECK_BOOL(node->GetAdaptiveQuality(), expectedNode->GetAdaptiveQuality());
+    CHECK_DOUBLE_TOLERANCE(node->GetTargetFrameTime(), expectedNode->GetTargetFrameTime(), TOLERANCE);
+    CHECK_INT(node->GetPredictionMode(), expectedNode->GetPredictionMode());
+    CHECK_DOUBLE_TOLERANCE(node->GetPredictionHorizon(), expectedNode->GetPredictionHorizon(), TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(node->GetTargetFPS(), expectedNode->GetTargetFPS(), TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(node->GetPoseTranslationDeadband(), expectedNode->GetPoseTranslationDeadband(), TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(node->GetPoseRotationDeadband(), expectedNode->GetPoseRotationDeadband(), TOLERANCE);
+    CHECK_STRING(node->GetViewNodeID(), expectedNode->GetViewNodeID());
+    CHECK_STRING(node->GetVideoSourceNodeID(), expectedNode->GetVideoSourceNodeID());
+    CHECK_STRING(node->GetCameraParametersNodeID(), expectedNode->GetCameraParametersNodeID());
+    CHECK_STRING(node->GetCameraTransformNodeID(), expectedNode->GetCameraTransformNodeID());
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestDefaults()
+  {
+    vtkNew<vtkMRMLTrackedScreenARParametersNode> node;
+    EXERCISE_ALL_BASIC_MRML_METHODS(node.GetPointer());
+    CHECK_INT(node->GetPixelFormat(), 0);
+    CHECK_BOOL(node->GetDownscaleVideoToView(), false);
+    CHECK_BOOL(node->GetSynchronizePoseToVideo(), true);
+    CHECK_BOOL(node->GetLayeredRendering(), false);
+    CHECK_BOOL(node->GetAdaptiveQuality(), false);
+    CHECK_DOUBLE_TOLERANCE(node->GetTargetFrameTime(), 1.0 / 30.0, TOLERANCE);
+    CHECK_INT(node->GetPredictionMode(), 0);
+    CHECK_BOOL(node->GetPredictionHorizon() < 0.0, true);
+    CHECK_DOUBLE_TOLERANCE(node->GetTargetFPS(), 60.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(node->GetPoseTranslationDeadband(), 0.2, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(node->GetPoseRotationDeadband(), 0.05, TOLERANCE);
+    CHECK_NULL(node->GetViewNodeID());
+    CHECK_NULL(node->GetVideoSourceNodeID());
+    CHECK_NULL(node->GetCameraParametersNodeID());
+    CHECK_NULL(node->GetCameraTransformNodeID());
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestReferences()
+  {
+    vtkNew<vtkMRMLScene> scene;
+    vtkMRMLTrackedScreenARParametersNode* node = AddParametersNode(scene.GetPointer());
+    CHECK_POINTER(node->GetViewNode(), scene->GetNodeByID(node->GetViewNodeID()));
+    CHECK_POINTER(node->GetVideoSourceNode(), scene->GetNodeByID(node->GetVideoSourceNodeID()));
+    CHECK_POINTER(node->GetCameraParametersNode(), scene->GetNodeByID(node->GetCameraParametersNodeID()));
+    CHECK_POINTER(node->GetCameraTransformNode(), scene->GetNodeByID(node->GetCameraTransformNodeID()));
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestWriteReadXML()
+  {
+    vtkNew<vtkMRMLScene> scene;
+    vtkMRMLTrackedScreenARParametersNode* node = AddParametersNode(scene.GetPointer());
+
+    std::stringstream xml;
+    node->WriteXML(xml, 0);
+    vtkNew<vtkMRMLTrackedScreenARParametersNode> readNode;
+    ReadXML(readNode.GetPointer(), xml.str());
+    CHECK_EXIT_SUCCESS(CheckParameters(readNode.GetPointer(), node));
+
+    // Defaults are written too, they must override the values of the node read into
+    vtkNew<vtkMRMLTrackedScreenARParametersNode> defaultNode;
+    std::stringstream defaultXML;
+    defaultNode->WriteXML(defaultXML, 0);
+    ReadXML(readNode.GetPointer(), defaultXML.str());
+    CHECK_INT(readNode->GetPixelFormat(), defaultNode->GetPixelFormat());
+    CHECK_BOOL(readNode->GetDownscaleVideoToView(), defaultNode->GetDownscaleVideoToView());
+    CHECK_BOOL(readNode->GetSynchronizePoseToVideo(), defaultNode->GetSynchronizePoseToVideo());
+    CHECK_BOOL(readNode->GetLayeredRendering(), defaultNode->GetLayeredRendering());
+    CHECK_BOOL(readNode->GetAdaptiveQuality(), defaultNode->GetAdaptiveQuality());
+    CHECK_INT(readNode->GetPredictionMode(), defaultNode->GetPredictionMode());
+    CHECK_DOUBLE_TOLERANCE(readNode->GetPredictionHorizon(), defaultNode->GetPredictionHorizon(), TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(readNode->GetTargetFPS(), defaultNode->GetTargetFPS(), TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(readNode->GetPoseTranslationDeadband(), defaultNode->GetPoseTranslationDeadband(), TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(readNode->GetPoseRotationDeadband(), defaultNode->GetPoseRotationDeadband(), TOLERANCE);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestCopy()
+  {
+    vtkNew<vtkMRMLScene> scene;
+    vtkMRMLTrackedScreenARParametersNode* node = AddParametersNode(scene.GetPointer());
+
+    vtkNew<vtkMRMLTrackedScreenARParametersNode> copy;
+    copy->Copy(node);
+    CHECK_EXIT_SUCCESS(CheckParameters(copy.GetPointer(), node));
+
+    // The references of the copy resolve in the scene of the original
+    scene->AddNode(copy.GetPointer());
+    CHECK_POINTER(copy->GetViewNode(), node->GetViewNode());
+    CHECK_POINTER(copy->GetVideoSourceNode(), node->GetVideoSourceNode());
+    CHECK_POINTER(copy->GetCameraParametersNode(), node->GetCameraParametersNode());
+    CHECK_POINTER(copy->GetCameraTransformNode(), node->GetCameraTransformNode());
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLTrackedScreenARParametersNodeTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestDefaults());
+  CHECK_EXIT_SUCCESS(TestReferences());
+  CHECK_EXIT_SUCCESS(TestWriteReadXML());
+  CHECK_EXIT_SUCCESS(TestCopy());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARDownscaleFilter.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cstring>
+
+namespace
+{
+  // Neither size is a multiple of any factor above 1, so every shrink drops a partial block
+  const int WIDTH = 61;
+  const int HEIGHT = 43;
+
+  //----------------------------------------------------------------------------
+  void CreateFrame(int scalarType, int numberOfComponents, unsigned int seed, vtkImageData* frame)
+  {
+    frame->SetDimensions(WIDTH, HEIGHT, 1);
+    frame->AllocateScalars(scalarType, numberOfComponents);
+    for (int row = 0; row < HEIGHT; ++row)
+    {
+      for (int column = 0; column < WIDTH; ++column)
+      {
+        for (int component = 0; component < numberOfComponents; ++component)
+        {
+          seed = seed * 1664525u + 1013904223u;
+          frame->SetScalarComponentFromDouble(column, row, 0, component, seed >> 24);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Compare every output pixel with the double precision mean of its input block
+  int CheckBoxMean(vtkImageData* frame, int factor, double tolerance)
+  {
+    vtkNew<vtkTrackedScreenARDownscaleFilter> filter;
+    filter->SetInputData(frame);
+    filter->SetShrinkFactor(factor);
+    filter->Update();
+    vtkImageData* output = filter->GetOutput();
+    CHECK_INT(output->GetDimensions()[0], WIDTH / factor);
+    CHECK_INT(output->GetDimensions()[1], HEIGHT / factor);
+    CHECK_INT(output->GetScalarType(), frame->GetScalarType());
+    CHECK_INT(output->GetNumberOfScalarComponents(), frame->GetNumberOfScalarComponents());
+
+    for (int outRow = 0; outRow < HEIGHT / factor; ++outRow)
+    {
+      for (int outColumn = 0; outColumn < WIDTH / factor; ++outColumn)
+      {
+        for (int component = 0; component < frame->GetNumberOfScalarComponents(); ++component)
+        {
+          double sum = 0.0;
+          for (int row = outRow * factor; row < (outRow + 1) * factor; ++row)
+          {
+            for (int column = outColumn * factor; column < (outColumn + 1) * factor; ++column)
+            {
+              sum += frame->GetScalarComponentAsDouble(column, row, 0, component);
+            }
+          }
+          CHECK_DOUBLE_TOLERANCE(output->GetScalarComponentAsDouble(outColumn, outRow, 0, component), sum / (factor * factor), tolerance);
+        }
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARDownscaleFilterTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Factors 2 to 4 use the unrolled kernels, the others the generic one
+  for (int factor = 1; factor <= 8; ++factor)
+  {
+    for (int numberOfComponents = 1; numberOfComponents <= 4; ++numberOfComponents)
+    {
+      vtkNew<vtkImageData> frame;
+      CreateFrame(VTK_UNSIGNED_CHAR, numberOfComponents, factor * 10 + numberOfComponents, frame.GetPointer());
+      // The 16-bit reciprocal of the block area rounds to within 0.58 of the exact mean
+      CHECK_EXIT_SUCCESS(CheckBoxMean(frame.GetPointer(), factor, 0.6));
+    }
+
+    vtkNew<vtkImageData> floatFrame;
+    CreateFrame(VTK_FLOAT, 3, factor, floatFrame.GetPointer());
+    CHECK_EXIT_SUCCESS(CheckBoxMean(floatFrame.GetPointer(), factor, 1e-4));
+  }
+
+  // Saturated blocks must not overflow the 16-bit row sums
+  vtkNew<vtkImageData> whiteFrame;
+  whiteFrame->SetDimensions(WIDTH, HEIGHT, 1);
+  whiteFrame->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+  memset(whiteFrame->GetScalarPointer(), 255, WIDTH * HEIGHT * 4);
+  for (int factor = 2; factor <= 8; ++factor)
+  {
+    CHECK_EXIT_SUCCESS(CheckBoxMean(whiteFrame.GetPointer(), factor, 0.0));
+  }
+
+  // A factor of 1 passes the frame through without copying
+  vtkNew<vtkImageData> frame;
+  CreateFrame(VTK_UNSIGNED_CHAR, 4, 1, frame.GetPointer());
+  vtkNew<vtkTrackedScreenARDownscaleFilter> filter;
+  filter->SetInputData(frame.GetPointer());
+  filter->Update();
+  CHECK_POINTER(filter->GetOutput()->GetScalarPointer(), frame->GetScalarPointer());
+
+  return EXIT_SUCCESS;
+}
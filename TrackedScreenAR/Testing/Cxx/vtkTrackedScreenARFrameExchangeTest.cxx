@@ -0,0 +1,211 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARFrameExchange.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+  const int WIDTH = 64;
+  const int HEIGHT = 48;
+
+  //----------------------------------------------------------------------------
+  // Frame whose every byte holds the same value, so a torn frame shows as mixed values
+  void FillFrame(vtkImageData* image, unsigned char value)
+  {
+    image->SetDimensions(WIDTH, HEIGHT, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    memset(image->GetScalarPointer(), value, WIDTH * HEIGHT * 3);
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsUniformFrame(vtkImageData* image, unsigned char value)
+  {
+    if (image->GetDimensions()[0] != WIDTH || image->GetDimensions()[1] != HEIGHT)
+    {
+      return false;
+    }
+    const unsigned char* pixels = static_cast<const unsigned char*>(image->GetScalarPointer());
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+    {
+      if (pixels[i] != value)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestPublishAcquire()
+  {
+    vtkNew<vtkTrackedScreenARFrameExchange> exchange;
+    CHECK_BOOL(exchange->AcquireLatestFrame(), false);
+    CHECK_DOUBLE(exchange->GetReadFrameTimestamp(), -1.0);
+
+    vtkNew<vtkImageData> image;
+    FillFrame(image.GetPointer(), 1);
+    CHECK_BOOL(exchange->WriteFrame(image.GetPointer(), 1.0), true);
+    CHECK_BOOL(exchange->AcquireLatestFrame(), true);
+    CHECK_DOUBLE(exchange->GetReadFrameTimestamp(), 1.0);
+    CHECK_BOOL(IsUniformFrame(exchange->GetReadFrame(), 1), true);
+    // Nothing new: the read frame is kept
+    CHECK_BOOL(exchange->AcquireLatestFrame(), false);
+    CHECK_DOUBLE(exchange->GetReadFrameTimestamp(), 1.0);
+
+    // The image is copied, the producer can reuse it right away
+    FillFrame(image.GetPointer(), 2);
+    CHECK_BOOL(IsUniformFrame(exchange->GetReadFrame(), 1), true);
+
+    // Frame 2 is replaced by frame 3 before the consumer comes, it is dropped
+    CHECK_BOOL(exchange->WriteFrame(image.GetPointer(), 2.0), true);
+    FillFrame(image.GetPointer(), 3);
+    CHECK_BOOL(exchange->WriteFrame(image.GetPointer(), 3.0), true);
+    CHECK_BOOL(exchange->AcquireLatestFrame(), true);
+    CHECK_DOUBLE(exchange->GetReadFrameTimestamp(), 3.0);
+    CHECK_BOOL(IsUniformFrame(exchange->GetReadFrame(), 3), true);
+    CHECK_BOOL(exchange->AcquireLatestFrame(), false);
+
+    // However many frames the producer writes, it never writes into the frame being read
+    vtkImageData* readFrame = exchange->GetReadFrame();
+    for (int frame = 4; frame < 10; ++frame)
+    {
+      FillFrame(image.GetPointer(), static_cast<unsigned char>(frame));
+      CHECK_BOOL(exchange->WriteFrame(image.GetPointer(), frame), true);
+      CHECK_BOOL(IsUniformFrame(readFrame, 3), true);
+    }
+    CHECK_BOOL(exchange->AcquireLatestFrame(), true);
+    CHECK_BOOL(IsUniformFrame(exchange->GetReadFrame(), 9), true);
+
+    unsigned long long publishedFrames = exchange->GetNumberOfPublishedFrames();
+    unsigned long long acquiredFrames = exchange->GetNumberOfAcquiredFrames();
+    unsigned long long droppedFrames = exchange->GetNumberOfDroppedFrames();
+    CHECK_INT(static_cast<int>(publishedFrames), 9);
+    CHECK_INT(static_cast<int>(acquiredFrames), 3);
+    CHECK_INT(static_cast<int>(droppedFrames), 6);
+    exchange->ResetFrameCounts();
+    publishedFrames = exchange->GetNumberOfPublishedFrames();
+    CHECK_INT(static_cast<int>(publishedFrames), 0);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestShareFrame()
+  {
+    vtkNew<vtkTrackedScreenARFrameExchange> exchange;
+    vtkNew<vtkImageData> emptyImage;
+    CHECK_BOOL(exchange->ShareFrame(emptyImage.GetPointer(), 1.0), false);
+
+    // Shared frames are the producer image, no pixel is copied
+    vtkNew<vtkImageData> image;
+    FillFrame(image.GetPointer(), 1);
+    CHECK_BOOL(exchange->ShareFrame(image.GetPointer(), 1.0), true);
+    CHECK_BOOL(exchange->AcquireLatestFrame(), true);
+    CHECK_POINTER(exchange->GetReadFrame()->GetScalarPointer(), image->GetScalarPointer());
+    CHECK_DOUBLE(exchange->GetReadFrameTimestamp(), 1.0);
+
+    // Copied frames written into a slot that shared an image do not write into that image
+    vtkNew<vtkImageData> copiedImage;
+    FillFrame(copiedImage.GetPointer(), 2);
+    for (int frame = 2; frame < 6; ++frame)
+    {
+      CHECK_BOOL(exchange->WriteFrame(copiedImage.GetPointer(), frame), true);
+      CHECK_BOOL(exchange->AcquireLatestFrame(), true);
+      CHECK_BOOL(IsUniformFrame(exchange->GetReadFrame(), 2), true);
+    }
+    CHECK_BOOL(IsUniformFrame(image.GetPointer(), 1), true);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Producer thread writing frames as fast as it can while the consumer acquires: every acquired frame
+  // must be whole and newer than the previous one
+  int TestConcurrentProducer()
+  {
+    const int numberOfFrames = 2000;
+    vtkNew<vtkTrackedScreenARFrameExchange> exchange;
+    std::atomic<bool> producerDone(false);
+    std::thread producer([&exchange, &producerDone]()
+    {
+      vtkNew<vtkImageData> image;
+      for (int frame = 1; frame <= numberOfFrames; ++frame)
+      {
+        FillFrame(image.GetPointer(), static_cast<unsigned char>(frame % 256));
+        exchange->WriteFrame(image.GetPointer(), frame);
+      }
+      producerDone = true;
+    });
+
+    double previousTimestamp = 0.0;
+    int numberOfTornFrames = 0;
+    int numberOfOutOfOrderFrames = 0;
+    bool done = false;
+    while (!done)
+    {
+      // Check once more after the producer finished, to get the last frame
+      done = producerDone;
+      if (!exchange->AcquireLatestFrame())
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      double timestamp = exchange->GetReadFrameTimestamp();
+      if (timestamp <= previousTimestamp)
+      {
+        ++numberOfOutOfOrderFrames;
+      }
+      if (!IsUniformFrame(exchange->GetReadFrame(), static_cast<unsigned char>(static_cast<int>(timestamp) % 256)))
+      {
+        ++numberOfTornFrames;
+      }
+      previousTimestamp = timestamp;
+    }
+    producer.join();
+
+    CHECK_INT(numberOfTornFrames, 0);
+    CHECK_INT(numberOfOutOfOrderFrames, 0);
+    CHECK_DOUBLE(previousTimestamp, numberOfFrames);
+    unsigned long long publishedFrames = exchange->GetNumberOfPublishedFrames();
+    unsigned long long acquiredFrames = exchange->GetNumberOfAcquiredFrames();
+    unsigned long long droppedFrames = exchange->GetNumberOfDroppedFrames();
+    CHECK_INT(static_cast<int>(publishedFrames), numberOfFrames);
+    CHECK_INT(static_cast<int>(acquiredFrames + droppedFrames), numberOfFrames);
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARFrameExchangeTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestPublishAcquire());
+  CHECK_EXIT_SUCCESS(TestShareFrame());
+  CHECK_EXIT_SUCCESS(TestConcurrentProducer());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,485 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Runs a synthetic video source and a synthetic tracker through the TrackedScreenAR logic
+// into an offscreen render window, and reports the cost of each rendered frame as JSON.
+// Each resolution is run with a moving and with a still tracker, without and with layered
+// rendering, which reports how often the cached scene layer was reused and the time it saved.
+// Not part of the test suite, run it manually on the target machine:
+//   vtkTrackedScreenARFrameLoopBenchmark [numberOfFrames] [output.json]
+// The report is written to standard output if no file is given.
+
+// TrackedScreenAR Logic includes
+#include "vtkSlicerTrackedScreenARLogic.h"
+#include "vtkTrackedScreenARFrameExchange.h"
+#include "vtkTrackedScreenARFramePacer.h"
+#include "vtkTrackedScreenARLatencyMonitor.h"
+#include "vtkTrackedScreenARSceneLayerPass.h"
+#include "vtkTrackedScreenARVideoSource.h"
+#include "vtkTrackedScreenARViewBinding.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLVectorVolumeNode.h>
+
+// Video cameras include
+#include <vtkMRMLPinholeCameraNode.h>
+
+// VTK includes
+#include <vtkActor.h>
+#include <vtkCamera.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix3x3.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSMPTools.h>
+#include <vtkSphereSource.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const int DEFAULT_NUMBER_OF_FRAMES = 300;
+  const int WARM_UP_FRAMES = 20;
+
+  // Acquisition rates of the simulated devices
+  const double VIDEO_FRAME_RATE = 60.0;
+  const double TRACKER_RATE = 250.0;
+
+  std::atomic<unsigned long long> AllocationCount(0);
+
+  // Heap functions counted in allocationsPerFrame, see the allocation hooks below main()
+#if defined(__GLIBC__)
+  const char* ALLOCATION_HOOKS = "malloc, calloc, realloc";
+#else
+  const char* ALLOCATION_HOOKS = "operator new";
+#endif
+
+  //----------------------------------------------------------------------------
+  struct LoopResult
+  {
+    int Width;
+    int Height;
+    bool Layered;
+    bool TrackerMoving;
+    std::vector<double> FrameTimes; // ms
+    double AllocationsPerFrame;
+    unsigned long long VideoFramesPublished;
+    unsigned long long VideoFramesAcquired;
+    unsigned long long VideoFramesDropped;
+    unsigned long long SupersededUpdates;
+    double MeanVideoLatency;
+    double P99VideoLatency;
+    double MeanRenderDuration;
+    unsigned long long LayerRenders;
+    unsigned long long CompositedFrames;
+  };
+
+  //----------------------------------------------------------------------------
+  void FillTestPattern(vtkImageData* image, int width, int height, int numberOfComponents)
+  {
+    image->SetDimensions(width, height, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, numberOfComponents);
+    unsigned char* pixel = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (int y = 0; y < height; ++y)
+    {
+      for (int x = 0; x < width; ++x)
+      {
+        for (int c = 0; c < numberOfComponents; ++c)
+        {
+          *pixel++ = static_cast<unsigned char>((x * (c + 1) + y * 3) & 0xff);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Deliver one camera frame: the device overwrites the image in place, like an OpenIGTLink volume update
+  void DeliverVideoFrame(vtkImageData* image, int frameIndex)
+  {
+    int* dimensions = image->GetDimensions();
+    int numberOfComponents = image->GetNumberOfScalarComponents();
+    unsigned char* firstRow = static_cast<unsigned char*>(image->GetScalarPointer());
+    std::fill(firstRow, firstRow + dimensions[0] * numberOfComponents, static_cast<unsigned char>(frameIndex & 0xff));
+    image->Modified();
+  }
+
+  //----------------------------------------------------------------------------
+  // Deliver one tracker pose: the tracked screen sways around the scene
+  void DeliverPose(vtkMRMLLinearTransformNode* node, double time)
+  {
+    vtkNew<vtkMatrix4x4> pose;
+    double angle = 0.3 * sin(2.0 * 3.141592653589793 * 0.5 * time);
+    pose->SetElement(0, 0, cos(angle));
+    pose->SetElement(0, 2, sin(angle));
+    pose->SetElement(2, 0, -sin(angle));
+    pose->SetElement(2, 2, cos(angle));
+    pose->SetElement(0, 3, 20.0 * sin(angle));
+    pose->SetElement(2, 3, -300.0);
+    node->SetMatrixTransformToParent(pose.GetPointer());
+  }
+
+  //----------------------------------------------------------------------------
+  // The module parents the view camera to the presented pose, do the same with the VTK camera
+  void ApplyPresentedPose(vtkMRMLLinearTransformNode* presentedNode, vtkCamera* camera)
+  {
+    vtkNew<vtkMatrix4x4> cameraToWorld;
+    presentedNode->GetMatrixTransformToParent(cameraToWorld.GetPointer());
+    double position[4] = { 0.0, 0.0, 0.0, 1.0 };
+    double focalPoint[4] = { 0.0, 0.0, 1.0, 1.0 };
+    double viewUp[4] = { 0.0, -1.0, 0.0, 0.0 };
+    cameraToWorld->MultiplyPoint(position, position);
+    cameraToWorld->MultiplyPoint(focalPoint, focalPoint);
+    cameraToWorld->MultiplyPoint(viewUp, viewUp);
+    camera->SetPosition(position);
+    camera->SetFocalPoint(focalPoint);
+    camera->SetViewUp(viewUp);
+  }
+
+  //----------------------------------------------------------------------------
+  double Percentile(std::vector<double> samples, double percentile)
+  {
+    if (samples.empty())
+    {
+      return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * samples.size()));
+    rank = std::max<size_t>(rank, 1) - 1;
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+  }
+
+  //----------------------------------------------------------------------------
+  LoopResult RunFrameLoop(int width, int height, int numberOfFrames, bool layered, bool trackerMoving)
+  {
+    LoopResult result;
+    result.Width = width;
+    result.Height = height;
+    result.Layered = layered;
+    result.TrackerMoving = trackerMoving;
+
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkSlicerTrackedScreenARLogic> logic;
+    logic->SetMRMLScene(scene.GetPointer());
+
+    // Synthetic video source
+    vtkNew<vtkImageData> videoImage;
+    FillTestPattern(videoImage.GetPointer(), width, height, 3);
+    vtkNew<vtkMRMLVectorVolumeNode> videoNode;
+    videoNode->SetName("SyntheticVideo");
+    scene->AddNode(videoNode.GetPointer());
+    videoNode->SetAndObserveImageData(videoImage.GetPointer());
+
+    // Calibrated camera with a typical wide-angle distortion
+    vtkNew<vtkMRMLPinholeCameraNode> cameraParameters;
+    scene->AddNode(cameraParameters.GetPointer());
+    vtkNew<vtkMatrix3x3> intrinsics;
+    intrinsics->SetElement(0, 0, width * 0.9);
+    intrinsics->SetElement(1, 1, width * 0.9);
+    intrinsics->SetElement(0, 2, width * 0.5);
+    intrinsics->SetElement(1, 2, height * 0.5);
+    cameraParameters->SetAndObserveIntrinsicMatrix(intrinsics.GetPointer());
+    vtkNew<vtkDoubleArray> distortion;
+    const double coefficients[5] = { -0.28, 0.07, 0.0005, -0.0003, 0.0 };
+    for (double coefficient : coefficients)
+    {
+      distortion->InsertNextValue(coefficient);
+    }
+    cameraParameters->SetAndObserveDistortionCoefficients(distortion.GetPointer());
+
+    // Synthetic tracker
+    vtkNew<vtkMRMLLinearTransformNode> trackerNode;
+    scene->AddNode(trackerNode.GetPointer());
+    DeliverPose(trackerNode.GetPointer(), 0.0);
+
+    // Offscreen view of the size of the video, with something to draw over the background
+    vtkNew<vtkRenderWindow> renderWindow;
+    renderWindow->SetOffScreenRendering(1);
+    renderWindow->SetSize(width, height);
+    vtkNew<vtkRenderer> renderer;
+    renderWindow->AddRenderer(renderer.GetPointer());
+    vtkNew<vtkSphereSource> sphere;
+    sphere->SetRadius(30.0);
+    sphere->SetThetaResolution(64);
+    sphere->SetPhiResolution(64);
+    vtkNew<vtkPolyDataMapper> mapper;
+    mapper->SetInputConnection(sphere->GetOutputPort());
+    vtkNew<vtkActor> actor;
+    actor->SetMapper(mapper.GetPointer());
+    renderer->AddActor(actor.GetPointer());
+
+    vtkTrackedScreenARViewBinding* binding = logic->AddViewBinding("vtkMRMLViewNodeBenchmark");
+    logic->SetRenderWindow(binding, renderWindow.GetPointer());
+    logic->SetVideoSourceNode(binding, videoNode.GetPointer());
+    logic->SetCameraParametersNode(binding, cameraParameters.GetPointer());
+    logic->SetCameraTransformNode(binding, trackerNode.GetPointer());
+    logic->SetLayeredRendering(binding, layered);
+    logic->UpdateCameraProjection(binding, renderer->GetActiveCamera());
+
+    // The logic shows the video in the background of the first renderer of the window
+    vtkTrackedScreenARVideoSource* source = binding->GetVideoSource();
+    vtkMRMLLinearTransformNode* presentedNode = logic->GetPresentedCameraTransformNode(binding);
+
+    // Devices deliver at their own rate: before each render, deliver what they produced since the last one
+    double startTime = vtkTimerLog::GetUniversalTime();
+    int videoFrames = 0;
+    int trackerPoses = 0;
+    std::vector<double> frameTimes;
+    frameTimes.reserve(numberOfFrames);
+    unsigned long long allocationsAtStart = 0;
+    for (int frame = 0; frame < WARM_UP_FRAMES + numberOfFrames; ++frame)
+    {
+      if (frame == WARM_UP_FRAMES)
+      {
+        source->GetFrameExchange()->ResetFrameCounts();
+        binding->GetFramePacer()->ResetStatistics();
+        binding->GetLatencyMonitor()->Reset();
+        binding->GetSceneLayerPass()->ResetFrameCounts();
+        allocationsAtStart = AllocationCount.load();
+      }
+
+      double frameStart = vtkTimerLog::GetUniversalTime();
+      double elapsed = frameStart - startTime;
+      for (; videoFrames <= static_cast<int>(elapsed * VIDEO_FRAME_RATE); ++videoFrames)
+      {
+        DeliverVideoFrame(videoImage.GetPointer(), videoFrames);
+      }
+      for (; trackerPoses <= static_cast<int>(elapsed * TRACKER_RATE); ++trackerPoses)
+      {
+        // A still tracker keeps sending the same pose
+        DeliverPose(trackerNode.GetPointer(), trackerMoving ? trackerPoses / TRACKER_RATE : 0.0);
+      }
+
+      if (logic->BeginFrame(binding) != 0)
+      {
+        ApplyPresentedPose(presentedNode, renderer->GetActiveCamera());
+      }
+      renderWindow->Render();
+
+      if (frame >= WARM_UP_FRAMES)
+      {
+        frameTimes.push_back((vtkTimerLog::GetUniversalTime() - frameStart) * 1000.0);
+      }
+    }
+
+    result.FrameTimes = frameTimes;
+    result.AllocationsPerFrame = static_cast<double>(AllocationCount.load() - allocationsAtStart) / numberOfFrames;
+    result.VideoFramesPublished = source->GetFrameExchange()->GetNumberOfPublishedFrames();
+    result.VideoFramesAcquired = source->GetFrameExchange()->GetNumberOfAcquiredFrames();
+    result.VideoFramesDropped = source->GetFrameExchange()->GetNumberOfDroppedFrames();
+    result.SupersededUpdates = binding->GetFramePacer()->GetDroppedUpdateCount();
+    result.MeanVideoLatency = binding->GetLatencyMonitor()->GetMean(vtkTrackedScreenARLatencyMonitor::VideoLatency);
+    result.P99VideoLatency = binding->GetLatencyMonitor()->GetPercentile(vtkTrackedScreenARLatencyMonitor::VideoLatency, 99.0);
+    result.MeanRenderDuration = binding->GetLatencyMonitor()->GetMean(vtkTrackedScreenARLatencyMonitor::RenderDuration);
+    result.LayerRenders = binding->GetSceneLayerPass()->GetNumberOfLayerRenders();
+    result.CompositedFrames = binding->GetSceneLayerPass()->GetNumberOfCompositedFrames();
+
+    logic->RemoveViewBinding(binding->GetViewNodeID());
+    return result;
+  }
+
+  //----------------------------------------------------------------------------
+  double MeanFrameTime(const LoopResult& result)
+  {
+    double total = std::accumulate(result.FrameTimes.begin(), result.FrameTimes.end(), 0.0);
+    return total / std::max<size_t>(1, result.FrameTimes.size());
+  }
+
+  //----------------------------------------------------------------------------
+  // Run of the same resolution and tracker motion without layered rendering, nullptr if none
+  const LoopResult* FindUnlayeredResult(const std::vector<LoopResult>& results, const LoopResult& layeredResult)
+  {
+    for (const LoopResult& result : results)
+    {
+      if (!result.Layered && result.Width == layeredResult.Width && result.Height == layeredResult.Height
+          && result.TrackerMoving == layeredResult.TrackerMoving)
+      {
+        return &result;
+      }
+    }
+    return nullptr;
+  }
+
+  //----------------------------------------------------------------------------
+  void WriteJson(std::ostream& os, int numberOfFrames, const std::vector<LoopResult>& results)
+  {
+    os << "{\n";
+    os << "  \"benchmark\": \"TrackedScreenARFrameLoop\",\n";
+    os << "  \"frames\": " << numberOfFrames << ",\n";
+    os << "  \"smpThreads\": " << vtkSMPTools::GetEstimatedNumberOfThreads() << ",\n";
+    os << "  \"videoFrameRate\": " << VIDEO_FRAME_RATE << ",\n";
+    os << "  \"trackerRate\": " << TRACKER_RATE << ",\n";
+    os << "  \"allocationHooks\": \"" << ALLOCATION_HOOKS << "\",\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+      const LoopResult& result = results[i];
+      double maximum = result.FrameTimes.empty() ? 0.0 : *std::max_element(result.FrameTimes.begin(), result.FrameTimes.end());
+      os << "    {\n";
+      os << "      \"resolution\": \"" << result.Width << "x" << result.Height << "\",\n";
+      os << "      \"tracker\": \"" << (result.TrackerMoving ? "moving" : "still") << "\",\n";
+      os << "      \"layeredRendering\": " << (result.Layered ? "true" : "false") << ",\n";
+      os << "      \"msPerFrame\": {"
+         << " \"mean\": " << MeanFrameTime(result)
+         << ", \"p50\": " << Percentile(result.FrameTimes, 50.0)
+         << ", \"p90\": " << Percentile(result.FrameTimes, 90.0)
+         << ", \"p99\": " << Percentile(result.FrameTimes, 99.0)
+         << ", \"max\": " << maximum << " },\n";
+      os << "      \"allocationsPerFrame\": " << result.AllocationsPerFrame << ",\n";
+      os << "      \"videoFrames\": {"
+         << " \"published\": " << result.VideoFramesPublished
+         << ", \"acquired\": " << result.VideoFramesAcquired
+         << ", \"dropped\": " << result.VideoFramesDropped << " },\n";
+      os << "      \"supersededUpdates\": " << result.SupersededUpdates << ",\n";
+      os << "      \"meanVideoLatencyMs\": " << result.MeanVideoLatency << ",\n";
+      os << "      \"p99VideoLatencyMs\": " << result.P99VideoLatency << ",\n";
+      os << "      \"meanRenderDurationMs\": " << result.MeanRenderDuration;
+      if (result.Layered)
+      {
+        // Share of the renders that only composited the cached scene over the new background
+        unsigned long long renders = result.LayerRenders + result.CompositedFrames;
+        os << ",\n      \"sceneLayer\": {"
+           << " \"layerRenders\": " << result.LayerRenders
+           << ", \"compositedFrames\": " << result.CompositedFrames
+           << ", \"hitRate\": " << (renders > 0 ? static_cast<double>(result.CompositedFrames) / renders : 0.0);
+        const LoopResult* unlayeredResult = FindUnlayeredResult(results, result);
+        if (unlayeredResult != nullptr)
+        {
+          os << ", \"msSavedPerFrame\": " << MeanFrameTime(*unlayeredResult) - MeanFrameTime(result)
+             << ", \"renderMsSaved\": " << unlayeredResult->MeanRenderDuration - result.MeanRenderDuration;
+        }
+        os << " }";
+      }
+      os << "\n";
+      os << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n";
+    os << "}\n";
+  }
+}
+
+#if defined(__GLIBC__)
+//----------------------------------------------------------------------------
+// Count every heap allocation of the process: image buffers (malloc and realloc of the data
+// arrays) as well as VTK objects, information entries and STL containers, whose operator new
+// ends up in malloc. The definitions interpose the C library ones for all loaded libraries.
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* pointer, size_t size);
+
+  //----------------------------------------------------------------------------
+  void* malloc(size_t size)
+  {
+    ++AllocationCount;
+    return __libc_malloc(size);
+  }
+
+  //----------------------------------------------------------------------------
+  void* calloc(size_t count, size_t size)
+  {
+    ++AllocationCount;
+    return __libc_calloc(count, size);
+  }
+
+  //----------------------------------------------------------------------------
+  void* realloc(void* pointer, size_t size)
+  {
+    ++AllocationCount;
+    return __libc_realloc(pointer, size);
+  }
+}
+#else
+//----------------------------------------------------------------------------
+// The C library allocator cannot be interposed portably, only operator new is counted:
+// VTK objects, information entries and STL containers are, image buffers are not.
+void* operator new(std::size_t size)
+{
+  ++AllocationCount;
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* pointer) noexcept
+{
+  free(pointer);
+}
+#endif
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int numberOfFrames = DEFAULT_NUMBER_OF_FRAMES;
+  if (argc > 1)
+  {
+    numberOfFrames = std::max(1, atoi(argv[1]));
+  }
+
+  const int sizes[][2] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+  std::vector<LoopResult> results;
+  for (const auto& size : sizes)
+  {
+    for (bool trackerMoving : { true, false })
+    {
+      for (bool layered : { false, true })
+      {
+        std::cerr << "Frame loop " << size[0] << "x" << size[1] << (trackerMoving ? ", moving" : ", still") << " tracker"
+                  << (layered ? ", layered" : "") << "..." << std::endl;
+        results.push_back(RunFrameLoop(size[0], size[1], numberOfFrames, layered, trackerMoving));
+      }
+    }
+  }
+
+  if (argc > 2)
+  {
+    std::ofstream file(argv[2]);
+    if (!file)
+    {
+      std::cerr << "Cannot write " << argv[2] << std::endl;
+      return EXIT_FAILURE;
+    }
+    WriteJson(file, numberOfFrames, results);
+  }
+  else
+  {
+    WriteJson(std::cout, numberOfFrames, results);
+  }
+  return EXIT_SUCCESS;
+}
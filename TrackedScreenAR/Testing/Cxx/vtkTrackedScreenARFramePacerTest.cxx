@@ -0,0 +1,75 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARFramePacer.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARFramePacerTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkTrackedScreenARFramePacer> pacer;
+  pacer->SetTargetFPS(50.0);
+  CHECK_BOOL(pacer->IsRenderPending(), false);
+  CHECK_INT(pacer->BeginFrame(0.0), 0);
+  CHECK_INT(pacer->GetRenderCount(), 0);
+
+  // The first update schedules the render, the others join it
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::VideoSource), true);
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::PoseSource), false);
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::SceneSource), false);
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::VideoSource), false);
+  CHECK_INT(pacer->GetMergedUpdateCount(), 2);
+  CHECK_INT(pacer->GetDroppedUpdateCount(), 1);
+  CHECK_BOOL(pacer->IsRenderPending(), true);
+
+  // Never rendered: due now
+  CHECK_DOUBLE(pacer->GetDelayToNextFrame(10.0), 0.0);
+  CHECK_INT(pacer->BeginFrame(10.0), vtkTrackedScreenARFramePacer::VideoSource | vtkTrackedScreenARFramePacer::PoseSource
+                                     | vtkTrackedScreenARFramePacer::SceneSource);
+  CHECK_INT(pacer->GetDirtySources(), 0);
+  CHECK_INT(pacer->GetRenderCount(), 1);
+
+  // At 50 fps the next render is due 20 ms after the last one
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::SceneSource), true);
+  CHECK_DOUBLE_TOLERANCE(pacer->GetDelayToNextFrame(10.005), 0.015, 1e-9);
+  CHECK_DOUBLE(pacer->GetDelayToNextFrame(10.5), 0.0);
+  CHECK_INT(pacer->BeginFrame(10.02), vtkTrackedScreenARFramePacer::SceneSource);
+  CHECK_INT(pacer->GetRenderCount(), 2);
+
+  // A render requested that nobody issued absorbs the next updates until the pacer is reset
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::VideoSource), true);
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::SceneSource), false);
+  pacer->Reset();
+  CHECK_BOOL(pacer->IsRenderPending(), false);
+  CHECK_INT(pacer->GetRenderCount(), 2);
+  CHECK_BOOL(pacer->MarkDirty(vtkTrackedScreenARFramePacer::SceneSource), true);
+  CHECK_DOUBLE(pacer->GetDelayToNextFrame(10.021), 0.0);
+  CHECK_INT(pacer->BeginFrame(10.021), vtkTrackedScreenARFramePacer::SceneSource);
+
+  pacer->ResetStatistics();
+  CHECK_INT(pacer->GetRenderCount(), 0);
+  CHECK_INT(pacer->GetMergedUpdateCount(), 0);
+  CHECK_INT(pacer->GetDroppedUpdateCount(), 0);
+  return EXIT_SUCCESS;
+}
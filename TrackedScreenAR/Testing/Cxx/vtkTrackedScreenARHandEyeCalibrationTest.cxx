@@ -0,0 +1,198 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARHandEyeCalibration.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <random>
+
+namespace
+{
+  // Pose errors tolerated on the solution, in mm and degrees
+  const double TRANSLATION_TOLERANCE = 0.5;
+  const double ROTATION_TOLERANCE = 0.25;
+
+  // Recalibrating between cases must not take longer, on any machine running the tests
+  const double MAXIMUM_SOLVE_TIME = 5.0;
+
+  const int NUMBER_OF_SAMPLES = 50;
+  const int NUMBER_OF_OUTLIERS = 10;
+
+  //----------------------------------------------------------------------------
+  // Rotation of the given angle (degrees) about the given axis, then translation
+  void SetPose(vtkMatrix4x4* matrix, const double axis[3], double angle, const double translation[3])
+  {
+    double unitAxis[3] = { axis[0], axis[1], axis[2] };
+    vtkMath::Normalize(unitAxis);
+    double c = cos(vtkMath::RadiansFromDegrees(angle));
+    double s = sin(vtkMath::RadiansFromDegrees(angle));
+    matrix->Identity();
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        matrix->SetElement(row, column, (1.0 - c) * unitAxis[row] * unitAxis[column] + (row == column ? c : 0.0));
+      }
+      matrix->SetElement(row, 3, translation[row]);
+    }
+    matrix->SetElement(0, 1, matrix->GetElement(0, 1) - s * unitAxis[2]);
+    matrix->SetElement(0, 2, matrix->GetElement(0, 2) + s * unitAxis[1]);
+    matrix->SetElement(1, 0, matrix->GetElement(1, 0) + s * unitAxis[2]);
+    matrix->SetElement(1, 2, matrix->GetElement(1, 2) - s * unitAxis[0]);
+    matrix->SetElement(2, 0, matrix->GetElement(2, 0) - s * unitAxis[1]);
+    matrix->SetElement(2, 1, matrix->GetElement(2, 1) + s * unitAxis[0]);
+  }
+
+  //----------------------------------------------------------------------------
+  // Random pose with the given rotation (degrees) and translation (mm) magnitudes
+  void SetRandomPose(vtkMatrix4x4* matrix, std::mt19937& generator, double angle, double translation)
+  {
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    double axis[3] = { normal(generator), normal(generator), normal(generator) };
+    double position[3] = { translation * uniform(generator), translation * uniform(generator), translation * uniform(generator) };
+    SetPose(matrix, axis, angle * uniform(generator), position);
+  }
+
+  //----------------------------------------------------------------------------
+  // Translation (mm) and rotation (degrees) between two rigid transforms
+  void ComputePoseError(vtkMatrix4x4* a, vtkMatrix4x4* b, double& translationError, double& rotationError)
+  {
+    vtkNew<vtkMatrix4x4> difference;
+    vtkNew<vtkMatrix4x4> inverse;
+    vtkMatrix4x4::Invert(b, inverse.GetPointer());
+    vtkMatrix4x4::Multiply4x4(a, inverse.GetPointer(), difference.GetPointer());
+    double trace = difference->GetElement(0, 0) + difference->GetElement(1, 1) + difference->GetElement(2, 2);
+    rotationError = vtkMath::DegreesFromRadians(acos(std::max(-1.0, std::min(1.0, (trace - 1.0) / 2.0))));
+    translationError = sqrt(pow(a->GetElement(0, 3) - b->GetElement(0, 3), 2) + pow(a->GetElement(1, 3) - b->GetElement(1, 3), 2)
+                            + pow(a->GetElement(2, 3) - b->GetElement(2, 3), 2));
+  }
+
+  //----------------------------------------------------------------------------
+  // Samples of a camera mounted on a marker, viewing a static pattern: M X P is the same for every
+  // sample, up to detection noise. The last samples are wrong detections.
+  void AddSamples(vtkTrackedScreenARHandEyeCalibration* calibration, vtkMatrix4x4* cameraToMarker, int numberOfSamples, int numberOfOutliers)
+  {
+    std::mt19937 generator(1);
+    vtkNew<vtkMatrix4x4> patternToTracker;
+    const double patternAxis[3] = { 0.0, 0.0, 1.0 };
+    const double patternPosition[3] = { 100.0, 200.0, -300.0 };
+    SetPose(patternToTracker.GetPointer(), patternAxis, 45.0, patternPosition);
+
+    vtkNew<vtkMatrix4x4> markerToTracker;
+    vtkNew<vtkMatrix4x4> trackerToCamera;
+    vtkNew<vtkMatrix4x4> patternToCamera;
+    vtkNew<vtkMatrix4x4> noise;
+    for (int sample = 0; sample < numberOfSamples; ++sample)
+    {
+      SetRandomPose(markerToTracker.GetPointer(), generator, 60.0, 200.0);
+      // P = inv(X) inv(M) T
+      vtkMatrix4x4::Multiply4x4(markerToTracker.GetPointer(), cameraToMarker, trackerToCamera.GetPointer());
+      trackerToCamera->Invert();
+      vtkMatrix4x4::Multiply4x4(trackerToCamera.GetPointer(), patternToTracker.GetPointer(), patternToCamera.GetPointer());
+      bool outlier = (sample >= numberOfSamples - numberOfOutliers);
+      SetRandomPose(noise.GetPointer(), generator, outlier ? 20.0 : 0.05, outlier ? 30.0 : 0.1);
+      vtkMatrix4x4::Multiply4x4(patternToCamera.GetPointer(), noise.GetPointer(), patternToCamera.GetPointer());
+      calibration->AddSample(markerToTracker.GetPointer(), patternToCamera.GetPointer());
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckCalibration(vtkTrackedScreenARHandEyeCalibration* calibration, vtkMatrix4x4* expectedCameraToMarker)
+  {
+    CHECK_INT(calibration->GetState(), vtkTrackedScreenARHandEyeCalibration::Succeeded);
+    vtkNew<vtkMatrix4x4> cameraToMarker;
+    CHECK_BOOL(calibration->GetCameraToMarker(cameraToMarker.GetPointer()), true);
+    double translationError = 0.0;
+    double rotationError = 0.0;
+    ComputePoseError(cameraToMarker.GetPointer(), expectedCameraToMarker, translationError, rotationError);
+    CHECK_BOOL(translationError < TRANSLATION_TOLERANCE, true);
+    CHECK_BOOL(rotationError < ROTATION_TOLERANCE, true);
+    CHECK_INT(calibration->GetNumberOfInliers(), NUMBER_OF_SAMPLES - NUMBER_OF_OUTLIERS);
+    CHECK_BOOL(calibration->GetSolveTime() < MAXIMUM_SOLVE_TIME, true);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  void SetCameraToMarker(vtkMatrix4x4* cameraToMarker)
+  {
+    const double axis[3] = { 1.0, 1.0, 0.0 };
+    const double translation[3] = { 20.0, -10.0, 50.0 };
+    SetPose(cameraToMarker, axis, 30.0, translation);
+  }
+
+  //----------------------------------------------------------------------------
+  int TestTooFewSamples()
+  {
+    vtkNew<vtkTrackedScreenARHandEyeCalibration> calibration;
+    vtkNew<vtkMatrix4x4> cameraToMarker;
+    SetCameraToMarker(cameraToMarker.GetPointer());
+    AddSamples(calibration.GetPointer(), cameraToMarker.GetPointer(), 2, 0);
+    TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+    CHECK_BOOL(calibration->Start(), false);
+    TESTING_OUTPUT_ASSERT_ERRORS_END();
+    CHECK_INT(calibration->GetState(), vtkTrackedScreenARHandEyeCalibration::Idle);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSolve()
+  {
+    vtkNew<vtkTrackedScreenARHandEyeCalibration> calibration;
+    vtkNew<vtkMatrix4x4> cameraToMarker;
+    SetCameraToMarker(cameraToMarker.GetPointer());
+    AddSamples(calibration.GetPointer(), cameraToMarker.GetPointer(), NUMBER_OF_SAMPLES, NUMBER_OF_OUTLIERS);
+    CHECK_BOOL(calibration->Solve(), true);
+    CHECK_EXIT_SUCCESS(CheckCalibration(calibration.GetPointer(), cameraToMarker.GetPointer()));
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestWorkerThread()
+  {
+    vtkNew<vtkTrackedScreenARHandEyeCalibration> calibration;
+    vtkNew<vtkMatrix4x4> cameraToMarker;
+    SetCameraToMarker(cameraToMarker.GetPointer());
+    AddSamples(calibration.GetPointer(), cameraToMarker.GetPointer(), NUMBER_OF_SAMPLES, NUMBER_OF_OUTLIERS);
+    CHECK_BOOL(calibration->Start(), true);
+    // Samples are locked while solving
+    vtkNew<vtkMatrix4x4> identity;
+    CHECK_BOOL(calibration->GetState() != vtkTrackedScreenARHandEyeCalibration::Running
+               || !calibration->AddSample(identity.GetPointer(), identity.GetPointer()), true);
+    calibration->Wait();
+    CHECK_EXIT_SUCCESS(CheckCalibration(calibration.GetPointer(), cameraToMarker.GetPointer()));
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARHandEyeCalibrationTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestTooFewSamples());
+  CHECK_EXIT_SUCCESS(TestSolve());
+  CHECK_EXIT_SUCCESS(TestWorkerThread());
+  return EXIT_SUCCESS;
+}
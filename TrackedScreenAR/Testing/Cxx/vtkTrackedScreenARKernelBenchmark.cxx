@@ -0,0 +1,225 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Times the per-frame image kernels of the TrackedScreenAR pipeline on synthetic frames.
+// Not part of the test suite, run it manually on the target machine:
+//   vtkTrackedScreenARKernelBenchmark [numberOfFrames]
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARDownscaleFilter.h"
+#include "vtkTrackedScreenARPixelFormatConverter.h"
+#include "vtkTrackedScreenARUndistortionFilter.h"
+
+// VTK includes
+#include <vtkAlgorithm.h>
+#include <vtkImageData.h>
+#include <vtkImageExtractComponents.h>
+#include <vtkNew.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace
+{
+  const int DEFAULT_NUMBER_OF_FRAMES = 200;
+
+  //----------------------------------------------------------------------------
+  void FillTestPattern(vtkImageData* image, int width, int height, int numberOfComponents)
+  {
+    image->SetDimensions(width, height, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, numberOfComponents);
+    unsigned char* pixel = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (int y = 0; y < height; ++y)
+    {
+      for (int x = 0; x < width; ++x)
+      {
+        for (int c = 0; c < numberOfComponents; ++c)
+        {
+          *pixel++ = static_cast<unsigned char>((x * (c + 1) + y * 3) & 0xff);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void PrintResult(const char* name, int numberOfFrames, double seconds)
+  {
+    std::cout << "  " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << seconds * 1000.0 / numberOfFrames << " ms/frame" << std::endl;
+  }
+
+  //----------------------------------------------------------------------------
+  double TimeFilter(vtkAlgorithm* filter, vtkImageData* frame, int numberOfFrames)
+  {
+    // The first update allocates outputs and builds caches, only the steady state is timed
+    filter->SetInputDataObject(frame);
+    filter->Update();
+
+    vtkNew<vtkTimerLog> timer;
+    timer->StartTimer();
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      frame->Modified();
+      filter->Update();
+    }
+    timer->StopTimer();
+    return timer->GetElapsedTime();
+  }
+
+  //----------------------------------------------------------------------------
+  void BenchmarkPixelFormatConversion(int numberOfFrames)
+  {
+    const int width = 1920;
+    const int height = 1080;
+    std::cout << "Pixel format conversion " << width << "x" << height << ", kernels: "
+              << vtkTrackedScreenARPixelFormatConverter::GetInstructionSetAsString(vtkTrackedScreenARPixelFormatConverter::GetWidestInstructionSet()) << std::endl;
+
+    // BGR: the converter against the VTK filter route used so far
+    vtkNew<vtkImageData> bgrFrame;
+    FillTestPattern(bgrFrame.GetPointer(), width, height, 3);
+    vtkNew<vtkImageExtractComponents> extractComponents;
+    extractComponents->SetComponents(2, 1, 0);
+    PrintResult("BGR, vtkImageExtractComponents", numberOfFrames, TimeFilter(extractComponents.GetPointer(), bgrFrame.GetPointer(), numberOfFrames));
+
+    const int formats[] =
+    {
+      vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR,
+      vtkTrackedScreenARPixelFormatConverter::PixelFormatBGRA,
+      vtkTrackedScreenARPixelFormatConverter::PixelFormatNV12,
+      vtkTrackedScreenARPixelFormatConverter::PixelFormatI420,
+      vtkTrackedScreenARPixelFormatConverter::PixelFormatYUYV,
+      vtkTrackedScreenARPixelFormatConverter::PixelFormatUYVY
+    };
+    for (int format : formats)
+    {
+      vtkNew<vtkImageData> frame;
+      switch (format)
+      {
+        case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR:
+          FillTestPattern(frame.GetPointer(), width, height, 3);
+          break;
+        case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGRA:
+          FillTestPattern(frame.GetPointer(), width, height, 4);
+          break;
+        case vtkTrackedScreenARPixelFormatConverter::PixelFormatNV12:
+        case vtkTrackedScreenARPixelFormatConverter::PixelFormatI420:
+          FillTestPattern(frame.GetPointer(), width, height * 3 / 2, 1);
+          break;
+        default:
+          FillTestPattern(frame.GetPointer(), width, height, 2);
+          break;
+      }
+
+      vtkNew<vtkTrackedScreenARPixelFormatConverter> converter;
+      converter->SetPixelFormat(format);
+      std::string name = vtkTrackedScreenARPixelFormatConverter::GetPixelFormatAsString(format);
+      converter->SetInstructionSet(vtkTrackedScreenARPixelFormatConverter::InstructionSetScalar);
+      PrintResult((name + ", scalar").c_str(), numberOfFrames, TimeFilter(converter.GetPointer(), frame.GetPointer(), numberOfFrames));
+      converter->SetInstructionSet(vtkTrackedScreenARPixelFormatConverter::InstructionSetAuto);
+      PrintResult((name + ", vectorized").c_str(), numberOfFrames, TimeFilter(converter.GetPointer(), frame.GetPointer(), numberOfFrames));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  double TimeUndistortion(vtkImageData* frame, int numberOfFrames)
+  {
+    vtkNew<vtkTrackedScreenARUndistortionFilter> filter;
+    int* dimensions = frame->GetDimensions();
+    filter->SetIntrinsics(dimensions[0] * 0.9, dimensions[0] * 0.9, dimensions[0] * 0.5, dimensions[1] * 0.5);
+    double coefficients[5] = { -0.28, 0.07, 0.0005, -0.0003, 0.0 };
+    filter->SetDistortionCoefficients(coefficients);
+
+    double seconds = TimeFilter(filter.GetPointer(), frame, numberOfFrames);
+    if (filter->GetRemapTableBuildCount() != 1)
+    {
+      std::cerr << "Remap table was rebuilt " << filter->GetRemapTableBuildCount() << " times" << std::endl;
+    }
+    return seconds;
+  }
+
+  //----------------------------------------------------------------------------
+  void BenchmarkUndistortion(int numberOfFrames)
+  {
+    const int sizes[][2] = { { 1280, 720 }, { 1920, 1080 } };
+    for (const auto& size : sizes)
+    {
+      vtkNew<vtkImageData> frame;
+      FillTestPattern(frame.GetPointer(), size[0], size[1], 3);
+
+      std::cout << "Undistortion " << size[0] << "x" << size[1] << " RGB" << std::endl;
+
+      vtkNew<vtkTrackedScreenARUndistortionFilter> builder;
+      builder->SetIntrinsics(size[0] * 0.9, size[0] * 0.9, size[0] * 0.5, size[1] * 0.5);
+      builder->SetDistortionCoefficients(-0.28, 0.07, 0.0005, -0.0003, 0.0);
+      builder->SetInputData(frame.GetPointer());
+      vtkNew<vtkTimerLog> timer;
+      timer->StartTimer();
+      builder->Update();
+      timer->StopTimer();
+      PrintResult("remap table build + first frame", 1, timer->GetElapsedTime());
+
+      vtkSMPTools::Initialize(1);
+      PrintResult("remap, 1 thread", numberOfFrames, TimeUndistortion(frame.GetPointer(), numberOfFrames));
+      vtkSMPTools::Initialize(0);
+      PrintResult("remap, all threads", numberOfFrames, TimeUndistortion(frame.GetPointer(), numberOfFrames));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void BenchmarkDownscale(int numberOfFrames)
+  {
+    // A 4K camera shown in a 1080p or 720p view
+    const int width = 3840;
+    const int height = 2160;
+    vtkNew<vtkImageData> frame;
+    FillTestPattern(frame.GetPointer(), width, height, 4);
+    std::cout << "Downscale " << width << "x" << height << " RGBA" << std::endl;
+
+    const int factors[] = { 2, 3 };
+    for (int factor : factors)
+    {
+      vtkNew<vtkTrackedScreenARDownscaleFilter> filter;
+      filter->SetShrinkFactor(factor);
+      std::string name = "box filter, factor " + std::to_string(factor);
+      PrintResult(name.c_str(), numberOfFrames, TimeFilter(filter.GetPointer(), frame.GetPointer(), numberOfFrames));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int numberOfFrames = DEFAULT_NUMBER_OF_FRAMES;
+  if (argc > 1)
+  {
+    numberOfFrames = std::max(1, atoi(argv[1]));
+  }
+
+  std::cout << "SMP threads: " << vtkSMPTools::GetEstimatedNumberOfThreads() << std::endl;
+
+  BenchmarkPixelFormatConversion(numberOfFrames);
+  BenchmarkUndistortion(numberOfFrames);
+  BenchmarkDownscale(numberOfFrames);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARLatencyMonitor.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+
+namespace
+{
+  const double TOLERANCE = 1e-6;
+
+  //----------------------------------------------------------------------------
+  void RecordRender(vtkTrackedScreenARLatencyMonitor* monitor, double start, double end)
+  {
+    monitor->RecordRenderStart(start);
+    monitor->RecordRenderEnd(end);
+  }
+
+  //----------------------------------------------------------------------------
+  int TestLatencies()
+  {
+    vtkNew<vtkTrackedScreenARLatencyMonitor> monitor;
+    CHECK_INT(monitor->GetNumberOfFrames(), 0);
+    CHECK_DOUBLE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::VideoLatency), 0.0);
+
+    // A render end without a start is not a frame
+    monitor->RecordRenderEnd(9.0);
+    CHECK_INT(monitor->GetNumberOfFrames(), 0);
+
+    // No pose arrived yet: the pose latency of the frame is unknown and ignored
+    monitor->RecordImageArrival(10.000);
+    RecordRender(monitor.GetPointer(), 10.010, 10.015);
+
+    // The same video frame is displayed again, it got older
+    monitor->RecordPoseArrival(10.020);
+    RecordRender(monitor.GetPointer(), 10.030, 10.040);
+
+    // The presented pose is synchronized to an older video frame, it is older than the latest arrival
+    monitor->RecordPresentedPose(10.005);
+    monitor->RecordImageArrival(10.045);
+    RecordRender(monitor.GetPointer(), 10.050, 10.060);
+
+    CHECK_INT(monitor->GetNumberOfFrames(), 3);
+    CHECK_INT(monitor->GetTotalNumberOfFrames(), 3);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::VideoLatency), (15.0 + 40.0 + 15.0) / 3.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMaximum(vtkTrackedScreenARLatencyMonitor::VideoLatency), 40.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetPercentile(vtkTrackedScreenARLatencyMonitor::VideoLatency, 0.0), 15.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetPercentile(vtkTrackedScreenARLatencyMonitor::VideoLatency, 50.0), 15.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetPercentile(vtkTrackedScreenARLatencyMonitor::VideoLatency, 100.0), 40.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::PoseLatency), (20.0 + 55.0) / 2.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMaximum(vtkTrackedScreenARLatencyMonitor::PoseLatency), 55.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::RenderDuration), (5.0 + 10.0 + 10.0) / 3.0, TOLERANCE);
+
+    // The last bin collects everything above the histogram range
+    monitor->SetBinWidth(10.0);
+    monitor->SetNumberOfBins(3);
+    vtkNew<vtkIntArray> counts;
+    monitor->GetHistogram(vtkTrackedScreenARLatencyMonitor::VideoLatency, counts.GetPointer());
+    CHECK_INT(counts->GetNumberOfTuples(), 3);
+    CHECK_INT(counts->GetValue(0), 0);
+    CHECK_INT(counts->GetValue(1), 2);
+    CHECK_INT(counts->GetValue(2), 1);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestWindow()
+  {
+    vtkNew<vtkTrackedScreenARLatencyMonitor> monitor;
+    monitor->SetWindowSize(2);
+    monitor->RecordImageArrival(1.0);
+    monitor->RecordPoseArrival(1.0);
+    RecordRender(monitor.GetPointer(), 2.0, 2.001);
+    RecordRender(monitor.GetPointer(), 3.0, 3.002);
+    RecordRender(monitor.GetPointer(), 4.0, 4.003);
+
+    // Only the two most recent frames are kept
+    CHECK_INT(monitor->GetNumberOfFrames(), 2);
+    CHECK_INT(monitor->GetTotalNumberOfFrames(), 3);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::RenderDuration), 2.5, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMaximum(vtkTrackedScreenARLatencyMonitor::VideoLatency), 3003.0, TOLERANCE);
+
+    // Reset also forgets the arrivals, the next frame has no known video or pose latency
+    monitor->RecordPresentedPose(0.5);
+    monitor->Reset();
+    CHECK_INT(monitor->GetNumberOfFrames(), 0);
+    CHECK_INT(monitor->GetTotalNumberOfFrames(), 0);
+    RecordRender(monitor.GetPointer(), 5.0, 5.004);
+    CHECK_INT(monitor->GetNumberOfFrames(), 1);
+    CHECK_DOUBLE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::VideoLatency), 0.0);
+    CHECK_DOUBLE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::PoseLatency), 0.0);
+    CHECK_DOUBLE_TOLERANCE(monitor->GetMean(vtkTrackedScreenARLatencyMonitor::RenderDuration), 4.0, TOLERANCE);
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARLatencyMonitorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestLatencies());
+  CHECK_EXIT_SUCCESS(TestWindow());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARPixelFormatConverter.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Input frame of the given size in the given format, filled with pseudo-random bytes so that
+  // every luma and chroma value and the clamping limits are reached
+  void CreateFrame(int format, int width, int height, unsigned int seed, vtkImageData* frame)
+  {
+    int numberOfComponents = 1;
+    int inputHeight = height;
+    switch (format)
+    {
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR:
+        numberOfComponents = 3;
+        break;
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatBGRA:
+        numberOfComponents = 4;
+        break;
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatNV12:
+      case vtkTrackedScreenARPixelFormatConverter::PixelFormatI420:
+        inputHeight = height * 3 / 2;
+        break;
+      default:
+        numberOfComponents = 2;
+        break;
+    }
+    frame->SetDimensions(width, inputHeight, 1);
+    frame->AllocateScalars(VTK_UNSIGNED_CHAR, numberOfComponents);
+    unsigned char* values = static_cast<unsigned char*>(frame->GetScalarPointer());
+    for (int i = 0; i < width * inputHeight * numberOfComponents; ++i)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      values[i] = static_cast<unsigned char>(seed >> 24);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Every vectorized kernel must give the bytes of the scalar reference kernel, including the
+  // pixels of the row tail that do not fill a vector
+  int CompareInstructionSets(int format, int width, int height)
+  {
+    vtkNew<vtkImageData> frame;
+    CreateFrame(format, width, height, static_cast<unsigned int>(format * 1000 + width), frame.GetPointer());
+
+    vtkNew<vtkTrackedScreenARPixelFormatConverter> converter;
+    converter->SetInputData(frame.GetPointer());
+    converter->SetPixelFormat(format);
+    converter->SetInstructionSet(vtkTrackedScreenARPixelFormatConverter::InstructionSetScalar);
+    converter->Update();
+    vtkImageData* output = converter->GetOutput();
+    CHECK_INT(output->GetDimensions()[0], width);
+    CHECK_INT(output->GetDimensions()[1], height);
+    size_t outputSize = static_cast<size_t>(width) * height * output->GetNumberOfScalarComponents();
+    const unsigned char* scalarOutput = static_cast<const unsigned char*>(output->GetScalarPointer());
+    std::vector<unsigned char> reference(scalarOutput, scalarOutput + outputSize);
+
+    for (int instructionSet = vtkTrackedScreenARPixelFormatConverter::InstructionSetScalar + 1;
+         instructionSet < vtkTrackedScreenARPixelFormatConverter::InstructionSet_Last; ++instructionSet)
+    {
+      if (!vtkTrackedScreenARPixelFormatConverter::IsInstructionSetSupported(instructionSet))
+      {
+        continue;
+      }
+      converter->SetInstructionSet(instructionSet);
+      converter->Update();
+      const unsigned char* vectorOutput = static_cast<const unsigned char*>(converter->GetOutput()->GetScalarPointer());
+      for (size_t i = 0; i < outputSize; ++i)
+      {
+        if (vectorOutput[i] != reference[i])
+        {
+          std::cerr << "Line " << __LINE__ << ": " << vtkTrackedScreenARPixelFormatConverter::GetPixelFormatAsString(format) << " "
+                    << vtkTrackedScreenARPixelFormatConverter::GetInstructionSetAsString(instructionSet) << " kernel differs from the scalar one"
+                    << " for width " << width << " at byte " << i << ": " << static_cast<int>(vectorOutput[i])
+                    << " instead of " << static_cast<int>(reference[i]) << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // BT.601 limited range red, Y 81 U 90 V 240
+  int TestKnownColor()
+  {
+    const int width = 34;
+    const int height = 2;
+    vtkNew<vtkImageData> frame;
+    frame->SetDimensions(width, height * 3 / 2, 1);
+    frame->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    unsigned char* values = static_cast<unsigned char*>(frame->GetScalarPointer());
+    memset(values, 81, width * height);
+    for (int i = 0; i < width * height / 2; i += 2)
+    {
+      values[width * height + i] = 90;
+      values[width * height + i + 1] = 240;
+    }
+
+    vtkNew<vtkTrackedScreenARPixelFormatConverter> converter;
+    converter->SetInputData(frame.GetPointer());
+    converter->SetPixelFormat(vtkTrackedScreenARPixelFormatConverter::PixelFormatNV12);
+    converter->Update();
+    const unsigned char* rgba = static_cast<const unsigned char*>(converter->GetOutput()->GetScalarPointer());
+    for (int pixel = 0; pixel < width * height; ++pixel)
+    {
+      CHECK_INT(rgba[4 * pixel], 255);
+      CHECK_INT(rgba[4 * pixel + 1], 0);
+      CHECK_INT(rgba[4 * pixel + 2], 0);
+      CHECK_INT(rgba[4 * pixel + 3], 255);
+    }
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPixelFormatConverterTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  std::cout << "Widest instruction set: " << vtkTrackedScreenARPixelFormatConverter::GetInstructionSetAsString(
+    vtkTrackedScreenARPixelFormatConverter::GetWidestInstructionSet()) << std::endl;
+  CHECK_BOOL(vtkTrackedScreenARPixelFormatConverter::IsInstructionSetSupported(vtkTrackedScreenARPixelFormatConverter::InstructionSetScalar), true);
+  CHECK_BOOL(vtkTrackedScreenARPixelFormatConverter::IsInstructionSetSupported(
+    vtkTrackedScreenARPixelFormatConverter::GetWidestInstructionSet()), true);
+
+  // Widths below, at and above the 4, 8, 16 and 32 pixel steps of the kernels. Chroma is shared by
+  // pixel pairs, so the YUV formats take even widths.
+  const int oddWidths[] = { 1, 3, 5, 7, 9, 15, 17, 31, 33, 63, 65, 127 };
+  const int evenWidths[] = { 2, 4, 6, 10, 14, 16, 18, 30, 32, 34, 62, 64, 66, 126 };
+  for (int format = vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR; format < vtkTrackedScreenARPixelFormatConverter::PixelFormat_Last; ++format)
+  {
+    bool swizzle = (format == vtkTrackedScreenARPixelFormatConverter::PixelFormatBGR || format == vtkTrackedScreenARPixelFormatConverter::PixelFormatBGRA);
+    // Planar frames need an even height, packed ones take any
+    int height = (format == vtkTrackedScreenARPixelFormatConverter::PixelFormatNV12
+                  || format == vtkTrackedScreenARPixelFormatConverter::PixelFormatI420) ? 4 : 3;
+    for (size_t i = 0; i < sizeof(evenWidths) / sizeof(evenWidths[0]); ++i)
+    {
+      CHECK_EXIT_SUCCESS(CompareInstructionSets(format, evenWidths[i], height));
+    }
+    for (size_t i = 0; swizzle && i < sizeof(oddWidths) / sizeof(oddWidths[0]); ++i)
+    {
+      CHECK_EXIT_SUCCESS(CompareInstructionSets(format, oddWidths[i], height));
+    }
+  }
+
+  CHECK_EXIT_SUCCESS(TestKnownColor());
+
+  // A packed YUV row of odd width ends in the middle of a chroma pair
+  vtkNew<vtkImageData> oddFrame;
+  CreateFrame(vtkTrackedScreenARPixelFormatConverter::PixelFormatYUYV, 7, 3, 1, oddFrame.GetPointer());
+  vtkNew<vtkTrackedScreenARPixelFormatConverter> converter;
+  converter->SetInputData(oddFrame.GetPointer());
+  converter->SetPixelFormat(vtkTrackedScreenARPixelFormatConverter::PixelFormatYUYV);
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  converter->Update();
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+
+  return EXIT_SUCCESS;
+}
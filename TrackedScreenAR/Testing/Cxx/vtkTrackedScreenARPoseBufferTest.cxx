@@ -0,0 +1,141 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARPoseBuffer.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  const double TOLERANCE = 1e-9;
+
+  //----------------------------------------------------------------------------
+  // Rotation about z by the given angle, then translation along x
+  void SetPose(vtkMatrix4x4* matrix, double angleDegrees, double x)
+  {
+    double angle = vtkMath::RadiansFromDegrees(angleDegrees);
+    matrix->Identity();
+    matrix->SetElement(0, 0, cos(angle));
+    matrix->SetElement(0, 1, -sin(angle));
+    matrix->SetElement(1, 0, sin(angle));
+    matrix->SetElement(1, 1, cos(angle));
+    matrix->SetElement(0, 3, x);
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckPose(vtkMatrix4x4* matrix, double angleDegrees, double x)
+  {
+    vtkNew<vtkMatrix4x4> expected;
+    SetPose(expected.GetPointer(), angleDegrees, x);
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        CHECK_DOUBLE_TOLERANCE(matrix->GetElement(row, column), expected->GetElement(row, column), TOLERANCE);
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPoseBufferTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkTrackedScreenARPoseBuffer> buffer;
+  vtkNew<vtkMatrix4x4> pose;
+  double oldest = 0.0;
+  double newest = 0.0;
+  CHECK_BOOL(buffer->GetPose(0.0, pose.GetPointer()), false);
+  CHECK_BOOL(buffer->GetTimeRange(oldest, newest), false);
+
+  SetPose(pose.GetPointer(), 0.0, 0.0);
+  buffer->AddPose(1.0, pose.GetPointer());
+  SetPose(pose.GetPointer(), 90.0, 10.0);
+  buffer->AddPose(2.0, pose.GetPointer());
+  CHECK_INT(buffer->GetNumberOfPoses(), 2);
+
+  // Halfway: half the rotation (SLERP) and half the translation
+  CHECK_BOOL(buffer->GetPose(1.5, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 45.0, 5.0));
+  CHECK_BOOL(buffer->GetPose(1.25, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 22.5, 2.5));
+
+  // Clamped to the stored range
+  CHECK_BOOL(buffer->GetPose(0.0, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 0.0));
+  CHECK_BOOL(buffer->GetPose(5.0, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 90.0, 10.0));
+
+  double timestamp = 0.0;
+  CHECK_BOOL(buffer->GetLatestPose(pose.GetPointer(), timestamp), true);
+  CHECK_DOUBLE(timestamp, 2.0);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 90.0, 10.0));
+
+  // Only the newest poses are kept once the ring wrapped around
+  buffer->SetCapacity(4);
+  CHECK_INT(buffer->GetNumberOfPoses(), 0);
+  for (int i = 0; i < 10; ++i)
+  {
+    SetPose(pose.GetPointer(), 0.0, i);
+    buffer->AddPose(i, pose.GetPointer());
+  }
+  CHECK_INT(buffer->GetNumberOfPoses(), 4);
+  CHECK_BOOL(buffer->GetTimeRange(oldest, newest), true);
+  CHECK_DOUBLE(oldest, 6.0);
+  CHECK_DOUBLE(newest, 9.0);
+  CHECK_BOOL(buffer->GetPose(7.5, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 7.5));
+  CHECK_BOOL(buffer->GetPose(2.0, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 6.0));
+
+  // A synchronized pose is only interpolated for recent frames within the stored range, a stalled video
+  // gets the latest pose instead of the oldest one
+  buffer->SetMaximumSynchronizationAge(2.0);
+  CHECK_BOOL(buffer->GetSynchronizedPose(7.5, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 7.5));
+  CHECK_BOOL(buffer->GetSynchronizedPose(10.0, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 9.0));
+  CHECK_BOOL(buffer->GetSynchronizedPose(2.0, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 9.0));
+  buffer->SetMaximumSynchronizationAge(1.0);
+  CHECK_BOOL(buffer->GetSynchronizedPose(7.5, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 9.0));
+  CHECK_BOOL(buffer->GetSynchronizedPose(8.5, pose.GetPointer()), true);
+  CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0, 8.5));
+  double poseTimestamp = 0.0;
+  CHECK_BOOL(buffer->GetSynchronizedPose(8.5, pose.GetPointer(), poseTimestamp), true);
+  CHECK_DOUBLE(poseTimestamp, 8.5);
+  CHECK_BOOL(buffer->GetSynchronizedPose(7.5, pose.GetPointer(), poseTimestamp), true);
+  CHECK_DOUBLE(poseTimestamp, 9.0);
+
+  buffer->Clear();
+  CHECK_INT(buffer->GetNumberOfPoses(), 0);
+  CHECK_BOOL(buffer->GetLatestPose(pose.GetPointer(), timestamp), false);
+  CHECK_BOOL(buffer->GetSynchronizedPose(8.5, pose.GetPointer()), false);
+  return EXIT_SUCCESS;
+}
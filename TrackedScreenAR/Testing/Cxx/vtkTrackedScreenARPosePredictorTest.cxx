@@ -0,0 +1,187 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARPosePredictor.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  const double TOLERANCE = 1e-6;
+
+  // Tracker period, exact in binary so that target times fall on samples
+  const double SAMPLE_INTERVAL = 1.0 / 64.0;
+
+  //----------------------------------------------------------------------------
+  // Constant motion: one degree about z and one mm along x per sample
+  void SetPose(vtkMatrix4x4* matrix, double sample)
+  {
+    double angle = vtkMath::RadiansFromDegrees(sample);
+    matrix->Identity();
+    matrix->SetElement(0, 0, cos(angle));
+    matrix->SetElement(0, 1, -sin(angle));
+    matrix->SetElement(1, 0, sin(angle));
+    matrix->SetElement(1, 1, cos(angle));
+    matrix->SetElement(0, 3, sample);
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckPose(vtkMatrix4x4* matrix, double sample)
+  {
+    vtkNew<vtkMatrix4x4> expected;
+    SetPose(expected.GetPointer(), sample);
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        CHECK_DOUBLE_TOLERANCE(matrix->GetElement(row, column), expected->GetElement(row, column), TOLERANCE);
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  void AddSamples(vtkTrackedScreenARPosePredictor* predictor, int first, int last)
+  {
+    vtkNew<vtkMatrix4x4> pose;
+    for (int sample = first; sample <= last; ++sample)
+    {
+      SetPose(pose.GetPointer(), sample);
+      predictor->AddMeasurement(sample * SAMPLE_INTERVAL, pose.GetPointer());
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int TestPredictionOff()
+  {
+    vtkNew<vtkTrackedScreenARPosePredictor> predictor;
+    vtkNew<vtkMatrix4x4> pose;
+    CHECK_BOOL(predictor->PredictPose(0.0, pose.GetPointer()), false);
+
+    AddSamples(predictor.GetPointer(), 0, 10);
+    CHECK_DOUBLE(predictor->GetLatestTimestamp(), 10 * SAMPLE_INTERVAL);
+    CHECK_BOOL(predictor->PredictPose(12 * SAMPLE_INTERVAL, pose.GetPointer()), true);
+    CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 10.0));
+
+    // The latest pose lags two samples behind, prediction and baseline agree
+    AddSamples(predictor.GetPointer(), 11, 12);
+    CHECK_INT(predictor->GetNumberOfResiduals(), 1);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetLastTranslationResidual(), 2.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetLastRotationResidual(), 2.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSBaselineTranslationResidual(), 2.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSBaselineRotationResidual(), 2.0, TOLERANCE);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestConstantVelocity()
+  {
+    vtkNew<vtkTrackedScreenARPosePredictor> predictor;
+    predictor->SetPredictionMode(vtkTrackedScreenARPosePredictor::ConstantVelocity);
+    vtkNew<vtkMatrix4x4> pose;
+
+    // A single measurement gives no velocity
+    AddSamples(predictor.GetPointer(), 0, 0);
+    CHECK_BOOL(predictor->PredictPose(2 * SAMPLE_INTERVAL, pose.GetPointer()), true);
+    CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 0.0));
+    predictor->Reset();
+
+    AddSamples(predictor.GetPointer(), 0, 10);
+    CHECK_BOOL(predictor->PredictPose(12 * SAMPLE_INTERVAL, pose.GetPointer()), true);
+    CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 12.0));
+
+    // Not scored before the measurement at the target time arrives
+    AddSamples(predictor.GetPointer(), 11, 11);
+    CHECK_INT(predictor->GetNumberOfResiduals(), 0);
+    AddSamples(predictor.GetPointer(), 12, 12);
+    CHECK_INT(predictor->GetNumberOfResiduals(), 1);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSTranslationResidual(), 0.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSRotationResidual(), 0.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSBaselineTranslationResidual(), 2.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSBaselineRotationResidual(), 2.0, TOLERANCE);
+
+    predictor->ResetResiduals();
+    CHECK_INT(predictor->GetNumberOfResiduals(), 0);
+    CHECK_DOUBLE(predictor->GetRMSBaselineTranslationResidual(), 0.0);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestHorizonClamp()
+  {
+    vtkNew<vtkTrackedScreenARPosePredictor> predictor;
+    predictor->SetPredictionMode(vtkTrackedScreenARPosePredictor::ConstantVelocity);
+    predictor->SetMaximumPredictionHorizon(2 * SAMPLE_INTERVAL);
+    vtkNew<vtkMatrix4x4> pose;
+
+    AddSamples(predictor.GetPointer(), 0, 10);
+    CHECK_BOOL(predictor->PredictPose(14 * SAMPLE_INTERVAL, pose.GetPointer()), true);
+    CHECK_EXIT_SUCCESS(CheckPose(pose.GetPointer(), 12.0));
+
+    // Scored at the clamped time the pose was extrapolated to, not the requested one
+    AddSamples(predictor.GetPointer(), 11, 12);
+    CHECK_INT(predictor->GetNumberOfResiduals(), 1);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetLastTranslationResidual(), 0.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetLastRotationResidual(), 0.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSBaselineTranslationResidual(), 2.0, TOLERANCE);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestKalman()
+  {
+    vtkNew<vtkTrackedScreenARPosePredictor> predictor;
+    predictor->SetPredictionMode(vtkTrackedScreenARPosePredictor::Kalman);
+    vtkNew<vtkMatrix4x4> pose;
+
+    // Once the filter settled it beats the unpredicted pose by far
+    AddSamples(predictor.GetPointer(), 0, 30);
+    for (int sample = 31; sample <= 60; ++sample)
+    {
+      predictor->PredictPose((sample + 1) * SAMPLE_INTERVAL, pose.GetPointer());
+      AddSamples(predictor.GetPointer(), sample, sample);
+    }
+    AddSamples(predictor.GetPointer(), 61, 61);
+    CHECK_INT(predictor->GetNumberOfResiduals(), 30);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSBaselineTranslationResidual(), 2.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(predictor->GetRMSBaselineRotationResidual(), 2.0, TOLERANCE);
+    CHECK_BOOL(predictor->GetRMSTranslationResidual() < 0.1, true);
+    CHECK_BOOL(predictor->GetRMSRotationResidual() < 0.1, true);
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARPosePredictorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestPredictionOff());
+  CHECK_EXIT_SUCCESS(TestConstantVelocity());
+  CHECK_EXIT_SUCCESS(TestHorizonClamp());
+  CHECK_EXIT_SUCCESS(TestKalman());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARProjection.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkCamera.h>
+#include <vtkNew.h>
+
+namespace
+{
+  const double TOLERANCE = 1e-9;
+
+  //----------------------------------------------------------------------------
+  int TestMatchingSizes()
+  {
+    // 640x480 video shown in a 640x480 view: the focal length alone sets the view angle
+    double intrinsics[4] = { 500.0, 500.0, 320.0, 240.0 };
+    int imageSize[2] = { 640, 480 };
+    int viewportSize[2] = { 640, 480 };
+    double viewAngle = 0.0;
+    double windowCenter[2] = { 0.0, 0.0 };
+    double scalingFactor = 0.0;
+    int letterboxOffset = -1;
+    CHECK_BOOL(vtkTrackedScreenARProjection::ComputeProjection(intrinsics, imageSize, viewportSize,
+                                                               viewAngle, windowCenter, scalingFactor, letterboxOffset), true);
+    // 2 * atan(240 / 500)
+    CHECK_DOUBLE_TOLERANCE(viewAngle, 51.28201164861056, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(windowCenter[0], 320.0 / 319.5 - 1.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(windowCenter[1], 240.0 / 239.5 - 1.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(scalingFactor, 1.0, TOLERANCE);
+    CHECK_INT(letterboxOffset, 0);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestScaledView()
+  {
+    // Same camera in a view twice as large: same view angle, principal point scaled with the image
+    double intrinsics[4] = { 500.0, 500.0, 320.0, 240.0 };
+    int imageSize[2] = { 640, 480 };
+    int viewportSize[2] = { 1280, 960 };
+    double viewAngle = 0.0;
+    double windowCenter[2] = { 0.0, 0.0 };
+    double scalingFactor = 0.0;
+    int letterboxOffset = -1;
+    CHECK_BOOL(vtkTrackedScreenARProjection::ComputeProjection(intrinsics, imageSize, viewportSize,
+                                                               viewAngle, windowCenter, scalingFactor, letterboxOffset), true);
+    CHECK_DOUBLE_TOLERANCE(viewAngle, 51.28201164861056, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(windowCenter[0], 640.0 / 639.5 - 1.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(windowCenter[1], 480.0 / 479.5 - 1.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(scalingFactor, 2.0, TOLERANCE);
+    CHECK_INT(letterboxOffset, 0);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestLetterboxedView()
+  {
+    // Wider view of the same height: the image is centered, 180 pixels from the left border
+    double intrinsics[4] = { 500.0, 500.0, 320.0, 240.0 };
+    int imageSize[2] = { 640, 480 };
+    int viewportSize[2] = { 1000, 480 };
+    double viewAngle = 0.0;
+    double windowCenter[2] = { 0.0, 0.0 };
+    double scalingFactor = 0.0;
+    int letterboxOffset = -1;
+    CHECK_BOOL(vtkTrackedScreenARProjection::ComputeProjection(intrinsics, imageSize, viewportSize,
+                                                               viewAngle, windowCenter, scalingFactor, letterboxOffset), true);
+    CHECK_DOUBLE_TOLERANCE(viewAngle, 51.28201164861056, TOLERANCE);
+    CHECK_INT(letterboxOffset, 180);
+    CHECK_DOUBLE_TOLERANCE(windowCenter[0], 500.0 / 499.5 - 1.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(windowCenter[1], 240.0 / 239.5 - 1.0, TOLERANCE);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestInvalidInputs()
+  {
+    double intrinsics[4] = { 500.0, 0.0, 320.0, 240.0 };
+    int imageSize[2] = { 640, 480 };
+    int viewportSize[2] = { 640, 480 };
+    double viewAngle = 0.0;
+    double windowCenter[2] = { 0.0, 0.0 };
+    double scalingFactor = 0.0;
+    int letterboxOffset = 0;
+    CHECK_BOOL(vtkTrackedScreenARProjection::ComputeProjection(intrinsics, imageSize, viewportSize,
+                                                               viewAngle, windowCenter, scalingFactor, letterboxOffset), false);
+    intrinsics[1] = 500.0;
+    viewportSize[1] = 1;
+    CHECK_BOOL(vtkTrackedScreenARProjection::ComputeProjection(intrinsics, imageSize, viewportSize,
+                                                               viewAngle, windowCenter, scalingFactor, letterboxOffset), false);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestMemoization()
+  {
+    vtkNew<vtkTrackedScreenARProjection> projection;
+    CHECK_BOOL(projection->GetValid(), false);
+
+    projection->SetIntrinsics(500.0, 500.0, 320.0, 240.0);
+    projection->SetImageSize(640, 480);
+    projection->SetViewportSize(640, 480);
+    CHECK_BOOL(projection->Update(), true);
+    CHECK_BOOL(projection->GetValid(), true);
+    CHECK_INT(projection->GetComputeCount(), 1);
+    CHECK_DOUBLE_TOLERANCE(projection->GetViewAngle(), 51.28201164861056, TOLERANCE);
+
+    // Unchanged or re-set to the same values: only the key is compared
+    CHECK_BOOL(projection->Update(), false);
+    projection->SetViewportSize(640, 480);
+    CHECK_BOOL(projection->Update(), false);
+    CHECK_INT(projection->GetComputeCount(), 1);
+
+    projection->SetViewportSize(1280, 960);
+    CHECK_BOOL(projection->Update(), true);
+    CHECK_INT(projection->GetComputeCount(), 2);
+    CHECK_DOUBLE_TOLERANCE(projection->GetScalingFactor(), 2.0, TOLERANCE);
+
+    // An invalid input is memoized too, and leaves the camera untouched
+    projection->SetIntrinsics(500.0, 0.0, 320.0, 240.0);
+    CHECK_BOOL(projection->Update(), true);
+    CHECK_BOOL(projection->GetValid(), false);
+    CHECK_BOOL(projection->Update(), false);
+    CHECK_INT(projection->GetComputeCount(), 3);
+
+    vtkNew<vtkCamera> camera;
+    camera->SetViewAngle(10.0);
+    projection->ApplyToCamera(camera.GetPointer());
+    CHECK_DOUBLE(camera->GetViewAngle(), 10.0);
+
+    projection->SetIntrinsics(500.0, 500.0, 320.0, 240.0);
+    projection->SetViewportSize(640, 480);
+    CHECK_BOOL(projection->Update(), true);
+    projection->ApplyToCamera(camera.GetPointer());
+    CHECK_DOUBLE_TOLERANCE(camera->GetViewAngle(), 51.28201164861056, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(camera->GetWindowCenter()[0], 320.0 / 319.5 - 1.0, TOLERANCE);
+    CHECK_DOUBLE_TOLERANCE(camera->GetWindowCenter()[1], 240.0 / 239.5 - 1.0, TOLERANCE);
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARProjectionTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestMatchingSizes());
+  CHECK_EXIT_SUCCESS(TestScaledView());
+  CHECK_EXIT_SUCCESS(TestLetterboxedView());
+  CHECK_EXIT_SUCCESS(TestInvalidInputs());
+  CHECK_EXIT_SUCCESS(TestMemoization());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARQualityGovernor.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+namespace
+{
+  const double TARGET_FRAME_TIME = 0.02;
+  const double OVER_BUDGET = 2.0 * TARGET_FRAME_TIME;
+  const double HEADROOM = 0.1 * TARGET_FRAME_TIME;
+  // Between the recover and the degrade thresholds
+  const double ON_BUDGET = 0.8 * TARGET_FRAME_TIME;
+
+  //----------------------------------------------------------------------------
+  // Number of frames of the given cost until the level changes, 0 if it did not within maximumFrames
+  int FramesUntilLevelChange(vtkTrackedScreenARQualityGovernor* governor, double frameTime, int maximumFrames)
+  {
+    for (int frame = 1; frame <= maximumFrames; ++frame)
+    {
+      if (governor->AddFrameTime(frameTime))
+      {
+        return frame;
+      }
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  void SetUpGovernor(vtkTrackedScreenARQualityGovernor* governor)
+  {
+    governor->SetTargetFrameTime(TARGET_FRAME_TIME);
+    governor->SetDegradeFrameCount(10);
+    governor->SetRecoverFrameCount(40);
+    governor->EnabledOn();
+  }
+
+  //----------------------------------------------------------------------------
+  int TestDegradeAndRecover()
+  {
+    vtkNew<vtkTrackedScreenARQualityGovernor> governor;
+    SetUpGovernor(governor);
+
+    // Nothing happens while disabled
+    governor->EnabledOff();
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 0);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::FullQuality);
+    governor->EnabledOn();
+
+    // Steps down one level after DegradeFrameCount frames over budget
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::DownscaledVideo);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::HalfResolutionVideo);
+
+    // Frames within budget but above the recover threshold neither degrade nor recover
+    CHECK_INT(FramesUntilLevelChange(governor, ON_BUDGET, 1000), 0);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::HalfResolutionVideo);
+
+    // Recovers one level once RecoverFrameCount frames averaged below the recover threshold, the average
+    // takes a few frames to come down from the frames within budget
+    CHECK_INT(FramesUntilLevelChange(governor, HEADROOM, 39), 0);
+    CHECK_BOOL(FramesUntilLevelChange(governor, HEADROOM, 10) > 0, true);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::DownscaledVideo);
+
+    // The recovery held for RecoverFrameCount frames, the next one comes at the normal pace
+    CHECK_INT(FramesUntilLevelChange(governor, HEADROOM, 100), 40);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::FullQuality);
+    CHECK_INT(governor->GetRecoverBackoff(), 1);
+    CHECK_INT(FramesUntilLevelChange(governor, HEADROOM, 1000), 0);
+    CHECK_INT(static_cast<int>(governor->GetLevelChangeCount()), 4);
+
+    governor->Reset();
+    CHECK_INT(static_cast<int>(governor->GetLevelChangeCount()), 0);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestRecoverBackoff()
+  {
+    vtkNew<vtkTrackedScreenARQualityGovernor> governor;
+    SetUpGovernor(governor);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(governor->GetRecoverBackoff(), 1);
+
+    // Each recovery undone right away doubles the wait of the next one, up to 16 times RecoverFrameCount
+    const int expectedBackoffs[] = { 2, 4, 8, 16, 16 };
+    int recoverFrames = 40;
+    for (int expectedBackoff : expectedBackoffs)
+    {
+      CHECK_INT(FramesUntilLevelChange(governor, HEADROOM, 10000), recoverFrames);
+      CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::FullQuality);
+      CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+      CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::DownscaledVideo);
+      CHECK_INT(governor->GetRecoverBackoff(), expectedBackoff);
+      recoverFrames = 40 * expectedBackoff;
+    }
+
+    // A recovery that held resets the backoff
+    CHECK_INT(FramesUntilLevelChange(governor, HEADROOM, 10000), 640);
+    CHECK_INT(FramesUntilLevelChange(governor, ON_BUDGET, 40), 0);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(governor->GetRecoverBackoff(), 1);
+    CHECK_INT(FramesUntilLevelChange(governor, HEADROOM, 10000), 40);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestMaximumLevel()
+  {
+    vtkNew<vtkTrackedScreenARQualityGovernor> governor;
+    SetUpGovernor(governor);
+
+    // Clamped to the existing levels
+    governor->SetMaximumLevel(100);
+    CHECK_INT(governor->GetMaximumLevel(), vtkTrackedScreenARQualityGovernor::NoExpensivePasses);
+
+    // Never steps down past the maximum level however long the frames stay over budget
+    governor->SetMaximumLevel(vtkTrackedScreenARQualityGovernor::HalfResolutionVideo);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::HalfResolutionVideo);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 1000), 0);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::HalfResolutionVideo);
+
+    // Lowering the maximum below the current level brings the level back up on the next frame
+    governor->SetMaximumLevel(vtkTrackedScreenARQualityGovernor::DownscaledVideo);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 1);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::DownscaledVideo);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 1000), 0);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSkippedLevels()
+  {
+    vtkNew<vtkTrackedScreenARQualityGovernor> governor;
+    SetUpGovernor(governor);
+
+    // Full quality cannot be skipped
+    governor->SetLevelSkipped(vtkTrackedScreenARQualityGovernor::FullQuality, true);
+    CHECK_BOOL(governor->GetLevelSkipped(vtkTrackedScreenARQualityGovernor::FullQuality), false);
+
+    // Skipped levels are passed over in both directions
+    governor->SetLevelSkipped(vtkTrackedScreenARQualityGovernor::DownscaledVideo, true);
+    CHECK_BOOL(governor->GetLevelSkipped(vtkTrackedScreenARQualityGovernor::DownscaledVideo), true);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::HalfResolutionVideo);
+    CHECK_INT(FramesUntilLevelChange(governor, HEADROOM, 100), 40);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::FullQuality);
+
+    // No level left to step down to
+    governor->SetLevelSkipped(vtkTrackedScreenARQualityGovernor::NoExpensivePasses, true);
+    governor->SetMaximumLevel(vtkTrackedScreenARQualityGovernor::ReducedDetail);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 100), 10);
+    CHECK_INT(governor->GetLevel(), vtkTrackedScreenARQualityGovernor::ReducedDetail);
+    CHECK_INT(FramesUntilLevelChange(governor, OVER_BUDGET, 1000), 0);
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARQualityGovernorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestDegradeAndRecover());
+  CHECK_EXIT_SUCCESS(TestRecoverBackoff());
+  CHECK_EXIT_SUCCESS(TestMaximumLevel());
+  CHECK_EXIT_SUCCESS(TestSkippedLevels());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,317 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Times the fixed-size rigid transform math of vtkTrackedScreenARRigidTransform against the
+// vtkMatrix4x4/vtkMath and vnl routes it replaces, and checks both agree.
+// Not part of the test suite, run it manually on the target machine:
+//   vtkTrackedScreenARRigidTransformBenchmark [numberOfIterations]
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARPoseBuffer.h"
+#include "vtkTrackedScreenARRigidTransform.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// VNL includes
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/algo/vnl_matrix_inverse.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  const int DEFAULT_NUMBER_OF_ITERATIONS = 1000000;
+
+  // Poses cycled through so the compiler cannot hoist the work out of the loops
+  const int NUMBER_OF_POSES = 64;
+
+  //----------------------------------------------------------------------------
+  void PrintResult(const char* name, int numberOfIterations, double seconds)
+  {
+    std::cout << "  " << std::left << std::setw(44) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << seconds * 1e9 / numberOfIterations << " ns/op" << std::endl;
+  }
+
+  //----------------------------------------------------------------------------
+  void PrintError(const char* name, double error)
+  {
+    std::cout << "  " << std::left << std::setw(44) << name << std::right << std::scientific << std::setprecision(2)
+              << std::setw(10) << error << std::endl;
+  }
+
+  //----------------------------------------------------------------------------
+  double MaximumDifference(vtkMatrix4x4* a, vtkMatrix4x4* b)
+  {
+    double difference = 0.0;
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        difference = std::max(difference, fabs(a->GetElement(row, column) - b->GetElement(row, column)));
+      }
+    }
+    return difference;
+  }
+
+  //----------------------------------------------------------------------------
+  // Conversion helpers the module widget used before
+  void ConvertVtkMatrixToVnlMatrix(const vtkMatrix4x4* inVtkMatrix, vnl_matrix_fixed<double, 4, 4>& outVnlMatrix)
+  {
+    for (int row = 0; row < 4; row++)
+    {
+      for (int column = 0; column < 4; column++)
+      {
+        outVnlMatrix.put(row, column, inVtkMatrix->GetElement(row, column));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void ConvertVnlMatrixToVtkMatrix(const vnl_matrix_fixed<double, 4, 4>& inVnlMatrix, vtkMatrix4x4* outVtkMatrix)
+  {
+    outVtkMatrix->Identity();
+    for (int row = 0; row < 3; row++)
+    {
+      for (int column = 0; column < 4; column++)
+      {
+        outVtkMatrix->SetElement(row, column, inVnlMatrix.get(row, column));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Matrix to pose and back the way the pose buffer did it before
+  void VtkMathMatrixToPose(vtkMatrix4x4* matrix, double q[4], double p[3])
+  {
+    double rotation[3][3];
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        rotation[row][column] = matrix->GetElement(row, column);
+      }
+      p[row] = matrix->GetElement(row, 3);
+    }
+    vtkMath::Matrix3x3ToQuaternion(rotation, q);
+  }
+
+  //----------------------------------------------------------------------------
+  void VtkMathPoseToMatrix(const double q[4], const double p[3], vtkMatrix4x4* matrix)
+  {
+    double rotation[3][3];
+    vtkMath::QuaternionToMatrix3x3(q, rotation);
+    matrix->Identity();
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        matrix->SetElement(row, column, rotation[row][column]);
+      }
+      matrix->SetElement(row, 3, p[row]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void MakeRandomPoses(std::vector<vtkTrackedScreenARRigidTransform>& poses)
+  {
+    vtkMath::RandomSeed(19);
+    poses.resize(NUMBER_OF_POSES);
+    for (int i = 0; i < NUMBER_OF_POSES; ++i)
+    {
+      double q[4] = { vtkMath::Gaussian(), vtkMath::Gaussian(), vtkMath::Gaussian(), vtkMath::Gaussian() };
+      vtkTrackedScreenARRigidTransform::QuaternionNormalize(q);
+      double p[3] = { vtkMath::Random(-500.0, 500.0), vtkMath::Random(-500.0, 500.0), vtkMath::Random(-500.0, 500.0) };
+      poses[i] = vtkTrackedScreenARRigidTransform::FromQuaternion(q, p);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int numberOfIterations = DEFAULT_NUMBER_OF_ITERATIONS;
+  if (argc > 1)
+  {
+    numberOfIterations = std::max(1, atoi(argv[1]));
+  }
+
+  std::vector<vtkTrackedScreenARRigidTransform> poses;
+  MakeRandomPoses(poses);
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > matrices(NUMBER_OF_POSES);
+  for (int i = 0; i < NUMBER_OF_POSES; ++i)
+  {
+    matrices[i] = vtkSmartPointer<vtkMatrix4x4>::New();
+    poses[i].ToMatrix(matrices[i]);
+  }
+
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkMatrix4x4> output;
+  vtkNew<vtkMatrix4x4> reference;
+  // Folded into the output so no loop is optimized away
+  double checksum = 0.0;
+
+  std::cout << "Rigid transform math, " << numberOfIterations << " iterations, "
+#ifdef TRACKEDSCREENAR_RIGID_TRANSFORM_SSE2
+            << "SSE2" << std::endl;
+#else
+            << "scalar" << std::endl;
+#endif
+
+  std::cout << "Inverse" << std::endl;
+  vnl_matrix_fixed<double, 4, 4> vnlMatrix;
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    ConvertVtkMatrixToVnlMatrix(matrices[i % NUMBER_OF_POSES], vnlMatrix);
+    vnl_matrix_fixed<double, 4, 4> vnlInverse(vnl_matrix_inverse<double>(vnlMatrix.as_matrix()).inverse());
+    ConvertVnlMatrixToVtkMatrix(vnlInverse, output);
+    checksum += output->GetElement(0, 3);
+  }
+  timer->StopTimer();
+  PrintResult("vnl_matrix_inverse + conversions", numberOfIterations, timer->GetElapsedTime());
+
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    vtkMatrix4x4::Invert(matrices[i % NUMBER_OF_POSES], output);
+    checksum += output->GetElement(0, 3);
+  }
+  timer->StopTimer();
+  PrintResult("vtkMatrix4x4::Invert", numberOfIterations, timer->GetElapsedTime());
+
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    checksum += poses[i % NUMBER_OF_POSES].Inverse().Element[3];
+  }
+  timer->StopTimer();
+  PrintResult("RigidTransform::Inverse", numberOfIterations, timer->GetElapsedTime());
+
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    vtkTrackedScreenARRigidTransform::FromMatrix(matrices[i % NUMBER_OF_POSES]).Inverse().ToMatrix(output);
+    checksum += output->GetElement(0, 3);
+  }
+  timer->StopTimer();
+  PrintResult("RigidTransform::Inverse from/to vtkMatrix4x4", numberOfIterations, timer->GetElapsedTime());
+
+  std::cout << "Composition" << std::endl;
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    vtkMatrix4x4::Multiply4x4(matrices[i % NUMBER_OF_POSES], matrices[(i + 1) % NUMBER_OF_POSES], output);
+    checksum += output->GetElement(0, 3);
+  }
+  timer->StopTimer();
+  PrintResult("vtkMatrix4x4::Multiply4x4", numberOfIterations, timer->GetElapsedTime());
+
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    checksum += vtkTrackedScreenARRigidTransform::Compose(poses[i % NUMBER_OF_POSES], poses[(i + 1) % NUMBER_OF_POSES]).Element[3];
+  }
+  timer->StopTimer();
+  PrintResult("RigidTransform::Compose", numberOfIterations, timer->GetElapsedTime());
+
+  std::cout << "Pose conversion" << std::endl;
+  double q[4];
+  double p[3];
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    VtkMathMatrixToPose(matrices[i % NUMBER_OF_POSES], q, p);
+    VtkMathPoseToMatrix(q, p, output);
+    checksum += output->GetElement(0, 0);
+  }
+  timer->StopTimer();
+  PrintResult("vtkMath matrix <-> quaternion", numberOfIterations, timer->GetElapsedTime());
+
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    vtkTrackedScreenARRigidTransform pose = vtkTrackedScreenARRigidTransform::FromMatrix(matrices[i % NUMBER_OF_POSES]);
+    pose.GetQuaternion(q);
+    pose.GetTranslation(p);
+    vtkTrackedScreenARRigidTransform::FromQuaternion(q, p).ToMatrix(output);
+    checksum += output->GetElement(0, 0);
+  }
+  timer->StopTimer();
+  PrintResult("RigidTransform matrix <-> quaternion", numberOfIterations, timer->GetElapsedTime());
+
+  std::cout << "Interpolation" << std::endl;
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    double q0[4], p0[3], q1[4], p1[3];
+    VtkMathMatrixToPose(matrices[i % NUMBER_OF_POSES], q0, p0);
+    VtkMathMatrixToPose(matrices[(i + 1) % NUMBER_OF_POSES], q1, p1);
+    vtkTrackedScreenARPoseBuffer::InterpolatePose(q0, p0, q1, p1, 0.3, q, p);
+    VtkMathPoseToMatrix(q, p, output);
+    checksum += output->GetElement(0, 0);
+  }
+  timer->StopTimer();
+  PrintResult("vtkMath conversions + SLERP", numberOfIterations, timer->GetElapsedTime());
+
+  timer->StartTimer();
+  for (int i = 0; i < numberOfIterations; ++i)
+  {
+    vtkTrackedScreenARRigidTransform::Interpolate(vtkTrackedScreenARRigidTransform::FromMatrix(matrices[i % NUMBER_OF_POSES]),
+      vtkTrackedScreenARRigidTransform::FromMatrix(matrices[(i + 1) % NUMBER_OF_POSES]), 0.3).ToMatrix(output);
+    checksum += output->GetElement(0, 0);
+  }
+  timer->StopTimer();
+  PrintResult("RigidTransform::Interpolate", numberOfIterations, timer->GetElapsedTime());
+
+  // Largest element difference to the VTK results over all poses
+  double inverseError = 0.0;
+  double composeError = 0.0;
+  double roundTripError = 0.0;
+  for (int i = 0; i < NUMBER_OF_POSES; ++i)
+  {
+    vtkMatrix4x4::Invert(matrices[i], reference);
+    poses[i].Inverse().ToMatrix(output);
+    inverseError = std::max(inverseError, MaximumDifference(reference, output));
+
+    vtkMatrix4x4::Multiply4x4(matrices[i], matrices[(i + 1) % NUMBER_OF_POSES], reference);
+    vtkTrackedScreenARRigidTransform::Compose(poses[i], poses[(i + 1) % NUMBER_OF_POSES]).ToMatrix(output);
+    composeError = std::max(composeError, MaximumDifference(reference, output));
+
+    poses[i].GetQuaternion(q);
+    poses[i].GetTranslation(p);
+    vtkTrackedScreenARRigidTransform::FromQuaternion(q, p).ToMatrix(output);
+    roundTripError = std::max(roundTripError, MaximumDifference(matrices[i], output));
+  }
+  std::cout << "Maximum difference" << std::endl;
+  PrintError("Inverse vs vtkMatrix4x4::Invert", inverseError);
+  PrintError("Compose vs vtkMatrix4x4::Multiply4x4", composeError);
+  PrintError("quaternion round trip", roundTripError);
+  std::cout << "Checksum " << checksum << std::endl;
+
+  return (inverseError < 1e-9 && composeError < 1e-9 && roundTripError < 1e-9) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
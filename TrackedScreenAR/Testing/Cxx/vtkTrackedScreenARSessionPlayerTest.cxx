@@ -0,0 +1,288 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARSessionFormat.h"
+#include "vtkTrackedScreenARSessionPlayer.h"
+#include "vtkTrackedScreenARSessionRecorder.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const int FRAME_WIDTH = 5;
+  const int FRAME_HEIGHT = 3;
+  const int NUMBER_OF_COMPONENTS = 3;
+  const int NUMBER_OF_FRAMES = 6;
+  // Two poses per frame, one before and one after it
+  const int NUMBER_OF_POSES = 2 * NUMBER_OF_FRAMES;
+  // Universal time magnitude, where a timestamp stored with less than double precision would differ
+  const double START_TIME = 1700000000.123456789;
+
+  //----------------------------------------------------------------------------
+  double GetFrameTimestamp(int frameIndex)
+  {
+    return START_TIME + frameIndex / 30.0 + 1e-7 * frameIndex;
+  }
+
+  //----------------------------------------------------------------------------
+  double GetPoseTimestamp(int poseIndex)
+  {
+    return START_TIME + poseIndex / 60.0 - 0.004;
+  }
+
+  //----------------------------------------------------------------------------
+  unsigned char GetFrameValue(int frameIndex, int valueIndex)
+  {
+    return static_cast<unsigned char>((frameIndex * 37 + valueIndex * 11) & 0xff);
+  }
+
+  //----------------------------------------------------------------------------
+  void SetFrame(vtkImageData* image, int frameIndex)
+  {
+    unsigned char* values = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT * NUMBER_OF_COMPONENTS; ++i)
+    {
+      values[i] = GetFrameValue(frameIndex, i);
+    }
+    image->Modified();
+  }
+
+  //----------------------------------------------------------------------------
+  // Values that are not exactly representable in fewer bits than a double
+  void SetPose(vtkMatrix4x4* matrix, int poseIndex)
+  {
+    matrix->Identity();
+    matrix->SetElement(0, 1, 1.0 / (3.0 + poseIndex));
+    matrix->SetElement(1, 0, -1.0 / (7.0 + poseIndex));
+    matrix->SetElement(0, 3, 10.0 * poseIndex + 0.1);
+    matrix->SetElement(1, 3, -0.3 * poseIndex);
+    matrix->SetElement(2, 3, 1e-9 * poseIndex);
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckFrame(vtkMRMLScalarVolumeNode* videoNode, int frameIndex)
+  {
+    CHECK_NOT_NULL(videoNode->GetImageData());
+    vtkDataArray* scalars = videoNode->GetImageData()->GetPointData()->GetScalars();
+    CHECK_NOT_NULL(scalars);
+    CHECK_INT(scalars->GetNumberOfComponents(), NUMBER_OF_COMPONENTS);
+    CHECK_INT(static_cast<int>(scalars->GetNumberOfValues()), FRAME_WIDTH * FRAME_HEIGHT * NUMBER_OF_COMPONENTS);
+    const unsigned char* values = static_cast<const unsigned char*>(scalars->GetVoidPointer(0));
+    for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT * NUMBER_OF_COMPONENTS; ++i)
+    {
+      CHECK_INT(values[i], GetFrameValue(frameIndex, i));
+    }
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Replayed poses must be bit identical, not only close
+  int CheckPose(vtkMRMLLinearTransformNode* transformNode, int poseIndex)
+  {
+    vtkNew<vtkMatrix4x4> expected;
+    SetPose(expected.GetPointer(), poseIndex);
+    vtkNew<vtkMatrix4x4> cameraToParent;
+    transformNode->GetMatrixTransformToParent(cameraToParent.GetPointer());
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        CHECK_BOOL(cameraToParent->GetElement(row, column) == expected->GetElement(row, column), true);
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int RecordSession(const std::string& fileName)
+  {
+    vtkNew<vtkImageData> image;
+    image->SetDimensions(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, NUMBER_OF_COMPONENTS);
+    vtkNew<vtkMatrix4x4> pose;
+
+    vtkNew<vtkTrackedScreenARSessionRecorder> recorder;
+    // Room for the whole session, nothing is dropped however slow the disk
+    recorder->SetMaximumQueueSize(1024);
+    CHECK_BOOL(recorder->Start(fileName), true);
+    for (int frameIndex = 0; frameIndex < NUMBER_OF_FRAMES; ++frameIndex)
+    {
+      SetPose(pose.GetPointer(), 2 * frameIndex);
+      CHECK_BOOL(recorder->RecordPose(pose.GetPointer(), GetPoseTimestamp(2 * frameIndex)), true);
+      SetFrame(image.GetPointer(), frameIndex);
+      CHECK_BOOL(recorder->RecordFrame(image.GetPointer(), GetFrameTimestamp(frameIndex)), true);
+      SetPose(pose.GetPointer(), 2 * frameIndex + 1);
+      CHECK_BOOL(recorder->RecordPose(pose.GetPointer(), GetPoseTimestamp(2 * frameIndex + 1)), true);
+    }
+    CHECK_BOOL(recorder->Stop(), true);
+
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfRecordedFrames()), NUMBER_OF_FRAMES);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfRecordedPoses()), NUMBER_OF_POSES);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfDroppedFrames()), 0);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfSkippedFrames()), 0);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Copy of the session as left by a recording that was never stopped: the header without counts
+  // nor tables, the chunks, and a frame chunk cut short by the crash
+  int WriteUnclosedSession(const std::string& fileName, const std::string& unclosedFileName)
+  {
+    std::ifstream input(fileName.c_str(), std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    CHECK_BOOL(data.size() >= sizeof(vtkTrackedScreenARSessionHeader), true);
+
+    vtkTrackedScreenARSessionHeader header;
+    memcpy(&header, &data[0], sizeof(header));
+    CHECK_BOOL(header.FrameTableOffset <= data.size(), true);
+    CHECK_INT(static_cast<int>(header.FrameTableOffset % TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT), 0);
+    data.resize(static_cast<size_t>(header.FrameTableOffset));
+    header.NumberOfFrames = 0;
+    header.FrameTableOffset = 0;
+    header.NumberOfPoses = 0;
+    header.PoseTableOffset = 0;
+    header.NumberOfViewFrames = 0;
+    header.ViewFrameTableOffset = 0;
+    memcpy(&data[0], &header, sizeof(header));
+
+    vtkTrackedScreenARSessionChunkHeader chunk;
+    chunk.Type = TRACKEDSCREENAR_SESSION_FRAME_CHUNK;
+    chunk.Reserved = 0;
+    chunk.DataSize = header.FrameSize;
+    vtkTrackedScreenARSessionFrameRecord record;
+    record.Timestamp = GetFrameTimestamp(NUMBER_OF_FRAMES);
+    record.Offset = data.size() + TRACKEDSCREENAR_SESSION_DATA_ALIGNMENT;
+    data.insert(data.end(), reinterpret_cast<const char*>(&chunk), reinterpret_cast<const char*>(&chunk) + sizeof(chunk));
+    data.insert(data.end(), reinterpret_cast<const char*>(&record), reinterpret_cast<const char*>(&record) + sizeof(record));
+    data.resize(data.size() + 7, 0);
+
+    std::ofstream output(unclosedFileName.c_str(), std::ios::binary | std::ios::trunc);
+    output.write(&data[0], data.size());
+    output.close();
+    CHECK_BOOL(output.fail(), false);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckReplay(vtkTrackedScreenARSessionPlayer* player, vtkMRMLScalarVolumeNode* videoNode, vtkMRMLLinearTransformNode* transformNode)
+  {
+    CHECK_INT(static_cast<int>(player->GetNumberOfFrames()), NUMBER_OF_FRAMES);
+    CHECK_INT(static_cast<int>(player->GetNumberOfPoses()), NUMBER_OF_POSES);
+    int dimensions[2] = { 0, 0 };
+    player->GetFrameDimensions(dimensions);
+    CHECK_INT(dimensions[0], FRAME_WIDTH);
+    CHECK_INT(dimensions[1], FRAME_HEIGHT);
+
+    // The session starts with its first pose, recorded before the first frame
+    double startTime = GetPoseTimestamp(0);
+    CHECK_BOOL(player->GetDuration() == GetPoseTimestamp(NUMBER_OF_POSES - 1) - startTime, true);
+
+    // Each step delivers the frame with the poses recorded before it
+    for (int frameIndex = 0; frameIndex < NUMBER_OF_FRAMES; ++frameIndex)
+    {
+      CHECK_BOOL(player->GetFrameTime(frameIndex) == GetFrameTimestamp(frameIndex) - startTime, true);
+      CHECK_BOOL(player->StepFrame(), true);
+      CHECK_INT(static_cast<int>(player->GetFrameIndex()), frameIndex + 1);
+      CHECK_INT(static_cast<int>(player->GetPoseIndex()), 2 * frameIndex + 1);
+      CHECK_EXIT_SUCCESS(CheckFrame(videoNode, frameIndex));
+      CHECK_EXIT_SUCCESS(CheckPose(transformNode, 2 * frameIndex));
+    }
+    CHECK_BOOL(player->StepFrame(), false);
+    CHECK_BOOL(player->IsAtEnd(), false);
+    int deliveredFrames = player->PlayUntil(player->GetDuration());
+    CHECK_INT(deliveredFrames, 0);
+    CHECK_BOOL(player->IsAtEnd(), true);
+    CHECK_EXIT_SUCCESS(CheckPose(transformNode, NUMBER_OF_POSES - 1));
+
+    // Playing by time delivers the same samples
+    player->Rewind();
+    deliveredFrames = player->PlayUntil(player->GetFrameTime(2));
+    CHECK_INT(deliveredFrames, 3);
+    CHECK_INT(static_cast<int>(player->GetPoseIndex()), 5);
+    CHECK_EXIT_SUCCESS(CheckFrame(videoNode, 2));
+    CHECK_EXIT_SUCCESS(CheckPose(transformNode, 4));
+    deliveredFrames = player->PlayUntil(player->GetDuration());
+    CHECK_INT(deliveredFrames, NUMBER_OF_FRAMES - 3);
+    CHECK_BOOL(player->IsAtEnd(), true);
+    CHECK_EXIT_SUCCESS(CheckFrame(videoNode, NUMBER_OF_FRAMES - 1));
+    CHECK_EXIT_SUCCESS(CheckPose(transformNode, NUMBER_OF_POSES - 1));
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARSessionPlayerTest(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: vtkTrackedScreenARSessionPlayerTest <temporary directory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string fileName = std::string(argv[1]) + "/vtkTrackedScreenARSessionPlayerTest.tsarsession";
+  std::string unclosedFileName = std::string(argv[1]) + "/vtkTrackedScreenARSessionPlayerTestUnclosed.tsarsession";
+
+  CHECK_EXIT_SUCCESS(RecordSession(fileName));
+  CHECK_EXIT_SUCCESS(WriteUnclosedSession(fileName, unclosedFileName));
+
+  vtkNew<vtkMRMLScalarVolumeNode> videoNode;
+  vtkNew<vtkMRMLLinearTransformNode> transformNode;
+  vtkNew<vtkTrackedScreenARSessionPlayer> player;
+  player->SetVideoNode(videoNode.GetPointer());
+  player->SetCameraTransformNode(transformNode.GetPointer());
+
+  // Closed by the recorder, read through its tables
+  CHECK_BOOL(player->Open(fileName), true);
+  CHECK_BOOL(player->IsRecovered(), false);
+  CHECK_EXIT_SUCCESS(CheckReplay(player.GetPointer(), videoNode.GetPointer(), transformNode.GetPointer()));
+  player->Close();
+
+  // Never closed, tables rebuilt from the chunks up to the cut one
+  TESTING_OUTPUT_ASSERT_WARNINGS_BEGIN();
+  bool opened = player->Open(unclosedFileName);
+  TESTING_OUTPUT_ASSERT_WARNINGS_END();
+  CHECK_BOOL(opened, true);
+  CHECK_BOOL(player->IsRecovered(), true);
+  CHECK_EXIT_SUCCESS(CheckReplay(player.GetPointer(), videoNode.GetPointer(), transformNode.GetPointer()));
+  player->Close();
+
+  // The video image keeps the last frame once the session is unmapped
+  CHECK_EXIT_SUCCESS(CheckFrame(videoNode.GetPointer(), NUMBER_OF_FRAMES - 1));
+
+  remove(fileName.c_str());
+  remove(unclosedFileName.c_str());
+  return EXIT_SUCCESS;
+}
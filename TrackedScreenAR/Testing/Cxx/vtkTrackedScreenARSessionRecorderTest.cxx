@@ -0,0 +1,251 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARSessionFormat.h"
+#include "vtkTrackedScreenARSessionPlayer.h"
+#include "vtkTrackedScreenARSessionRecorder.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkRenderWindow.h>
+
+// STD includes
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace
+{
+  const int FRAME_WIDTH = 7;
+  const int FRAME_HEIGHT = 3;
+  const int QUEUE_SIZE = 3;
+  const int NUMBER_OF_FRAMES = 6;
+  const double START_TIME = 1700000000.0;
+
+  //----------------------------------------------------------------------------
+  // Recorder whose writer thread holds on to the first frame it takes until released,
+  // so that the following frames fill the queue
+  class vtkStalledSessionRecorder : public vtkTrackedScreenARSessionRecorder
+  {
+  public:
+    static vtkStalledSessionRecorder* New();
+    vtkTypeMacro(vtkStalledSessionRecorder, vtkTrackedScreenARSessionRecorder);
+
+    void WaitUntilWriterStalled()
+    {
+      std::unique_lock<std::mutex> lock(this->StallMutex);
+      this->StallCondition.wait(lock, [this]() { return this->WriterStalled; });
+    }
+
+    void ReleaseWriter()
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->StallMutex);
+        this->WriterReleased = true;
+      }
+      this->StallCondition.notify_all();
+    }
+
+  protected:
+    vtkStalledSessionRecorder()
+      : WriterStalled(false)
+      , WriterReleased(false)
+    {
+    }
+
+    virtual bool WriteChunk(vtkTypeUInt32 type, const void* record, size_t recordSize, const void* data, vtkTypeUInt64 dataSize)
+    {
+      if (type == TRACKEDSCREENAR_SESSION_FRAME_CHUNK)
+      {
+        std::unique_lock<std::mutex> lock(this->StallMutex);
+        this->WriterStalled = true;
+        this->StallCondition.notify_all();
+        this->StallCondition.wait(lock, [this]() { return this->WriterReleased; });
+      }
+      return this->Superclass::WriteChunk(type, record, recordSize, data, dataSize);
+    }
+
+    std::mutex StallMutex;
+    std::condition_variable StallCondition;
+    bool WriterStalled;
+    bool WriterReleased;
+  };
+  vtkStandardNewMacro(vtkStalledSessionRecorder);
+
+  //----------------------------------------------------------------------------
+  double GetFrameTimestamp(int frameIndex)
+  {
+    return START_TIME + frameIndex / 30.0;
+  }
+
+  //----------------------------------------------------------------------------
+  void SetFrame(vtkImageData* image, int frameIndex)
+  {
+    unsigned char* values = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+    {
+      values[i] = static_cast<unsigned char>(frameIndex * 40 + i);
+    }
+    image->Modified();
+  }
+
+  //----------------------------------------------------------------------------
+  // Frames that must survive a full queue: the first one, held by the writer thread, then the
+  // first or the last frames that arrived depending on the drop policy
+  int GetKeptFrameIndex(int dropPolicy, int keptIndex)
+  {
+    if (keptIndex == 0 || dropPolicy == vtkTrackedScreenARSessionRecorder::DropNewest)
+    {
+      return keptIndex;
+    }
+    return NUMBER_OF_FRAMES - QUEUE_SIZE - 1 + keptIndex;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestDropPolicy(const std::string& fileName, int dropPolicy)
+  {
+    vtkNew<vtkImageData> image;
+    image->SetDimensions(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+    vtkNew<vtkStalledSessionRecorder> recorder;
+    recorder->SetMaximumQueueSize(QUEUE_SIZE);
+    recorder->SetDropPolicy(dropPolicy);
+    CHECK_BOOL(recorder->Start(fileName), true);
+
+    SetFrame(image.GetPointer(), 0);
+    CHECK_BOOL(recorder->RecordFrame(image.GetPointer(), GetFrameTimestamp(0)), true);
+    recorder->WaitUntilWriterStalled();
+
+    // Queued while the writer is busy
+    for (int frameIndex = 1; frameIndex <= QUEUE_SIZE; ++frameIndex)
+    {
+      SetFrame(image.GetPointer(), frameIndex);
+      CHECK_BOOL(recorder->RecordFrame(image.GetPointer(), GetFrameTimestamp(frameIndex)), true);
+    }
+    CHECK_INT(recorder->GetQueueSize(), QUEUE_SIZE);
+
+    // The queue is full: recording never waits, the policy decides which frame goes
+    for (int frameIndex = QUEUE_SIZE + 1; frameIndex < NUMBER_OF_FRAMES; ++frameIndex)
+    {
+      SetFrame(image.GetPointer(), frameIndex);
+      bool queued = recorder->RecordFrame(image.GetPointer(), GetFrameTimestamp(frameIndex));
+      CHECK_BOOL(queued, dropPolicy == vtkTrackedScreenARSessionRecorder::DropOldest);
+    }
+    CHECK_INT(recorder->GetQueueSize(), QUEUE_SIZE);
+    CHECK_INT(recorder->GetPeakQueueSize(), QUEUE_SIZE);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfDroppedFrames()), NUMBER_OF_FRAMES - 1 - QUEUE_SIZE);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfRecordedFrames()), 0);
+
+    // Poses are never dropped
+    vtkNew<vtkMatrix4x4> pose;
+    pose->SetElement(0, 3, 12.5);
+    CHECK_BOOL(recorder->RecordPose(pose.GetPointer(), GetFrameTimestamp(NUMBER_OF_FRAMES)), true);
+
+    recorder->ReleaseWriter();
+    CHECK_BOOL(recorder->Stop(), true);
+    CHECK_BOOL(recorder->IsRecording(), false);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfRecordedFrames()), QUEUE_SIZE + 1);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfRecordedPoses()), 1);
+    CHECK_INT(recorder->GetQueueSize(), 0);
+
+    // The stopped file holds the kept frames, in arrival order
+    vtkNew<vtkMRMLScalarVolumeNode> videoNode;
+    vtkNew<vtkTrackedScreenARSessionPlayer> player;
+    player->SetVideoNode(videoNode.GetPointer());
+    CHECK_BOOL(player->Open(fileName), true);
+    CHECK_BOOL(player->IsRecovered(), false);
+    CHECK_INT(static_cast<int>(player->GetNumberOfFrames()), QUEUE_SIZE + 1);
+    CHECK_INT(static_cast<int>(player->GetNumberOfPoses()), 1);
+    for (int keptIndex = 0; keptIndex <= QUEUE_SIZE; ++keptIndex)
+    {
+      int frameIndex = GetKeptFrameIndex(dropPolicy, keptIndex);
+      CHECK_DOUBLE(player->GetFrameTime(keptIndex), GetFrameTimestamp(frameIndex) - GetFrameTimestamp(0));
+      CHECK_BOOL(player->StepFrame(), true);
+      const unsigned char* values = static_cast<const unsigned char*>(videoNode->GetImageData()->GetPointData()->GetScalars()->GetVoidPointer(0));
+      for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+      {
+        CHECK_INT(values[i], static_cast<unsigned char>(frameIndex * 40 + i));
+      }
+    }
+    player->Close();
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSkippedFrames(const std::string& fileName)
+  {
+    vtkNew<vtkImageData> image;
+    image->SetDimensions(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    vtkNew<vtkImageData> resizedImage;
+    resizedImage->SetDimensions(FRAME_WIDTH + 1, FRAME_HEIGHT, 1);
+    resizedImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    vtkNew<vtkRenderWindow> renderWindow;
+
+    vtkNew<vtkTrackedScreenARSessionRecorder> recorder;
+    CHECK_BOOL(recorder->RecordFrame(image.GetPointer(), START_TIME), false);
+    CHECK_BOOL(recorder->Start(fileName), true);
+    CHECK_BOOL(recorder->RecordFrame(image.GetPointer(), START_TIME), true);
+
+    // The first frame fixes the geometry of the session
+    CHECK_BOOL(recorder->RecordFrame(resizedImage.GetPointer(), START_TIME + 0.1), false);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfSkippedFrames()), 1);
+
+    // View frames are not read back unless requested
+    CHECK_BOOL(recorder->GetRecordViewFrames(), false);
+    CHECK_BOOL(recorder->RecordViewFrame(renderWindow.GetPointer(), START_TIME, nullptr, START_TIME + 0.2), false);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfSkippedFrames()), 1);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfDroppedViewFrames()), 0);
+
+    CHECK_BOOL(recorder->Stop(), true);
+    CHECK_BOOL(recorder->Stop(), false);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfRecordedFrames()), 1);
+    CHECK_INT(static_cast<int>(recorder->GetNumberOfRecordedViewFrames()), 0);
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARSessionRecorderTest(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: vtkTrackedScreenARSessionRecorderTest <temporary directory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string fileName = std::string(argv[1]) + "/vtkTrackedScreenARSessionRecorderTest.tsarsession";
+
+  CHECK_EXIT_SUCCESS(TestDropPolicy(fileName, vtkTrackedScreenARSessionRecorder::DropNewest));
+  CHECK_EXIT_SUCCESS(TestDropPolicy(fileName, vtkTrackedScreenARSessionRecorder::DropOldest));
+  CHECK_EXIT_SUCCESS(TestSkippedFrames(fileName));
+
+  remove(fileName.c_str());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// TrackedScreenAR Logic includes
+#include "vtkTrackedScreenARUndistortionFilter.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  const int WIDTH = 160;
+  const int HEIGHT = 120;
+  const double INTRINSICS[4] = { 150.0, 155.0, 81.3, 58.7 };
+  const double COEFFICIENTS[5] = { 0.2, 0.05, 0.001, -0.002, 0.01 };
+
+  //----------------------------------------------------------------------------
+  // Where the ideal pinhole pixel (column, row) lands on the sensor, evaluated directly from the
+  // OpenCV radial/tangential model
+  void DistortPixel(const double intrinsics[4], const double coefficients[5], double column, double row, double source[2])
+  {
+    double x = (column - intrinsics[2]) / intrinsics[0];
+    double y = (row - intrinsics[3]) / intrinsics[1];
+    double r2 = x * x + y * y;
+    double radial = 1.0 + coefficients[0] * r2 + coefficients[1] * r2 * r2 + coefficients[4] * r2 * r2 * r2;
+    double xd = x * radial + 2.0 * coefficients[2] * x * y + coefficients[3] * (r2 + 2.0 * x * x);
+    double yd = y * radial + coefficients[2] * (r2 + 2.0 * y * y) + 2.0 * coefficients[3] * x * y;
+    source[0] = intrinsics[0] * xd + intrinsics[2];
+    source[1] = intrinsics[1] * yd + intrinsics[3];
+  }
+
+  //----------------------------------------------------------------------------
+  // Synthetic grid whose two components are the column and row of each pixel. Bilinear
+  // interpolation is exact on it, so the undistorted image holds the source position of every pixel.
+  void CreateGrid(int scalarType, int width, int height, vtkImageData* grid)
+  {
+    grid->SetDimensions(width, height, 1);
+    grid->AllocateScalars(scalarType, 2);
+    for (int row = 0; row < height; ++row)
+    {
+      for (int column = 0; column < width; ++column)
+      {
+        grid->SetScalarComponentFromDouble(column, row, 0, 0, column);
+        grid->SetScalarComponentFromDouble(column, row, 0, 1, row);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckUndistortedGrid(vtkImageData* output, double tolerance)
+  {
+    int numberOfCheckedPixels = 0;
+    int numberOfOutsidePixels = 0;
+    for (int row = 0; row < HEIGHT; ++row)
+    {
+      for (int column = 0; column < WIDTH; ++column)
+      {
+        double source[2] = { 0.0, 0.0 };
+        DistortPixel(INTRINSICS, COEFFICIENTS, column, row, source);
+        if (source[0] < -0.5 || source[0] >= WIDTH - 0.5 || source[1] < -0.5 || source[1] >= HEIGHT - 0.5)
+        {
+          // Rays that miss the sensor are black
+          CHECK_DOUBLE(output->GetScalarComponentAsDouble(column, row, 0, 0), 0.0);
+          CHECK_DOUBLE(output->GetScalarComponentAsDouble(column, row, 0, 1), 0.0);
+          ++numberOfOutsidePixels;
+          continue;
+        }
+        if (source[0] < 0.0 || source[0] > WIDTH - 1 || source[1] < 0.0 || source[1] > HEIGHT - 1)
+        {
+          // Clamped onto the border, not interpolated
+          continue;
+        }
+        CHECK_DOUBLE_TOLERANCE(output->GetScalarComponentAsDouble(column, row, 0, 0), source[0], tolerance);
+        CHECK_DOUBLE_TOLERANCE(output->GetScalarComponentAsDouble(column, row, 0, 1), source[1], tolerance);
+        ++numberOfCheckedPixels;
+      }
+    }
+    // The distortion is strong enough to push the corners off the sensor
+    CHECK_BOOL(numberOfOutsidePixels > 0, true);
+    CHECK_BOOL(numberOfCheckedPixels > WIDTH * HEIGHT / 2, true);
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestRemapTable()
+  {
+    vtkNew<vtkImageData> grid;
+    CreateGrid(VTK_FLOAT, WIDTH, HEIGHT, grid.GetPointer());
+
+    vtkNew<vtkTrackedScreenARUndistortionFilter> filter;
+    filter->SetInputData(grid.GetPointer());
+    filter->SetIntrinsics(const_cast<double*>(INTRINSICS));
+    filter->SetDistortionCoefficients(const_cast<double*>(COEFFICIENTS));
+    CHECK_BOOL(filter->IsDistortionActive(), true);
+    filter->Update();
+    // Table positions have 8 fractional bits
+    CHECK_EXIT_SUCCESS(CheckUndistortedGrid(filter->GetOutput(), 0.5 / 256 + 1e-4));
+
+    // The unsigned char kernel rounds the interpolated value to an integer
+    vtkNew<vtkImageData> byteGrid;
+    CreateGrid(VTK_UNSIGNED_CHAR, WIDTH, HEIGHT, byteGrid.GetPointer());
+    filter->SetInputData(byteGrid.GetPointer());
+    filter->Update();
+    CHECK_EXIT_SUCCESS(CheckUndistortedGrid(filter->GetOutput(), 0.5 + 1.0 / 256));
+    return EXIT_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestRemapTableRebuild()
+  {
+    vtkNew<vtkImageData> frame;
+    CreateGrid(VTK_UNSIGNED_CHAR, WIDTH, HEIGHT, frame.GetPointer());
+
+    vtkNew<vtkTrackedScreenARUndistortionFilter> filter;
+    filter->SetInputData(frame.GetPointer());
+    filter->SetIntrinsics(const_cast<double*>(INTRINSICS));
+    filter->SetDistortionCoefficients(const_cast<double*>(COEFFICIENTS));
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 1);
+
+    // New frame content of the same size reuses the table
+    frame->SetScalarComponentFromDouble(0, 0, 0, 0, 255.0);
+    frame->Modified();
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 1);
+
+    // Setting the same parameters again does not rebuild it
+    filter->SetIntrinsics(const_cast<double*>(INTRINSICS));
+    filter->SetDistortionCoefficients(const_cast<double*>(COEFFICIENTS));
+    filter->Modified();
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 1);
+
+    filter->SetIntrinsics(INTRINSICS[0] + 1.0, INTRINSICS[1], INTRINSICS[2], INTRINSICS[3]);
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 2);
+
+    double coefficients[5] = { COEFFICIENTS[0], COEFFICIENTS[1], COEFFICIENTS[2], COEFFICIENTS[3], 0.0 };
+    filter->SetDistortionCoefficients(coefficients);
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 3);
+
+    vtkNew<vtkImageData> smallerFrame;
+    CreateGrid(VTK_UNSIGNED_CHAR, WIDTH / 2, HEIGHT / 2, smallerFrame.GetPointer());
+    filter->SetInputData(smallerFrame.GetPointer());
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 4);
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 4);
+
+    // A disabled filter passes frames through without touching the table
+    filter->EnabledOff();
+    filter->SetInputData(frame.GetPointer());
+    filter->Update();
+    CHECK_INT(filter->GetRemapTableBuildCount(), 4);
+    CHECK_POINTER(filter->GetOutput()->GetScalarPointer(), frame->GetScalarPointer());
+    return EXIT_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedScreenARUndistortionFilterTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestRemapTable());
+  CHECK_EXIT_SUCCESS(TestRemapTableRebuild());
+  return EXIT_SUCCESS;
+}
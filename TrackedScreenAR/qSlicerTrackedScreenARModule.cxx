@@ -21,6 +21,11 @@
 // TrackedScreenAR includes
 #include "qSlicerTrackedScreenARModule.h"
 #include "qSlicerTrackedScreenARModuleWidget.h"
+#include "qSlicerTrackedScreenARViewDriver.h"
+
+// Slicer includes
+#include <qSlicerApplication.h>
+#include <qSlicerLayoutManager.h>
 
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_ExtensionTemplate
@@ -28,6 +33,9 @@ class qSlicerTrackedScreenARModulePrivate
 {
 public:
   qSlicerTrackedScreenARModulePrivate();
+
+  // Renders the AR views, whether the module widget exists or not
+  qSlicerTrackedScreenARViewDriver* ViewDriver;
 };
 
 //-----------------------------------------------------------------------------
@@ -35,6 +43,7 @@ public:
 
 //-----------------------------------------------------------------------------
 qSlicerTrackedScreenARModulePrivate::qSlicerTrackedScreenARModulePrivate()
+  : ViewDriver(nullptr)
 {
 }
 
@@ -94,7 +103,18 @@ QStringList qSlicerTrackedScreenARModule::dependencies() const
 //-----------------------------------------------------------------------------
 void qSlicerTrackedScreenARModule::setup()
 {
+  Q_D(qSlicerTrackedScreenARModule);
   this->Superclass::setup();
+
+  // The logic binds the views of the parameters nodes as soon as a scene brings them,
+  // the driver shows them in the layout without waiting for the module widget to be created
+  d->ViewDriver = new qSlicerTrackedScreenARViewDriver(this);
+  d->ViewDriver->setLogic(vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic()));
+  qSlicerLayoutManager* layoutManager = (qSlicerApplication::application() != nullptr ? qSlicerApplication::application()->layoutManager() : nullptr);
+  if (layoutManager != nullptr)
+  {
+    connect(layoutManager, SIGNAL(layoutChanged(int)), d->ViewDriver, SLOT(updateViews()));
+  }
 }
 
 //-----------------------------------------------------------------------------
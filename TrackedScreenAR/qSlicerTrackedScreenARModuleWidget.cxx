@@ -15,72 +15,41 @@
 
 ==============================================================================*/
 
+
 // Qt includes
 #include <QDebug>
+#include <QFileDialog>
+#include <QTimer>
 
 // Local includes
 #include "qSlicerTrackedScreenARModuleWidget.h"
 #include "ui_qSlicerTrackedScreenARModuleWidget.h"
 
-// Slicer includes
-#include <qSlicerApplication.h>
-#include <qSlicerLayoutManager.h>
+// Logic includes
+#include "vtkSlicerTrackedScreenARLogic.h"
+#include "vtkTrackedScreenARHandEyeCalibration.h"
+#include "vtkTrackedScreenARPixelFormatConverter.h"
+#include "vtkTrackedScreenARPosePredictor.h"
+#include "vtkTrackedScreenARSessionPlayer.h"
+#include "vtkTrackedScreenARSessionRecorder.h"
+
+// TrackedScreenAR MRML includes
+#include <vtkMRMLTrackedScreenARParametersNode.h>
 
 // MRML includes
-#include <qMRMLThreeDView.h>
-#include <qMRMLThreeDWidget.h>
-#include <vtkMRMLCameraNode.h>
 #include <vtkMRMLLinearTransformNode.h>
-#include <vtkMRMLScalarVolumeNode.h>
-#include <vtkMRMLScene.h>
-#include <vtkMRMLVectorVolumeNode.h>
-
-// Video cameras include
-#include <vtkMRMLPinholeCameraNode.h>
-
-// ITK includes
-#include <vnl_math.h>
+#include <vtkMRMLVolumeNode.h>
 
 // VTK includes
-#include <vtkCamera.h>
-#include <vtkImageData.h>
-#include <vtkRenderWindow.h>
-#include <vtkRenderer.h>
-#include <vtkRendererCollection.h>
-#include <vtkTexture.h>
-
-// VNL includes
-#include <vnl/vnl_matrix_fixed.h>
-#include <vnl/algo/vnl_matrix_inverse.h>
+#include <vtkWeakPointer.h>
 
 namespace
 {
-  //----------------------------------------------------------------------------
-  void ConvertVtkMatrixToVnlMatrix(const vtkMatrix4x4* inVtkMatrix, vnl_matrix_fixed<double, 4, 4>& outVnlMatrix)
-  {
-
-    for (int row = 0; row < 4; row++)
-    {
-      for (int column = 0; column < 4; column++)
-      {
-        outVnlMatrix.put(row, column, inVtkMatrix->GetElement(row, column));
-      }
-    }
-  }
-
-  //----------------------------------------------------------------------------
-  void ConvertVnlMatrixToVtkMatrix(const vnl_matrix_fixed<double, 4, 4>& inVnlMatrix, vtkMatrix4x4* outVtkMatrix)
-  {
-    outVtkMatrix->Identity();
+  // How often the calibration state is checked while the solver runs
+  const int CALIBRATION_STATUS_INTERVAL_MSEC = 200;
 
-    for (int row = 0; row < 3; row++)
-    {
-      for (int column = 0; column < 4; column++)
-      {
-        outVtkMatrix->SetElement(row, column, inVnlMatrix.get(row, column));
-      }
-    }
-  }
+  // How often a replayed session delivers its due samples, below the video frame interval
+  const int SESSION_PLAYBACK_INTERVAL_MSEC = 5;
 }
 
 //-----------------------------------------------------------------------------
@@ -88,13 +57,19 @@ namespace
 class qSlicerTrackedScreenARModuleWidgetPrivate: public Ui_qSlicerTrackedScreenARModuleWidget
 {
 public:
-  vtkMRMLLinearTransformNode* cameraTransformNode = nullptr;
-  vtkMRMLPinholeCameraNode* cameraParametersNode = nullptr;
-  vtkMRMLVolumeNode* videoSourceNode = nullptr;
+  // View the node selectors currently edit
+  QString CurrentViewNodeID;
+
+  // Parameters node of that view, shown in the node selectors. The logic applies its changes,
+  // the 3D views are driven by the module whether this widget exists or not.
+  vtkWeakPointer<vtkMRMLTrackedScreenARParametersNode> ParametersNode;
+  unsigned long ParametersNodeObserverTag = 0;
 
-  vtkTexture* BackgroundTexture = nullptr;
+  // Polls the calibration solver while it runs on its worker thread
+  QTimer* CalibrationStatusTimer = nullptr;
 
-  unsigned long ImageObserverTag = 0;
+  // Drives the session playback and refreshes the session state while recording or playing
+  QTimer* SessionTimer = nullptr;
 
 public:
   qSlicerTrackedScreenARModuleWidgetPrivate();
@@ -107,17 +82,11 @@ public:
 //-----------------------------------------------------------------------------
 qSlicerTrackedScreenARModuleWidgetPrivate::qSlicerTrackedScreenARModuleWidgetPrivate()
 {
-  this->BackgroundTexture = vtkTexture::New();
 }
 
 //-----------------------------------------------------------------------------
 qSlicerTrackedScreenARModuleWidgetPrivate::~qSlicerTrackedScreenARModuleWidgetPrivate()
 {
-  if (this->BackgroundTexture != nullptr)
-  {
-    this->BackgroundTexture->Delete();
-    this->BackgroundTexture = nullptr;
-  }
 }
 
 //-----------------------------------------------------------------------------
@@ -133,157 +102,514 @@ qSlicerTrackedScreenARModuleWidget::qSlicerTrackedScreenARModuleWidget(QWidget*
 //-----------------------------------------------------------------------------
 qSlicerTrackedScreenARModuleWidget::~qSlicerTrackedScreenARModuleWidget()
 {
+  Q_D(qSlicerTrackedScreenARModuleWidget);
+
+  if (d->ParametersNode != nullptr)
+  {
+    d->ParametersNode->RemoveObserver(d->ParametersNodeObserverTag);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::enter()
+{
+  this->Superclass::enter();
+
+  // A scene may have been loaded or closed while the module was not shown
+  this->observeParametersNode();
+  this->updateWidgetFromParametersNode();
+  this->updateCalibrationStatus();
+  this->updateSessionStatus();
 }
 
 //----------------------------------------------------------------------------
-void qSlicerTrackedScreenARModuleWidget::onCameraTransformNodeChanged(const QString& nodeId)
+void qSlicerTrackedScreenARModuleWidget::onViewNodeChanged(const QString& nodeId)
 {
   Q_D(qSlicerTrackedScreenARModuleWidget);
 
-  vtkMRMLNode* node = this->mrmlScene()->GetNodeByID(nodeId.toStdString());
-  if (node == nullptr)
+  d->CurrentViewNodeID = nodeId;
+  this->observeParametersNode();
+  this->updateWidgetFromParametersNode();
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::observeParametersNode()
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
+
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  vtkMRMLTrackedScreenARParametersNode* node = (logic != nullptr ? logic->GetParametersNode(d->CurrentViewNodeID.toStdString()) : nullptr);
+  if (node == d->ParametersNode)
   {
-    qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->cameraNode()->SetAndObserveTransformNodeID(nodeId.toStdString().c_str());
     return;
   }
+  if (d->ParametersNode != nullptr)
+  {
+    d->ParametersNode->RemoveObserver(d->ParametersNodeObserverTag);
+  }
+  d->ParametersNode = node;
+  if (d->ParametersNode != nullptr)
+  {
+    d->ParametersNodeObserverTag = d->ParametersNode->AddObserver(vtkCommand::ModifiedEvent, this, &qSlicerTrackedScreenARModuleWidget::onParametersNodeModified);
+  }
+}
 
-  d->cameraTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(node);
+//----------------------------------------------------------------------------
+vtkMRMLTrackedScreenARParametersNode* qSlicerTrackedScreenARModuleWidget::editedParametersNode()
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
 
-  // parent camera by transform
-  vtkMRMLCameraNode* camera = qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->cameraNode();
-  camera->SetAndObserveTransformNodeID(node->GetID());
+  if (d->ParametersNode == nullptr && !d->CurrentViewNodeID.isEmpty())
+  {
+    vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic())->AddParametersNode(d->CurrentViewNodeID.toStdString());
+    this->observeParametersNode();
+  }
+  return d->ParametersNode;
+}
 
-  this->onResetViewClicked();
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onParametersNodeModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  this->updateWidgetFromParametersNode();
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::updateWidgetFromParametersNode()
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
+
+  // Show the settings of the selected view without applying them again
+  vtkMRMLTrackedScreenARParametersNode* node = d->ParametersNode;
+
+  bool wasBlocked = d->comboBox_VideoSource->blockSignals(true);
+  d->comboBox_VideoSource->setCurrentNodeID(node != nullptr ? node->GetVideoSourceNodeID() : nullptr);
+  d->comboBox_VideoSource->blockSignals(wasBlocked);
+
+  wasBlocked = d->comboBox_PixelFormat->blockSignals(true);
+  d->comboBox_PixelFormat->setCurrentIndex(node != nullptr ? node->GetPixelFormat() : vtkTrackedScreenARPixelFormatConverter::PixelFormatRGB);
+  d->comboBox_PixelFormat->blockSignals(wasBlocked);
+
+  wasBlocked = d->comboBox_VideoCameraParameters->blockSignals(true);
+  d->comboBox_VideoCameraParameters->setCurrentNodeID(node != nullptr ? node->GetCameraParametersNodeID() : nullptr);
+  d->comboBox_VideoCameraParameters->blockSignals(wasBlocked);
+
+  wasBlocked = d->comboBox_CameraTransform->blockSignals(true);
+  d->comboBox_CameraTransform->setCurrentNodeID(node != nullptr ? node->GetCameraTransformNodeID() : nullptr);
+  d->comboBox_CameraTransform->blockSignals(wasBlocked);
+
+  wasBlocked = d->checkBox_DownscaleVideo->blockSignals(true);
+  d->checkBox_DownscaleVideo->setChecked(node != nullptr && node->GetDownscaleVideoToView());
+  d->checkBox_DownscaleVideo->blockSignals(wasBlocked);
+
+  wasBlocked = d->checkBox_LayeredRendering->blockSignals(true);
+  d->checkBox_LayeredRendering->setChecked(node != nullptr && node->GetLayeredRendering());
+  d->checkBox_LayeredRendering->blockSignals(wasBlocked);
+
+  wasBlocked = d->checkBox_AdaptiveQuality->blockSignals(true);
+  d->checkBox_AdaptiveQuality->setChecked(node != nullptr && node->GetAdaptiveQuality());
+  d->checkBox_AdaptiveQuality->blockSignals(wasBlocked);
+
+  wasBlocked = d->doubleSpinBox_FrameBudget->blockSignals(true);
+  d->doubleSpinBox_FrameBudget->setValue(1000.0 * (node != nullptr ? node->GetTargetFrameTime() : 1.0 / 30.0));
+  d->doubleSpinBox_FrameBudget->setEnabled(node != nullptr && node->GetAdaptiveQuality());
+  d->doubleSpinBox_FrameBudget->blockSignals(wasBlocked);
+
+  wasBlocked = d->comboBox_PredictionMode->blockSignals(true);
+  d->comboBox_PredictionMode->setCurrentIndex(node != nullptr ? node->GetPredictionMode() : vtkTrackedScreenARPosePredictor::PredictionOff);
+  d->comboBox_PredictionMode->blockSignals(wasBlocked);
+
+  // Negative horizons select the measured latency, shown as the special value at the minimum
+  wasBlocked = d->doubleSpinBox_PredictionHorizon->blockSignals(true);
+  double predictionHorizon = (node != nullptr ? node->GetPredictionHorizon() : -1.0);
+  d->doubleSpinBox_PredictionHorizon->setValue(predictionHorizon >= 0.0 ? 1000.0 * predictionHorizon : d->doubleSpinBox_PredictionHorizon->minimum());
+  d->doubleSpinBox_PredictionHorizon->setEnabled(node != nullptr && node->GetPredictionMode() != vtkTrackedScreenARPosePredictor::PredictionOff);
+  d->doubleSpinBox_PredictionHorizon->blockSignals(wasBlocked);
+
+  wasBlocked = d->doubleSpinBox_TargetFrameRate->blockSignals(true);
+  d->doubleSpinBox_TargetFrameRate->setValue(node != nullptr ? node->GetTargetFPS() : 60.0);
+  d->doubleSpinBox_TargetFrameRate->blockSignals(wasBlocked);
+
+  wasBlocked = d->doubleSpinBox_PoseTranslationDeadband->blockSignals(true);
+  d->doubleSpinBox_PoseTranslationDeadband->setValue(node != nullptr ? node->GetPoseTranslationDeadband() : 0.2);
+  d->doubleSpinBox_PoseTranslationDeadband->blockSignals(wasBlocked);
+
+  wasBlocked = d->doubleSpinBox_PoseRotationDeadband->blockSignals(true);
+  d->doubleSpinBox_PoseRotationDeadband->setValue(node != nullptr ? node->GetPoseRotationDeadband() : 0.05);
+  d->doubleSpinBox_PoseRotationDeadband->blockSignals(wasBlocked);
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onCameraTransformNodeChanged(const QString& nodeId)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  // The logic parents the view camera to the presented pose and resets the view
+  node->SetCameraTransformNodeID(nodeId.isEmpty() ? nullptr : nodeId.toUtf8().constData());
 }
 
 //----------------------------------------------------------------------------
 void qSlicerTrackedScreenARModuleWidget::onVideoSourceNodeChanged(const QString& nodeId)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  // Frames reach the background texture through the logic's frame exchange and video pipeline (pixel format
+  // conversion, downscaling, undistortion), shared by all views showing the same volume. Each stage passes
+  // frames through untouched when it has nothing to do.
+  node->SetVideoSourceNodeID(nodeId.isEmpty() ? nullptr : nodeId.toUtf8().constData());
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onVideoSourceParametersNodeChanged(const QString& nodeId)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  // The logic updates the projection once the intrinsics are in place
+  node->SetCameraParametersNodeID(nodeId.isEmpty() ? nullptr : nodeId.toUtf8().constData());
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onResetViewClicked()
 {
   Q_D(qSlicerTrackedScreenARModuleWidget);
 
-  vtkMRMLNode* node = this->mrmlScene()->GetNodeByID(nodeId.toStdString());
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  logic->ResetCameraView(logic->GetViewBinding(d->CurrentViewNodeID.toStdString()));
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onPixelFormatChanged(int index)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  // Planar formats store the frame in a taller image, the logic updates every view showing the source
+  node->SetPixelFormat(index);
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onDownscaleVideoToggled(bool downscale)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  node->SetDownscaleVideoToView(downscale);
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onLayeredRenderingToggled(bool layered)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  node->SetLayeredRendering(layered);
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onAdaptiveQualityToggled(bool adaptive)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  node->SetAdaptiveQuality(adaptive);
+}
 
-  if (d->videoSourceNode != nullptr && d->videoSourceNode != node)
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onFrameBudgetChanged(double frameBudgetMs)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
   {
-    d->videoSourceNode->RemoveObserver(d->ImageObserverTag);
-    d->ImageObserverTag = 0;
-    d->videoSourceNode = nullptr;
+    return;
   }
+  node->SetTargetFrameTime(frameBudgetMs / 1000.0);
+}
 
-  if (node == nullptr || vtkMRMLVolumeNode::SafeDownCast(node)->GetImageData() == nullptr)
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onPredictionModeChanged(int index)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
   {
-    qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->renderWindow()->GetRenderers()->GetFirstRenderer()->SetTexturedBackground(false);
-    d->BackgroundTexture->SetInputDataObject(nullptr);
+    return;
   }
-  else
+  node->SetPredictionMode(index);
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onPredictionHorizonChanged(double predictionHorizonMs)
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
+
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
   {
-    d->videoSourceNode = vtkMRMLVolumeNode::SafeDownCast(node);
+    return;
+  }
+  node->SetPredictionHorizon(predictionHorizonMs > d->doubleSpinBox_PredictionHorizon->minimum() ? predictionHorizonMs / 1000.0 : -1.0);
+}
 
-    qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->renderWindow()->GetRenderers()->GetFirstRenderer()->SetTexturedBackground(true);
-    d->BackgroundTexture->SetInputDataObject(d->videoSourceNode->GetImageData());
-    qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->renderWindow()->GetRenderers()->GetFirstRenderer()->SetLeftBackgroundTexture(d->BackgroundTexture);
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onTargetFrameRateChanged(double targetFPS)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  node->SetTargetFPS(targetFPS);
+}
 
-    d->ImageObserverTag = d->videoSourceNode->GetImageData()->AddObserver(vtkCommand::ModifiedEvent, this, &qSlicerTrackedScreenARModuleWidget::onImageDataModified);
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onPoseTranslationDeadbandChanged(double deadband)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
+  }
+  node->SetPoseTranslationDeadband(deadband);
+}
 
-    // Finally, trigger any camera parameter setting
-    if (d->cameraParametersNode != nullptr)
-    {
-      this->onVideoSourceParametersNodeChanged(QString(d->cameraParametersNode->GetID()));
-    }
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onPoseRotationDeadbandChanged(double deadband)
+{
+  vtkMRMLTrackedScreenARParametersNode* node = this->editedParametersNode();
+  if (node == nullptr)
+  {
+    return;
   }
+  node->SetPoseRotationDeadband(deadband);
 }
 
 //----------------------------------------------------------------------------
-void qSlicerTrackedScreenARModuleWidget::onVideoSourceParametersNodeChanged(const QString& nodeId)
+void qSlicerTrackedScreenARModuleWidget::onAddCalibrationSampleClicked()
 {
   Q_D(qSlicerTrackedScreenARModuleWidget);
 
-  // make VTK camera parameters match new camera intrinsics
-  vtkMRMLNode* node = this->mrmlScene()->GetNodeByID(nodeId.toStdString());
-  if (node != nullptr && vtkMRMLPinholeCameraNode::SafeDownCast(node) != nullptr && d->videoSourceNode != nullptr)
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  if (!logic->AddCalibrationSample(vtkMRMLVolumeNode::SafeDownCast(d->comboBox_VideoSource->currentNode()),
+                                   vtkMRMLTransformNode::SafeDownCast(d->comboBox_CalibrationPattern->currentNode())))
   {
-    vtkMRMLPinholeCameraNode* videoCameraNode = vtkMRMLPinholeCameraNode::SafeDownCast(node);
-    d->cameraParametersNode = videoCameraNode;
+    qWarning() << Q_FUNC_INFO << ": select the video source, camera marker and detected pattern transforms, and wait for the running calibration";
+  }
+  this->updateCalibrationStatus();
+}
 
-    vtkCamera* camera = qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->cameraNode()->GetCamera();
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onCalibrationMarkerNodeChanged(vtkMRMLNode* node)
+{
+  // Buffered from now on, so that samples get the marker pose at the time of their video frame
+  vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic())->SetCalibrationMarkerNode(vtkMRMLTransformNode::SafeDownCast(node));
+}
 
-    double imageWidth = d->videoSourceNode->GetImageData()->GetDimensions()[0];
-    double imageHeight = d->videoSourceNode->GetImageData()->GetDimensions()[1];
-    double windowWidth = qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->renderWindow()->GetSize()[0];
-    double windowHeight = qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->renderWindow()->GetSize()[1];
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onClearCalibrationSamplesClicked()
+{
+  vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic())->GetHandEyeCalibration()->RemoveAllSamples();
+  this->updateCalibrationStatus();
+}
 
-    double focalLengthY = videoCameraNode->GetIntrinsicMatrix()->GetElement(1, 1);
-    if (windowHeight != imageHeight)
-    {
-      double factor = static_cast<double>(windowHeight) / static_cast<double>(imageHeight);
-      focalLengthY = focalLengthY * factor;
-    }
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onCalibrateClicked()
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
 
-    camera->SetViewAngle(2 * atan((windowHeight / 2) / focalLengthY) * 180 / vnl_math::pi);
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  if (!logic->StartCalibration(vtkMRMLLinearTransformNode::SafeDownCast(d->comboBox_CalibrationOutput->currentNode())))
+  {
+    qWarning() << Q_FUNC_INFO << ": select an output camera transform and add at least 3 samples";
+    return;
+  }
+  d->CalibrationStatusTimer->start();
+  this->updateCalibrationStatus();
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::updateCalibrationStatus()
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
 
-    // Calculate window center
-    double px = 0;
-    double width = 0;
+  // Also published by the next rendered frame, this covers the case where no AR view renders
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  logic->PublishCalibrationResult();
 
-    double py = 0;
-    double height = 0;
+  vtkTrackedScreenARHandEyeCalibration* calibration = logic->GetHandEyeCalibration();
+  int numberOfSamples = calibration->GetNumberOfSamples();
+  QString status;
+  switch (calibration->GetState())
+  {
+    case vtkTrackedScreenARHandEyeCalibration::Running:
+      status = tr("Solving from %1 samples...").arg(numberOfSamples);
+      break;
+    case vtkTrackedScreenARHandEyeCalibration::Succeeded:
+      status = tr("Calibrated from %1 of %2 samples in %3 s, residuals %4 mm, %5 deg.")
+        .arg(calibration->GetNumberOfInliers()).arg(numberOfSamples).arg(calibration->GetSolveTime(), 0, 'f', 2)
+        .arg(calibration->GetTranslationResidual(), 0, 'f', 2).arg(calibration->GetRotationResidual(), 0, 'f', 2);
+      break;
+    case vtkTrackedScreenARHandEyeCalibration::Failed:
+      status = tr("Calibration failed: %1.").arg(QString::fromStdString(calibration->GetFailureReason()));
+      break;
+    default:
+      status = tr("%1 samples.").arg(numberOfSamples);
+      break;
+  }
+  d->label_CalibrationStatus->setText(status);
+  d->pushButton_AddCalibrationSample->setEnabled(calibration->GetState() != vtkTrackedScreenARHandEyeCalibration::Running);
+  d->pushButton_ClearCalibrationSamples->setEnabled(calibration->GetState() != vtkTrackedScreenARHandEyeCalibration::Running);
+  d->pushButton_Calibrate->setEnabled(calibration->GetState() != vtkTrackedScreenARHandEyeCalibration::Running);
+
+  if (calibration->GetState() != vtkTrackedScreenARHandEyeCalibration::Running)
+  {
+    d->CalibrationStatusTimer->stop();
+  }
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onRecordSessionToggled(bool record)
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
 
-    if (imageWidth != windowWidth || imageHeight != windowHeight)
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  if (!record)
+  {
+    if (!logic->StopSessionRecording())
     {
-      double factor = static_cast<double>(windowHeight) / static_cast<double>(imageHeight);
-
-      px = factor * videoCameraNode->GetIntrinsicMatrix()->GetElement(0, 2);
-      width = windowWidth;
-      int expectedWindowSize = vtkMath::Round(factor * static_cast<double>(imageWidth));
-      if (expectedWindowSize != windowWidth)
-      {
-        int diffX = (windowWidth - expectedWindowSize) / 2;
-        px = px + diffX;
-      }
-
-      py = factor * videoCameraNode->GetIntrinsicMatrix()->GetElement(1, 2);
-      height = windowHeight;
+      qWarning() << Q_FUNC_INFO << ": the session file could not be completed";
     }
-    else
-    {
-      px = videoCameraNode->GetIntrinsicMatrix()->GetElement(0, 2);
-      width = imageWidth;
+    this->updateSessionStatus();
+    return;
+  }
 
-      py = videoCameraNode->GetIntrinsicMatrix()->GetElement(1, 2);
-      height = imageHeight;
+  QString fileName = QFileDialog::getSaveFileName(this, tr("Record session"), QString(), tr("TrackedScreenAR sessions (*.tsarsession);;All files (*)"));
+  if (fileName.isEmpty() || !logic->StartSessionRecording(logic->GetViewBinding(d->CurrentViewNodeID.toStdString()), fileName.toStdString()))
+  {
+    if (!fileName.isEmpty())
+    {
+      qWarning() << Q_FUNC_INFO << ": cannot record the selected view to" << fileName;
     }
+    bool wasBlocked = d->pushButton_RecordSession->blockSignals(true);
+    d->pushButton_RecordSession->setChecked(false);
+    d->pushButton_RecordSession->blockSignals(wasBlocked);
+    return;
+  }
+  d->SessionTimer->start();
+  this->updateSessionStatus();
+}
+
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onRecordViewFramesToggled(bool recordViewFrames)
+{
+  vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic())->GetSessionRecorder()->SetRecordViewFrames(recordViewFrames);
+}
 
-    double cx = width - px;
-    double cy = py;
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onPlaySessionToggled(bool play)
+{
+  Q_D(qSlicerTrackedScreenARModuleWidget);
 
-    camera->SetWindowCenter(cx / ((width - 1) / 2) - 1, cy / ((height - 1) / 2) - 1);
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  if (logic->GetSessionPlayer()->IsOpen())
+  {
+    // Checked plays, unchecked pauses, Stop closes the session
+    logic->SetSessionPlaybackPaused(!play);
+    this->updateSessionStatus();
+    return;
   }
-  else
+
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Play session"), QString(), tr("TrackedScreenAR sessions (*.tsarsession);;All files (*)"));
+  if (fileName.isEmpty() || !logic->StartSessionPlayback(logic->GetViewBinding(d->CurrentViewNodeID.toStdString()), fileName.toStdString()))
   {
-    d->cameraParametersNode = nullptr;
+    if (!fileName.isEmpty())
+    {
+      qWarning() << Q_FUNC_INFO << ": cannot play" << fileName << "into the selected view, set its video and camera transform first";
+    }
+    bool wasBlocked = d->pushButton_PlaySession->blockSignals(true);
+    d->pushButton_PlaySession->setChecked(false);
+    d->pushButton_PlaySession->blockSignals(wasBlocked);
+    return;
   }
+  d->SessionTimer->start();
+  this->updateSessionStatus();
 }
 
 //----------------------------------------------------------------------------
-void qSlicerTrackedScreenARModuleWidget::onResetViewClicked()
+void qSlicerTrackedScreenARModuleWidget::onStepSessionFrameClicked()
 {
   Q_D(qSlicerTrackedScreenARModuleWidget);
 
-  vtkMRMLCameraNode* camNode = qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->cameraNode();
-  vtkMRMLLinearTransformNode* trNode = vtkMRMLLinearTransformNode::SafeDownCast(d->comboBox_CameraTransform->currentNode());
+  vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic())->StepSessionPlayback();
+  bool wasBlocked = d->pushButton_PlaySession->blockSignals(true);
+  d->pushButton_PlaySession->setChecked(false);
+  d->pushButton_PlaySession->blockSignals(wasBlocked);
+  this->updateSessionStatus();
+}
 
-  if (trNode)
-  {
-    vtkNew<vtkMatrix4x4> extrinsicTransform;
-    trNode->GetMatrixTransformToWorld(extrinsicTransform);
-    camNode->GetAppliedTransform()->DeepCopy(extrinsicTransform);
-  }
+//----------------------------------------------------------------------------
+void qSlicerTrackedScreenARModuleWidget::onStopSessionPlaybackClicked()
+{
+  vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic())->StopSessionPlayback();
+  this->updateSessionStatus();
 }
 
 //----------------------------------------------------------------------------
-void qSlicerTrackedScreenARModuleWidget::onImageDataModified()
+void qSlicerTrackedScreenARModuleWidget::updateSessionStatus()
 {
-  qSlicerApplication::application()->layoutManager()->threeDWidget(0)->threeDView()->scheduleRender();
+  Q_D(qSlicerTrackedScreenARModuleWidget);
+
+  vtkSlicerTrackedScreenARLogic* logic = vtkSlicerTrackedScreenARLogic::SafeDownCast(this->logic());
+  vtkTrackedScreenARSessionRecorder* recorder = logic->GetSessionRecorder();
+  vtkTrackedScreenARSessionPlayer* player = logic->GetSessionPlayer();
+  logic->UpdateSessionPlayback();
+
+  QStringList status;
+  if (recorder->IsRecording())
+  {
+    status << tr("Recorded %1 frames, %2 poses, %3 view frames, %4 dropped.")
+      .arg(recorder->GetNumberOfRecordedFrames()).arg(recorder->GetNumberOfRecordedPoses())
+      .arg(recorder->GetNumberOfRecordedViewFrames()).arg(recorder->GetNumberOfDroppedFrames() + recorder->GetNumberOfDroppedViewFrames());
+  }
+  if (player->IsOpen())
+  {
+    status << tr("Played %1 of %2 frames%3%4.")
+      .arg(player->GetFrameIndex()).arg(player->GetNumberOfFrames())
+      .arg(player->IsRecovered() ? tr(" (recovered)") : QString())
+      .arg(player->IsAtEnd() ? tr(", end of session") : (logic->GetSessionPlaybackPaused() ? tr(", paused") : QString()));
+  }
+  d->label_SessionStatus->setText(status.isEmpty() ? tr("No session.") : status.join(" "));
+
+  bool wasBlocked = d->pushButton_RecordSession->blockSignals(true);
+  d->pushButton_RecordSession->setChecked(recorder->IsRecording());
+  d->pushButton_RecordSession->blockSignals(wasBlocked);
+  wasBlocked = d->checkBox_RecordViewFrames->blockSignals(true);
+  d->checkBox_RecordViewFrames->setChecked(recorder->GetRecordViewFrames());
+  d->checkBox_RecordViewFrames->blockSignals(wasBlocked);
+  wasBlocked = d->pushButton_PlaySession->blockSignals(true);
+  d->pushButton_PlaySession->setChecked(player->IsOpen() && !logic->GetSessionPlaybackPaused());
+  d->pushButton_PlaySession->blockSignals(wasBlocked);
+  d->pushButton_StepSessionFrame->setEnabled(player->IsOpen() && !player->IsAtEnd());
+  d->pushButton_StopSessionPlayback->setEnabled(player->IsOpen());
+
+  if (!recorder->IsRecording() && (!player->IsOpen() || player->IsAtEnd() || logic->GetSessionPlaybackPaused()))
+  {
+    d->SessionTimer->stop();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -293,8 +619,45 @@ void qSlicerTrackedScreenARModuleWidget::setup()
   d->setupUi(this);
   this->Superclass::setup();
 
+  for (int format = 0; format < vtkTrackedScreenARPixelFormatConverter::PixelFormat_Last; ++format)
+  {
+    d->comboBox_PixelFormat->addItem(vtkTrackedScreenARPixelFormatConverter::GetPixelFormatAsString(format));
+  }
+  for (int mode = 0; mode < vtkTrackedScreenARPosePredictor::PredictionMode_Last; ++mode)
+  {
+    d->comboBox_PredictionMode->addItem(vtkTrackedScreenARPosePredictor::GetPredictionModeAsString(mode));
+  }
+
+  connect(d->comboBox_ThreeDView, &qMRMLNodeComboBox::currentNodeIDChanged, this, &qSlicerTrackedScreenARModuleWidget::onViewNodeChanged);
   connect(d->comboBox_VideoSource, &qMRMLNodeComboBox::currentNodeIDChanged, this, &qSlicerTrackedScreenARModuleWidget::onVideoSourceNodeChanged);
+  connect(d->comboBox_PixelFormat, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &qSlicerTrackedScreenARModuleWidget::onPixelFormatChanged);
+  connect(d->checkBox_DownscaleVideo, &QCheckBox::toggled, this, &qSlicerTrackedScreenARModuleWidget::onDownscaleVideoToggled);
+  connect(d->checkBox_LayeredRendering, &QCheckBox::toggled, this, &qSlicerTrackedScreenARModuleWidget::onLayeredRenderingToggled);
+  connect(d->checkBox_AdaptiveQuality, &QCheckBox::toggled, this, &qSlicerTrackedScreenARModuleWidget::onAdaptiveQualityToggled);
+  connect(d->doubleSpinBox_FrameBudget, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, &qSlicerTrackedScreenARModuleWidget::onFrameBudgetChanged);
+  connect(d->comboBox_PredictionMode, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &qSlicerTrackedScreenARModuleWidget::onPredictionModeChanged);
+  connect(d->doubleSpinBox_PredictionHorizon, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, &qSlicerTrackedScreenARModuleWidget::onPredictionHorizonChanged);
+  connect(d->doubleSpinBox_TargetFrameRate, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, &qSlicerTrackedScreenARModuleWidget::onTargetFrameRateChanged);
+  connect(d->doubleSpinBox_PoseTranslationDeadband, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, &qSlicerTrackedScreenARModuleWidget::onPoseTranslationDeadbandChanged);
+  connect(d->doubleSpinBox_PoseRotationDeadband, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, &qSlicerTrackedScreenARModuleWidget::onPoseRotationDeadbandChanged);
   connect(d->comboBox_VideoCameraParameters, &qMRMLNodeComboBox::currentNodeIDChanged, this, &qSlicerTrackedScreenARModuleWidget::onVideoSourceParametersNodeChanged);
   connect(d->comboBox_CameraTransform, &qMRMLNodeComboBox::currentNodeIDChanged, this, &qSlicerTrackedScreenARModuleWidget::onCameraTransformNodeChanged);
   connect(d->pushButton_ResetView, &QPushButton::clicked, this, &qSlicerTrackedScreenARModuleWidget::onResetViewClicked);
+
+  d->CalibrationStatusTimer = new QTimer(this);
+  d->CalibrationStatusTimer->setInterval(CALIBRATION_STATUS_INTERVAL_MSEC);
+  connect(d->CalibrationStatusTimer, &QTimer::timeout, this, &qSlicerTrackedScreenARModuleWidget::updateCalibrationStatus);
+  connect(d->comboBox_CalibrationMarker, &qMRMLNodeComboBox::currentNodeChanged, this, &qSlicerTrackedScreenARModuleWidget::onCalibrationMarkerNodeChanged);
+  connect(d->pushButton_AddCalibrationSample, &QPushButton::clicked, this, &qSlicerTrackedScreenARModuleWidget::onAddCalibrationSampleClicked);
+  connect(d->pushButton_ClearCalibrationSamples, &QPushButton::clicked, this, &qSlicerTrackedScreenARModuleWidget::onClearCalibrationSamplesClicked);
+  connect(d->pushButton_Calibrate, &QPushButton::clicked, this, &qSlicerTrackedScreenARModuleWidget::onCalibrateClicked);
+
+  d->SessionTimer = new QTimer(this);
+  d->SessionTimer->setInterval(SESSION_PLAYBACK_INTERVAL_MSEC);
+  connect(d->SessionTimer, &QTimer::timeout, this, &qSlicerTrackedScreenARModuleWidget::updateSessionStatus);
+  connect(d->pushButton_RecordSession, &QPushButton::toggled, this, &qSlicerTrackedScreenARModuleWidget::onRecordSessionToggled);
+  connect(d->checkBox_RecordViewFrames, &QCheckBox::toggled, this, &qSlicerTrackedScreenARModuleWidget::onRecordViewFramesToggled);
+  connect(d->pushButton_PlaySession, &QPushButton::toggled, this, &qSlicerTrackedScreenARModuleWidget::onPlaySessionToggled);
+  connect(d->pushButton_StepSessionFrame, &QPushButton::clicked, this, &qSlicerTrackedScreenARModuleWidget::onStepSessionFrameClicked);
+  connect(d->pushButton_StopSessionPlayback, &QPushButton::clicked, this, &qSlicerTrackedScreenARModuleWidget::onStopSessionPlaybackClicked);
 }
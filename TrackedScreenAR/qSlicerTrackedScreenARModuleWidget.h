@@ -25,6 +25,8 @@
 
 class qSlicerTrackedScreenARModuleWidgetPrivate;
 class vtkMRMLNode;
+class vtkMRMLTrackedScreenARParametersNode;
+class vtkObject;
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
 class Q_SLICER_QTMODULES_TRACKEDSCREENAR_EXPORT qSlicerTrackedScreenARModuleWidget :
@@ -37,14 +39,52 @@ public:
   qSlicerTrackedScreenARModuleWidget(QWidget* parent = 0);
   virtual ~qSlicerTrackedScreenARModuleWidget();
 
+  virtual void enter();
+
 public slots:
+  void onViewNodeChanged(const QString& nodeId);
   void onCameraTransformNodeChanged(const QString& nodeId);
   void onVideoSourceNodeChanged(const QString& nodeId);
   void onVideoSourceParametersNodeChanged(const QString& nodeId);
   void onResetViewClicked();
+  void onPixelFormatChanged(int index);
+  void onDownscaleVideoToggled(bool downscale);
+  void onLayeredRenderingToggled(bool layered);
+  void onAdaptiveQualityToggled(bool adaptive);
+  void onFrameBudgetChanged(double frameBudgetMs);
+  void onPredictionModeChanged(int index);
+  void onPredictionHorizonChanged(double predictionHorizonMs);
+  void onTargetFrameRateChanged(double targetFPS);
+  void onPoseTranslationDeadbandChanged(double deadband);
+  void onPoseRotationDeadbandChanged(double deadband);
+  void onAddCalibrationSampleClicked();
+  void onCalibrationMarkerNodeChanged(vtkMRMLNode* node);
+  void onClearCalibrationSamplesClicked();
+  void onCalibrateClicked();
+  void onRecordSessionToggled(bool record);
+  void onRecordViewFramesToggled(bool recordViewFrames);
+  void onPlaySessionToggled(bool play);
+  void onStepSessionFrameClicked();
+  void onStopSessionPlaybackClicked();
+
+  /// Show the parameters node of the selected view in the node selectors
+  void updateWidgetFromParametersNode();
+
+protected slots:
+  /// Publish a finished calibration and show the calibration state
+  void updateCalibrationStatus();
+
+  /// Deliver the replayed samples that are due and show the recording and playback state
+  void updateSessionStatus();
 
 protected:
-  void onImageDataModified();
+  /// Parameters node of the selected view, added to the scene on first edit. nullptr if no view is selected.
+  vtkMRMLTrackedScreenARParametersNode* editedParametersNode();
+
+  /// Observe the parameters node of the selected view, if it has one
+  void observeParametersNode();
+
+  void onParametersNodeModified(vtkObject* caller, unsigned long event, void* callData);
 
 protected:
   QScopedPointer<qSlicerTrackedScreenARModuleWidgetPrivate> d_ptr;
@@ -0,0 +1,330 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// Qt includes
+#include <QMap>
+#include <QPointer>
+#include <QTimer>
+
+// Local includes
+#include "qSlicerTrackedScreenARViewDriver.h"
+
+// Logic includes
+#include "vtkSlicerTrackedScreenARLogic.h"
+#include "vtkTrackedScreenARFramePacer.h"
+#include "vtkTrackedScreenARViewBinding.h"
+
+// Slicer includes
+#include <qSlicerApplication.h>
+#include <qSlicerLayoutManager.h>
+
+// MRML includes
+#include <qMRMLThreeDView.h>
+#include <qMRMLThreeDWidget.h>
+#include <vtkMRMLViewNode.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkRenderWindow.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+//-----------------------------------------------------------------------------
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+class qSlicerTrackedScreenARViewDriverPrivate
+{
+public:
+  // Qt side of a view bound in the logic and shown in the layout
+  struct ViewState
+  {
+    QPointer<qMRMLThreeDView> ThreeDView;
+    vtkWeakPointer<vtkTrackedScreenARViewBinding> Binding;
+
+    // Render setting of the view before it was attached, its own scheduled renders are off while bound
+    bool SavedRenderEnabled = true;
+
+    // Fires when the frame pacer of the view says the next render is due
+    QTimer* RenderTimer = nullptr;
+    unsigned long RenderRequestedObserverTag = 0;
+
+    // Displayable managers of the view, they request a render when the scene or its display changed
+    vtkSmartPointer<vtkCollection> DisplayableManagers;
+    QList<unsigned long> DisplayableManagerObserverTags;
+  };
+
+  QMap<QString, ViewState*> Views;
+
+  vtkWeakPointer<vtkSlicerTrackedScreenARLogic> Logic;
+  unsigned long LogicModifiedObserverTag = 0;
+
+public:
+  ~qSlicerTrackedScreenARViewDriverPrivate();
+
+  ViewState* viewForBinding(vtkObject* binding) const;
+  ViewState* viewForDisplayableManager(vtkObject* displayableManager) const;
+
+  /// Detach the view from its binding and forget it
+  void releaseView(const QString& viewNodeID);
+};
+
+//-----------------------------------------------------------------------------
+// qSlicerTrackedScreenARViewDriverPrivate methods
+
+//-----------------------------------------------------------------------------
+qSlicerTrackedScreenARViewDriverPrivate::~qSlicerTrackedScreenARViewDriverPrivate()
+{
+  foreach (const QString& viewNodeID, this->Views.keys())
+  {
+    this->releaseView(viewNodeID);
+  }
+}
+
+//-----------------------------------------------------------------------------
+qSlicerTrackedScreenARViewDriverPrivate::ViewState* qSlicerTrackedScreenARViewDriverPrivate::viewForBinding(vtkObject* binding) const
+{
+  foreach (ViewState* view, this->Views)
+  {
+    if (view->Binding != nullptr && view->Binding.GetPointer() == binding && view->ThreeDView != nullptr)
+    {
+      return view;
+    }
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+qSlicerTrackedScreenARViewDriverPrivate::ViewState* qSlicerTrackedScreenARViewDriverPrivate::viewForDisplayableManager(vtkObject* displayableManager) const
+{
+  foreach (ViewState* view, this->Views)
+  {
+    if (view->Binding != nullptr && view->DisplayableManagers->IsItemPresent(displayableManager) != 0)
+    {
+      return view;
+    }
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARViewDriverPrivate::releaseView(const QString& viewNodeID)
+{
+  ViewState* view = this->Views.take(viewNodeID);
+  if (view == nullptr)
+  {
+    return;
+  }
+  for (int i = 0; i < view->DisplayableManagerObserverTags.size(); ++i)
+  {
+    view->DisplayableManagers->GetItemAsObject(i)->RemoveObserver(view->DisplayableManagerObserverTags[i]);
+  }
+  if (view->Binding != nullptr)
+  {
+    view->Binding->RemoveObserver(view->RenderRequestedObserverTag);
+    if (this->Logic != nullptr)
+    {
+      this->Logic->SetRenderWindow(view->Binding, nullptr);
+    }
+  }
+  if (view->ThreeDView != nullptr)
+  {
+    view->ThreeDView->setRenderEnabled(view->SavedRenderEnabled);
+    view->ThreeDView->scheduleRender();
+  }
+  delete view->RenderTimer;
+  delete view;
+}
+
+//-----------------------------------------------------------------------------
+// qSlicerTrackedScreenARViewDriver methods
+
+//-----------------------------------------------------------------------------
+qSlicerTrackedScreenARViewDriver::qSlicerTrackedScreenARViewDriver(QObject* _parent)
+  : Superclass(_parent)
+  , d_ptr(new qSlicerTrackedScreenARViewDriverPrivate)
+{
+}
+
+//-----------------------------------------------------------------------------
+qSlicerTrackedScreenARViewDriver::~qSlicerTrackedScreenARViewDriver()
+{
+  this->setLogic(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARViewDriver::setLogic(vtkSlicerTrackedScreenARLogic* logic)
+{
+  Q_D(qSlicerTrackedScreenARViewDriver);
+
+  if (logic == d->Logic)
+  {
+    return;
+  }
+  foreach (const QString& viewNodeID, d->Views.keys())
+  {
+    d->releaseView(viewNodeID);
+  }
+  if (d->Logic != nullptr)
+  {
+    d->Logic->RemoveObserver(d->LogicModifiedObserverTag);
+  }
+  d->Logic = logic;
+  if (d->Logic != nullptr)
+  {
+    // The logic is modified when a view is bound or released
+    d->LogicModifiedObserverTag = d->Logic->AddObserver(vtkCommand::ModifiedEvent, this, &qSlicerTrackedScreenARViewDriver::onLogicModified);
+  }
+  this->updateViews();
+}
+
+//-----------------------------------------------------------------------------
+vtkSlicerTrackedScreenARLogic* qSlicerTrackedScreenARViewDriver::logic() const
+{
+  Q_D(const qSlicerTrackedScreenARViewDriver);
+  return d->Logic;
+}
+
+//-----------------------------------------------------------------------------
+qMRMLThreeDView* qSlicerTrackedScreenARViewDriver::threeDViewForNode(const QString& viewNodeID)
+{
+  qSlicerLayoutManager* layoutManager = (qSlicerApplication::application() != nullptr ? qSlicerApplication::application()->layoutManager() : nullptr);
+  if (layoutManager == nullptr)
+  {
+    return nullptr;
+  }
+  for (int i = 0; i < layoutManager->threeDViewCount(); ++i)
+  {
+    qMRMLThreeDWidget* threeDWidget = layoutManager->threeDWidget(i);
+    if (threeDWidget != nullptr && threeDWidget->mrmlViewNode() != nullptr && viewNodeID == threeDWidget->mrmlViewNode()->GetID())
+    {
+      return threeDWidget->threeDView();
+    }
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARViewDriver::updateViews()
+{
+  Q_D(qSlicerTrackedScreenARViewDriver);
+
+  foreach (const QString& viewNodeID, d->Views.keys())
+  {
+    qSlicerTrackedScreenARViewDriverPrivate::ViewState* view = d->Views.value(viewNodeID);
+    vtkTrackedScreenARViewBinding* binding = (d->Logic != nullptr ? d->Logic->GetViewBinding(viewNodeID.toStdString()) : nullptr);
+    if (binding == nullptr || binding != view->Binding || view->ThreeDView == nullptr || view->ThreeDView != threeDViewForNode(viewNodeID))
+    {
+      // Unbound, or the layout changed since the view was attached
+      d->releaseView(viewNodeID);
+    }
+  }
+  if (d->Logic == nullptr)
+  {
+    return;
+  }
+
+  for (int i = 0; i < d->Logic->GetNumberOfViewBindings(); ++i)
+  {
+    vtkTrackedScreenARViewBinding* binding = d->Logic->GetNthViewBinding(i);
+    QString viewNodeID = QString::fromStdString(binding->GetViewNodeID());
+    qMRMLThreeDView* threeDView = threeDViewForNode(viewNodeID);
+    if (d->Views.contains(viewNodeID) || threeDView == nullptr)
+    {
+      continue;
+    }
+
+    qSlicerTrackedScreenARViewDriverPrivate::ViewState* view = new qSlicerTrackedScreenARViewDriverPrivate::ViewState;
+    view->ThreeDView = threeDView;
+    view->Binding = binding;
+
+    view->RenderTimer = new QTimer(this);
+    view->RenderTimer->setSingleShot(true);
+    view->RenderTimer->setTimerType(Qt::PreciseTimer);
+    connect(view->RenderTimer, &QTimer::timeout, this, [this, viewNodeID]() { this->renderView(viewNodeID); });
+    view->RenderRequestedObserverTag = binding->AddObserver(vtkTrackedScreenARViewBinding::RenderRequestedEvent, this, &qSlicerTrackedScreenARViewDriver::onRenderRequested);
+    // Scene and display changes go through the frame pacer of the view like video frames and poses
+    view->DisplayableManagers = vtkSmartPointer<vtkCollection>::New();
+    threeDView->getDisplayableManagers(view->DisplayableManagers);
+    for (int managerIndex = 0; managerIndex < view->DisplayableManagers->GetNumberOfItems(); ++managerIndex)
+    {
+      view->DisplayableManagerObserverTags << view->DisplayableManagers->GetItemAsObject(managerIndex)->AddObserver(
+        vtkCommand::UpdateEvent, this, &qSlicerTrackedScreenARViewDriver::onSceneRenderRequested);
+    }
+    d->Views[viewNodeID] = view;
+
+    // The view would otherwise also render on its own each time a displayable manager asks for it, on top of
+    // the renders of the frame pacer. Disabled rendering turns scheduleRender() and forceRender() into no-ops.
+    view->SavedRenderEnabled = threeDView->renderEnabled();
+    threeDView->setRenderEnabled(false);
+
+    // Shows the video in the background and timestamps the renders for latency statistics
+    d->Logic->SetRenderWindow(binding, threeDView->renderWindow());
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARViewDriver::onLogicModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  this->updateViews();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARViewDriver::onRenderRequested(vtkObject* caller, unsigned long vtkNotUsed(event), void* callData)
+{
+  Q_D(qSlicerTrackedScreenARViewDriver);
+
+  qSlicerTrackedScreenARViewDriverPrivate::ViewState* view = d->viewForBinding(caller);
+  if (view == nullptr)
+  {
+    return;
+  }
+  double delay = *reinterpret_cast<double*>(callData);
+  if (!view->RenderTimer->isActive())
+  {
+    view->RenderTimer->start(static_cast<int>(delay * 1000.0 + 0.5));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARViewDriver::onSceneRenderRequested(vtkObject* caller, unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  Q_D(qSlicerTrackedScreenARViewDriver);
+
+  qSlicerTrackedScreenARViewDriverPrivate::ViewState* view = d->viewForDisplayableManager(caller);
+  // The camera moved to the pose presented by the frame being prepared, that is no scene change
+  if (view != nullptr && !view->Binding->GetPresentingCameraPose())
+  {
+    view->Binding->RequestRender(vtkTrackedScreenARFramePacer::SceneSource);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTrackedScreenARViewDriver::renderView(const QString& viewNodeID)
+{
+  Q_D(qSlicerTrackedScreenARViewDriver);
+
+  qSlicerTrackedScreenARViewDriverPrivate::ViewState* view = d->Views.value(viewNodeID, nullptr);
+  if (d->Logic == nullptr || view == nullptr || view->Binding == nullptr || view->ThreeDView == nullptr)
+  {
+    return;
+  }
+  if (d->Logic->BeginFrame(view->Binding) != 0 && view->ThreeDView->isVisible())
+  {
+    // Rendering of the view widget is disabled while it is bound, render its window directly
+    view->ThreeDView->renderWindow()->Render();
+  }
+}
@@ -0,0 +1,73 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+#ifndef __qSlicerTrackedScreenARViewDriver_h
+#define __qSlicerTrackedScreenARViewDriver_h
+
+// Qt includes
+#include <QObject>
+
+#include "qSlicerTrackedScreenARModuleExport.h"
+
+class qMRMLThreeDView;
+class qSlicerTrackedScreenARViewDriverPrivate;
+class vtkObject;
+class vtkSlicerTrackedScreenARLogic;
+
+/// \ingroup Slicer_QtModules_TrackedScreenAR
+/// Attaches the 3D views of the layout to the view bindings of the logic and renders them when
+/// their frame pacer asks for it, in place of the renders the views schedule themselves. Owned by the module, so AR views come up with the scene whether
+/// or not the module panel was ever opened.
+class Q_SLICER_QTMODULES_TRACKEDSCREENAR_EXPORT qSlicerTrackedScreenARViewDriver : public QObject
+{
+  Q_OBJECT
+
+public:
+  typedef QObject Superclass;
+  qSlicerTrackedScreenARViewDriver(QObject* parent = 0);
+  virtual ~qSlicerTrackedScreenARViewDriver();
+
+  /// Logic whose view bindings are driven
+  void setLogic(vtkSlicerTrackedScreenARLogic* logic);
+  vtkSlicerTrackedScreenARLogic* logic() const;
+
+  /// 3D view widget showing the given view node, nullptr if the layout does not show it or there is no layout
+  static qMRMLThreeDView* threeDViewForNode(const QString& viewNodeID);
+
+public slots:
+  /// Attach the 3D views of the layout to the bindings of the nodes they show, and release
+  /// the views that are no longer bound or shown
+  void updateViews();
+
+protected slots:
+  void renderView(const QString& viewNodeID);
+
+protected:
+  void onLogicModified(vtkObject* caller, unsigned long event, void* callData);
+  void onRenderRequested(vtkObject* caller, unsigned long event, void* callData);
+  void onSceneRenderRequested(vtkObject* caller, unsigned long event, void* callData);
+
+protected:
+  QScopedPointer<qSlicerTrackedScreenARViewDriverPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerTrackedScreenARViewDriver);
+  Q_DISABLE_COPY(qSlicerTrackedScreenARViewDriver);
+};
+
+#endif
@@ -17,15 +17,23 @@
 
 // VideoPassthrough Logic includes
 #include "vtkSlicerVideoPassthroughLogic.h"
+#include "vtkVideoPassthroughRenderScheduler.h"
+#include "vtkVideoPassthroughStereoPairing.h"
+
+// Telemetry includes
+#include <vtkAugmentedRealityTelemetry.h>
 
 // MRML includes
 #include <vtkMRMLScene.h>
 #include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLTableNode.h>
 
 // VTK includes
 #include <vtkIntArray.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkRenderWindow.h>
+#include <vtkTimerLog.h>
 
 // STD includes
 #include <cassert>
@@ -35,18 +43,278 @@ vtkStandardNewMacro(vtkSlicerVideoPassthroughLogic);
 
 //----------------------------------------------------------------------------
 vtkSlicerVideoPassthroughLogic::vtkSlicerVideoPassthroughLogic()
+  : LeftEyeVolumeNodeInternal(nullptr)
+  , RightEyeVolumeNodeInternal(nullptr)
+  , StereoVolumeNodeInternal(nullptr)
+  , StereoPairing(vtkVideoPassthroughStereoPairing::New())
+  , RenderScheduler(vtkVideoPassthroughRenderScheduler::New())
+  , RenderWindowInternal(nullptr)
+  , Telemetry(vtkSmartPointer<vtkAugmentedRealityTelemetry>::New())
+  , RenderStartTelemetryTime(-1.0)
 {
+  this->Telemetry->SetName("VideoPassthrough");
+  this->EyeFrameAges[vtkVideoPassthroughStereoPairing::LeftEye] = -1.0;
+  this->EyeFrameAges[vtkVideoPassthroughStereoPairing::RightEye] = -1.0;
 }
 
 //----------------------------------------------------------------------------
 vtkSlicerVideoPassthroughLogic::~vtkSlicerVideoPassthroughLogic()
 {
+  vtkSetAndObserveMRMLNodeMacro(this->LeftEyeVolumeNodeInternal, nullptr);
+  vtkSetAndObserveMRMLNodeMacro(this->RightEyeVolumeNodeInternal, nullptr);
+  vtkSetAndObserveMRMLNodeMacro(this->StereoVolumeNodeInternal, nullptr);
+  vtkSetAndObserveMRMLNodeMacro(this->RenderWindowInternal, nullptr);
+
+  this->StereoPairing->Delete();
+  this->StereoPairing = nullptr;
+  this->RenderScheduler->Delete();
+  this->RenderScheduler = nullptr;
 }
 
 //----------------------------------------------------------------------------
 void vtkSlicerVideoPassthroughLogic::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "LeftEyeVolumeNode: " << (this->LeftEyeVolumeNodeInternal ? this->LeftEyeVolumeNodeInternal->GetID() : "(none)") << std::endl;
+  os << indent << "RightEyeVolumeNode: " << (this->RightEyeVolumeNodeInternal ? this->RightEyeVolumeNodeInternal->GetID() : "(none)") << std::endl;
+  os << indent << "StereoVolumeNode: " << (this->StereoVolumeNodeInternal ? this->StereoVolumeNodeInternal->GetID() : "(none)") << std::endl;
+  os << indent << "StereoPairing:" << std::endl;
+  this->StereoPairing->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "RenderScheduler:" << std::endl;
+  this->RenderScheduler->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "EyeFrameAges: " << this->EyeFrameAges[0] << " " << this->EyeFrameAges[1] << std::endl;
+  os << indent << "TelemetryTableNodeID: " << this->TelemetryTableNodeID << std::endl;
+  os << indent << "Telemetry:" << std::endl;
+  this->Telemetry->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::SetLeftEyeVolumeNode(vtkMRMLScalarVolumeNode* node)
+{
+  if (node == this->LeftEyeVolumeNodeInternal)
+  {
+    return;
+  }
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLVolumeNode::ImageDataModifiedEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(this->LeftEyeVolumeNodeInternal, node, events.GetPointer());
+
+  // Frames queued for the previous source would pair with the wrong camera
+  this->StereoPairing->ClearPendingFrames();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkSlicerVideoPassthroughLogic::GetLeftEyeVolumeNode()
+{
+  return this->LeftEyeVolumeNodeInternal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::SetRightEyeVolumeNode(vtkMRMLScalarVolumeNode* node)
+{
+  if (node == this->RightEyeVolumeNodeInternal)
+  {
+    return;
+  }
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLVolumeNode::ImageDataModifiedEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(this->RightEyeVolumeNodeInternal, node, events.GetPointer());
+
+  this->StereoPairing->ClearPendingFrames();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkSlicerVideoPassthroughLogic::GetRightEyeVolumeNode()
+{
+  return this->RightEyeVolumeNodeInternal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::SetStereoVolumeNode(vtkMRMLScalarVolumeNode* node)
+{
+  if (node == this->StereoVolumeNodeInternal)
+  {
+    return;
+  }
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLVolumeNode::ImageDataModifiedEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(this->StereoVolumeNodeInternal, node, events.GetPointer());
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkSlicerVideoPassthroughLogic::GetStereoVolumeNode()
+{
+  return this->StereoVolumeNodeInternal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::SetStereoLayout(int layout)
+{
+  if (layout == this->StereoPairing->GetStereoLayout())
+  {
+    return;
+  }
+  this->StereoPairing->SetStereoLayout(layout);
+  this->StereoPairing->ClearPendingFrames();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerVideoPassthroughLogic::GetStereoLayout()
+{
+  return this->StereoPairing->GetStereoLayout();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerVideoPassthroughLogic::HasVideoSource()
+{
+  if (this->StereoPairing->GetStereoLayout() == vtkVideoPassthroughStereoPairing::SeparateFrames)
+  {
+    return (this->LeftEyeVolumeNodeInternal != nullptr && this->RightEyeVolumeNodeInternal != nullptr);
+  }
+  return (this->StereoVolumeNodeInternal != nullptr);
+}
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughStereoPairing* vtkSlicerVideoPassthroughLogic::GetStereoPairing()
+{
+  return this->StereoPairing;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::SetRenderWindow(vtkRenderWindow* renderWindow)
+{
+  if (renderWindow == this->RenderWindowInternal)
+  {
+    return;
+  }
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkCommand::StartEvent);
+  events->InsertNextValue(vtkCommand::EndEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(this->RenderWindowInternal, renderWindow, events.GetPointer());
+  this->RenderStartTelemetryTime = -1.0;
+
+  // A render requested for the previous window, or while there was none, will never complete
+  // and would absorb every later request. Start over, and show the pair presented so far.
+  this->RenderScheduler->Reset();
+  if (renderWindow != nullptr && this->StereoPairing->GetPresentedTimestamp(vtkVideoPassthroughStereoPairing::LeftEye) >= 0.0)
+  {
+    this->RequestPassthroughRender(vtkTimerLog::GetUniversalTime());
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkRenderWindow* vtkSlicerVideoPassthroughLogic::GetRenderWindow()
+{
+  return this->RenderWindowInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughRenderScheduler* vtkSlicerVideoPassthroughLogic::GetRenderScheduler()
+{
+  return this->RenderScheduler;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerVideoPassthroughLogic::IsRenderPending()
+{
+  return this->RenderScheduler->GetRenderPending();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::RequestPassthroughRender(double now)
+{
+  double delay = 0.0;
+  if (this->RenderScheduler->RequestRender(now, delay))
+  {
+    this->InvokeEvent(RenderRequestedEvent, &delay);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::RecordPassthroughRender(double now)
+{
+  this->RenderScheduler->RecordRender(now);
+
+  for (int eye = 0; eye < vtkVideoPassthroughStereoPairing::Eye_Last; ++eye)
+  {
+    double timestamp = this->StereoPairing->GetPresentedTimestamp(eye);
+    this->EyeFrameAges[eye] = (timestamp >= 0.0 ? now - timestamp : -1.0);
+  }
+
+  this->PublishTelemetry();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerVideoPassthroughLogic::GetPassthroughFrameRate()
+{
+  return this->RenderScheduler->GetAchievedFrameRate();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerVideoPassthroughLogic::GetEyeFrameAge(int eye)
+{
+  if (eye < 0 || eye >= vtkVideoPassthroughStereoPairing::Eye_Last)
+  {
+    vtkErrorMacro("GetEyeFrameAge: invalid eye " << eye);
+    return -1.0;
+  }
+  return this->EyeFrameAges[eye];
+}
+
+//----------------------------------------------------------------------------
+vtkAugmentedRealityTelemetry* vtkSlicerVideoPassthroughLogic::GetTelemetry()
+{
+  return this->Telemetry;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTableNode* vtkSlicerVideoPassthroughLogic::GetTelemetryTableNode()
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (scene == nullptr)
+  {
+    return nullptr;
+  }
+
+  vtkMRMLTableNode* node = vtkMRMLTableNode::SafeDownCast(scene->GetNodeByID(this->TelemetryTableNodeID));
+  if (node == nullptr)
+  {
+    vtkNew<vtkMRMLTableNode> newNode;
+    newNode->SetName(scene->GenerateUniqueName("VideoPassthroughTelemetry").c_str());
+    newNode->SetSaveWithScene(false);
+    scene->AddNode(newNode.GetPointer());
+    this->TelemetryTableNodeID = newNode->GetID();
+    node = newNode.GetPointer();
+  }
+  return node;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerVideoPassthroughLogic::PublishTelemetry()
+{
+  if (!this->Telemetry->UpdateAggregates())
+  {
+    return false;
+  }
+  vtkMRMLTableNode* tableNode = this->GetTelemetryTableNode();
+  if (tableNode == nullptr)
+  {
+    return false;
+  }
+  this->Telemetry->WriteAggregates(tableNode->GetTable());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerVideoPassthroughLogic::WriteTelemetryTrace(const std::string& fileName)
+{
+  return this->Telemetry->WriteChromeTrace(fileName);
 }
 
 //---------------------------------------------------------------------------
@@ -79,6 +347,76 @@ void vtkSlicerVideoPassthroughLogic
 
 //---------------------------------------------------------------------------
 void vtkSlicerVideoPassthroughLogic
-::OnMRMLSceneNodeRemoved(vtkMRMLNode* vtkNotUsed(node))
+::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
 {
+  if (node == nullptr)
+  {
+    return;
+  }
+  if (node == this->LeftEyeVolumeNodeInternal)
+  {
+    this->SetLeftEyeVolumeNode(nullptr);
+  }
+  if (node == this->RightEyeVolumeNodeInternal)
+  {
+    this->SetRightEyeVolumeNode(nullptr);
+  }
+  if (node == this->StereoVolumeNodeInternal)
+  {
+    this->SetStereoVolumeNode(nullptr);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoPassthroughLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  if (caller == this->RenderWindowInternal && event == vtkCommand::StartEvent)
+  {
+    this->RenderStartTelemetryTime = this->Telemetry->GetTime();
+    return;
+  }
+  if (caller == this->RenderWindowInternal && event == vtkCommand::EndEvent)
+  {
+    if (this->RenderStartTelemetryTime >= 0.0)
+    {
+      this->Telemetry->RecordEvent(vtkAugmentedRealityTelemetry::Render, this->RenderStartTelemetryTime, this->Telemetry->GetTime());
+      this->RenderStartTelemetryTime = -1.0;
+    }
+    this->RecordPassthroughRender(vtkTimerLog::GetUniversalTime());
+    return;
+  }
+  if (event != vtkMRMLVolumeNode::ImageDataModifiedEvent)
+  {
+    this->Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+    return;
+  }
+
+  // Volumes carry no acquisition time, frames are stamped on arrival
+  double now = vtkTimerLog::GetUniversalTime();
+  vtkAugmentedRealityTelemetryScope ingestScope(this->Telemetry, vtkAugmentedRealityTelemetry::Ingest);
+  bool packed = (this->StereoPairing->GetStereoLayout() != vtkVideoPassthroughStereoPairing::SeparateFrames);
+  bool presented = false;
+  if (packed)
+  {
+    if (caller == this->StereoVolumeNodeInternal)
+    {
+      // Splitting the packed frame into the eye images is the conversion stage of this pipeline
+      vtkAugmentedRealityTelemetryScope conversionScope(this->Telemetry, vtkAugmentedRealityTelemetry::PixelConversion);
+      presented = this->StereoPairing->PushPackedFrame(this->StereoVolumeNodeInternal->GetImageData(), now);
+    }
+  }
+  else if (caller == this->LeftEyeVolumeNodeInternal)
+  {
+    presented = this->StereoPairing->PushFrame(vtkVideoPassthroughStereoPairing::LeftEye, this->LeftEyeVolumeNodeInternal->GetImageData(), now);
+  }
+  else if (caller == this->RightEyeVolumeNodeInternal)
+  {
+    presented = this->StereoPairing->PushFrame(vtkVideoPassthroughStereoPairing::RightEye, this->RightEyeVolumeNodeInternal->GetImageData(), now);
+  }
+
+  // Only a complete pair is worth a render, a lone eye frame would not change what is shown
+  if (presented)
+  {
+    this->RequestPassthroughRender(now);
+  }
 }
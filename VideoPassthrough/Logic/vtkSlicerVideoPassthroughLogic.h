@@ -27,14 +27,24 @@
 // Slicer includes
 #include "vtkSlicerModuleLogic.h"
 
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkSmartPointer.h>
+
 // MRML includes
 
 // STD includes
 #include <cstdlib>
+#include <string>
 
 #include "vtkSlicerVideoPassthroughModuleLogicExport.h"
 
+class vtkAugmentedRealityTelemetry;
 class vtkMRMLScalarVolumeNode;
+class vtkMRMLTableNode;
+class vtkRenderWindow;
+class vtkVideoPassthroughRenderScheduler;
+class vtkVideoPassthroughStereoPairing;
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
 class VTK_SLICER_VIDEOPASSTHROUGH_MODULE_LOGIC_EXPORT vtkSlicerVideoPassthroughLogic :
@@ -45,6 +55,75 @@ public:
   vtkTypeMacro(vtkSlicerVideoPassthroughLogic, vtkSlicerModuleLogic);
   void PrintSelf(ostream& os, vtkIndent indent);
 
+  enum Events
+  {
+    /// Fired when a new stereo pair needs the passthrough view to render, call data is a double*
+    /// holding the delay in seconds. The observer is expected to render the view once the delay
+    /// elapsed if IsRenderPending() still returns true.
+    RenderRequestedEvent = vtkCommand::UserEvent + 1
+  };
+
+  /// Eye video volumes. Their frames go through the stereo pairing stage, the eye
+  /// textures show its outputs.
+  void SetLeftEyeVolumeNode(vtkMRMLScalarVolumeNode* node);
+  vtkMRMLScalarVolumeNode* GetLeftEyeVolumeNode();
+  void SetRightEyeVolumeNode(vtkMRMLScalarVolumeNode* node);
+  vtkMRMLScalarVolumeNode* GetRightEyeVolumeNode();
+
+  /// Volume packing both eyes in each frame, used instead of the eye volumes when the stereo
+  /// layout is side-by-side or top-bottom
+  void SetStereoVolumeNode(vtkMRMLScalarVolumeNode* node);
+  vtkMRMLScalarVolumeNode* GetStereoVolumeNode();
+
+  /// Where the eye frames come from, see vtkVideoPassthroughStereoPairing::StereoLayout.
+  /// SeparateFrames (the eye volumes) by default.
+  void SetStereoLayout(int layout);
+  int GetStereoLayout();
+
+  /// True if the volumes the current stereo layout needs are set, i.e. passthrough is enabled
+  bool HasVideoSource();
+
+  /// Matches left and right frames by acquisition time and presents them together
+  vtkVideoPassthroughStereoPairing* GetStereoPairing();
+
+  /// Render window of the passthrough view. Its renders are observed to measure the achieved
+  /// frame rate and the frame age, whether the logic requested them or not. Setting it resets
+  /// the render scheduler and requests a render if a pair was already presented.
+  void SetRenderWindow(vtkRenderWindow* renderWindow);
+  vtkRenderWindow* GetRenderWindow();
+
+  /// Rate-limits the renders requested on frame arrival
+  vtkVideoPassthroughRenderScheduler* GetRenderScheduler();
+
+  /// True if a render was requested and the view has not rendered since
+  bool IsRenderPending();
+
+  /// Record a completed render of the passthrough view. Called on the end of each render of
+  /// the render window; views without one (see vtkVideoPassthroughHeadlessView) call it directly.
+  void RecordPassthroughRender(double now);
+
+  /// Renders per second of the passthrough view
+  double GetPassthroughFrameRate();
+
+  /// Seconds between the acquisition of the frame shown in an eye (see
+  /// vtkVideoPassthroughStereoPairing::Eye) and the last render, negative before the first one
+  double GetEyeFrameAge(int eye);
+
+  /// Timing of the passthrough stages: ingest, pixel conversion of packed frames, texture binding
+  /// and render. The eye textures are uploaded and submitted to the headset within the render.
+  vtkAugmentedRealityTelemetry* GetTelemetry();
+
+  /// Table the per-stage aggregates are published to, created in the scene (not saved with it) on first use
+  vtkMRMLTableNode* GetTelemetryTableNode();
+
+  /// Fold the stage timings into aggregates and write them to the telemetry table, once per aggregation
+  /// interval (one second by default). RecordPassthroughRender() calls it. Returns true if the table was updated.
+  bool PublishTelemetry();
+
+  /// Write the buffered stage timings as a Chrome trace, for chrome://tracing or ui.perfetto.dev.
+  /// Returns false if the file cannot be written.
+  bool WriteTelemetryTrace(const std::string& fileName);
+
 protected:
   vtkSlicerVideoPassthroughLogic();
   virtual ~vtkSlicerVideoPassthroughLogic();
@@ -52,6 +131,20 @@ protected:
 protected:
   vtkMRMLScalarVolumeNode* LeftEyeVolumeNodeInternal;
   vtkMRMLScalarVolumeNode* RightEyeVolumeNodeInternal;
+  vtkMRMLScalarVolumeNode* StereoVolumeNodeInternal;
+
+  vtkVideoPassthroughStereoPairing* StereoPairing;
+  vtkVideoPassthroughRenderScheduler* RenderScheduler;
+  vtkRenderWindow* RenderWindowInternal;
+
+  double EyeFrameAges[2];
+
+  vtkSmartPointer<vtkAugmentedRealityTelemetry> Telemetry;
+  std::string TelemetryTableNodeID;
+  // Telemetry time of the start of the current render, negative outside renders
+  double RenderStartTelemetryTime;
+
+  void RequestPassthroughRender(double now);
 
   virtual void SetMRMLSceneInternal(vtkMRMLScene* newScene);
   /// Register MRML Node classes to Scene. Gets called automatically when the MRMLScene is attached to this logic class.
@@ -59,6 +152,8 @@ protected:
   virtual void UpdateFromMRMLScene();
   virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node);
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
+  virtual void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData);
+
 private:
 
   vtkSlicerVideoPassthroughLogic(const vtkSlicerVideoPassthroughLogic&); // Not implemented
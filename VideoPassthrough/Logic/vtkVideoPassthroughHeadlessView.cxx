@@ -0,0 +1,140 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VideoPassthrough Logic includes
+#include "vtkVideoPassthroughHeadlessView.h"
+#include "vtkSlicerVideoPassthroughLogic.h"
+#include "vtkVideoPassthroughStereoPairing.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkVideoPassthroughHeadlessView);
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughHeadlessView::vtkVideoPassthroughHeadlessView()
+  : Logic(nullptr)
+  , RenderRequestedObserverTag(0)
+  , NextRenderTime(-1.0)
+  , NumberOfRenders(0)
+  , NumberOfTextureUploads(0)
+{
+  this->UploadedEyeMTimes[0] = 0;
+  this->UploadedEyeMTimes[1] = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughHeadlessView::~vtkVideoPassthroughHeadlessView()
+{
+  this->SetLogic(nullptr);
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughHeadlessView::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Logic: " << this->Logic << std::endl;
+  os << indent << "NextRenderTime: " << this->NextRenderTime << std::endl;
+  os << indent << "NumberOfRenders: " << this->NumberOfRenders << std::endl;
+  os << indent << "NumberOfTextureUploads: " << this->NumberOfTextureUploads << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughHeadlessView::SetLogic(vtkSlicerVideoPassthroughLogic* logic)
+{
+  if (logic == this->Logic)
+  {
+    return;
+  }
+  if (this->Logic != nullptr)
+  {
+    this->Logic->RemoveObserver(this->RenderRequestedObserverTag);
+    this->Logic->UnRegister(this);
+  }
+  this->Logic = logic;
+  this->NextRenderTime = -1.0;
+  if (this->Logic != nullptr)
+  {
+    this->Logic->Register(this);
+    this->RenderRequestedObserverTag = this->Logic->AddObserver(vtkSlicerVideoPassthroughLogic::RenderRequestedEvent, this, &vtkVideoPassthroughHeadlessView::OnRenderRequested);
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerVideoPassthroughLogic* vtkVideoPassthroughHeadlessView::GetLogic()
+{
+  return this->Logic;
+}
+
+//----------------------------------------------------------------------------
+double vtkVideoPassthroughHeadlessView::GetNextRenderTime()
+{
+  if (this->Logic == nullptr || !this->Logic->IsRenderPending())
+  {
+    return -1.0;
+  }
+  return this->NextRenderTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughHeadlessView::OnRenderRequested(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* callData)
+{
+  double delay = *reinterpret_cast<double*>(callData);
+  this->NextRenderTime = vtkTimerLog::GetUniversalTime() + delay;
+}
+
+//----------------------------------------------------------------------------
+bool vtkVideoPassthroughHeadlessView::ProcessPendingRender(double now)
+{
+  double nextRenderTime = this->GetNextRenderTime();
+  if (nextRenderTime < 0.0 || now < nextRenderTime)
+  {
+    return false;
+  }
+  this->Render(now);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughHeadlessView::Render(double now)
+{
+  if (this->Logic == nullptr)
+  {
+    return;
+  }
+
+  vtkVideoPassthroughStereoPairing* pairing = this->Logic->GetStereoPairing();
+  for (int eye = 0; eye < vtkVideoPassthroughStereoPairing::Eye_Last; ++eye)
+  {
+    // vtkTexture uploads again whenever its input changed since the last upload
+    vtkMTimeType eyeMTime = pairing->GetOutput(eye)->GetMTime();
+    if (eyeMTime > this->UploadedEyeMTimes[eye])
+    {
+      this->UploadedEyeMTimes[eye] = eyeMTime;
+      ++this->NumberOfTextureUploads;
+    }
+  }
+  ++this->NumberOfRenders;
+  this->NextRenderTime = -1.0;
+
+  this->Logic->RecordPassthroughRender(now);
+}
@@ -0,0 +1,87 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkVideoPassthroughHeadlessView - stand-in for the VR render window of the passthrough view
+// .SECTION Description
+// Answers the render requests of vtkSlicerVideoPassthroughLogic the way the module widget
+// does with the headset view, without a headset or a GL context: a requested render is
+// due once its delay elapsed, and rendering consumes the eye outputs of the stereo pairing
+// stage like the eye textures would (an eye is uploaded when its output changed) and
+// reports the render to the logic.
+//
+// The owner polls ProcessPendingRender(), so frame-driven scheduling, the achieved frame
+// rate and the frame age can be exercised headless.
+
+#ifndef __vtkVideoPassthroughHeadlessView_h
+#define __vtkVideoPassthroughHeadlessView_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerVideoPassthroughModuleLogicExport.h"
+
+class vtkSlicerVideoPassthroughLogic;
+
+/// \ingroup Slicer_QtModules_VideoPassthrough
+class VTK_SLICER_VIDEOPASSTHROUGH_MODULE_LOGIC_EXPORT vtkVideoPassthroughHeadlessView : public vtkObject
+{
+public:
+  static vtkVideoPassthroughHeadlessView* New();
+  vtkTypeMacro(vtkVideoPassthroughHeadlessView, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Logic whose render requests this view answers
+  void SetLogic(vtkSlicerVideoPassthroughLogic* logic);
+  vtkSlicerVideoPassthroughLogic* GetLogic();
+
+  /// Time (same clock as vtkTimerLog::GetUniversalTime) the pending render is due at,
+  /// negative if no render is pending
+  double GetNextRenderTime();
+
+  /// Render if a requested render is due. Returns true if the view rendered.
+  bool ProcessPendingRender(double now);
+
+  /// Render unconditionally, like the headset loop does on its own
+  void Render(double now);
+
+  /// Renders, and eye texture uploads they caused
+  vtkGetMacro(NumberOfRenders, unsigned long long);
+  vtkGetMacro(NumberOfTextureUploads, unsigned long long);
+
+protected:
+  vtkVideoPassthroughHeadlessView();
+  virtual ~vtkVideoPassthroughHeadlessView();
+
+  void OnRenderRequested(vtkObject* caller, unsigned long event, void* callData);
+
+protected:
+  vtkSlicerVideoPassthroughLogic* Logic;
+  unsigned long RenderRequestedObserverTag;
+
+  double NextRenderTime;
+  // Modification time of each eye output when it was last uploaded
+  vtkMTimeType UploadedEyeMTimes[2];
+
+  unsigned long long NumberOfRenders;
+  unsigned long long NumberOfTextureUploads;
+
+private:
+  vtkVideoPassthroughHeadlessView(const vtkVideoPassthroughHeadlessView&); // Not implemented
+  void operator=(const vtkVideoPassthroughHeadlessView&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VideoPassthrough Logic includes
+#include "vtkVideoPassthroughRenderScheduler.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkVideoPassthroughRenderScheduler);
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughRenderScheduler::vtkVideoPassthroughRenderScheduler()
+  : MaximumRenderRate(90.0)
+  , FrameRateWindow(1.0)
+  , RenderPending(false)
+  , LastRenderTime(-1.0)
+  , NumberOfScheduledRenders(0)
+  , NumberOfCoalescedRequests(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughRenderScheduler::~vtkVideoPassthroughRenderScheduler()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughRenderScheduler::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "MaximumRenderRate: " << this->MaximumRenderRate << std::endl;
+  os << indent << "FrameRateWindow: " << this->FrameRateWindow << std::endl;
+  os << indent << "RenderPending: " << (this->RenderPending ? "true" : "false") << std::endl;
+  os << indent << "LastRenderTime: " << this->LastRenderTime << std::endl;
+  os << indent << "AchievedFrameRate: " << this->GetAchievedFrameRate() << std::endl;
+  os << indent << "NumberOfScheduledRenders: " << this->NumberOfScheduledRenders << std::endl;
+  os << indent << "NumberOfCoalescedRequests: " << this->NumberOfCoalescedRequests << std::endl;
+}
+
+//----------------------------------------------------------------------------
+bool vtkVideoPassthroughRenderScheduler::RequestRender(double now, double& delay)
+{
+  if (this->RenderPending)
+  {
+    ++this->NumberOfCoalescedRequests;
+    return false;
+  }
+  this->RenderPending = true;
+  ++this->NumberOfScheduledRenders;
+
+  delay = 0.0;
+  if (this->LastRenderTime >= 0.0)
+  {
+    delay = std::max(0.0, this->LastRenderTime + 1.0 / this->MaximumRenderRate - now);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughRenderScheduler::RecordRender(double now)
+{
+  this->RenderPending = false;
+  this->LastRenderTime = now;
+
+  this->RenderTimes.push_back(now);
+  while (!this->RenderTimes.empty() && this->RenderTimes.front() < now - this->FrameRateWindow)
+  {
+    this->RenderTimes.pop_front();
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkVideoPassthroughRenderScheduler::GetAchievedFrameRate()
+{
+  if (this->RenderTimes.size() < 2)
+  {
+    return 0.0;
+  }
+  double span = this->RenderTimes.back() - this->RenderTimes.front();
+  if (span <= 0.0)
+  {
+    return 0.0;
+  }
+  return (this->RenderTimes.size() - 1) / span;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkVideoPassthroughRenderScheduler::GetNumberOfScheduledRenders() const
+{
+  return this->NumberOfScheduledRenders;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkVideoPassthroughRenderScheduler::GetNumberOfCoalescedRequests() const
+{
+  return this->NumberOfCoalescedRequests;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughRenderScheduler::Reset()
+{
+  this->RenderPending = false;
+  this->LastRenderTime = -1.0;
+  this->RenderTimes.clear();
+  this->NumberOfScheduledRenders = 0;
+  this->NumberOfCoalescedRequests = 0;
+}
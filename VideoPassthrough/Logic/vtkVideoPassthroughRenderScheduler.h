@@ -0,0 +1,97 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkVideoPassthroughRenderScheduler - rate-limited render requests driven by frame arrival
+// .SECTION Description
+// Decides when the passthrough view has to render after a new stereo pair was presented.
+// Requests made while a render is pending ride along with it, and renders are spaced by
+// at least 1 / MaximumRenderRate. Completed renders (scheduled or not) are recorded to
+// measure the achieved frame rate.
+//
+// All methods take the current time in seconds, so the scheduling can be driven by a
+// simulated clock.
+
+#ifndef __vtkVideoPassthroughRenderScheduler_h
+#define __vtkVideoPassthroughRenderScheduler_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <deque>
+
+#include "vtkSlicerVideoPassthroughModuleLogicExport.h"
+
+/// \ingroup Slicer_QtModules_VideoPassthrough
+class VTK_SLICER_VIDEOPASSTHROUGH_MODULE_LOGIC_EXPORT vtkVideoPassthroughRenderScheduler : public vtkObject
+{
+public:
+  static vtkVideoPassthroughRenderScheduler* New();
+  vtkTypeMacro(vtkVideoPassthroughRenderScheduler, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Upper bound on scheduled renders per second, 90 (common headset refresh rate) by default
+  vtkSetClampMacro(MaximumRenderRate, double, 1.0, 1000.0);
+  vtkGetMacro(MaximumRenderRate, double);
+
+  /// Seconds of render history the achieved frame rate is averaged over, 1 by default
+  vtkSetClampMacro(FrameRateWindow, double, 0.1, 60.0);
+  vtkGetMacro(FrameRateWindow, double);
+
+  /// Ask for a render. Returns true and the delay in seconds before rendering if a render
+  /// has to be scheduled, false if one is already pending.
+  bool RequestRender(double now, double& delay);
+
+  /// True between a scheduled request and the next completed render
+  vtkGetMacro(RenderPending, bool);
+
+  /// Record a completed render of the view, whoever triggered it
+  void RecordRender(double now);
+
+  /// Renders per second over the last FrameRateWindow seconds, 0 if fewer than two renders
+  double GetAchievedFrameRate();
+
+  /// Time of the last completed render, negative before the first one
+  vtkGetMacro(LastRenderTime, double);
+
+  /// Renders scheduled, and requests absorbed by a pending render
+  unsigned long long GetNumberOfScheduledRenders() const;
+  unsigned long long GetNumberOfCoalescedRequests() const;
+  void Reset();
+
+protected:
+  vtkVideoPassthroughRenderScheduler();
+  virtual ~vtkVideoPassthroughRenderScheduler();
+
+protected:
+  double MaximumRenderRate;
+  double FrameRateWindow;
+
+  bool RenderPending;
+  double LastRenderTime;
+  // Completion times of the renders within FrameRateWindow, oldest first
+  std::deque<double> RenderTimes;
+
+  unsigned long long NumberOfScheduledRenders;
+  unsigned long long NumberOfCoalescedRequests;
+
+private:
+  vtkVideoPassthroughRenderScheduler(const vtkVideoPassthroughRenderScheduler&); // Not implemented
+  void operator=(const vtkVideoPassthroughRenderScheduler&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,352 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VideoPassthrough Logic includes
+#include "vtkVideoPassthroughStereoPairing.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkVideoPassthroughStereoPairing);
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughStereoPairing::vtkVideoPassthroughStereoPairing()
+  : Tolerance(0.010)
+  , MaximumPendingFrames(4)
+  , StereoLayout(SeparateFrames)
+  , NumberOfPresentedPairs(0)
+  , NumberOfUnmatchedFrames(0)
+  , NumberOfLateFrames(0)
+{
+  for (int eye = 0; eye < Eye_Last; ++eye)
+  {
+    this->Outputs[eye] = vtkImageData::New();
+    this->PresentedTimestamps[eye] = -1.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkVideoPassthroughStereoPairing::~vtkVideoPassthroughStereoPairing()
+{
+  for (int eye = 0; eye < Eye_Last; ++eye)
+  {
+    this->Outputs[eye]->Delete();
+    this->Outputs[eye] = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughStereoPairing::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Tolerance: " << this->Tolerance << std::endl;
+  os << indent << "MaximumPendingFrames: " << this->MaximumPendingFrames << std::endl;
+  os << indent << "StereoLayout: " << GetStereoLayoutAsString(this->StereoLayout) << std::endl;
+  os << indent << "PendingFrames: " << this->PendingFrames[LeftEye].size() << " " << this->PendingFrames[RightEye].size() << std::endl;
+  os << indent << "PresentedTimestamps: " << this->PresentedTimestamps[LeftEye] << " " << this->PresentedTimestamps[RightEye] << std::endl;
+  os << indent << "NumberOfPresentedPairs: " << this->NumberOfPresentedPairs << std::endl;
+  os << indent << "NumberOfUnmatchedFrames: " << this->NumberOfUnmatchedFrames << std::endl;
+  os << indent << "NumberOfLateFrames: " << this->NumberOfLateFrames << std::endl;
+}
+
+//----------------------------------------------------------------------------
+bool vtkVideoPassthroughStereoPairing::PushFrame(int eye, vtkImageData* image, double timestamp)
+{
+  if (eye < 0 || eye >= Eye_Last)
+  {
+    vtkErrorMacro("PushFrame: invalid eye " << eye);
+    return false;
+  }
+  vtkDataArray* scalars = (image != nullptr ? image->GetPointData()->GetScalars() : nullptr);
+  if (scalars == nullptr)
+  {
+    return false;
+  }
+
+  if (timestamp <= this->PresentedTimestamps[eye])
+  {
+    // A newer frame of this eye is already on screen, this one can never be presented
+    ++this->NumberOfLateFrames;
+    return false;
+  }
+
+  std::deque<PendingFrame>& pending = this->PendingFrames[eye];
+  if (!pending.empty() && timestamp <= pending.back().Timestamp)
+  {
+    // Out of order, keep the queue sorted by dropping it
+    ++this->NumberOfLateFrames;
+    return false;
+  }
+
+  PendingFrame frame;
+  frame.Image = this->TakeFreeImage();
+  frame.Timestamp = timestamp;
+  frame.Image->CopyStructure(image);
+  // AllocateScalars reuses the array of a recycled image unless an output still shares it
+  frame.Image->AllocateScalars(image->GetScalarType(), image->GetNumberOfScalarComponents());
+  memcpy(frame.Image->GetScalarPointer(), image->GetScalarPointer(), scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents() * scalars->GetDataTypeSize());
+  pending.push_back(frame);
+
+  if (pending.size() > static_cast<size_t>(this->MaximumPendingFrames))
+  {
+    // The other eye stalled, its counterpart is unlikely to come
+    this->ReleaseFrames(eye, pending.size() - this->MaximumPendingFrames, true);
+  }
+
+  size_t leftIndex = 0;
+  size_t rightIndex = 0;
+  if (!this->FindNewestPair(leftIndex, rightIndex))
+  {
+    return false;
+  }
+
+  // Swap both eyes in the same call, the pending images become the outputs by shallow copy
+  for (int pairEye = 0; pairEye < Eye_Last; ++pairEye)
+  {
+    size_t index = (pairEye == LeftEye ? leftIndex : rightIndex);
+    const PendingFrame& presented = this->PendingFrames[pairEye][index];
+    this->Outputs[pairEye]->ShallowCopy(presented.Image);
+    this->PresentedTimestamps[pairEye] = presented.Timestamp;
+
+    // Older frames of the eye lost their chance, the presented one is done
+    this->ReleaseFrames(pairEye, index, true);
+    this->ReleaseFrames(pairEye, 1, false);
+  }
+  ++this->NumberOfPresentedPairs;
+
+  this->InvokeEvent(PairPresentedEvent);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkVideoPassthroughStereoPairing::GetStereoLayoutAsString(int layout)
+{
+  switch (layout)
+  {
+    case SeparateFrames:
+      return "Separate";
+    case SideBySide:
+      return "Side by side";
+    case TopBottom:
+      return "Top-bottom";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkVideoPassthroughStereoPairing::PushPackedFrame(vtkImageData* image, double timestamp)
+{
+  if (this->StereoLayout == SeparateFrames)
+  {
+    vtkErrorMacro("PushPackedFrame: StereoLayout is SeparateFrames, frames have to be pushed per eye");
+    return false;
+  }
+  if (image == nullptr || image->GetPointData()->GetScalars() == nullptr)
+  {
+    return false;
+  }
+  int packedDimension = image->GetDimensions()[this->StereoLayout == SideBySide ? 0 : 1];
+  if (packedDimension % 2 != 0)
+  {
+    vtkErrorMacro("PushPackedFrame: " << GetStereoLayoutAsString(this->StereoLayout) << " frame has an odd "
+      << (this->StereoLayout == SideBySide ? "width" : "height") << " of " << packedDimension << ", it cannot be split in two eyes");
+    return false;
+  }
+  if (timestamp <= this->PresentedTimestamps[LeftEye])
+  {
+    ++this->NumberOfLateFrames;
+    return false;
+  }
+
+  // Nothing to match, anything still queued from separate frames is stale
+  this->ClearPendingFrames();
+
+  this->SplitPackedFrame(image);
+
+  for (int eye = 0; eye < Eye_Last; ++eye)
+  {
+    this->PresentedTimestamps[eye] = timestamp;
+  }
+  ++this->NumberOfPresentedPairs;
+
+  this->InvokeEvent(PairPresentedEvent);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughStereoPairing::SplitPackedFrame(vtkImageData* image)
+{
+  int* dimensions = image->GetDimensions();
+  bool sideBySide = (this->StereoLayout == SideBySide);
+  int eyeWidth = (sideBySide ? dimensions[0] / 2 : dimensions[0]);
+  int eyeHeight = (sideBySide ? dimensions[1] : dimensions[1] / 2);
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  size_t pixelBytes = static_cast<size_t>(scalars->GetNumberOfComponents()) * scalars->GetDataTypeSize();
+  size_t eyeRowBytes = static_cast<size_t>(eyeWidth) * pixelBytes;
+  size_t packedRowBytes = static_cast<size_t>(dimensions[0]) * pixelBytes;
+  size_t packedSliceBytes = packedRowBytes * dimensions[1];
+
+  const unsigned char* packed = static_cast<const unsigned char*>(image->GetScalarPointer());
+  for (int eye = 0; eye < Eye_Last; ++eye)
+  {
+    vtkImageData* output = this->Outputs[eye];
+    output->SetDimensions(eyeWidth, eyeHeight, dimensions[2]);
+    output->SetOrigin(image->GetOrigin());
+    output->SetSpacing(image->GetSpacing());
+    output->AllocateScalars(image->GetScalarType(), image->GetNumberOfScalarComponents());
+
+    // The right eye starts half a row (side-by-side) or half a slice (top-bottom) into each slice
+    size_t eyeOffset = (eye == LeftEye ? 0 : (sideBySide ? eyeRowBytes : packedRowBytes * eyeHeight));
+    unsigned char* eyePixels = static_cast<unsigned char*>(output->GetScalarPointer());
+    for (int slice = 0; slice < dimensions[2]; ++slice)
+    {
+      const unsigned char* packedRow = packed + slice * packedSliceBytes + eyeOffset;
+      for (int row = 0; row < eyeHeight; ++row)
+      {
+        memcpy(eyePixels, packedRow, eyeRowBytes);
+        eyePixels += eyeRowBytes;
+        packedRow += packedRowBytes;
+      }
+    }
+    output->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkVideoPassthroughStereoPairing::FindNewestPair(size_t& leftIndex, size_t& rightIndex)
+{
+  const std::deque<PendingFrame>& left = this->PendingFrames[LeftEye];
+  const std::deque<PendingFrame>& right = this->PendingFrames[RightEye];
+
+  // Queues hold a handful of frames, trying every combination is cheaper than being clever
+  bool found = false;
+  double newestPairTimestamp = 0.0;
+  for (size_t i = left.size(); i-- > 0;)
+  {
+    for (size_t j = right.size(); j-- > 0;)
+    {
+      if (std::abs(left[i].Timestamp - right[j].Timestamp) > this->Tolerance)
+      {
+        continue;
+      }
+      double pairTimestamp = std::min(left[i].Timestamp, right[j].Timestamp);
+      if (!found || pairTimestamp > newestPairTimestamp)
+      {
+        found = true;
+        newestPairTimestamp = pairTimestamp;
+        leftIndex = i;
+        rightIndex = j;
+      }
+    }
+  }
+  return found;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkVideoPassthroughStereoPairing::TakeFreeImage()
+{
+  if (this->FreeImages.empty())
+  {
+    return vtkSmartPointer<vtkImageData>::New();
+  }
+  vtkSmartPointer<vtkImageData> image = this->FreeImages.back();
+  this->FreeImages.pop_back();
+  return image;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughStereoPairing::ReleaseFrames(int eye, size_t count, bool unmatched)
+{
+  std::deque<PendingFrame>& pending = this->PendingFrames[eye];
+  for (size_t i = 0; i < count && !pending.empty(); ++i)
+  {
+    if (unmatched)
+    {
+      ++this->NumberOfUnmatchedFrames;
+    }
+    this->FreeImages.push_back(pending.front().Image);
+    pending.pop_front();
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkVideoPassthroughStereoPairing::GetOutput(int eye)
+{
+  if (eye < 0 || eye >= Eye_Last)
+  {
+    vtkErrorMacro("GetOutput: invalid eye " << eye);
+    return nullptr;
+  }
+  return this->Outputs[eye];
+}
+
+//----------------------------------------------------------------------------
+double vtkVideoPassthroughStereoPairing::GetPresentedTimestamp(int eye)
+{
+  if (eye < 0 || eye >= Eye_Last)
+  {
+    vtkErrorMacro("GetPresentedTimestamp: invalid eye " << eye);
+    return -1.0;
+  }
+  return this->PresentedTimestamps[eye];
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughStereoPairing::ClearPendingFrames()
+{
+  for (int eye = 0; eye < Eye_Last; ++eye)
+  {
+    this->ReleaseFrames(eye, this->PendingFrames[eye].size(), false);
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkVideoPassthroughStereoPairing::GetNumberOfPresentedPairs() const
+{
+  return this->NumberOfPresentedPairs;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkVideoPassthroughStereoPairing::GetNumberOfUnmatchedFrames() const
+{
+  return this->NumberOfUnmatchedFrames;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkVideoPassthroughStereoPairing::GetNumberOfLateFrames() const
+{
+  return this->NumberOfLateFrames;
+}
+
+//----------------------------------------------------------------------------
+void vtkVideoPassthroughStereoPairing::ResetFrameCounts()
+{
+  this->NumberOfPresentedPairs = 0;
+  this->NumberOfUnmatchedFrames = 0;
+  this->NumberOfLateFrames = 0;
+}
@@ -0,0 +1,163 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkVideoPassthroughStereoPairing - pairs left and right eye video frames by acquisition time
+// .SECTION Description
+// Left and right cameras deliver their frames independently, so showing each eye's latest
+// frame mixes frames acquired at different moments. This stage queues a few frames per eye
+// and presents a pair only when a left and a right frame were acquired within Tolerance of
+// each other. Both eye outputs are updated in the same call, a render never sees one eye
+// of a pair without the other.
+//
+// Frames that are discarded without being presented are counted: unmatched frames had no
+// counterpart before a newer pair was presented or the queue overflowed, late frames
+// arrived after a newer frame of the same eye was already presented.
+//
+// Cameras that pack both eyes in one frame are a pair by construction and bypass the
+// queues: PushPackedFrame() presents both halves at once. Each half is copied row by row into
+// its eye output, so the packed image can be modified again as soon as the call returns
+// whatever the layout.
+
+#ifndef __vtkVideoPassthroughStereoPairing_h
+#define __vtkVideoPassthroughStereoPairing_h
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <deque>
+#include <vector>
+
+#include "vtkSlicerVideoPassthroughModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_VideoPassthrough
+class VTK_SLICER_VIDEOPASSTHROUGH_MODULE_LOGIC_EXPORT vtkVideoPassthroughStereoPairing : public vtkObject
+{
+public:
+  static vtkVideoPassthroughStereoPairing* New();
+  vtkTypeMacro(vtkVideoPassthroughStereoPairing, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum Eye
+  {
+    LeftEye = 0,
+    RightEye,
+    Eye_Last
+  };
+
+  enum StereoLayout
+  {
+    /// One frame per eye, pushed with PushFrame()
+    SeparateFrames = 0,
+    /// Left eye in the left half of each row, right eye in the right half
+    SideBySide,
+    /// Left eye in the first half of the rows, right eye in the second half
+    TopBottom,
+    StereoLayout_Last
+  };
+
+  enum Events
+  {
+    /// Fired when a new pair was copied to the outputs
+    PairPresentedEvent = vtkCommand::UserEvent + 1
+  };
+
+  /// Largest difference in seconds between the acquisition times of two frames presented together
+  vtkSetClampMacro(Tolerance, double, 0.0, VTK_DOUBLE_MAX);
+  vtkGetMacro(Tolerance, double);
+
+  /// Frames kept per eye while waiting for a counterpart, the oldest is discarded beyond that
+  vtkSetClampMacro(MaximumPendingFrames, int, 1, 16);
+  vtkGetMacro(MaximumPendingFrames, int);
+
+  /// Copy a frame of one eye, acquired at the given time (seconds), and present the newest
+  /// matched pair if there is one. The image can be modified again as soon as this returns.
+  /// Returns true if a new pair was presented.
+  bool PushFrame(int eye, vtkImageData* image, double timestamp);
+
+  /// How the frames given to PushPackedFrame() hold both eyes, SeparateFrames by default
+  vtkSetClampMacro(StereoLayout, int, SeparateFrames, StereoLayout_Last - 1);
+  vtkGetMacro(StereoLayout, int);
+  static const char* GetStereoLayoutAsString(int layout);
+
+  /// Present both eyes of a packed stereo frame according to StereoLayout. The image can be
+  /// modified again as soon as this returns. Frames whose packed dimension (width for
+  /// side-by-side, height for top-bottom) is odd are rejected with an error.
+  /// Returns true if the pair was presented.
+  bool PushPackedFrame(vtkImageData* image, double timestamp);
+
+  /// Frames of the last presented pair, the background textures read these
+  vtkImageData* GetOutput(int eye);
+
+  /// Acquisition time of the presented frame of an eye, negative before the first pair
+  double GetPresentedTimestamp(int eye);
+
+  /// Discard the pending frames, outputs keep the last presented pair
+  void ClearPendingFrames();
+
+  /// Pairs presented, and frames discarded without being presented
+  unsigned long long GetNumberOfPresentedPairs() const;
+  unsigned long long GetNumberOfUnmatchedFrames() const;
+  unsigned long long GetNumberOfLateFrames() const;
+  void ResetFrameCounts();
+
+protected:
+  vtkVideoPassthroughStereoPairing();
+  virtual ~vtkVideoPassthroughStereoPairing();
+
+  struct PendingFrame
+  {
+    vtkSmartPointer<vtkImageData> Image;
+    double Timestamp;
+  };
+
+  /// Image to copy a new frame into, recycled from discarded frames when possible
+  vtkSmartPointer<vtkImageData> TakeFreeImage();
+  void ReleaseFrames(int eye, size_t count, bool unmatched);
+
+  /// Find the newest left and right frames within tolerance, returns false if there is none
+  bool FindNewestPair(size_t& leftIndex, size_t& rightIndex);
+
+  /// Copy the halves of a packed frame into the eye outputs, each slice is split the same way
+  void SplitPackedFrame(vtkImageData* image);
+
+protected:
+  double Tolerance;
+  int MaximumPendingFrames;
+  int StereoLayout;
+
+  // Oldest first
+  std::deque<PendingFrame> PendingFrames[Eye_Last];
+  std::vector<vtkSmartPointer<vtkImageData> > FreeImages;
+
+  vtkImageData* Outputs[Eye_Last];
+  double PresentedTimestamps[Eye_Last];
+
+  unsigned long long NumberOfPresentedPairs;
+  unsigned long long NumberOfUnmatchedFrames;
+  unsigned long long NumberOfLateFrames;
+
+private:
+  vtkVideoPassthroughStereoPairing(const vtkVideoPassthroughStereoPairing&); // Not implemented
+  void operator=(const vtkVideoPassthroughStereoPairing&); // Not implemented
+};
+
+#endif
@@ -0,0 +1,106 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// VideoPassthrough Logic includes
+#include "vtkSlicerVideoPassthroughLogic.h"
+#include "vtkVideoPassthroughStereoPairing.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkRenderWindow.h>
+#include <vtksys/SystemTools.hxx>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void CountRenderRequest(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eventId), void* clientData, void* vtkNotUsed(callData))
+  {
+    ++(*static_cast<int*>(clientData));
+  }
+
+  //----------------------------------------------------------------------------
+  // Frames are stamped on arrival, space them so that each one is newer than the last
+  void ReceiveFrame(vtkImageData* image)
+  {
+    vtksys::SystemTools::Delay(2);
+    image->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerVideoPassthroughLogicTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerVideoPassthroughLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  int renderRequests = 0;
+  vtkNew<vtkCallbackCommand> renderRequestCounter;
+  renderRequestCounter->SetCallback(CountRenderRequest);
+  renderRequestCounter->SetClientData(&renderRequests);
+  logic->AddObserver(vtkSlicerVideoPassthroughLogic::RenderRequestedEvent, renderRequestCounter.GetPointer());
+
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(4, 2, 1);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkNew<vtkMRMLScalarVolumeNode> stereoVolumeNode;
+  stereoVolumeNode->SetAndObserveImageData(image.GetPointer());
+  scene->AddNode(stereoVolumeNode.GetPointer());
+  logic->SetStereoLayout(vtkVideoPassthroughStereoPairing::SideBySide);
+  logic->SetStereoVolumeNode(stereoVolumeNode.GetPointer());
+  CHECK_BOOL(logic->HasVideoSource(), true);
+
+  // Frames arrive before the passthrough view exists, nothing completes the requested render
+  ReceiveFrame(image.GetPointer());
+  CHECK_INT(renderRequests, 1);
+  CHECK_BOOL(logic->IsRenderPending(), true);
+  ReceiveFrame(image.GetPointer());
+  CHECK_INT(renderRequests, 1);
+
+  // Attaching the view drops the stale request and asks for a render of the presented pair
+  vtkNew<vtkRenderWindow> renderWindow;
+  logic->SetRenderWindow(renderWindow.GetPointer());
+  CHECK_INT(renderRequests, 2);
+  CHECK_BOOL(logic->IsRenderPending(), true);
+
+  // Once the view rendered, the next frame asks for a new render
+  renderWindow->InvokeEvent(vtkCommand::EndEvent);
+  CHECK_BOOL(logic->IsRenderPending(), false);
+  ReceiveFrame(image.GetPointer());
+  CHECK_INT(renderRequests, 3);
+
+  // A pending render of a detached view does not hold back the next view either
+  logic->SetRenderWindow(nullptr);
+  CHECK_BOOL(logic->IsRenderPending(), false);
+  CHECK_INT(renderRequests, 3);
+  ReceiveFrame(image.GetPointer());
+  CHECK_INT(renderRequests, 4);
+  logic->SetRenderWindow(renderWindow.GetPointer());
+  CHECK_INT(renderRequests, 5);
+
+  logic->SetRenderWindow(nullptr);
+  logic->SetStereoVolumeNode(nullptr);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Measure the Slicer startup time added by the VideoPassthrough module.
+
+Starts Slicer repeatedly, without a main window and without the splash screen,
+in three configurations run in turn so that disk caches affect them alike:
+
+  without   VideoPassthrough ignored, the baseline
+  with      VideoPassthrough loaded, it must not build the VirtualReality widget
+  eager     VideoPassthrough loaded and the VirtualReality module widget built,
+            the cost the module used to add at startup
+
+Run it on a workstation without a headset, with this extension installed:
+
+  python3 VideoPassthroughStartupTime.py /path/to/Slicer --repeat 10
+
+The median startup time of each configuration is printed in milliseconds.
+"""
+
+import argparse
+import statistics
+import subprocess
+import sys
+import time
+
+CONFIGURATIONS = [
+  ("without", ["--modules-to-ignore", "VideoPassthrough"]),
+  ("with", []),
+  ("eager", ["--python-code", "slicer.modules.virtualreality.widgetRepresentation()"]),
+]
+
+
+def measure(slicer, arguments):
+  command = [slicer, "--no-splash", "--no-main-window", "--exit-after-startup"] + arguments
+  start = time.perf_counter()
+  subprocess.run(command, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True)
+  return (time.perf_counter() - start) * 1000.0
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument("slicer", help="Slicer launcher")
+  parser.add_argument("--repeat", type=int, default=10, help="startups per configuration (default: 10)")
+  args = parser.parse_args()
+
+  # First start fills the caches, it is not counted
+  measure(args.slicer, [])
+
+  times = {name: [] for name, _ in CONFIGURATIONS}
+  for _ in range(args.repeat):
+    for name, arguments in CONFIGURATIONS:
+      times[name].append(measure(args.slicer, arguments))
+
+  baseline = statistics.median(times["without"])
+  for name, _ in CONFIGURATIONS:
+    median = statistics.median(times[name])
+    print("%-8s median %8.1f ms  min %8.1f ms  added %+7.1f ms" % (name, median, min(times[name]), median - baseline))
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -21,6 +21,7 @@
 // VideoPassthrough includes
 #include "qSlicerVideoPassthroughModule.h"
 #include "qSlicerVideoPassthroughModuleWidget.h"
+#include "qSlicerVideoPassthroughViewBinder.h"
 
 //-----------------------------------------------------------------------------
 #if (QT_VERSION < QT_VERSION_CHECK(5, 0, 0))
@@ -34,6 +35,8 @@ class qSlicerVideoPassthroughModulePrivate
 {
 public:
   qSlicerVideoPassthroughModulePrivate();
+
+  qSlicerVideoPassthroughViewBinder* ViewBinder;
 };
 
 //-----------------------------------------------------------------------------
@@ -41,6 +44,7 @@ public:
 
 //-----------------------------------------------------------------------------
 qSlicerVideoPassthroughModulePrivate::qSlicerVideoPassthroughModulePrivate()
+  : ViewBinder(nullptr)
 {
 }
 
@@ -100,7 +104,14 @@ QStringList qSlicerVideoPassthroughModule::dependencies() const
 //-----------------------------------------------------------------------------
 void qSlicerVideoPassthroughModule::setup()
 {
+  Q_D(qSlicerVideoPassthroughModule);
   this->Superclass::setup();
+
+  // The VR view is looked up when passthrough gets a source or the VR logic changes, never here:
+  // asking for it now would build the VirtualReality widget stack on every startup
+  d->ViewBinder = new qSlicerVideoPassthroughViewBinder(this);
+  d->ViewBinder->setLogic(vtkSlicerVideoPassthroughLogic::SafeDownCast(this->logic()));
+  d->ViewBinder->observeVirtualRealityModule();
 }
 
 //-----------------------------------------------------------------------------
@@ -15,14 +15,6 @@
 
 ==============================================================================*/
 
-// Qt includes
-#include <QDebug>
-
-// Slicer includes
-#include <qSlicerAbstractModuleRepresentation.h>
-#include <qSlicerApplication.h>
-#include <qSlicerModuleManager.h>
-
 // MRML includes
 #include <vtkMRMLScalarVolumeNode.h>
 
@@ -32,21 +24,7 @@
 
 // Local includes
 #include "vtkSlicerVideoPassthroughLogic.h"
-
-// SlicerVirtualReality includes
-#include <qMRMLVirtualRealityView.h>
-#include <qSlicerVirtualRealityModule.h>
-#include <qSlicerVirtualRealityModuleWidget.h>
-
-// VTK includes
-#include <vtkImageData.h>
-#include <vtkTexture.h>
-
-// VTK OpenVR includes
-#include <vtkOpenVRRenderer.h>
-
-// OS includes
-#include <thread>
+#include "vtkVideoPassthroughStereoPairing.h"
 
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_AugmentedReality
@@ -54,21 +32,6 @@ class qSlicerVideoPassthroughModuleWidgetPrivate: public Ui_qSlicerVideoPassthro
 {
 public:
   qSlicerVideoPassthroughModuleWidgetPrivate();
-
-  qMRMLVirtualRealityView* VRView;
-
-  vtkMRMLScalarVolumeNode* LeftEyeNode = nullptr;
-  vtkMRMLScalarVolumeNode* RightEyeNode = nullptr;
-
-  vtkTexture* LeftEyeTexture = vtkTexture::New();
-  vtkTexture* RightEyeTexture = vtkTexture::New();
-
-public:
-  ~qSlicerVideoPassthroughModuleWidgetPrivate()
-  {
-    this->LeftEyeTexture->Delete();
-    this->RightEyeTexture->Delete();
-  }
 };
 
 //-----------------------------------------------------------------------------
@@ -88,16 +51,6 @@ qSlicerVideoPassthroughModuleWidget::qSlicerVideoPassthroughModuleWidget(QWidget
   : Superclass(_parent)
   , d_ptr(new qSlicerVideoPassthroughModuleWidgetPrivate)
 {
-  Q_D(qSlicerVideoPassthroughModuleWidget);
-
-  qSlicerVirtualRealityModule* module = dynamic_cast<qSlicerVirtualRealityModule*>(qSlicerApplication::application()->moduleManager()->module("VirtualReality"));
-  assert(module); // dependency system should have assured us this exists
-
-  // Workaround: find view via findChildren approach as module function is not exported
-  qSlicerVirtualRealityModuleWidget* widget = dynamic_cast<qSlicerVirtualRealityModuleWidget*>(module->widgetRepresentation());
-  assert(widget); // ensure that widget has been created, lazy creation should guarantee this existence
-
-  d->VRView = module->viewWidget();
 }
 
 //-----------------------------------------------------------------------------
@@ -107,57 +60,45 @@ qSlicerVideoPassthroughModuleWidget::~qSlicerVideoPassthroughModuleWidget()
 
   QWidget::disconnect(d->comboBox_leftEye, static_cast<void (qMRMLNodeComboBox::*)(vtkMRMLNode*)>(&qMRMLNodeComboBox::currentNodeChanged), this, &qSlicerVideoPassthroughModuleWidget::onLeftEyeNodeChanged);
   QWidget::disconnect(d->comboBox_rightEye, static_cast<void (qMRMLNodeComboBox::*)(vtkMRMLNode*)>(&qMRMLNodeComboBox::currentNodeChanged), this, &qSlicerVideoPassthroughModuleWidget::onRightEyeNodeChanged);
+  QWidget::disconnect(d->comboBox_stereoVolume, static_cast<void (qMRMLNodeComboBox::*)(vtkMRMLNode*)>(&qMRMLNodeComboBox::currentNodeChanged), this, &qSlicerVideoPassthroughModuleWidget::onStereoVolumeNodeChanged);
 }
 
 //----------------------------------------------------------------------------
 void qSlicerVideoPassthroughModuleWidget::onLeftEyeNodeChanged(vtkMRMLNode* node)
 {
-  Q_D(qSlicerVideoPassthroughModuleWidget);
-
-  vtkMRMLScalarVolumeNode* scalarNode = vtkMRMLScalarVolumeNode::SafeDownCast(node);
-
-  d->LeftEyeNode = scalarNode;
-  if (node != nullptr)
-  {
-    d->LeftEyeTexture->SetInputDataObject(scalarNode->GetImageData());
-  }
-
-  eyeChanged();
+  vtkSlicerVideoPassthroughLogic* logic = vtkSlicerVideoPassthroughLogic::SafeDownCast(this->logic());
+  logic->SetLeftEyeVolumeNode(vtkMRMLScalarVolumeNode::SafeDownCast(node));
 }
 
 //----------------------------------------------------------------------------
 void qSlicerVideoPassthroughModuleWidget::onRightEyeNodeChanged(vtkMRMLNode* node)
 {
-  Q_D(qSlicerVideoPassthroughModuleWidget);
-
-  vtkMRMLScalarVolumeNode* scalarNode = vtkMRMLScalarVolumeNode::SafeDownCast(node);
-
-  d->RightEyeNode = scalarNode;
-  if (node != nullptr)
-  {
-    d->RightEyeTexture->SetInputDataObject(scalarNode->GetImageData());
-  }
+  vtkSlicerVideoPassthroughLogic* logic = vtkSlicerVideoPassthroughLogic::SafeDownCast(this->logic());
+  logic->SetRightEyeVolumeNode(vtkMRMLScalarVolumeNode::SafeDownCast(node));
+}
 
-  eyeChanged();
+//----------------------------------------------------------------------------
+void qSlicerVideoPassthroughModuleWidget::onStereoVolumeNodeChanged(vtkMRMLNode* node)
+{
+  vtkSlicerVideoPassthroughLogic* logic = vtkSlicerVideoPassthroughLogic::SafeDownCast(this->logic());
+  logic->SetStereoVolumeNode(vtkMRMLScalarVolumeNode::SafeDownCast(node));
 }
 
 //----------------------------------------------------------------------------
-void qSlicerVideoPassthroughModuleWidget::eyeChanged()
+void qSlicerVideoPassthroughModuleWidget::onStereoLayoutChanged(int layout)
 {
   Q_D(qSlicerVideoPassthroughModuleWidget);
 
-  if (d->LeftEyeNode != nullptr && d->RightEyeNode != nullptr)
-  {
-    d->VRView->renderer()->SetTexturedBackground(true);
-    d->VRView->renderer()->SetLeftBackgroundTexture(d->LeftEyeTexture);
-    d->VRView->renderer()->SetRightBackgroundTexture(d->RightEyeTexture);
-  }
-  else
-  {
-    d->VRView->renderer()->SetTexturedBackground(false);
-    d->VRView->renderer()->SetLeftBackgroundTexture(nullptr);
-    d->VRView->renderer()->SetRightBackgroundTexture(nullptr);
-  }
+  vtkSlicerVideoPassthroughLogic* logic = vtkSlicerVideoPassthroughLogic::SafeDownCast(this->logic());
+  logic->SetStereoLayout(layout);
+
+  bool packed = (layout != vtkVideoPassthroughStereoPairing::SeparateFrames);
+  d->label_leftEyeSource->setVisible(!packed);
+  d->comboBox_leftEye->setVisible(!packed);
+  d->label_rightEyeSource->setVisible(!packed);
+  d->comboBox_rightEye->setVisible(!packed);
+  d->label_stereoVolumeSource->setVisible(packed);
+  d->comboBox_stereoVolume->setVisible(packed);
 }
 
 //-----------------------------------------------------------------------------
@@ -167,6 +108,15 @@ void qSlicerVideoPassthroughModuleWidget::setup()
   d->setupUi(this);
   this->Superclass::setup();
 
+  for (int layout = 0; layout < vtkVideoPassthroughStereoPairing::StereoLayout_Last; ++layout)
+  {
+    d->comboBox_stereoLayout->addItem(vtkVideoPassthroughStereoPairing::GetStereoLayoutAsString(layout));
+  }
+  d->label_stereoVolumeSource->setVisible(false);
+  d->comboBox_stereoVolume->setVisible(false);
+
+  QWidget::connect(d->comboBox_stereoLayout, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &qSlicerVideoPassthroughModuleWidget::onStereoLayoutChanged);
   QWidget::connect(d->comboBox_leftEye, static_cast<void (qMRMLNodeComboBox::*)(vtkMRMLNode*)>(&qMRMLNodeComboBox::currentNodeChanged), this, &qSlicerVideoPassthroughModuleWidget::onLeftEyeNodeChanged);
   QWidget::connect(d->comboBox_rightEye, static_cast<void (qMRMLNodeComboBox::*)(vtkMRMLNode*)>(&qMRMLNodeComboBox::currentNodeChanged), this, &qSlicerVideoPassthroughModuleWidget::onRightEyeNodeChanged);
+  QWidget::connect(d->comboBox_stereoVolume, static_cast<void (qMRMLNodeComboBox::*)(vtkMRMLNode*)>(&qMRMLNodeComboBox::currentNodeChanged), this, &qSlicerVideoPassthroughModuleWidget::onStereoVolumeNodeChanged);
 }
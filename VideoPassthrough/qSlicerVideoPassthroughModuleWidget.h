@@ -41,9 +41,8 @@ public:
 public slots:
   void onLeftEyeNodeChanged(vtkMRMLNode* node);
   void onRightEyeNodeChanged(vtkMRMLNode* node);
-
-protected:
-  void eyeChanged();
+  void onStereoVolumeNodeChanged(vtkMRMLNode* node);
+  void onStereoLayoutChanged(int layout);
 
 protected:
   QScopedPointer<qSlicerVideoPassthroughModuleWidgetPrivate> d_ptr;
@@ -0,0 +1,333 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+
+// Qt includes
+#include <QPointer>
+#include <QTimer>
+
+// Local includes
+#include "qSlicerVideoPassthroughViewBinder.h"
+
+// VideoPassthrough Logic includes
+#include "vtkSlicerVideoPassthroughLogic.h"
+#include "vtkVideoPassthroughStereoPairing.h"
+
+// Slicer includes
+#include <qSlicerApplication.h>
+#include <qSlicerModuleManager.h>
+
+// MRML includes
+#include <vtkMRMLAbstractLogic.h>
+
+// SlicerVirtualReality includes
+#include <qMRMLVirtualRealityView.h>
+#include <qSlicerVirtualRealityModule.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkTexture.h>
+#include <vtkWeakPointer.h>
+
+// VTK OpenVR includes
+#include <vtkOpenVRRenderWindow.h>
+#include <vtkOpenVRRenderer.h>
+
+//-----------------------------------------------------------------------------
+/// \ingroup Slicer_QtModules_AugmentedReality
+class qSlicerVideoPassthroughViewBinderPrivate
+{
+public:
+  qSlicerVideoPassthroughViewBinderPrivate();
+  ~qSlicerVideoPassthroughViewBinderPrivate();
+
+  /// VirtualReality module, nullptr if it is not loaded
+  static qSlicerVirtualRealityModule* virtualRealityModule();
+
+  vtkWeakPointer<vtkSlicerVideoPassthroughLogic> Logic;
+  unsigned long LogicModifiedObserverTag = 0;
+  unsigned long RenderRequestedObserverTag = 0;
+
+  vtkWeakPointer<vtkMRMLAbstractLogic> VirtualRealityLogic;
+  unsigned long VirtualRealityLogicModifiedObserverTag = 0;
+
+  QPointer<qMRMLVirtualRealityView> VRView;
+
+  vtkTexture* LeftEyeTexture = vtkTexture::New();
+  vtkTexture* RightEyeTexture = vtkTexture::New();
+
+  // Fires when a render requested by the logic on frame arrival is due
+  QTimer* RenderTimer = nullptr;
+
+  // A render was requested while the view could not show the pair, it is issued once the background is bound
+  bool RenderDeferred = false;
+};
+
+//-----------------------------------------------------------------------------
+// qSlicerVideoPassthroughViewBinderPrivate methods
+
+//-----------------------------------------------------------------------------
+qSlicerVideoPassthroughViewBinderPrivate::qSlicerVideoPassthroughViewBinderPrivate()
+{
+}
+
+//-----------------------------------------------------------------------------
+qSlicerVideoPassthroughViewBinderPrivate::~qSlicerVideoPassthroughViewBinderPrivate()
+{
+  this->LeftEyeTexture->Delete();
+  this->RightEyeTexture->Delete();
+}
+
+//-----------------------------------------------------------------------------
+qSlicerVirtualRealityModule* qSlicerVideoPassthroughViewBinderPrivate::virtualRealityModule()
+{
+  if (qSlicerApplication::application() == nullptr || qSlicerApplication::application()->moduleManager() == nullptr)
+  {
+    return nullptr;
+  }
+  return qobject_cast<qSlicerVirtualRealityModule*>(qSlicerApplication::application()->moduleManager()->module("VirtualReality"));
+}
+
+//-----------------------------------------------------------------------------
+// qSlicerVideoPassthroughViewBinder methods
+
+//-----------------------------------------------------------------------------
+qSlicerVideoPassthroughViewBinder::qSlicerVideoPassthroughViewBinder(QObject* _parent)
+  : Superclass(_parent)
+  , d_ptr(new qSlicerVideoPassthroughViewBinderPrivate)
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  // Render the headset view when a new stereo pair arrives, at most at the scheduler rate
+  d->RenderTimer = new QTimer(this);
+  d->RenderTimer->setSingleShot(true);
+  d->RenderTimer->setTimerType(Qt::PreciseTimer);
+  connect(d->RenderTimer, &QTimer::timeout, this, &qSlicerVideoPassthroughViewBinder::onRenderTimerTimeout);
+}
+
+//-----------------------------------------------------------------------------
+qSlicerVideoPassthroughViewBinder::~qSlicerVideoPassthroughViewBinder()
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  if (d->VirtualRealityLogic != nullptr)
+  {
+    d->VirtualRealityLogic->RemoveObserver(d->VirtualRealityLogicModifiedObserverTag);
+  }
+  this->setLogic(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::setLogic(vtkSlicerVideoPassthroughLogic* logic)
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  if (logic == d->Logic)
+  {
+    return;
+  }
+  this->detachView();
+  if (d->Logic != nullptr)
+  {
+    d->Logic->RemoveObserver(d->LogicModifiedObserverTag);
+    d->Logic->RemoveObserver(d->RenderRequestedObserverTag);
+  }
+  d->Logic = logic;
+  if (d->Logic != nullptr)
+  {
+    // Textures show the last matched pair, never the latest frame of each eye on its own
+    d->LeftEyeTexture->SetInputDataObject(d->Logic->GetStereoPairing()->GetOutput(vtkVideoPassthroughStereoPairing::LeftEye));
+    d->RightEyeTexture->SetInputDataObject(d->Logic->GetStereoPairing()->GetOutput(vtkVideoPassthroughStereoPairing::RightEye));
+
+    // The logic is modified when a video source is set or cleared
+    d->LogicModifiedObserverTag = d->Logic->AddObserver(vtkCommand::ModifiedEvent, this, &qSlicerVideoPassthroughViewBinder::onLogicModified);
+    d->RenderRequestedObserverTag = d->Logic->AddObserver(vtkSlicerVideoPassthroughLogic::RenderRequestedEvent, this, &qSlicerVideoPassthroughViewBinder::onRenderRequested);
+  }
+  else
+  {
+    d->LeftEyeTexture->SetInputDataObject(nullptr);
+    d->RightEyeTexture->SetInputDataObject(nullptr);
+  }
+  this->updateView();
+}
+
+//-----------------------------------------------------------------------------
+vtkSlicerVideoPassthroughLogic* qSlicerVideoPassthroughViewBinder::logic() const
+{
+  Q_D(const qSlicerVideoPassthroughViewBinder);
+  return d->Logic;
+}
+
+//-----------------------------------------------------------------------------
+qMRMLVirtualRealityView* qSlicerVideoPassthroughViewBinder::view() const
+{
+  Q_D(const qSlicerVideoPassthroughViewBinder);
+  return d->VRView;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::observeVirtualRealityModule()
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  qSlicerVirtualRealityModule* module = d->virtualRealityModule();
+  vtkMRMLAbstractLogic* virtualRealityLogic = (module != nullptr ? module->logic() : nullptr);
+  if (virtualRealityLogic == d->VirtualRealityLogic)
+  {
+    return;
+  }
+  if (d->VirtualRealityLogic != nullptr)
+  {
+    d->VirtualRealityLogic->RemoveObserver(d->VirtualRealityLogicModifiedObserverTag);
+  }
+  d->VirtualRealityLogic = virtualRealityLogic;
+  if (d->VirtualRealityLogic != nullptr)
+  {
+    // The VR logic is modified when its view node is activated or the headset connects
+    d->VirtualRealityLogicModifiedObserverTag = d->VirtualRealityLogic->AddObserver(vtkCommand::ModifiedEvent, this, &qSlicerVideoPassthroughViewBinder::onVirtualRealityLogicModified);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::updateView()
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  if (d->Logic == nullptr || !d->Logic->HasVideoSource())
+  {
+    // Passthrough is off: leave the VirtualReality module alone
+    this->detachView();
+    return;
+  }
+
+  qSlicerVirtualRealityModule* module = d->virtualRealityModule();
+  qMRMLVirtualRealityView* view = (module != nullptr ? module->viewWidget() : nullptr);
+  if (view != d->VRView)
+  {
+    this->detachView();
+    if (view != nullptr)
+    {
+      this->attachView(view);
+    }
+  }
+  this->updateBackground();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::attachView(qMRMLVirtualRealityView* view)
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  // Detaching modifies the logic, which may have attached the view already
+  if (view == d->VRView)
+  {
+    return;
+  }
+  d->VRView = view;
+  connect(view, &QObject::destroyed, this, &qSlicerVideoPassthroughViewBinder::detachView);
+  d->Logic->SetRenderWindow(view->renderWindow());
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::detachView()
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  d->RenderTimer->stop();
+  d->RenderDeferred = false;
+  if (d->VRView != nullptr)
+  {
+    disconnect(d->VRView, &QObject::destroyed, this, &qSlicerVideoPassthroughViewBinder::detachView);
+    if (d->VRView->renderer() != nullptr)
+    {
+      d->VRView->renderer()->SetTexturedBackground(false);
+      d->VRView->renderer()->SetLeftBackgroundTexture(nullptr);
+      d->VRView->renderer()->SetRightBackgroundTexture(nullptr);
+    }
+  }
+  d->VRView = nullptr;
+
+  // Also reached from the view destruction, once the renderer is gone: only the logic is left to release
+  if (d->Logic != nullptr)
+  {
+    d->Logic->SetRenderWindow(nullptr);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::updateBackground()
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  if (d->VRView == nullptr || d->VRView->renderer() == nullptr)
+  {
+    return;
+  }
+  d->VRView->renderer()->SetTexturedBackground(true);
+  d->VRView->renderer()->SetLeftBackgroundTexture(d->LeftEyeTexture);
+  d->VRView->renderer()->SetRightBackgroundTexture(d->RightEyeTexture);
+
+  // The request is still pending in the logic, the timer renders it
+  if (d->RenderDeferred)
+  {
+    d->RenderDeferred = false;
+    d->RenderTimer->start(0);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::onLogicModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  this->updateView();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::onVirtualRealityLogicModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  // The VirtualReality module creates or deletes its view from its own observers, look once they all ran
+  QTimer::singleShot(0, this, SLOT(updateView()));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::onRenderRequested(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event), void* callData)
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  if (d->VRView == nullptr || d->VRView->renderer() == nullptr)
+  {
+    // Rendered once the view is attached and its background bound, the logic keeps the request pending
+    d->RenderDeferred = true;
+    return;
+  }
+  double delay = *reinterpret_cast<double*>(callData);
+  if (!d->RenderTimer->isActive())
+  {
+    d->RenderTimer->start(static_cast<int>(delay * 1000.0 + 0.5));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoPassthroughViewBinder::onRenderTimerTimeout()
+{
+  Q_D(qSlicerVideoPassthroughViewBinder);
+
+  // The headset loop may have rendered the pair in the meantime
+  if (d->Logic != nullptr && d->Logic->IsRenderPending() && d->VRView != nullptr)
+  {
+    d->VRView->renderWindow()->Render();
+  }
+}
@@ -0,0 +1,83 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qSlicerVideoPassthroughViewBinder_h
+#define __qSlicerVideoPassthroughViewBinder_h
+
+// Qt includes
+#include <QObject>
+
+#include "qSlicerVideoPassthroughModuleExport.h"
+
+class qMRMLVirtualRealityView;
+class qSlicerVideoPassthroughViewBinderPrivate;
+class vtkObject;
+class vtkSlicerVideoPassthroughLogic;
+
+/// \ingroup Slicer_QtModules_AugmentedReality
+/// Attaches the passthrough logic to the VirtualReality view: shows the eye textures in its
+/// background and renders it when a new stereo pair arrives. Owned by the module.
+///
+/// The VirtualReality module is only asked for its view once passthrough has a video source,
+/// and never for its widget representation, so loading the module does not create the VR
+/// widget stack. The view is attached when it comes up and detached when it goes away.
+class Q_SLICER_QTMODULES_VIDEOPASSTHROUGH_EXPORT qSlicerVideoPassthroughViewBinder : public QObject
+{
+  Q_OBJECT
+
+public:
+  typedef QObject Superclass;
+  qSlicerVideoPassthroughViewBinder(QObject* parent = 0);
+  virtual ~qSlicerVideoPassthroughViewBinder();
+
+  /// Passthrough logic bound to the view
+  void setLogic(vtkSlicerVideoPassthroughLogic* logic);
+  vtkSlicerVideoPassthroughLogic* logic() const;
+
+  /// Virtual reality view the logic is attached to, nullptr if detached
+  qMRMLVirtualRealityView* view() const;
+
+  /// Observe the VirtualReality module logic to follow its view coming up and going away.
+  /// Does not create the VirtualReality module widget.
+  void observeVirtualRealityModule();
+
+public slots:
+  /// Attach to the VirtualReality view if passthrough has a source and the view exists,
+  /// detach otherwise
+  void updateView();
+
+protected slots:
+  void onRenderTimerTimeout();
+  void detachView();
+
+protected:
+  void attachView(qMRMLVirtualRealityView* view);
+  void updateBackground();
+
+  void onLogicModified(vtkObject* caller, unsigned long event, void* callData);
+  void onVirtualRealityLogicModified(vtkObject* caller, unsigned long event, void* callData);
+  void onRenderRequested(vtkObject* caller, unsigned long event, void* callData);
+
+protected:
+  QScopedPointer<qSlicerVideoPassthroughViewBinderPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerVideoPassthroughViewBinder);
+  Q_DISABLE_COPY(qSlicerVideoPassthroughViewBinder);
+};
+
+#endif